@@ -1,73 +1,393 @@
 #include "src/utils/osm_parser.hpp"
+#include "src/utils/lanelet_graph.hpp"
+#include "src/utils/osm_cache.hpp"
+#include "src/utils/boundary_writer.hpp"
+#include "src/utils/parallel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
 #include <iostream>
-#include <fstream>
-
-int main() {
-    std::cout << "🔍 OSM to CSV converter for track boundaries..." << std::endl;
-    
-    trajectory_editor::OSMParser parser;
-    
-    // OSMファイルを読み込み
-    if (!parser.loadFromFile("data/lanelet2_map.osm")) {
-        std::cout << "❌ Failed to load OSM file" << std::endl;
-        return 1;
-    }
-    
-    // 境界線データを抽出
-    auto boundaries = parser.extractTrackBoundaries();
-    
-    if (boundaries.empty()) {
-        std::cout << "❌ No track boundaries found in OSM file" << std::endl;
-        return 1;
-    }
-    
-    std::cout << "✅ Found " << boundaries.size() << " lane boundaries" << std::endl;
-    
-    // 全ての境界線を結合
-    std::vector<trajectory_editor::OSMNode> all_left_nodes, all_right_nodes;
-    
-    for (const auto& [left_boundary, right_boundary] : boundaries) {
-        all_left_nodes.insert(all_left_nodes.end(), left_boundary.begin(), left_boundary.end());
-        all_right_nodes.insert(all_right_nodes.end(), right_boundary.begin(), right_boundary.end());
-        
-        std::cout << "  Left: " << left_boundary.size() << " points, Right: " << right_boundary.size() << " points" << std::endl;
-    }
-    
-    std::cout << "🏁 Total combined points - Left: " << all_left_nodes.size() << ", Right: " << all_right_nodes.size() << std::endl;
-    
-    // CSVファイルに出力
-    std::ofstream csv_file("data/track_boundaries.csv");
-    if (!csv_file.is_open()) {
-        std::cout << "❌ Failed to create CSV file" << std::endl;
-        return 1;
-    }
-    
-    // ヘッダー
-    csv_file << "left_x,left_y,left_z,right_x,right_y,right_z" << std::endl;
-    
-    // データ行（左右の点数を合わせる）
-    size_t max_points = std::max(all_left_nodes.size(), all_right_nodes.size());
-    size_t left_size = all_left_nodes.size();
-    size_t right_size = all_right_nodes.size();
-    
-    for (size_t i = 0; i < max_points; ++i) {
-        // 左側の点（足りない場合は最後の点を使用）
-        size_t left_idx = std::min(i, left_size - 1);
-        const auto& left_point = all_left_nodes[left_idx];
-        
-        // 右側の点（足りない場合は最後の点を使用）
-        size_t right_idx = std::min(i, right_size - 1);
-        const auto& right_point = all_right_nodes[right_idx];
-        
-        csv_file << left_point.local_x << "," << left_point.local_y << "," << left_point.elevation << ","
-                 << right_point.local_x << "," << right_point.local_y << "," << right_point.elevation << std::endl;
-    }
-    
-    csv_file.close();
-    
-    std::cout << "✅ CSV file generated: data/track_boundaries.csv" << std::endl;
-    std::cout << "📊 Total rows: " << max_points << std::endl;
-    std::cout << "🎯 Ready to test with trajectory editor!" << std::endl;
-    
-    return 0;
-}
\ No newline at end of file
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+namespace fs = std::filesystem;
+using trajectory_editor::BoundaryFormat;
+using trajectory_editor::BoundaryWriter;
+using trajectory_editor::LaneletFilter;
+using trajectory_editor::LaneletGraph;
+using trajectory_editor::LanePoint;
+using trajectory_editor::OSMCache;
+using trajectory_editor::OSMId;
+using trajectory_editor::OSMParser;
+
+// 終了コード（バッチ処理で失敗した地図があれば 2）
+constexpr int EXIT_OK = 0;
+constexpr int EXIT_USAGE = 1;
+constexpr int EXIT_CONVERT_FAILED = 2;
+
+// 引数なしで実行したときの入出力（以前の固定パス）
+const char* const DEFAULT_INPUT = "data/lanelet2_map.osm";
+const char* const DEFAULT_OUTPUT = "data/track_boundaries.csv";
+
+// コマンドライン引数（--key value 形式のオプションと位置引数。--help だけは値を取らない）
+struct Options {
+    std::vector<std::string> files;
+    std::map<std::string, std::string> values;
+    bool help = false;
+
+    std::string getString(const std::string& key, const std::string& default_value) const {
+        auto it = values.find(key);
+        return it != values.end() ? it->second : default_value;
+    }
+};
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            options.help = true;
+        } else if (arg.rfind("--", 0) == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << std::endl;
+                return false;
+            }
+            options.values[arg.substr(2)] = argv[++i];
+        } else {
+            options.files.push_back(arg);
+        }
+    }
+    return true;
+}
+
+std::vector<std::string> splitList(const std::string& text) {
+    std::vector<std::string> items;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+// --lanelets 1,2,3 と --tag key=value,key=value
+bool parseFilter(const Options& options, LaneletFilter& filter) {
+    for (const auto& item : splitList(options.getString("lanelets", ""))) {
+        OSMId id = 0;
+        auto result = std::from_chars(item.data(), item.data() + item.size(), id);
+        if (result.ec != std::errc() || result.ptr != item.data() + item.size()) {
+            std::cerr << "Invalid lanelet ID: " << item << std::endl;
+            return false;
+        }
+        filter.ids.push_back(id);
+    }
+    std::sort(filter.ids.begin(), filter.ids.end());
+
+    for (const auto& item : splitList(options.getString("tag", ""))) {
+        size_t separator = item.find('=');
+        if (separator == std::string::npos || separator == 0) {
+            std::cerr << "Invalid tag filter (expected key=value): " << item << std::endl;
+            return false;
+        }
+        filter.tags.push_back({item.substr(0, separator), item.substr(separator + 1)});
+    }
+    return true;
+}
+
+// 変換する1つの地図
+struct ConversionJob {
+    std::string input;
+    std::string output;
+};
+
+struct ConversionSettings {
+    LaneletFilter filter;
+    BoundaryFormat format = trajectory_editor::BOUNDARY_FORMAT_CSV;
+    bool use_cache = true;
+    bool parallel_parse = true;   // 1つの地図を複数スレッドで読む（地図単位で並列化するときは切る）
+};
+
+const char* getExtension(BoundaryFormat format) {
+    return format == trajectory_editor::BOUNDARY_FORMAT_BINARY ? ".trkb" : ".csv";
+}
+
+// 入力（ファイルまたはディレクトリ）を地図の一覧にし、出力先を決める
+//
+// 地図が1つなら --output はファイル名（既存のディレクトリならその中）、複数なら出力先の
+// ディレクトリとして扱い、入力ディレクトリからの相対パスを保つ。--output がなければ
+// 各地図の隣に拡張子を変えて書く。
+bool collectJobs(const Options& options, BoundaryFormat format, std::vector<ConversionJob>& jobs) {
+    std::vector<std::string> inputs = options.files;
+    std::string output = options.getString("output", "");
+    if (inputs.empty()) {
+        inputs.push_back(DEFAULT_INPUT);
+        if (output.empty()) {
+            output = DEFAULT_OUTPUT;
+        }
+    }
+
+    // (地図, 出力先での相対パス)
+    std::vector<std::pair<fs::path, fs::path>> maps;
+    for (const auto& input : inputs) {
+        std::error_code error;
+        if (fs::is_directory(input, error)) {
+            std::vector<fs::path> found;
+            for (fs::recursive_directory_iterator it(input, error), end; !error && it != end; it.increment(error)) {
+                if (it->is_regular_file(error) && it->path().extension() == ".osm") {
+                    found.push_back(it->path());
+                }
+            }
+            if (error) {
+                std::cerr << "Failed to read directory " << input << ": " << error.message() << std::endl;
+                return false;
+            }
+            std::sort(found.begin(), found.end());
+            for (const auto& path : found) {
+                maps.push_back({path, path.lexically_relative(input)});
+            }
+        } else {
+            maps.push_back({fs::path(input), fs::path(input).filename()});
+        }
+    }
+    if (maps.empty()) {
+        std::cerr << "No .osm files found" << std::endl;
+        return false;
+    }
+
+    bool single_file = maps.size() == 1 && !fs::is_directory(inputs.front());
+    std::error_code error;
+    bool output_is_directory = !output.empty() &&
+                               (!single_file || output.back() == '/' || fs::is_directory(output, error));
+    if (output_is_directory) {
+        fs::create_directories(output, error);
+        if (error) {
+            std::cerr << "Failed to create output directory " << output << ": " << error.message() << std::endl;
+            return false;
+        }
+    }
+
+    for (const auto& [input, relative] : maps) {
+        ConversionJob job;
+        job.input = input.string();
+        if (output.empty()) {
+            job.output = fs::path(input).replace_extension(getExtension(format)).string();
+        } else if (output_is_directory) {
+            fs::path target = fs::path(output) / fs::path(relative).replace_extension(getExtension(format));
+            fs::create_directories(target.parent_path(), error);
+            job.output = target.string();
+        } else {
+            job.output = output;
+        }
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+// 1つの地図を変換する（ログは地図ごとにまとめて出すので log に書く）
+bool convertMap(const ConversionJob& job, const ConversionSettings& settings, std::ostream& log) {
+    auto start_time = std::chrono::steady_clock::now();
+    log << "🔍 " << job.input << "\n";
+
+    OSMParser parser;
+    parser.setParallel(settings.parallel_parse);
+    OSMCache cache;
+    std::vector<std::pair<LanePoint, LanePoint>> cached_rows;
+
+    // キャッシュが有効ならXMLを読まずに済ませる
+    bool from_cache = settings.use_cache && cache.load(job.input, parser, cached_rows);
+    if (from_cache) {
+        log << "⚡ Loaded from cache " << OSMCache::getCachePath(job.input) << "\n";
+    } else {
+        if (settings.use_cache) {
+            log << "📄 Cache not used: " << cache.getStatus() << "\n";
+        }
+        if (!parser.loadFromFile(job.input)) {
+            log << "❌ Failed to load OSM file: " << parser.getLastError() << "\n";
+            return false;
+        }
+        log << "📄 Parsed " << parser.getNodes().size() << " nodes, " << parser.getWays().size() << " ways, "
+            << parser.getRelations().size() << " relations\n";
+    }
+
+    BoundaryWriter writer;
+    if (from_cache && settings.filter.empty()) {
+        // キャッシュの境界線をそのまま書く
+        if (!writer.open(job.output, settings.format)) {
+            log << "❌ Failed to create " << job.output << "\n";
+            return false;
+        }
+        for (const auto& [left_point, right_point] : cached_rows) {
+            writer.writeRow(left_point, right_point);
+        }
+    } else {
+        // laneletの接続グラフから境界線をつなぐ
+        LaneletGraph graph;
+        graph.build(parser, settings.filter);
+        if (graph.size() == 0) {
+            log << "❌ No track boundaries found in OSM file\n";
+            return false;
+        }
+        log << "✅ Found " << graph.size() << " lanelets\n";
+
+        auto corridors = graph.stitch();
+        for (const auto& corridor : corridors) {
+            log << "  Corridor: " << corridor.lanelets.size() << " lanelets, "
+                << corridor.length << " m, Left: " << corridor.left.size()
+                << " points, Right: " << corridor.right.size() << " points"
+                << (corridor.closed ? " (closed)" : "") << "\n";
+        }
+
+        // 最も長い列をコースとして出力する（出力は左右1本ずつしか持てない）
+        if (corridors.size() > 1) {
+            log << "⚠️  Writing the longest corridor only, skipped " << corridors.size() - 1 << "\n";
+        }
+        if (!writer.open(job.output, settings.format)) {
+            log << "❌ Failed to create " << job.output << "\n";
+            return false;
+        }
+
+        // キャッシュの境界線は地図全体の結果なので、絞り込んだときは保存しない
+        bool save_cache = settings.use_cache && !from_cache && settings.filter.empty();
+        std::vector<std::pair<LanePoint, LanePoint>> rows;
+        LaneletGraph::pairByArcLength(corridors.front(), [&](const LanePoint& left, const LanePoint& right) {
+            writer.writeRow(left, right);
+            if (save_cache) {
+                rows.push_back({left, right});
+            }
+        });
+        if (save_cache && !cache.save(job.input, parser, rows)) {
+            log << "⚠️  Failed to write cache: " << cache.getStatus() << "\n";
+        }
+    }
+
+    uint64_t row_count = writer.getRowCount();
+    if (!writer.close()) {
+        log << "❌ Failed to write " << job.output << "\n";
+        return false;
+    }
+
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+    log << "✅ Generated " << job.output << " (" << row_count << " rows, " << elapsed_ms << " ms)\n";
+    return true;
+}
+
+void printUsage() {
+    std::cout << "Usage: osm_to_csv_converter [options] [inputs...]\n"
+              << "\n"
+              << "Converts the longest lanelet corridor of each Lanelet2 map into left/right\n"
+              << "track boundaries. Inputs are .osm files or directories searched recursively\n"
+              << "(default " << DEFAULT_INPUT << " -> " << DEFAULT_OUTPUT << ").\n"
+              << "\n"
+              << "Options:\n"
+              << "  --output <path>         output file for one map, or output directory\n"
+              << "                          (default: next to each map)\n"
+              << "  --format <csv|binary>   output format (default from the output extension,\n"
+              << "                          .trkb = binary, otherwise csv)\n"
+              << "  --lanelets <id,...>     only use these lanelet relation IDs\n"
+              << "  --tag <key=value,...>   only use lanelets with all of these tags\n"
+              << "  --jobs <n>              maps converted in parallel (default: hardware threads)\n"
+              << "  --cache <on|off>        read and write the <map>.osm.cache sidecar (default on)\n"
+              << "  --help                  show this message\n"
+              << "\n"
+              << "Exit codes: 0 = ok, 1 = usage error, 2 = some maps failed\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return EXIT_USAGE;
+    }
+    if (options.help) {
+        printUsage();
+        return EXIT_OK;
+    }
+
+    ConversionSettings settings;
+    if (!parseFilter(options, settings.filter)) {
+        return EXIT_USAGE;
+    }
+
+    std::string format = options.getString("format", "");
+    if (format == "binary") {
+        settings.format = trajectory_editor::BOUNDARY_FORMAT_BINARY;
+    } else if (format == "csv") {
+        settings.format = trajectory_editor::BOUNDARY_FORMAT_CSV;
+    } else if (format.empty()) {
+        settings.format = BoundaryWriter::formatFromPath(options.getString("output", ""));
+    } else {
+        std::cerr << "Unknown format: " << format << std::endl;
+        printUsage();
+        return EXIT_USAGE;
+    }
+
+    std::string cache_mode = options.getString("cache", "on");
+    if (cache_mode != "on" && cache_mode != "off") {
+        std::cerr << "Invalid --cache value: " << cache_mode << std::endl;
+        return EXIT_USAGE;
+    }
+    settings.use_cache = cache_mode == "on";
+
+    std::vector<ConversionJob> jobs;
+    if (!collectJobs(options, settings.format, jobs)) {
+        return EXIT_USAGE;
+    }
+
+    // 1以上の整数（"-1" は stoul が大きな値に変換してしまうので数字だけを受け付ける）
+    size_t max_jobs = trajectory_editor::getWorkerCount();
+    std::string jobs_text = options.getString("jobs", std::to_string(max_jobs));
+    bool digits_only = !jobs_text.empty() && jobs_text.size() <= 9 &&
+        std::all_of(jobs_text.begin(), jobs_text.end(), [](char c) { return c >= '0' && c <= '9'; });
+    if (digits_only) {
+        max_jobs = std::stoul(jobs_text);
+    }
+    if (!digits_only || max_jobs == 0) {
+        std::cerr << "Invalid --jobs value (expected an integer >= 1)" << std::endl;
+        return EXIT_USAGE;
+    }
+    size_t workers = std::max<size_t>(1, std::min(max_jobs, jobs.size()));
+
+    // 地図単位で並列化するときは地図ごとの並列読み込みを切ってスレッドを取り合わない
+    settings.parallel_parse = workers == 1;
+
+    // 空いたスレッドが次の地図を取る（地図の大きさがばらついても偏らない）
+    auto start_time = std::chrono::steady_clock::now();
+    std::atomic<size_t> next_job{0};
+    std::atomic<size_t> failures{0};
+    std::mutex output_mutex;
+    trajectory_editor::parallelFor(0, workers, 1, [&](size_t begin, size_t end) {
+        for (size_t worker = begin; worker < end; ++worker) {
+            for (size_t i = next_job++; i < jobs.size(); i = next_job++) {
+                std::ostringstream log;
+                bool success = false;
+                try {
+                    success = convertMap(jobs[i], settings, log);
+                } catch (const std::exception& e) {
+                    log << "❌ " << e.what() << "\n";
+                }
+                if (!success) {
+                    ++failures;
+                }
+                std::lock_guard<std::mutex> lock(output_mutex);
+                std::cout << log.str() << std::flush;
+            }
+        }
+    });
+
+    if (jobs.size() > 1) {
+        double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        std::cout << "📊 Converted " << jobs.size() - failures << "/" << jobs.size() << " maps in "
+                  << elapsed_s << " s" << std::endl;
+    }
+    return failures > 0 ? EXIT_CONVERT_FAILED : EXIT_OK;
+}
@@ -0,0 +1,179 @@
+#include "arc_length_index.hpp"
+#include "../utils/trace.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace trajectory_editor {
+
+ArcLengthIndex::ArcLengthIndex()
+    : data_(nullptr), revision_(0), point_count_(0), tree_mask_(0) {}
+
+void ArcLengthIndex::clear() {
+    data_ = nullptr;
+    revision_ = 0;
+    point_count_ = 0;
+    segment_lengths_.clear();
+    tree_.clear();
+    tree_mask_ = 0;
+}
+
+void ArcLengthIndex::build(const TrajectoryData& data) {
+    const auto& points = data.getPoints();
+    data_ = &data;
+    revision_ = data.getRevision();
+    point_count_ = points.size();
+
+    size_t segment_count = point_count_ > 1 ? point_count_ - 1 : 0;
+    segment_lengths_.resize(segment_count);
+    tree_.assign(segment_count + 1, 0.0);
+
+    for (size_t i = 0; i < segment_count; ++i) {
+        segment_lengths_[i] = segmentLength(points[i], points[i + 1]);
+        tree_[i + 1] = segment_lengths_[i];
+    }
+
+    // 線形時間のFenwick木構築
+    for (size_t i = 1; i <= segment_count; ++i) {
+        size_t parent = i + (i & (~i + 1));
+        if (parent <= segment_count) {
+            tree_[parent] += tree_[i];
+        }
+    }
+
+    tree_mask_ = 1;
+    while (tree_mask_ * 2 <= segment_count) {
+        tree_mask_ *= 2;
+    }
+}
+
+void ArcLengthIndex::update(const TrajectoryData& data) {
+    TRACE_ZONE("ArcLengthIndex::update");
+    if (data_ != &data) {
+        build(data);
+        return;
+    }
+
+    TrajectoryChange change = data.getChangesSince(revision_);
+    if (change.none) {
+        return;
+    }
+    if (change.full || change.structural) {
+        build(data);
+        return;
+    }
+
+    revision_ = data.getRevision();
+    if (!change.geometric) {
+        return;  // 速度のみの変更
+    }
+
+    // 点 first..last の移動で影響を受ける区間は first-1 .. last
+    size_t first_segment = change.first > 0 ? change.first - 1 : 0;
+    size_t last_segment = std::min(change.last, segment_lengths_.size() == 0 ? 0 : segment_lengths_.size() - 1);
+    if (segment_lengths_.empty() || first_segment > last_segment) {
+        return;
+    }
+
+    // 広範囲の変更は作り直した方が速い
+    if (last_segment - first_segment + 1 > segment_lengths_.size() / 16) {
+        build(data);
+        return;
+    }
+
+    const auto& points = data.getPoints();
+    for (size_t i = first_segment; i <= last_segment; ++i) {
+        updateSegment(i, segmentLength(points[i], points[i + 1]));
+    }
+}
+
+double ArcLengthIndex::getTotalLength() const {
+    return prefixSum(segment_lengths_.size());
+}
+
+double ArcLengthIndex::getDistanceAt(size_t index) const {
+    return prefixSum(std::min(index, segment_lengths_.size()));
+}
+
+size_t ArcLengthIndex::findIndexAtDistance(double s) const {
+    if (point_count_ == 0 || s <= 0.0) {
+        return 0;
+    }
+
+    // Fenwick木を上位ビットから降りて、累積距離が s 以下となる最大の区間数を求める
+    size_t position = 0;
+    double remaining = s;
+    for (size_t step = tree_mask_; step > 0; step >>= 1) {
+        size_t next = position + step;
+        if (next < tree_.size() && tree_[next] <= remaining) {
+            position = next;
+            remaining -= tree_[next];
+        }
+    }
+    return std::min(position, point_count_ - 1);
+}
+
+size_t ArcLengthIndex::findIndexAtOrAfterDistance(double s) const {
+    size_t index = findIndexAtDistance(s);
+    if (index + 1 < point_count_ && getDistanceAt(index) < s) {
+        ++index;
+    }
+    return index;
+}
+
+bool ArcLengthIndex::interpolate(double s, StationSample& sample) const {
+    if (!data_ || point_count_ == 0 || data_->size() != point_count_) {
+        return false;
+    }
+
+    const auto& points = data_->getPoints();
+    if (point_count_ == 1) {
+        sample = StationSample();
+        sample.x = points[0].x;
+        sample.y = points[0].y;
+        sample.z = points[0].z;
+        sample.velocity = points[0].velocity;
+        return true;
+    }
+
+    double total = getTotalLength();
+    s = std::max(0.0, std::min(s, total));
+
+    size_t segment = std::min(findIndexAtDistance(s), segment_lengths_.size() - 1);
+    double segment_start = getDistanceAt(segment);
+    double length = segment_lengths_[segment];
+    double ratio = length > 0.0 ? (s - segment_start) / length : 0.0;
+    ratio = std::max(0.0, std::min(1.0, ratio));
+
+    const auto& a = points[segment];
+    const auto& b = points[segment + 1];
+    sample.x = a.x + (b.x - a.x) * ratio;
+    sample.y = a.y + (b.y - a.y) * ratio;
+    sample.z = a.z + (b.z - a.z) * ratio;
+    sample.velocity = a.velocity + (b.velocity - a.velocity) * ratio;
+    sample.heading = std::atan2(b.y - a.y, b.x - a.x);
+    sample.segment_index = segment;
+    sample.ratio = ratio;
+    return true;
+}
+
+double ArcLengthIndex::segmentLength(const TrajectoryPoint& a, const TrajectoryPoint& b) {
+    return std::hypot(b.x - a.x, b.y - a.y);
+}
+
+void ArcLengthIndex::updateSegment(size_t segment, double length) {
+    double delta = length - segment_lengths_[segment];
+    segment_lengths_[segment] = length;
+    for (size_t i = segment + 1; i < tree_.size(); i += i & (~i + 1)) {
+        tree_[i] += delta;
+    }
+}
+
+double ArcLengthIndex::prefixSum(size_t count) const {
+    double sum = 0.0;
+    for (size_t i = count; i > 0; i -= i & (~i + 1)) {
+        sum += tree_[i];
+    }
+    return sum;
+}
+
+} // namespace trajectory_editor
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "trajectory_data.hpp"
+#include <vector>
+#include <cstdint>
+
+namespace trajectory_editor {
+
+// 距離（s）における補間結果
+struct StationSample {
+    double x = 0.0;
+    double y = 0.0;
+    double z = 0.0;
+    double velocity = 0.0;
+    double heading = 0.0;       // 進行方向 [rad]（東=0、反時計回り）
+    size_t segment_index = 0;   // 区間の始点インデックス
+    double ratio = 0.0;         // 区間内の位置 [0, 1]
+};
+
+// 累積距離（arc length）のインデックス
+//
+// 区間長をFenwick木で保持し、点の移動は前後2区間の差分更新で済ませる。
+// 距離→インデックスの検索と累積距離の取得はどちらも O(log n)。
+class ArcLengthIndex {
+public:
+    ArcLengthIndex();
+
+    // 構築・更新
+    void build(const TrajectoryData& data);
+    void update(const TrajectoryData& data);  // 前回からの変更分だけ反映
+    void clear();
+
+    // データアクセス
+    size_t size() const { return point_count_; }
+    bool empty() const { return point_count_ == 0; }
+    double getTotalLength() const;
+    double getDistanceAt(size_t index) const;
+    double getSegmentLength(size_t index) const { return segment_lengths_[index]; }
+
+    // 距離 s 以下で最も遠い点のインデックス（sは[0, 全長]にクランプ）
+    size_t findIndexAtDistance(double s) const;
+    // 距離 s 以上で最も近い点のインデックス
+    size_t findIndexAtOrAfterDistance(double s) const;
+
+    // 距離 s における位置・速度・方位の補間
+    bool interpolate(double s, StationSample& sample) const;
+
+private:
+    const TrajectoryData* data_;
+    uint64_t revision_;
+    size_t point_count_;
+    std::vector<double> segment_lengths_;  // segment_lengths_[i] = |p[i+1] - p[i]|
+    std::vector<double> tree_;             // Fenwick木（1始まり）
+    size_t tree_mask_;                     // 検索用の最上位ビット
+
+    static double segmentLength(const TrajectoryPoint& a, const TrajectoryPoint& b);
+    void updateSegment(size_t segment, double length);
+    double prefixSum(size_t count) const;
+};
+
+} // namespace trajectory_editor
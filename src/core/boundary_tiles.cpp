@@ -0,0 +1,232 @@
+#include "boundary_tiles.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace trajectory_editor {
+
+namespace {
+
+// (x0, y0) → (x1, y1)（タイルの大きさ単位の座標）が from から to へ進む途中で通るタイルを
+// 順に visit に渡す（両端のタイルは含まない）。格子線との交点をパラメータ順にたどる
+// （Amanatides-Woo）ので、角をかすめるだけのタイルも落とさない。ちょうど格子点を
+// 通る場合は斜めに進む（隣のタイルとは1点でしか接しない）。
+template <typename Visit>
+void traverseTiles(double x0, double y0, double x1, double y1, TileKey from, TileKey to, Visit&& visit) {
+    const double infinity = std::numeric_limits<double>::infinity();
+    double dx = x1 - x0;
+    double dy = y1 - y0;
+    int step_x = dx > 0.0 ? 1 : (dx < 0.0 ? -1 : 0);
+    int step_y = dy > 0.0 ? 1 : (dy < 0.0 ? -1 : 0);
+    // 次の縦・横の格子線に届くパラメータと、格子1つ分のパラメータ
+    double next_x = step_x > 0 ? (std::floor(x0) + 1.0 - x0) / dx : (step_x < 0 ? (std::floor(x0) - x0) / dx : infinity);
+    double next_y = step_y > 0 ? (std::floor(y0) + 1.0 - y0) / dy : (step_y < 0 ? (std::floor(y0) - y0) / dy : infinity);
+    double delta_x = step_x != 0 ? 1.0 / std::abs(dx) : infinity;
+    double delta_y = step_y != 0 ? 1.0 / std::abs(dy) : infinity;
+
+    // 丸め誤差で to を外れても止まるように、歩数は両端のタイルの距離までにする
+    int64_t steps = std::abs(static_cast<int64_t>(to.x) - from.x) + std::abs(static_cast<int64_t>(to.y) - from.y);
+    TileKey tile = from;
+    for (int64_t k = 0; k < steps; ++k) {
+        if (next_x < next_y) {
+            tile.x += step_x;
+            next_x += delta_x;
+        } else if (next_y < next_x) {
+            tile.y += step_y;
+            next_y += delta_y;
+        } else {
+            tile.x += step_x;
+            tile.y += step_y;
+            next_x += delta_x;
+            next_y += delta_y;
+            ++k;
+        }
+        if (tile == to) {
+            return;
+        }
+        visit(tile);
+    }
+}
+
+} // namespace
+
+BoundaryTileIndex::BoundaryTileIndex()
+    : tile_size_(1.0), min_x_(0.0), max_x_(0.0), min_y_(0.0), max_y_(0.0) {}
+
+void BoundaryTileIndex::clear() {
+    map_.reset();
+    ways_.clear();
+    keys_.clear();
+    offsets_.clear();
+    runs_.clear();
+    min_x_ = max_x_ = min_y_ = max_y_ = 0.0;
+}
+
+TileKey BoundaryTileIndex::tileOf(double x, double y) const {
+    const double limit = static_cast<double>(std::numeric_limits<int32_t>::max());
+    TileKey key;
+    key.x = static_cast<int32_t>(std::max(-limit, std::min(limit, std::floor(x / tile_size_))));
+    key.y = static_cast<int32_t>(std::max(-limit, std::min(limit, std::floor(y / tile_size_))));
+    return key;
+}
+
+void BoundaryTileIndex::build(std::shared_ptr<const OSMParser> map, const std::vector<OSMId>& way_ids,
+                              double tile_size) {
+    clear();
+    if (!map || tile_size <= 0.0) {
+        return;
+    }
+    map_ = std::move(map);
+    tile_size_ = tile_size;
+
+    for (OSMId id : way_ids) {
+        if (const OSMWay* way = map_->findWay(id)) {
+            ways_.push_back(way);
+        }
+    }
+
+    // (タイル, 頂点の範囲) を集めてからタイル順に並べる
+    std::vector<std::pair<TileKey, Run>> entries;
+    bool has_bounds = false;
+    for (uint32_t w = 0; w < ways_.size(); ++w) {
+        const auto& refs = ways_[w]->node_refs;
+        bool in_run = false;
+        Run run{w, 0, 0};
+        TileKey run_tile;
+        const OSMNode* previous = nullptr;
+
+        for (uint32_t i = 0; i < refs.size(); ++i) {
+            const OSMNode* node = map_->findNode(refs[i]);
+            if (!node) {
+                // 地図にない頂点で折れ線を切る
+                if (in_run) {
+                    entries.push_back({run_tile, run});
+                }
+                in_run = false;
+                previous = nullptr;
+                continue;
+            }
+
+            if (!has_bounds) {
+                min_x_ = max_x_ = node->local_x;
+                min_y_ = max_y_ = node->local_y;
+                has_bounds = true;
+            } else {
+                min_x_ = std::min(min_x_, node->local_x);
+                max_x_ = std::max(max_x_, node->local_x);
+                min_y_ = std::min(min_y_, node->local_y);
+                max_y_ = std::max(max_y_, node->local_y);
+            }
+
+            TileKey tile = tileOf(node->local_x, node->local_y);
+            if (!in_run) {
+                in_run = true;
+                run = Run{w, i, i};
+                run_tile = tile;
+            } else if (tile == run_tile) {
+                run.last = i;
+            } else {
+                // タイルを出る線分は両側のタイルに入れる
+                run.last = i;
+                entries.push_back({run_tile, run});
+
+                // 途中で通過するだけのタイル
+                traverseTiles(previous->local_x / tile_size_, previous->local_y / tile_size_,
+                              node->local_x / tile_size_, node->local_y / tile_size_, run_tile, tile,
+                              [&](const TileKey& crossed) { entries.push_back({crossed, Run{w, i - 1, i}}); });
+
+                run = Run{w, i - 1, i};
+                run_tile = tile;
+            }
+            previous = node;
+        }
+        if (in_run) {
+            entries.push_back({run_tile, run});
+        }
+    }
+
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+    runs_.reserve(entries.size());
+    for (const auto& [key, run] : entries) {
+        if (keys_.empty() || !(keys_.back() == key)) {
+            keys_.push_back(key);
+            offsets_.push_back(static_cast<uint32_t>(runs_.size()));
+        }
+        runs_.push_back(run);
+    }
+    offsets_.push_back(static_cast<uint32_t>(runs_.size()));
+}
+
+void BoundaryTileIndex::getBounds(double& min_x, double& max_x, double& min_y, double& max_y) const {
+    min_x = min_x_;
+    max_x = max_x_;
+    min_y = min_y_;
+    max_y = max_y_;
+}
+
+std::vector<TileKey> BoundaryTileIndex::findTiles(double min_x, double min_y, double max_x, double max_y) const {
+    std::vector<TileKey> result;
+    if (keys_.empty() || min_x > max_x || min_y > max_y) {
+        return result;
+    }
+    TileKey low = tileOf(min_x, min_y);
+    TileKey high = tileOf(max_x, max_y);
+
+    // 範囲の列ごとに二分探索する。範囲のほうが索引より広ければ全タイルを調べる
+    uint64_t columns = static_cast<uint64_t>(static_cast<int64_t>(high.x) - low.x + 1);
+    if (columns > keys_.size()) {
+        for (const auto& key : keys_) {
+            if (key.x >= low.x && key.x <= high.x && key.y >= low.y && key.y <= high.y) {
+                result.push_back(key);
+            }
+        }
+        return result;
+    }
+    for (int64_t x = low.x; x <= high.x; ++x) {
+        TileKey first;
+        first.x = static_cast<int32_t>(x);
+        first.y = low.y;
+        for (auto it = std::lower_bound(keys_.begin(), keys_.end(), first);
+             it != keys_.end() && it->x == first.x && it->y <= high.y; ++it) {
+            result.push_back(*it);
+        }
+    }
+    return result;
+}
+
+std::vector<std::vector<BoundaryPoint>> BoundaryTileIndex::decodeTile(const TileKey& key, double min_spacing) const {
+    std::vector<std::vector<BoundaryPoint>> polylines;
+    auto it = std::lower_bound(keys_.begin(), keys_.end(), key);
+    if (it == keys_.end() || !(*it == key)) {
+        return polylines;
+    }
+    size_t tile = static_cast<size_t>(it - keys_.begin());
+    double min_spacing_sq = min_spacing * min_spacing;
+
+    for (uint32_t r = offsets_[tile]; r < offsets_[tile + 1]; ++r) {
+        const Run& run = runs_[r];
+        const auto& refs = ways_[run.way]->node_refs;
+        std::vector<BoundaryPoint> points;
+        for (uint32_t i = run.first; i <= run.last; ++i) {
+            const OSMNode* node = map_->findNode(refs[i]);
+            if (!node) {
+                continue;
+            }
+            if (!points.empty() && i != run.last) {
+                double dx = node->local_x - points.back().x;
+                double dy = node->local_y - points.back().y;
+                if (dx * dx + dy * dy < min_spacing_sq) {
+                    continue;
+                }
+            }
+            points.emplace_back(node->local_x, node->local_y, node->elevation);
+        }
+        if (!points.empty()) {
+            polylines.push_back(std::move(points));
+        }
+    }
+    return polylines;
+}
+
+} // namespace trajectory_editor
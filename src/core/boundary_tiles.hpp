@@ -0,0 +1,69 @@
+#pragma once
+
+#include "track_boundaries.hpp"
+#include "../utils/osm_parser.hpp"
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace trajectory_editor {
+
+// タイルの位置（原点からタイルの大きさ単位で数えた番号）
+struct TileKey {
+    int32_t x = 0;
+    int32_t y = 0;
+
+    bool operator==(const TileKey& other) const { return x == other.x && y == other.y; }
+    bool operator<(const TileKey& other) const { return x != other.x ? x < other.x : y < other.y; }
+};
+
+// 地図上の境界線を正方形のタイルに分けた索引
+//
+// 各タイルは「どのwayのどの頂点の範囲がそのタイルを通るか」だけを持ち、座標は
+// decodeTile() で地図のテーブルから取り出す。表示側は見えているタイルだけを取り出して
+// 描けばよく、地図の大きさに比例するのは索引と地図のテーブルだけになる。
+// タイルをまたぐ線分は通過するすべてのタイルに入るので、どのタイルだけを描いても
+// その範囲の線は欠けない。
+class BoundaryTileIndex {
+public:
+    BoundaryTileIndex();
+
+    // 構築（way_ids の境界線を tile_size [m] のタイルに分ける）
+    void build(std::shared_ptr<const OSMParser> map, const std::vector<OSMId>& way_ids, double tile_size);
+    void clear();
+
+    // データアクセス
+    bool empty() const { return keys_.empty(); }
+    double getTileSize() const { return tile_size_; }
+    size_t getTileCount() const { return keys_.size(); }
+    void getBounds(double& min_x, double& max_x, double& min_y, double& max_y) const;
+
+    // 範囲と交わる、境界線のあるタイル
+    std::vector<TileKey> findTiles(double min_x, double min_y, double max_x, double max_y) const;
+
+    // タイル内の境界線の折れ線。min_spacing > 0 なら直前に残した頂点からそれより近い頂点を
+    // 間引く（各折れ線の両端は残す）。ズームアウト時の描画量を抑える
+    std::vector<std::vector<BoundaryPoint>> decodeTile(const TileKey& key, double min_spacing = 0.0) const;
+
+private:
+    // way の頂点 [first, last] がタイルを通る
+    struct Run {
+        uint32_t way;      // ways_ の添字
+        uint32_t first;
+        uint32_t last;
+    };
+
+    std::shared_ptr<const OSMParser> map_;
+    std::vector<const OSMWay*> ways_;
+    double tile_size_;
+    double min_x_, max_x_, min_y_, max_y_;
+
+    // タイルはキーの昇順。タイル i の範囲は runs_[offsets_[i], offsets_[i + 1])
+    std::vector<TileKey> keys_;
+    std::vector<uint32_t> offsets_;
+    std::vector<Run> runs_;
+
+    TileKey tileOf(double x, double y) const;
+};
+
+} // namespace trajectory_editor
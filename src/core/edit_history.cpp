@@ -1,5 +1,9 @@
 #include "edit_history.hpp"
+#include "../utils/memory_usage.hpp"
+#include "../utils/trace.hpp"
+#include <algorithm>
 #include <sstream>
+#include <stdexcept>
 
 namespace trajectory_editor {
 
@@ -21,6 +25,10 @@ std::string MovePointCommand::getDescription() const {
     return oss.str();
 }
 
+size_t MovePointCommand::getMemoryUsage() const {
+    return sizeof(*this);
+}
+
 // AddPointCommand implementation
 AddPointCommand::AddPointCommand(size_t index, const TrajectoryPoint& point)
     : index_(index), point_(point) {}
@@ -39,16 +47,21 @@ std::string AddPointCommand::getDescription() const {
     return oss.str();
 }
 
+size_t AddPointCommand::getMemoryUsage() const {
+    return sizeof(*this);
+}
+
 // RemovePointCommand implementation
 RemovePointCommand::RemovePointCommand(size_t index, const TrajectoryPoint& point)
     : index_(index), point_(point) {}
 
 void RemovePointCommand::execute(TrajectoryData& data) {
+    extra_columns_ = data.getExtraColumns(index_, index_);
     data.removePoint(index_);
 }
 
 void RemovePointCommand::undo(TrajectoryData& data) {
-    data.insertPoint(index_, point_);
+    data.insertRange(index_, {point_}, &extra_columns_);
 }
 
 std::string RemovePointCommand::getDescription() const {
@@ -57,6 +70,10 @@ std::string RemovePointCommand::getDescription() const {
     return oss.str();
 }
 
+size_t RemovePointCommand::getMemoryUsage() const {
+    return sizeof(*this) + stringTableBytes(extra_columns_);
+}
+
 // ChangeVelocityCommand implementation
 ChangeVelocityCommand::ChangeVelocityCommand(size_t index, double old_velocity, double new_velocity)
     : index_(index), old_velocity_(old_velocity), new_velocity_(new_velocity) {}
@@ -85,6 +102,10 @@ std::string ChangeVelocityCommand::getDescription() const {
     return oss.str();
 }
 
+size_t ChangeVelocityCommand::getMemoryUsage() const {
+    return sizeof(*this);
+}
+
 // ChangeRangeVelocityCommand implementation
 ChangeRangeVelocityCommand::ChangeRangeVelocityCommand(size_t start_index, size_t end_index,
                                                       const std::vector<double>& old_velocities, double new_velocity)
@@ -112,10 +133,251 @@ std::string ChangeRangeVelocityCommand::getDescription() const {
     return oss.str();
 }
 
+size_t ChangeRangeVelocityCommand::getMemoryUsage() const {
+    return sizeof(*this) + old_velocities_.capacity() * sizeof(double);
+}
+
+// SetVelocitiesCommand implementation
+SetVelocitiesCommand::SetVelocitiesCommand(size_t start_index, std::vector<double> old_velocities,
+                                           std::vector<double> new_velocities, std::string description)
+    : start_index_(start_index), old_velocities_(std::move(old_velocities)),
+      new_velocities_(std::move(new_velocities)), description_(std::move(description)) {}
+
+void SetVelocitiesCommand::execute(TrajectoryData& data) {
+    data.setVelocities(start_index_, new_velocities_);
+}
+
+void SetVelocitiesCommand::undo(TrajectoryData& data) {
+    data.setVelocities(start_index_, old_velocities_);
+}
+
+std::string SetVelocitiesCommand::getDescription() const {
+    if (!description_.empty()) {
+        return description_;
+    }
+    std::ostringstream oss;
+    oss << "Change velocities " << start_index_ << "-" << (start_index_ + new_velocities_.size() - 1);
+    return oss.str();
+}
+
+size_t SetVelocitiesCommand::getMemoryUsage() const {
+    return sizeof(*this) + (old_velocities_.capacity() + new_velocities_.capacity()) * sizeof(double) +
+           stringHeapBytes(description_);
+}
+
+// InsertRangeCommand implementation
+InsertRangeCommand::InsertRangeCommand(size_t index, std::vector<TrajectoryPoint> points)
+    : index_(index), points_(std::move(points)) {}
+
+void InsertRangeCommand::execute(TrajectoryData& data) {
+    data.insertRange(index_, points_);
+}
+
+void InsertRangeCommand::undo(TrajectoryData& data) {
+    if (!points_.empty()) {
+        data.removeRange(index_, index_ + points_.size() - 1);
+    }
+}
+
+std::string InsertRangeCommand::getDescription() const {
+    std::ostringstream oss;
+    oss << "Insert " << points_.size() << " points at " << index_;
+    return oss.str();
+}
+
+size_t InsertRangeCommand::getMemoryUsage() const {
+    return sizeof(*this) + points_.capacity() * sizeof(TrajectoryPoint);
+}
+
+// SpliceRangeCommand implementation
+SpliceRangeCommand::SpliceRangeCommand(size_t index, const TrajectoryData& source,
+                                       size_t source_start, size_t source_end)
+    : index_(index), count_(source_end >= source_start ? source_end - source_start + 1 : 0),
+      source_(&source), source_start_(source_start) {
+    if (source_start >= source.size() || source_end >= source.size() || source_start > source_end) {
+        throw std::out_of_range("Invalid source range");
+    }
+}
+
+void SpliceRangeCommand::execute(TrajectoryData& data) {
+    if (source_) {
+        data.spliceFrom(*source_, source_start_, source_start_ + count_ - 1, index_);
+        source_ = nullptr;
+        return;
+    }
+    data.insertRange(index_, points_, &extra_columns_);
+    points_ = std::vector<TrajectoryPoint>();
+    extra_columns_ = std::vector<std::vector<std::string>>();
+}
+
+void SpliceRangeCommand::undo(TrajectoryData& data) {
+    size_t last = index_ + count_ - 1;
+    points_ = data.getRange(index_, last);
+    extra_columns_ = data.getExtraColumns(index_, last);
+    data.removeRange(index_, last);
+}
+
+std::string SpliceRangeCommand::getDescription() const {
+    std::ostringstream oss;
+    oss << "Import " << count_ << " points at " << index_;
+    return oss.str();
+}
+
+size_t SpliceRangeCommand::getMemoryUsage() const {
+    return sizeof(*this) + points_.capacity() * sizeof(TrajectoryPoint) + stringTableBytes(extra_columns_);
+}
+
+// RemoveRangeCommand implementation
+RemoveRangeCommand::RemoveRangeCommand(size_t start_index, std::vector<TrajectoryPoint> removed_points)
+    : start_index_(start_index), removed_points_(std::move(removed_points)) {}
+
+void RemoveRangeCommand::execute(TrajectoryData& data) {
+    if (!removed_points_.empty()) {
+        size_t end_index = start_index_ + removed_points_.size() - 1;
+        removed_extra_columns_ = data.getExtraColumns(start_index_, end_index);
+        data.removeRange(start_index_, end_index);
+    }
+}
+
+void RemoveRangeCommand::undo(TrajectoryData& data) {
+    data.insertRange(start_index_, removed_points_, &removed_extra_columns_);
+}
+
+std::string RemoveRangeCommand::getDescription() const {
+    std::ostringstream oss;
+    oss << "Remove points " << start_index_ << "-" << (start_index_ + removed_points_.size() - 1);
+    return oss.str();
+}
+
+size_t RemoveRangeCommand::getMemoryUsage() const {
+    return sizeof(*this) + removed_points_.capacity() * sizeof(TrajectoryPoint) +
+           stringTableBytes(removed_extra_columns_);
+}
+
+// ReplaceRangeCommand implementation
+ReplaceRangeCommand::ReplaceRangeCommand(size_t start_index, std::vector<TrajectoryPoint> old_points,
+                                         std::vector<TrajectoryPoint> new_points, std::string description)
+    : start_index_(start_index), old_points_(std::move(old_points)), new_points_(std::move(new_points)),
+      description_(std::move(description)) {}
+
+void ReplaceRangeCommand::execute(TrajectoryData& data) {
+    if (!old_points_.empty()) {
+        old_extra_columns_ = data.getExtraColumns(start_index_, start_index_ + old_points_.size() - 1);
+    }
+    apply(data, start_index_, old_points_, new_points_, nullptr);
+}
+
+void ReplaceRangeCommand::undo(TrajectoryData& data) {
+    apply(data, start_index_, new_points_, old_points_, &old_extra_columns_);
+}
+
+std::string ReplaceRangeCommand::getDescription() const {
+    if (!description_.empty()) {
+        return description_;
+    }
+    std::ostringstream oss;
+    oss << "Replace " << old_points_.size() << " points at " << start_index_;
+    return oss.str();
+}
+
+size_t ReplaceRangeCommand::getMemoryUsage() const {
+    return sizeof(*this) + (old_points_.capacity() + new_points_.capacity()) * sizeof(TrajectoryPoint) +
+           stringTableBytes(old_extra_columns_) + stringHeapBytes(description_);
+}
+
+void ReplaceRangeCommand::apply(TrajectoryData& data, size_t start_index,
+                                const std::vector<TrajectoryPoint>& from, const std::vector<TrajectoryPoint>& to,
+                                const std::vector<std::vector<std::string>>* to_extra_columns) {
+    if (from.empty()) {
+        data.insertRange(start_index, to, to_extra_columns);
+    } else {
+        data.replaceRange(start_index, start_index + from.size() - 1, to, to_extra_columns);
+    }
+}
+
+// ResampleCommand implementation
+ResampleCommand::ResampleCommand(size_t start_index, std::vector<TrajectoryPoint> old_points,
+                                 std::vector<TrajectoryPoint> new_points, double spacing)
+    : start_index_(start_index), old_count_(old_points.size()), new_count_(new_points.size()),
+      spacing_(spacing), replace_(start_index, std::move(old_points), std::move(new_points)),
+      orientation_first_(0) {}
+
+void ResampleCommand::execute(TrajectoryData& data) {
+    // 計算し直す範囲の元の列を残す（範囲外の前後1点は置換では戻らない）
+    size_t first = 0;
+    size_t last = 0;
+    old_extra_columns_.clear();
+    if (getOrientationRange(data, start_index_, old_count_, first, last)) {
+        orientation_first_ = first;
+        old_extra_columns_ = data.getExtraColumns(first, last);
+    }
+    
+    replace_.execute(data);
+    if (getOrientationRange(data, start_index_, new_count_, first, last)) {
+        data.updateOrientations(first, last);
+    }
+}
+
+void ResampleCommand::undo(TrajectoryData& data) {
+    replace_.undo(data);
+    data.setExtraColumns(orientation_first_, old_extra_columns_);
+}
+
+std::string ResampleCommand::getDescription() const {
+    std::ostringstream oss;
+    oss << "Resample points " << start_index_ << "-" << (start_index_ + old_count_ - 1)
+        << " at " << spacing_ << " m";
+    return oss.str();
+}
+
+size_t ResampleCommand::getMemoryUsage() const {
+    return sizeof(*this) - sizeof(replace_) + replace_.getMemoryUsage() + stringTableBytes(old_extra_columns_);
+}
+
+bool ResampleCommand::getOrientationRange(const TrajectoryData& data, size_t start_index, size_t count,
+                                          size_t& first, size_t& last) {
+    if (!data.hasOrientation() || count == 0 || data.empty()) {
+        return false;
+    }
+    // 範囲の前後1点も進行方向が変わる
+    first = start_index > 0 ? start_index - 1 : 0;
+    last = std::min(start_index + count, data.size() - 1);
+    return true;
+}
+
+// CompositeCommand implementation
+CompositeCommand::CompositeCommand(std::vector<std::unique_ptr<EditCommand>> commands)
+    : commands_(std::move(commands)) {}
+
+void CompositeCommand::execute(TrajectoryData& data) {
+    for (auto& command : commands_) {
+        command->execute(data);
+    }
+}
+
+void CompositeCommand::undo(TrajectoryData& data) {
+    for (auto it = commands_.rbegin(); it != commands_.rend(); ++it) {
+        (*it)->undo(data);
+    }
+}
+
+std::string CompositeCommand::getDescription() const {
+    return commands_.empty() ? std::string() : commands_.front()->getDescription();
+}
+
+size_t CompositeCommand::getMemoryUsage() const {
+    size_t bytes = sizeof(*this) + commands_.capacity() * sizeof(commands_[0]);
+    for (const auto& command : commands_) {
+        bytes += command->getMemoryUsage();
+    }
+    return bytes;
+}
+
 // EditHistory implementation
 EditHistory::EditHistory() : current_index_(0), max_history_size_(50) {}
 
 void EditHistory::executeCommand(std::unique_ptr<EditCommand> command, TrajectoryData& data) {
+    TRACE_ZONE("EditHistory::executeCommand");
     // 現在の位置以降のコマンドを削除（redo履歴をクリア）
     commands_.erase(commands_.begin() + current_index_, commands_.end());
     
@@ -130,7 +392,23 @@ void EditHistory::executeCommand(std::unique_ptr<EditCommand> command, Trajector
     trimHistory();
 }
 
+void EditHistory::mergeIntoLastCommand(std::unique_ptr<EditCommand> command, TrajectoryData& data) {
+    if (!canUndo()) {
+        executeCommand(std::move(command), data);
+        return;
+    }
+    TRACE_ZONE("EditHistory::mergeIntoLastCommand");
+    commands_.erase(commands_.begin() + current_index_, commands_.end());
+    command->execute(data);
+    
+    std::vector<std::unique_ptr<EditCommand>> merged;
+    merged.push_back(std::move(commands_.back()));
+    merged.push_back(std::move(command));
+    commands_.back() = std::make_unique<CompositeCommand>(std::move(merged));
+}
+
 void EditHistory::undo(TrajectoryData& data) {
+    TRACE_ZONE("EditHistory::undo");
     if (canUndo()) {
         --current_index_;
         commands_[current_index_]->undo(data);
@@ -138,6 +416,7 @@ void EditHistory::undo(TrajectoryData& data) {
 }
 
 void EditHistory::redo(TrajectoryData& data) {
+    TRACE_ZONE("EditHistory::redo");
     if (canRedo()) {
         commands_[current_index_]->execute(data);
         ++current_index_;
@@ -171,6 +450,14 @@ std::string EditHistory::getRedoDescription() const {
     return "";
 }
 
+size_t EditHistory::getMemoryUsage() const {
+    size_t bytes = commands_.capacity() * sizeof(commands_[0]);
+    for (const auto& command : commands_) {
+        bytes += command->getMemoryUsage();
+    }
+    return bytes;
+}
+
 void EditHistory::trimHistory() {
     if (commands_.size() > max_history_size_) {
         size_t excess = commands_.size() - max_history_size_;
@@ -14,6 +14,7 @@ public:
     virtual void execute(TrajectoryData& data) = 0;
     virtual void undo(TrajectoryData& data) = 0;
     virtual std::string getDescription() const = 0;
+    virtual size_t getMemoryUsage() const = 0;  // コマンドが保持しているデータの大きさ [bytes]
 };
 
 // 点移動コマンド
@@ -23,6 +24,7 @@ public:
     void execute(TrajectoryData& data) override;
     void undo(TrajectoryData& data) override;
     std::string getDescription() const override;
+    size_t getMemoryUsage() const override;
 
 private:
     size_t index_;
@@ -36,6 +38,7 @@ public:
     void execute(TrajectoryData& data) override;
     void undo(TrajectoryData& data) override;
     std::string getDescription() const override;
+    size_t getMemoryUsage() const override;
 
 private:
     size_t index_;
@@ -49,10 +52,12 @@ public:
     void execute(TrajectoryData& data) override;
     void undo(TrajectoryData& data) override;
     std::string getDescription() const override;
+    size_t getMemoryUsage() const override;
 
 private:
     size_t index_;
     TrajectoryPoint point_;
+    std::vector<std::vector<std::string>> extra_columns_;  // 削除した行の8列形式の元の列（実行時に保持）
 };
 
 // 速度変更コマンド
@@ -62,6 +67,7 @@ public:
     void execute(TrajectoryData& data) override;
     void undo(TrajectoryData& data) override;
     std::string getDescription() const override;
+    size_t getMemoryUsage() const override;
 
 private:
     size_t index_;
@@ -76,6 +82,7 @@ public:
     void execute(TrajectoryData& data) override;
     void undo(TrajectoryData& data) override;
     std::string getDescription() const override;
+    size_t getMemoryUsage() const override;
 
 private:
     size_t start_index_, end_index_;
@@ -83,6 +90,132 @@ private:
     double new_velocity_;
 };
 
+// 点ごとの速度一括変更コマンド（速度プロファイルの適用など）
+class SetVelocitiesCommand : public EditCommand {
+public:
+    SetVelocitiesCommand(size_t start_index, std::vector<double> old_velocities,
+                         std::vector<double> new_velocities, std::string description = "");
+    void execute(TrajectoryData& data) override;
+    void undo(TrajectoryData& data) override;
+    std::string getDescription() const override;
+    size_t getMemoryUsage() const override;
+
+private:
+    size_t start_index_;
+    std::vector<double> old_velocities_;
+    std::vector<double> new_velocities_;
+    std::string description_;
+};
+
+// 範囲挿入コマンド
+class InsertRangeCommand : public EditCommand {
+public:
+    InsertRangeCommand(size_t index, std::vector<TrajectoryPoint> points);
+    void execute(TrajectoryData& data) override;
+    void undo(TrajectoryData& data) override;
+    std::string getDescription() const override;
+    size_t getMemoryUsage() const override;
+
+private:
+    size_t index_;
+    std::vector<TrajectoryPoint> points_;
+};
+
+// 別の軌跡の範囲を挿入するコマンド（8列形式どうしなら姿勢列も取り込む）
+//
+// 最初の実行は TrajectoryData::spliceFrom で挿入元から直接コピーする（source はそれまで
+// 有効であること）。点列を持つのは取り消した後だけで、取り消すときに挿入した行を
+// 退避し、やり直しではそれを戻して手放す。
+class SpliceRangeCommand : public EditCommand {
+public:
+    SpliceRangeCommand(size_t index, const TrajectoryData& source, size_t source_start, size_t source_end);
+    void execute(TrajectoryData& data) override;
+    void undo(TrajectoryData& data) override;
+    std::string getDescription() const override;
+    size_t getMemoryUsage() const override;
+
+private:
+    size_t index_;
+    size_t count_;
+    const TrajectoryData* source_;  // 最初の実行まで
+    size_t source_start_;
+    std::vector<TrajectoryPoint> points_;                  // 取り消した行（やり直し用）
+    std::vector<std::vector<std::string>> extra_columns_;  // 取り消した行の8列形式の元の列（なければ空）
+};
+
+// 範囲削除コマンド
+class RemoveRangeCommand : public EditCommand {
+public:
+    RemoveRangeCommand(size_t start_index, std::vector<TrajectoryPoint> removed_points);
+    void execute(TrajectoryData& data) override;
+    void undo(TrajectoryData& data) override;
+    std::string getDescription() const override;
+    size_t getMemoryUsage() const override;
+
+private:
+    size_t start_index_;
+    std::vector<TrajectoryPoint> removed_points_;
+    std::vector<std::vector<std::string>> removed_extra_columns_;  // 8列形式の元の列（実行時に保持）
+};
+
+// 範囲置換コマンド（点数が変わってもよい）
+class ReplaceRangeCommand : public EditCommand {
+public:
+    ReplaceRangeCommand(size_t start_index, std::vector<TrajectoryPoint> old_points,
+                        std::vector<TrajectoryPoint> new_points, std::string description = "");
+    void execute(TrajectoryData& data) override;
+    void undo(TrajectoryData& data) override;
+    std::string getDescription() const override;
+    size_t getMemoryUsage() const override;
+
+private:
+    size_t start_index_;
+    std::vector<TrajectoryPoint> old_points_;
+    std::vector<TrajectoryPoint> new_points_;
+    std::vector<std::vector<std::string>> old_extra_columns_;  // 置換前の8列形式の元の列（実行時に保持）
+    std::string description_;
+    
+    static void apply(TrajectoryData& data, size_t start_index,
+                      const std::vector<TrajectoryPoint>& from, const std::vector<TrajectoryPoint>& to,
+                      const std::vector<std::vector<std::string>>* to_extra_columns);
+};
+
+// 等間隔リサンプリング（点列を置き換え、8列形式なら姿勢も計算し直す。取り消しでは元の姿勢に戻す）
+class ResampleCommand : public EditCommand {
+public:
+    ResampleCommand(size_t start_index, std::vector<TrajectoryPoint> old_points,
+                    std::vector<TrajectoryPoint> new_points, double spacing);
+    void execute(TrajectoryData& data) override;
+    void undo(TrajectoryData& data) override;
+    std::string getDescription() const override;
+    size_t getMemoryUsage() const override;
+
+private:
+    size_t start_index_;
+    size_t old_count_;
+    size_t new_count_;
+    double spacing_;
+    ReplaceRangeCommand replace_;
+    size_t orientation_first_;  // 姿勢を計算し直す前後1点を含む範囲の先頭
+    std::vector<std::vector<std::string>> old_extra_columns_;  // その範囲の元の列（実行時に保持）
+    
+    static bool getOrientationRange(const TrajectoryData& data, size_t start_index, size_t count,
+                                    size_t& first, size_t& last);
+};
+
+// 複数のコマンドを1回の取り消し・やり直しにまとめるコマンド（取り消しは逆順）
+class CompositeCommand : public EditCommand {
+public:
+    explicit CompositeCommand(std::vector<std::unique_ptr<EditCommand>> commands);
+    void execute(TrajectoryData& data) override;
+    void undo(TrajectoryData& data) override;
+    std::string getDescription() const override;  // 最初のコマンドの説明
+    size_t getMemoryUsage() const override;
+
+private:
+    std::vector<std::unique_ptr<EditCommand>> commands_;
+};
+
 // 編集履歴管理クラス
 class EditHistory {
 public:
@@ -91,6 +224,8 @@ public:
     
     // 履歴管理
     void executeCommand(std::unique_ptr<EditCommand> command, TrajectoryData& data);
+    // 実行して直前のコマンドとまとめる（編集に伴う速度プロファイルの適用など。直前がなければ単独で積む）
+    void mergeIntoLastCommand(std::unique_ptr<EditCommand> command, TrajectoryData& data);
     void undo(TrajectoryData& data);
     void redo(TrajectoryData& data);
     void clear();
@@ -100,6 +235,7 @@ public:
     bool canRedo() const;
     std::string getUndoDescription() const;
     std::string getRedoDescription() const;
+    size_t getMemoryUsage() const;  // 履歴に残っているコマンドの大きさ [bytes]
     
     // 設定
     void setMaxHistorySize(size_t max_size) { max_history_size_ = max_size; }
@@ -0,0 +1,416 @@
+#include "frenet_frame.hpp"
+#include "../utils/parallel.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+namespace trajectory_editor {
+
+namespace {
+
+// 並列化する最小のチャンク（これより少ない点数なら呼び出し元で計算）
+constexpr size_t PARALLEL_CHUNK = 2048;
+
+// 始点と終点をこの距離以内なら周回とみなす [m]
+constexpr double CLOSED_LOOP_TOLERANCE = 1e-3;
+
+// これより短い区間は基準線から除く [m]
+constexpr double MIN_SEGMENT_LENGTH = 1e-9;
+
+// 区間の端の丸め誤差の許容量（区間内の位置 t に対して）
+constexpr double RATIO_TOLERANCE = 1e-9;
+
+// 最近傍の区間の前後何区間まで解を探すか
+constexpr size_t NEIGHBOR_SEGMENTS = 2;
+
+double cross(double ax, double ay, double bx, double by) {
+    return ax * by - ay * bx;
+}
+
+} // namespace
+
+FrenetFrame::FrenetFrame() = default;
+
+void FrenetFrame::clear() {
+    vertices_.clear();
+    index_.clear();
+}
+
+void FrenetFrame::build(const std::vector<TrajectoryPoint>& reference) {
+    std::vector<Vertex> vertices;
+    vertices.reserve(reference.size());
+    for (const auto& point : reference) {
+        vertices.push_back({point.x, point.y, 0.0, 0.0, 0.0});
+    }
+    buildVertices(std::move(vertices));
+}
+
+void FrenetFrame::buildFromBoundaries(const TrackBoundaries& boundaries) {
+    const auto& left = boundaries.getLeftBoundary();
+    const auto& right = boundaries.getRightBoundary();
+    SegmentIndex right_index;
+    right_index.build(right);
+    if (left.empty() || right_index.empty()) {
+        clear();
+        return;
+    }
+
+    // 左境界の各頂点と右境界上の最近傍点の中点をつなぐ
+    std::vector<Vertex> vertices;
+    vertices.reserve(left.size());
+    SegmentHit hit;
+    for (const auto& point : left) {
+        hit = hit.valid ? right_index.findNearest(point.x, point.y, hit.segment)
+                        : right_index.findNearest(point.x, point.y);
+        vertices.push_back({0.5 * (point.x + hit.x), 0.5 * (point.y + hit.y), 0.0, 0.0, 0.0});
+    }
+    buildVertices(std::move(vertices));
+}
+
+void FrenetFrame::buildVertices(std::vector<Vertex> vertices) {
+    clear();
+
+    // 長さ0の区間を除く
+    for (const auto& vertex : vertices) {
+        if (vertices_.empty() || std::hypot(vertex.x - vertices_.back().x, vertex.y - vertices_.back().y)
+                                     >= MIN_SEGMENT_LENGTH) {
+            vertices_.push_back(vertex);
+        }
+    }
+    if (vertices_.size() < 2) {
+        vertices_.clear();
+        return;
+    }
+
+    // 区間の法線を隣り合う頂点で平均する
+    size_t n = vertices_.size();
+    std::vector<double> segment_nx(n - 1), segment_ny(n - 1);
+    vertices_[0].s = 0.0;
+    for (size_t i = 0; i + 1 < n; ++i) {
+        double ex = vertices_[i + 1].x - vertices_[i].x;
+        double ey = vertices_[i + 1].y - vertices_[i].y;
+        double length = std::hypot(ex, ey);
+        segment_nx[i] = -ey / length;
+        segment_ny[i] = ex / length;
+        vertices_[i + 1].s = vertices_[i].s + length;
+    }
+
+    auto set_normal = [&](Vertex& vertex, size_t before, size_t after) {
+        double nx = segment_nx[before] + segment_nx[after];
+        double ny = segment_ny[before] + segment_ny[after];
+        double length = std::hypot(nx, ny);
+        if (length < 1e-12) {
+            // 折り返している頂点は後ろの区間の法線を使う
+            nx = segment_nx[after];
+            ny = segment_ny[after];
+            length = 1.0;
+        }
+        vertex.nx = nx / length;
+        vertex.ny = ny / length;
+    };
+
+    vertices_[0].nx = segment_nx[0];
+    vertices_[0].ny = segment_ny[0];
+    vertices_[n - 1].nx = segment_nx[n - 2];
+    vertices_[n - 1].ny = segment_ny[n - 2];
+    for (size_t i = 1; i + 1 < n; ++i) {
+        set_normal(vertices_[i], i - 1, i);
+    }
+    if (isClosed()) {
+        set_normal(vertices_[0], n - 2, 0);
+        vertices_[n - 1].nx = vertices_[0].nx;
+        vertices_[n - 1].ny = vertices_[0].ny;
+    }
+
+    std::vector<BoundaryPoint> polyline;
+    polyline.reserve(n);
+    for (const auto& vertex : vertices_) {
+        polyline.emplace_back(vertex.x, vertex.y);
+    }
+    index_.build(polyline);
+}
+
+bool FrenetFrame::isClosed() const {
+    return vertices_.size() > 3 &&
+           std::hypot(vertices_.front().x - vertices_.back().x,
+                      vertices_.front().y - vertices_.back().y) < CLOSED_LOOP_TOLERANCE;
+}
+
+bool FrenetFrame::solveSegment(size_t segment, double x, double y, bool extrapolate, FrenetPoint& result) const {
+    const Vertex& a = vertices_[segment];
+    const Vertex& b = vertices_[segment + 1];
+    double ex = b.x - a.x;
+    double ey = b.y - a.y;
+    double qx = x - a.x;
+    double qy = y - a.y;
+    double mx = b.nx - a.nx;
+    double my = b.ny - a.ny;
+    double length = b.s - a.s;
+
+    // (q - t e) × (n0 + t m) = 0 を t について解く
+    double c2 = -cross(ex, ey, mx, my);
+    double c1 = cross(qx, qy, mx, my) - cross(ex, ey, a.nx, a.ny);
+    double c0 = cross(qx, qy, a.nx, a.ny);
+    double roots[2];
+    int root_count = 0;
+    if (std::abs(c2) <= 1e-12 * (std::abs(c1) + std::abs(c0))) {
+        if (c1 != 0.0) {
+            roots[root_count++] = -c0 / c1;
+        }
+    } else {
+        double discriminant = c1 * c1 - 4.0 * c2 * c0;
+        if (discriminant >= 0.0) {
+            // 桁落ちしない解の公式
+            double root = std::sqrt(discriminant);
+            double q = -0.5 * (c1 + (c1 >= 0.0 ? root : -root));
+            if (q != 0.0) {
+                roots[root_count++] = q / c2;
+                roots[root_count++] = c0 / q;
+            } else {
+                roots[root_count++] = 0.0;
+            }
+        }
+    }
+
+    bool found = false;
+    for (int r = 0; r < root_count; ++r) {
+        double t = roots[r];
+        if (t < -RATIO_TOLERANCE || t > 1.0 + RATIO_TOLERANCE) {
+            continue;
+        }
+        t = std::max(0.0, std::min(1.0, t));
+        double nx = a.nx + t * mx;
+        double ny = a.ny + t * my;
+        double norm = std::hypot(nx, ny);
+        if (norm < 1e-12) {
+            continue;
+        }
+        double d = ((qx - t * ex) * nx + (qy - t * ey) * ny) / norm;
+        if (!found || std::abs(d) < std::abs(result.d)) {
+            result.s = a.s + t * length;
+            result.d = d;
+            result.segment = segment;
+            found = true;
+        }
+    }
+    if (found || !extrapolate) {
+        return found;
+    }
+
+    // 開いた基準線の両端の外側は端の法線を保った延長線で扱う
+    double t = (qx * ex + qy * ey) / (length * length);
+    if (segment == 0 && t < 0.0) {
+        result.s = t * length;
+        result.d = qx * a.nx + qy * a.ny;
+        result.segment = segment;
+        return true;
+    }
+    if (segment + 2 == vertices_.size() && t > 1.0) {
+        result.s = a.s + t * length;
+        result.d = (x - b.x) * b.nx + (y - b.y) * b.ny;
+        result.segment = segment;
+        return true;
+    }
+    return false;
+}
+
+FrenetPoint FrenetFrame::toFrenet(double x, double y) const {
+    return toFrenet(x, y, SIZE_MAX);
+}
+
+FrenetPoint FrenetFrame::toFrenet(double x, double y, size_t hint_segment) const {
+    if (empty()) {
+        throw std::logic_error("Frenet frame is empty");
+    }
+    SegmentHit hit = hint_segment < index_.getSegmentCount() ? index_.findNearest(x, y, hint_segment)
+                                                             : index_.findNearest(x, y);
+
+    // 法線の補間で決まる区間は最近傍の区間かその隣にある
+    size_t segment_count = vertices_.size() - 1;
+    bool closed = isClosed();
+    FrenetPoint best;
+    bool found = false;
+    for (size_t offset = 0; offset <= 2 * NEIGHBOR_SEGMENTS; ++offset) {
+        // 0, -1, +1, -2, +2 の順
+        long step = offset == 0 ? 0 : (offset % 2 == 1 ? -static_cast<long>((offset + 1) / 2)
+                                                         : static_cast<long>(offset / 2));
+        long candidate = static_cast<long>(hit.segment) + step;
+        if (closed) {
+            candidate = (candidate % static_cast<long>(segment_count) + static_cast<long>(segment_count))
+                        % static_cast<long>(segment_count);
+        } else if (candidate < 0 || candidate >= static_cast<long>(segment_count)) {
+            continue;
+        }
+        FrenetPoint point;
+        if (solveSegment(static_cast<size_t>(candidate), x, y, !closed, point) &&
+            (!found || std::abs(point.d) < std::abs(best.d))) {
+            best = point;
+            found = true;
+        }
+    }
+    if (found) {
+        return best;
+    }
+
+    // 基準線の曲率半径より遠い点は法線が重なって解けないので、最近傍点で代用する
+    best.segment = hit.segment;
+    best.s = vertices_[hit.segment].s + hit.ratio * (vertices_[hit.segment + 1].s - vertices_[hit.segment].s);
+    best.d = hit.signed_distance;
+    return best;
+}
+
+size_t FrenetFrame::findSegment(double s, size_t hint_segment) const {
+    size_t segment_count = vertices_.size() - 1;
+    auto contains = [&](size_t segment) {
+        return vertices_[segment].s <= s && s <= vertices_[segment + 1].s;
+    };
+    if (hint_segment < segment_count) {
+        if (contains(hint_segment)) {
+            return hint_segment;
+        }
+        if (hint_segment + 1 < segment_count && contains(hint_segment + 1)) {
+            return hint_segment + 1;
+        }
+        if (hint_segment > 0 && contains(hint_segment - 1)) {
+            return hint_segment - 1;
+        }
+    }
+    if (s <= 0.0) {
+        return 0;
+    }
+    if (s >= getLength()) {
+        return segment_count - 1;
+    }
+    auto it = std::upper_bound(vertices_.begin(), vertices_.end(), s,
+                               [](double value, const Vertex& vertex) { return value < vertex.s; });
+    return static_cast<size_t>(it - vertices_.begin()) - 1;
+}
+
+void FrenetFrame::evaluate(size_t segment, double s, double d, double& x, double& y) const {
+    const Vertex& a = vertices_[segment];
+    const Vertex& b = vertices_[segment + 1];
+    double t = (s - a.s) / (b.s - a.s);
+    double nx, ny;
+    if (t < 0.0) {
+        nx = a.nx;
+        ny = a.ny;
+    } else if (t > 1.0) {
+        nx = b.nx;
+        ny = b.ny;
+    } else {
+        nx = a.nx + t * (b.nx - a.nx);
+        ny = a.ny + t * (b.ny - a.ny);
+        double norm = std::hypot(nx, ny);
+        if (norm > 0.0) {
+            nx /= norm;
+            ny /= norm;
+        }
+    }
+    x = a.x + t * (b.x - a.x) + d * nx;
+    y = a.y + t * (b.y - a.y) + d * ny;
+}
+
+void FrenetFrame::toCartesian(double s, double d, double& x, double& y) const {
+    if (empty()) {
+        throw std::logic_error("Frenet frame is empty");
+    }
+    if (isClosed()) {
+        s = std::fmod(s, getLength());
+        if (s < 0.0) {
+            s += getLength();
+        }
+    }
+    evaluate(findSegment(s, SIZE_MAX), s, d, x, y);
+}
+
+std::vector<FrenetPoint> FrenetFrame::toFrenet(const std::vector<TrajectoryPoint>& points,
+                                               size_t start_index, size_t end_index) const {
+    if (start_index >= points.size() || end_index >= points.size() || start_index > end_index) {
+        throw std::out_of_range("Invalid range");
+    }
+    if (empty()) {
+        throw std::logic_error("Frenet frame is empty");
+    }
+
+    std::vector<FrenetPoint> result(end_index - start_index + 1);
+    parallelFor(0, result.size(), PARALLEL_CHUNK, [&](size_t begin, size_t end) {
+        // チャンク内では直前の点の区間をヒントにする
+        size_t hint = SIZE_MAX;
+        for (size_t i = begin; i < end; ++i) {
+            const auto& point = points[start_index + i];
+            result[i] = toFrenet(point.x, point.y, hint);
+            hint = result[i].segment;
+        }
+    });
+    return result;
+}
+
+void FrenetFrame::toCartesian(const std::vector<FrenetPoint>& frenet, std::vector<TrajectoryPoint>& points,
+                              size_t start_index) const {
+    if (frenet.empty()) {
+        return;
+    }
+    if (start_index >= points.size() || frenet.size() > points.size() - start_index) {
+        throw std::out_of_range("Invalid range");
+    }
+    if (empty()) {
+        throw std::logic_error("Frenet frame is empty");
+    }
+
+    bool closed = isClosed();
+    double length = getLength();
+    parallelFor(0, frenet.size(), PARALLEL_CHUNK, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            double s = frenet[i].s;
+            if (closed && (s < 0.0 || s > length)) {
+                s = std::fmod(s, length);
+                if (s < 0.0) {
+                    s += length;
+                }
+            }
+            auto& point = points[start_index + i];
+            evaluate(findSegment(s, frenet[i].segment), s, frenet[i].d, point.x, point.y);
+        }
+    });
+}
+
+std::vector<TrajectoryPoint> FrenetFrame::offsetRange(const std::vector<TrajectoryPoint>& points,
+                                                      size_t start_index, size_t end_index,
+                                                      double offset, double taper) const {
+    std::vector<FrenetPoint> frenet = toFrenet(points, start_index, end_index);
+    size_t count = frenet.size();
+
+    // offset は軌跡の進行方向の左が正。基準線と逆向きに走る範囲なら d の符号を反転する
+    double direction = 0.0;
+    double length = getLength();
+    for (size_t i = 0; i + 1 < count; ++i) {
+        double ds = frenet[i + 1].s - frenet[i].s;
+        if (std::abs(ds) < 0.5 * length) {
+            direction += ds;
+        }
+    }
+    double signed_offset = direction < 0.0 ? -offset : offset;
+
+    // 両端からの弧長（軌跡に沿って測る）でなめらかに移動量を増やす
+    std::vector<double> distance(count, 0.0);
+    for (size_t i = 1; i < count; ++i) {
+        const auto& a = points[start_index + i - 1];
+        const auto& b = points[start_index + i];
+        distance[i] = distance[i - 1] + std::hypot(b.x - a.x, b.y - a.y);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        double weight = 1.0;
+        if (taper > 0.0) {
+            double u = std::min(1.0, std::min(distance[i], distance[count - 1] - distance[i]) / taper);
+            weight = u * u * (3.0 - 2.0 * u);
+        }
+        frenet[i].d += signed_offset * weight;
+    }
+
+    std::vector<TrajectoryPoint> result(points.begin() + start_index, points.begin() + end_index + 1);
+    toCartesian(frenet, result, 0);
+    return result;
+}
+
+} // namespace trajectory_editor
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "trajectory_data.hpp"
+#include "track_boundaries.hpp"
+#include "segment_index.hpp"
+#include <vector>
+
+namespace trajectory_editor {
+
+// 基準線に沿った座標
+struct FrenetPoint {
+    double s = 0.0;        // 基準線の始点からの弧長 [m]（両端の外側は延長線上で負または全長超え）
+    double d = 0.0;        // 基準線の左が正の横方向距離 [m]
+    size_t segment = 0;    // 対応する基準線の区間（次の検索のヒントに使える）
+};
+
+// 基準線に沿った (s, d) 座標系
+//
+// 基準線は折れ線で、各頂点の法線は前後の区間の法線の平均。区間内の法線は両端の
+// 頂点法線を線形補間して正規化したものを使うので、法線は基準線に沿って連続に変わり、
+// 角の外側でも (s, d) が途切れない。toFrenet() は p = r(t) + d n(t) を満たす t を
+// 区間ごとの2次方程式で求めるため、toCartesian() とは往復で一致する。
+// 区間の候補は SegmentIndex の最近傍検索で絞る。検索はconstなので複数スレッドから呼べる。
+class FrenetFrame {
+public:
+    FrenetFrame();
+
+    // 構築（頂点が2つ未満なら空になる）
+    void build(const std::vector<TrajectoryPoint>& reference);
+    void buildFromBoundaries(const TrackBoundaries& boundaries);  // 左右の境界の中央線
+    void clear();
+
+    // データアクセス
+    bool empty() const { return vertices_.size() < 2; }
+    double getLength() const { return vertices_.empty() ? 0.0 : vertices_.back().s; }
+    bool isClosed() const;  // 始点と終点が一致する基準線（s は全長で折り返す）
+
+    // 1点の変換（hint_segment は近くの区間。連続した点の変換向け）
+    FrenetPoint toFrenet(double x, double y) const;
+    FrenetPoint toFrenet(double x, double y, size_t hint_segment) const;
+    void toCartesian(double s, double d, double& x, double& y) const;
+
+    // 範囲 [start_index, end_index] の一括変換（end_indexは含む。並列に変換する）
+    std::vector<FrenetPoint> toFrenet(const std::vector<TrajectoryPoint>& points,
+                                      size_t start_index, size_t end_index) const;
+    // frenet の各点を変換して points[start_index + i] の x, y に書き込む
+    void toCartesian(const std::vector<FrenetPoint>& frenet, std::vector<TrajectoryPoint>& points,
+                     size_t start_index) const;
+
+    // 範囲の点を横方向へ offset だけ動かした点列（z・速度はそのまま）。
+    // taper > 0 なら範囲の両端から弧長 taper の間で移動量を0からなめらかに増やす
+    std::vector<TrajectoryPoint> offsetRange(const std::vector<TrajectoryPoint>& points,
+                                             size_t start_index, size_t end_index,
+                                             double offset, double taper = 0.0) const;
+
+private:
+    struct Vertex {
+        double x, y;
+        double nx, ny;   // 頂点の法線（左向きの単位ベクトル）
+        double s;        // 始点からの弧長
+    };
+
+    std::vector<Vertex> vertices_;
+    SegmentIndex index_;
+
+    void buildVertices(std::vector<Vertex> vertices);
+    bool solveSegment(size_t segment, double x, double y, bool extrapolate, FrenetPoint& result) const;
+    size_t findSegment(double s, size_t hint_segment) const;
+    void evaluate(size_t segment, double s, double d, double& x, double& y) const;
+};
+
+} // namespace trajectory_editor
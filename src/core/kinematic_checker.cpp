@@ -0,0 +1,219 @@
+#include "kinematic_checker.hpp"
+#include "../utils/parallel.hpp"
+#include "../utils/trace.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace trajectory_editor {
+
+namespace {
+
+// 並列化する最小のチャンク（これより少ない点数なら呼び出し元で計算）
+constexpr size_t PARALLEL_CHUNK = 8192;
+
+// これより短い区間・遅い速度では加速度・加加速度を0とみなす
+constexpr double MIN_SEGMENT_LENGTH = 1e-6;  // [m]
+constexpr double MIN_VELOCITY_SUM = 1e-6;    // [m/s]
+constexpr double MIN_DURATION = 1e-9;        // [s]
+
+} // namespace
+
+KinematicChecker::KinematicChecker()
+    : data_(nullptr), revision_(0), violation_count_(0), last_recomputed_(0) {}
+
+void KinematicChecker::setLimits(const KinematicLimits& limits) {
+    limits_ = limits;
+    changed_violations_.clear();
+    classify(0, flags_.size());
+}
+
+void KinematicChecker::clear() {
+    data_ = nullptr;
+    revision_ = 0;
+    acceleration_.clear();
+    jerk_.clear();
+    flags_.clear();
+    violation_count_ = 0;
+    changed_violations_.clear();
+    updateMaxima(0, 0, true);
+    last_recomputed_ = 0;
+}
+
+void KinematicChecker::build(const TrajectoryData& data) {
+    data_ = &data;
+    revision_ = data.getRevision();
+
+    size_t n = data.size();
+    acceleration_.assign(n, 0.0);
+    jerk_.assign(n, 0.0);
+    // 点数が同じなら前のフラグと比べて変わった点を残す
+    if (flags_.size() != n) {
+        flags_.assign(n, KINEMATIC_OK);
+        violation_count_ = 0;
+    }
+    changed_violations_.clear();
+    recompute(data, 0, n);
+    updateMaxima(0, n, true);
+}
+
+void KinematicChecker::update(const TrajectoryData& data) {
+    TRACE_ZONE("KinematicChecker::update");
+    if (data_ != &data) {
+        build(data);
+        return;
+    }
+
+    TrajectoryChange change = data.getChangesSince(revision_);
+    revision_ = data.getRevision();
+    last_recomputed_ = 0;
+    if (change.none) {
+        return;
+    }
+    changed_violations_.clear();
+
+    // 点 i の値は点 i-1, i, i+1 だけで決まる（速度だけの変更も同じ範囲）
+    size_t n = data.size();
+    size_t old_size = flags_.size();
+    size_t begin = 0;
+    size_t end = 0;
+    change.getRecomputeRange(n, 1, begin, end);
+
+    // 再計算する範囲に入る前の点の違反を数え直す（範囲より後ろは点数の差だけずれるだけ）
+    size_t old_end = end + old_size >= n ? std::min(old_size, end + old_size - n) : begin;
+    size_t replaced = 0;
+    for (size_t i = std::min(begin, old_end); i < old_end; ++i) {
+        replaced += flags_[i] != KINEMATIC_OK ? 1 : 0;
+    }
+    change.shiftColumn(acceleration_, n);
+    change.shiftColumn(jerk_, n);
+    change.shiftColumn(flags_, n);
+    size_t shifted = 0;
+    for (size_t i = begin; i < end; ++i) {
+        shifted += flags_[i] != KINEMATIC_OK ? 1 : 0;
+    }
+    violation_count_ = violation_count_ - replaced + shifted;
+
+    recompute(data, begin, end);
+    updateMaxima(begin, end, n != old_size);
+}
+
+void KinematicChecker::recompute(const TrajectoryData& data, size_t begin, size_t end) {
+    const auto& points = data.getPoints();
+    size_t n = points.size();
+    end = std::min(end, n);
+    if (begin >= end) {
+        return;
+    }
+    last_recomputed_ = end - begin;
+
+    parallelFor(begin, end, PARALLEL_CHUNK, [&](size_t chunk_begin, size_t chunk_end) {
+        // 前後1点を含めて座標と速度を連続した配列に並べる
+        size_t first = chunk_begin > 0 ? chunk_begin - 1 : 0;
+        size_t last = std::min(chunk_end, n - 1);  // 含む
+        size_t count = last - first + 1;
+        std::vector<double> x(count), y(count), v(count);
+        for (size_t k = 0; k < count; ++k) {
+            const auto& point = points[first + k];
+            x[k] = point.x;
+            y[k] = point.y;
+            v[k] = point.velocity;
+        }
+
+        // 区間 k → k+1 の加速度と所要時間
+        size_t segments = count - 1;
+        std::vector<double> acceleration(segments), duration(segments);
+        for (size_t k = 0; k < segments; ++k) {
+            double dx = x[k + 1] - x[k];
+            double dy = y[k + 1] - y[k];
+            double ds = std::sqrt(dx * dx + dy * dy);
+            double velocity_sum = v[k] + v[k + 1];
+            double safe_ds = std::max(ds, MIN_SEGMENT_LENGTH);
+            double safe_sum = std::max(velocity_sum, MIN_VELOCITY_SUM);
+            // 0除算しない分母で両方を計算してから選ぶ（分岐にならずベクトル化できる）
+            acceleration[k] = ds > MIN_SEGMENT_LENGTH ? (v[k + 1] * v[k + 1] - v[k] * v[k]) / (2.0 * safe_ds) : 0.0;
+            duration[k] = velocity_sum > MIN_VELOCITY_SUM ? 2.0 * ds / safe_sum : 0.0;
+        }
+
+        // 点 i の加加速度は区間 i-1 と i の加速度の差 / 所要時間の平均（両端の点は0）
+        // 書き込み先は生のポインタで持つ（メンバーの vector 経由だと毎回読み直しになりベクトル化されない）
+        size_t inner_begin = std::max<size_t>(chunk_begin, 1);
+        size_t inner_end = std::max(inner_begin, std::min(chunk_end, n - 1));
+        size_t segment_end = std::max(chunk_begin, std::min(chunk_end, n - 1));
+        double* out_acceleration = acceleration_.data();
+        double* out_jerk = jerk_.data();
+        const double* segment_acceleration = acceleration.data();
+        const double* segment_duration = duration.data();
+        for (size_t i = chunk_begin; i < segment_end; ++i) {
+            out_acceleration[i] = segment_acceleration[i - first];
+        }
+        for (size_t i = segment_end; i < chunk_end; ++i) {
+            out_acceleration[i] = 0.0;
+        }
+        for (size_t i = chunk_begin; i < inner_begin; ++i) {
+            out_jerk[i] = 0.0;
+        }
+        for (size_t i = inner_begin; i < inner_end; ++i) {
+            size_t k = i - first;
+            double mean_duration = 0.5 * (segment_duration[k - 1] + segment_duration[k]);
+            double safe_duration = std::max(mean_duration, MIN_DURATION);
+            double jerk = (segment_acceleration[k] - segment_acceleration[k - 1]) / safe_duration;
+            out_jerk[i] = mean_duration > MIN_DURATION ? jerk : 0.0;
+        }
+        for (size_t i = inner_end; i < chunk_end; ++i) {
+            out_jerk[i] = 0.0;
+        }
+    });
+    classify(begin, end);
+}
+
+void KinematicChecker::classify(size_t begin, size_t end) {
+    end = std::min(end, flags_.size());
+    const double max_acceleration = limits_.max_acceleration;
+    const double max_deceleration = limits_.max_deceleration;
+    const double max_jerk = limits_.max_jerk;
+    for (size_t i = begin; i < end; ++i) {
+        double acceleration = acceleration_[i];
+        double jerk = jerk_[i];
+        uint8_t flag = static_cast<uint8_t>((acceleration > max_acceleration ? KINEMATIC_ACCELERATION : 0) |
+                                            (-acceleration > max_deceleration ? KINEMATIC_DECELERATION : 0) |
+                                            (std::abs(jerk) > max_jerk ? KINEMATIC_JERK : 0));
+        bool was_violation = flags_[i] != KINEMATIC_OK;
+        bool is_violation = flag != KINEMATIC_OK;
+        if (was_violation != is_violation) {
+            changed_violations_.push_back(i);
+            violation_count_ = is_violation ? violation_count_ + 1 : violation_count_ - 1;
+        }
+        flags_[i] = flag;
+    }
+}
+
+void KinematicChecker::updateMaxima(size_t begin, size_t end, bool rebuild) {
+    // 点数が変わると後ろの点の添字がずれるので作り直す
+    if (rebuild) {
+        begin = 0;
+        end = acceleration_.size();
+        max_acceleration_.resize(end);
+        max_deceleration_.resize(end);
+        max_abs_jerk_.resize(end);
+    }
+    for (size_t i = begin; i < end; ++i) {
+        max_acceleration_.set(i, acceleration_[i]);
+        max_deceleration_.set(i, -acceleration_[i]);
+        max_abs_jerk_.set(i, std::abs(jerk_[i]));
+    }
+    max_acceleration_.refresh(begin, end);
+    max_deceleration_.refresh(begin, end);
+    max_abs_jerk_.refresh(begin, end);
+}
+
+std::vector<size_t> KinematicChecker::getViolations() const {
+    std::vector<size_t> violations;
+    for (size_t i = 0; i < flags_.size(); ++i) {
+        if (flags_[i] != KINEMATIC_OK) {
+            violations.push_back(i);
+        }
+    }
+    return violations;
+}
+
+} // namespace trajectory_editor
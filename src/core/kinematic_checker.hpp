@@ -0,0 +1,86 @@
+#pragma once
+
+#include "trajectory_data.hpp"
+#include "max_tree.hpp"
+#include <vector>
+#include <cstdint>
+
+namespace trajectory_editor {
+
+// 縦方向の運動学的な制約（単位は m/s^2, m/s^3）
+struct KinematicLimits {
+    double max_acceleration = 3.0;
+    double max_deceleration = 6.0;   // 正の値で指定
+    double max_jerk = 10.0;          // 加加速度の絶対値
+};
+
+// 点ごとの違反の種類（ビットの組み合わせ）
+enum KinematicViolation : uint8_t {
+    KINEMATIC_OK = 0,
+    KINEMATIC_ACCELERATION = 1 << 0,
+    KINEMATIC_DECELERATION = 1 << 1,
+    KINEMATIC_JERK = 1 << 2,
+};
+
+// 速度と弧長から求める縦加速度・加加速度のチェック
+//
+// 点 i の加速度は区間 i → i+1 の (v1^2 - v0^2) / (2 ds)、加加速度は隣接する区間の
+// 加速度の差を区間の所要時間 2 ds / (v0 + v1) の平均で割ったもの。どちらも前後1点
+// だけで決まるので、update() は変更ジャーナルで編集点の前後1点だけを再計算する。
+// 計算は座標・速度を連続した配列に並べ直してから分岐のないループで行う
+// （コンパイラのベクトル化が効く形）。
+// 違反の数と最大値も再計算した範囲だけで更新する（最大値は区間の最大値の木で持つ）。
+// 表示側は getChangedViolations() の点だけを描き直せばよい。
+class KinematicChecker {
+public:
+    KinematicChecker();
+
+    // 設定（変更すると違反フラグだけを付け直す）
+    void setLimits(const KinematicLimits& limits);
+    const KinematicLimits& getLimits() const { return limits_; }
+
+    // 構築・更新
+    void build(const TrajectoryData& data);
+    void update(const TrajectoryData& data);
+    void clear();
+
+    // データアクセス（末尾の点の加速度と両端の加加速度は0）
+    size_t size() const { return acceleration_.size(); }
+    const std::vector<double>& getAccelerations() const { return acceleration_; }  // [m/s^2]
+    const std::vector<double>& getJerks() const { return jerk_; }                  // [m/s^3]
+    const std::vector<uint8_t>& getViolationFlags() const { return flags_; }      // KinematicViolation の組み合わせ
+
+    // 統計（最大値と違反の数は O(1)。値が0以下しかなければ0と点0を返す）
+    double getMaxAcceleration(size_t* index = nullptr) const { return max_acceleration_.getMax(index); }
+    double getMaxDeceleration(size_t* index = nullptr) const { return max_deceleration_.getMax(index); }  // 正の値
+    double getMaxAbsJerk(size_t* index = nullptr) const { return max_abs_jerk_.getMax(index); }
+    std::vector<size_t> getViolations() const;
+    size_t countViolations() const { return violation_count_; }
+
+    // 直近にフラグを付け直した build/update/setLimits で違反の有無が変わった点（現在の添字。
+    // 点数が変わった場合は編集点より後ろが前後にずれているので、表示側は全体を付け直す）
+    const std::vector<size_t>& getChangedViolations() const { return changed_violations_; }
+
+    // 直近の update() で再計算した点数
+    size_t getLastRecomputedCount() const { return last_recomputed_; }
+
+private:
+    KinematicLimits limits_;
+    const TrajectoryData* data_;
+    uint64_t revision_;
+    std::vector<double> acceleration_;
+    std::vector<double> jerk_;
+    std::vector<uint8_t> flags_;
+    size_t violation_count_;
+    std::vector<size_t> changed_violations_;
+    MaxTree max_acceleration_;
+    MaxTree max_deceleration_;
+    MaxTree max_abs_jerk_;
+    size_t last_recomputed_;
+
+    void recompute(const TrajectoryData& data, size_t begin, size_t end);
+    void classify(size_t begin, size_t end);
+    void updateMaxima(size_t begin, size_t end, bool rebuild);
+};
+
+} // namespace trajectory_editor
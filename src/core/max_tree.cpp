@@ -0,0 +1,44 @@
+#include "max_tree.hpp"
+
+namespace trajectory_editor {
+
+void MaxTree::resize(size_t count) {
+    leaves_ = 1;
+    while (leaves_ < count) {
+        leaves_ <<= 1;
+    }
+    values_.assign(2 * leaves_, floor_);
+    indices_.assign(2 * leaves_, 0);
+    for (size_t i = 0; i < leaves_; ++i) {
+        indices_[leaves_ + i] = i;
+    }
+}
+
+void MaxTree::refresh(size_t begin, size_t end) {
+    if (begin >= end) {
+        return;
+    }
+    // 親の段ごとに、葉の範囲の祖先だけを子から求め直す
+    size_t first = (leaves_ + begin) >> 1;
+    size_t last = (leaves_ + end - 1) >> 1;
+    while (first >= 1) {
+        for (size_t node = first; node <= last; ++node) {
+            size_t child = 2 * node + (values_[2 * node + 1] > values_[2 * node] ? 1 : 0);
+            values_[node] = values_[child];
+            indices_[node] = indices_[child];
+        }
+        first >>= 1;
+        last >>= 1;
+    }
+}
+
+double MaxTree::getMax(size_t* index) const {
+    // 葉は floor 以下を floor にしてあるので、floor より大きい値がなければ根も floor
+    bool above = values_[1] > floor_;
+    if (index) {
+        *index = above ? indices_[1] : 0;
+    }
+    return above ? values_[1] : floor_;
+}
+
+} // namespace trajectory_editor
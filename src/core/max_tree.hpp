@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace trajectory_editor {
+
+// 点ごとの値の最大値とその位置を持つ木（葉が点。同じ値なら小さい添字）
+//
+// 値を書き換えた範囲の祖先だけを計算し直すので、k 点の更新は O(k + log n)、
+// 最大値の取得は O(1)。floor 以下の値（NaN も）は floor として持ち、floor より
+// 大きい値がなければ最大値は floor、位置は点0になる（floor の既定は0）。
+// 最小値は符号を反転して入れ、floor を -∞ にすれば求まる。
+class MaxTree {
+public:
+    explicit MaxTree(double floor = 0.0)
+        : floor_(floor), values_(2, floor), indices_(2, 0) {}
+
+    void resize(size_t count);  // 全ての値を floor にする
+    void set(size_t index, double value) { values_[leaves_ + index] = value > floor_ ? value : floor_; }
+    void refresh(size_t begin, size_t end);  // 葉 [begin, end) の祖先を計算し直す
+    double getMax(size_t* index = nullptr) const;
+
+private:
+    double floor_;
+    size_t leaves_ = 1;
+    std::vector<double> values_;
+    std::vector<size_t> indices_;
+};
+
+} // namespace trajectory_editor
@@ -0,0 +1,58 @@
+#include "pentadiagonal_solver.hpp"
+
+namespace trajectory_editor {
+
+PentadiagonalSolver::PentadiagonalSolver() = default;
+
+bool PentadiagonalSolver::factor(const std::vector<double>& diag, const std::vector<double>& off1,
+                                 const std::vector<double>& off2) {
+    size_t n = diag.size();
+    d_.assign(n, 0.0);
+    l1_.assign(n, 0.0);
+    l2_.assign(n, 0.0);
+
+    for (size_t k = 0; k < n; ++k) {
+        double dk = diag[k];
+        double ek = k + 1 < n ? off1[k] : 0.0;
+        if (k >= 1) {
+            dk -= l1_[k - 1] * l1_[k - 1] * d_[k - 1];
+            ek -= l1_[k - 1] * l2_[k - 1] * d_[k - 1];
+        }
+        if (k >= 2) {
+            dk -= l2_[k - 2] * l2_[k - 2] * d_[k - 2];
+        }
+        if (!(dk > 0.0)) {
+            d_.clear();
+            l1_.clear();
+            l2_.clear();
+            return false;
+        }
+        d_[k] = dk;
+        l1_[k] = k + 1 < n ? ek / dk : 0.0;
+        l2_[k] = k + 2 < n ? off2[k] / dk : 0.0;
+    }
+    return true;
+}
+
+void PentadiagonalSolver::solve(std::vector<double>& rhs) const {
+    size_t n = d_.size();
+    for (size_t k = 1; k < n; ++k) {
+        rhs[k] -= l1_[k - 1] * rhs[k - 1];
+        if (k >= 2) {
+            rhs[k] -= l2_[k - 2] * rhs[k - 2];
+        }
+    }
+    for (size_t k = 0; k < n; ++k) {
+        rhs[k] /= d_[k];
+    }
+    for (size_t k = n; k-- > 0;) {
+        if (k + 1 < n) {
+            rhs[k] -= l1_[k] * rhs[k + 1];
+        }
+        if (k + 2 < n) {
+            rhs[k] -= l2_[k] * rhs[k + 2];
+        }
+    }
+}
+
+} // namespace trajectory_editor
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+namespace trajectory_editor {
+
+// 対称5重対角行列の LDL^T 分解
+//
+// 行列は対角・1つ右・2つ右の3本の帯で渡す（off1[k] = A(k, k+1), off2[k] = A(k, k+2)、
+// 範囲外の要素は無視する）。分解・求解ともに O(n)。正定値であることが前提で、
+// ピボットが正でなければ factor() は false を返す。
+class PentadiagonalSolver {
+public:
+    PentadiagonalSolver();
+
+    bool factor(const std::vector<double>& diag, const std::vector<double>& off1,
+                const std::vector<double>& off2);
+    void solve(std::vector<double>& rhs) const;  // rhs を解で上書きする
+
+    size_t size() const { return d_.size(); }
+
+private:
+    std::vector<double> d_;   // D の対角
+    std::vector<double> l1_;  // L の1つ下
+    std::vector<double> l2_;  // L の2つ下
+};
+
+} // namespace trajectory_editor
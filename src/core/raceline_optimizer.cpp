@@ -0,0 +1,519 @@
+#include "raceline_optimizer.hpp"
+#include "pentadiagonal_solver.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace trajectory_editor {
+
+namespace {
+
+// 始点と終点をこの距離以内なら周回とみなす [m]
+constexpr double CLOSED_LOOP_TOLERANCE = 1e-3;
+
+// これより短い区間は曲率の項に使わない [m]
+constexpr double MIN_SEGMENT_LENGTH = 1e-9;
+
+// 射影ニュートン法: 境界に張り付いているとみなす距離の上限 [m]
+constexpr double ACTIVE_SET_EPSILON = 1e-3;
+
+// 射影ニュートン法: 刻み1の移動量がこれより小さければ収束 [m]
+constexpr double STEP_TOLERANCE = 1e-6;
+
+// 射影ニュートン法: Armijo 条件の係数と刻みを半分にする回数の上限
+constexpr double ARMIJO_RATIO = 1e-4;
+constexpr int MAX_LINE_SEARCH_HALVINGS = 30;
+
+// 信頼半径: 実際の減少が予測のこの割合未満なら縮め、この割合を超えれば広げる
+constexpr double TRUST_SHRINK_RATIO = 0.1;
+constexpr double TRUST_GROW_RATIO = 0.75;
+constexpr double TRUST_SHRINK_FACTOR = 0.5;
+constexpr double TRUST_GROW_FACTOR = 2.0;
+
+// 信頼半径がこれより小さくなれば、それ以上下げられないとみなす [m]
+constexpr double MIN_TRUST_RADIUS = 1e-4;
+
+// 曲率の1項（中心 c と前後の点 a, b）
+//
+// 曲率は2つの区間の方位差 Δθ を区間長の平均 ds で割ったもの。Σ κ^2 ds = Σ Δθ^2 / ds
+struct CurvatureTerm {
+    size_t a, c, b;
+    double h0, h1;        // 区間 a→c, c→b の長さ
+    double m0x, m0y;      // 区間 a→c の左法線
+    double m1x, m1y;      // 区間 c→b の左法線
+    double delta_heading; // 方位差 [rad]
+    double ds;
+};
+
+// 区間長が0なら false
+bool makeTerm(const std::vector<TrajectoryPoint>& points, size_t a, size_t c, size_t b, CurvatureTerm& term) {
+    double d0x = points[c].x - points[a].x, d0y = points[c].y - points[a].y;
+    double d1x = points[b].x - points[c].x, d1y = points[b].y - points[c].y;
+    double h0 = std::hypot(d0x, d0y);
+    double h1 = std::hypot(d1x, d1y);
+    if (h0 < MIN_SEGMENT_LENGTH || h1 < MIN_SEGMENT_LENGTH) {
+        return false;
+    }
+    term.a = a;
+    term.c = c;
+    term.b = b;
+    term.h0 = h0;
+    term.h1 = h1;
+    term.m0x = -d0y / h0;
+    term.m0y = d0x / h0;
+    term.m1x = -d1y / h1;
+    term.m1y = d1x / h1;
+    term.delta_heading = std::atan2(d0x * d1y - d0y * d1x, d0x * d1x + d0y * d1y);
+    term.ds = 0.5 * (h0 + h1);
+    return true;
+}
+
+// 点 0..count-1 の曲率の項を列挙する（周回なら全点、開いた軌跡なら両端以外）
+template <typename Visitor>
+void forEachTerm(const std::vector<TrajectoryPoint>& points, size_t count, bool closed, Visitor&& visit) {
+    CurvatureTerm term;
+    if (closed) {
+        for (size_t c = 0; c < count; ++c) {
+            if (makeTerm(points, (c + count - 1) % count, c, (c + 1) % count, term)) {
+                visit(term);
+            }
+        }
+    } else {
+        for (size_t c = 1; c + 1 < count; ++c) {
+            if (makeTerm(points, c - 1, c, c + 1, term)) {
+                visit(term);
+            }
+        }
+    }
+}
+
+// 巡回5重対角の対称行列（band1[k] = H(k, k+1 mod n), band2[k] = H(k, k+2 mod n)）
+struct CyclicBandMatrix {
+    std::vector<double> diag, band1, band2;
+    bool closed = false;
+
+    explicit CyclicBandMatrix(size_t n, bool is_closed)
+        : diag(n, 0.0), band1(n, 0.0), band2(n, 0.0), closed(is_closed) {}
+
+    size_t size() const { return diag.size(); }
+
+    void add(size_t i, size_t j, double value) {
+        size_t n = size();
+        if (i == j) {
+            diag[i] += value;
+            return;
+        }
+        size_t d = (j + n - i) % n;
+        if (d == 1) {
+            band1[i] += value;
+        } else if (d == 2) {
+            band2[i] += value;
+        } else if (d == n - 1) {
+            band1[j] += value;
+        } else if (d == n - 2) {
+            band2[j] += value;
+        }
+    }
+
+    // 列の添字 k + offset が巡回で折り返すか
+    bool wraps(size_t k, size_t offset) const { return k + offset >= size(); }
+
+    void multiply(const std::vector<double>& x, std::vector<double>& y) const {
+        size_t n = size();
+        y.assign(n, 0.0);
+        for (size_t k = 0; k < n; ++k) {
+            y[k] += diag[k] * x[k];
+            for (size_t offset = 1; offset <= 2; ++offset) {
+                if (!closed && wraps(k, offset)) {
+                    continue;
+                }
+                size_t j = (k + offset) % n;
+                double value = offset == 1 ? band1[k] : band2[k];
+                y[k] += value * x[j];
+                y[j] += value * x[k];
+            }
+        }
+    }
+};
+
+// 4x4 の連立一次方程式（部分ピボット選択つきのGauss消去）
+bool solveSmall(double a[4][4], double b[4]) {
+    for (int col = 0; col < 4; ++col) {
+        int pivot = col;
+        for (int row = col + 1; row < 4; ++row) {
+            if (std::abs(a[row][col]) > std::abs(a[pivot][col])) {
+                pivot = row;
+            }
+        }
+        if (a[pivot][col] == 0.0) {
+            return false;
+        }
+        std::swap(a[pivot], a[col]);
+        std::swap(b[pivot], b[col]);
+        for (int row = col + 1; row < 4; ++row) {
+            double factor = a[row][col] / a[col][col];
+            for (int k = col; k < 4; ++k) {
+                a[row][k] -= factor * a[col][k];
+            }
+            b[row] -= factor * b[col];
+        }
+    }
+    for (int row = 3; row >= 0; --row) {
+        for (int k = row + 1; k < 4; ++k) {
+            b[row] -= a[row][k] * b[k];
+        }
+        b[row] /= a[row][row];
+    }
+    return true;
+}
+
+// H x = rhs を解く（rhs を解で上書き）。折り返す要素は U S U^T として分け、
+// 残りの帯行列 B の分解と Woodbury の式 x = B^-1 r - Z (I + S U^T Z)^-1 S U^T B^-1 r で解く
+bool solveCyclic(const CyclicBandMatrix& h, std::vector<double>& rhs) {
+    size_t n = h.size();
+    std::vector<double> off1(n, 0.0), off2(n, 0.0);
+    for (size_t k = 0; k < n; ++k) {
+        off1[k] = h.wraps(k, 1) ? 0.0 : h.band1[k];
+        off2[k] = h.wraps(k, 2) ? 0.0 : h.band2[k];
+    }
+    PentadiagonalSolver solver;
+    if (!solver.factor(h.diag, off1, off2)) {
+        return false;
+    }
+    solver.solve(rhs);
+    if (!h.closed) {
+        return true;
+    }
+
+    // 折り返す要素は (n-1, 0), (n-2, 0), (n-1, 1) の3つ
+    const size_t index[4] = {0, 1, n - 2, n - 1};
+    double s[4][4] = {};
+    s[0][3] = s[3][0] = h.band1[n - 1];
+    s[0][2] = s[2][0] = h.band2[n - 2];
+    s[1][3] = s[3][1] = h.band2[n - 1];
+
+    std::vector<std::vector<double>> z(4, std::vector<double>(n, 0.0));
+    for (int c = 0; c < 4; ++c) {
+        z[c][index[c]] = 1.0;
+        solver.solve(z[c]);
+    }
+
+    // M = I + S U^T Z, v = S U^T B^-1 r
+    double m[4][4];
+    double v[4];
+    for (int r = 0; r < 4; ++r) {
+        v[r] = 0.0;
+        for (int k = 0; k < 4; ++k) {
+            v[r] += s[r][k] * rhs[index[k]];
+        }
+        for (int c = 0; c < 4; ++c) {
+            double sum = r == c ? 1.0 : 0.0;
+            for (int k = 0; k < 4; ++k) {
+                sum += s[r][k] * z[c][index[k]];
+            }
+            m[r][c] = sum;
+        }
+    }
+    if (!solveSmall(m, v)) {
+        return false;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        rhs[i] -= z[0][i] * v[0] + z[1][i] * v[1] + z[2][i] * v[2] + z[3][i] * v[3];
+    }
+    return true;
+}
+
+} // namespace
+
+RacelineOptimizer::RacelineOptimizer() : has_boundaries_(false) {}
+
+void RacelineOptimizer::setBoundaries(const TrackBoundaries& boundaries) {
+    left_index_.build(boundaries.getLeftBoundary());
+    right_index_.build(boundaries.getRightBoundary());
+    has_boundaries_ = !boundaries.empty();
+}
+
+double RacelineOptimizer::curvatureCost(const std::vector<TrajectoryPoint>& points, bool closed) {
+    size_t count = closed && points.size() > 1 ? points.size() - 1 : points.size();
+    if (count < 3) {
+        return 0.0;
+    }
+    double cost = 0.0;
+    forEachTerm(points, count, closed, [&](const CurvatureTerm& term) {
+        cost += term.delta_heading * term.delta_heading / term.ds;
+    });
+    return cost;
+}
+
+bool RacelineOptimizer::optimize(const std::vector<TrajectoryPoint>& initial, std::vector<TrajectoryPoint>& result) {
+    stats_ = RacelineStats();
+    size_t n = initial.size();
+    if (n < 5) {
+        return false;
+    }
+
+    bool closed = std::hypot(initial.front().x - initial.back().x,
+                             initial.front().y - initial.back().y) < CLOSED_LOOP_TOLERANCE;
+    size_t count = closed ? n - 1 : n;
+    if (count < 5) {
+        return false;
+    }
+
+    // 各パスは信頼半径の中で線形化した問題を解き、本来のコストが下がったときだけ採用する。
+    // 予測どおりに下がれば半径を広げ、外れれば縮める
+    std::vector<TrajectoryPoint> reference = initial;
+    std::vector<TrajectoryPoint> trial;
+    double cost = curvatureCost(initial, closed);
+    double radius = options_.trust_radius;
+    double max_radius = std::max(options_.trust_radius, options_.max_offset);
+    size_t active_constraints = 0;
+    stats_.initial_cost = cost;
+    for (int pass = 0; pass < std::max(1, options_.max_linearization_passes); ++pass) {
+        trial = reference;
+        double predicted = 0.0;
+        if (!solvePass(initial, trial, count, closed, radius, predicted)) {
+            // 数値的に解けなければ、それまでに採用した最良のラインで終える
+            if (stats_.accepted_passes == 0) {
+                return false;
+            }
+            break;
+        }
+        ++stats_.passes;
+        if (closed) {
+            trial[n - 1].x = trial[0].x;
+            trial[n - 1].y = trial[0].y;
+        }
+
+        // 2次モデルでもほとんど下がらなければ、今のラインが線形化した問題の解
+        if (!(predicted > options_.cost_tolerance * cost)) {
+            stats_.converged = true;
+            break;
+        }
+
+        double trial_cost = curvatureCost(trial, closed);
+        double decrease = cost - trial_cost;
+        if (decrease > 0.0) {
+            reference.swap(trial);
+            cost = trial_cost;
+            active_constraints = stats_.active_constraints;
+            ++stats_.accepted_passes;
+            if (decrease < options_.cost_tolerance * cost) {
+                stats_.converged = true;
+                break;
+            }
+        }
+
+        double ratio = decrease / predicted;
+        if (ratio < TRUST_SHRINK_RATIO) {
+            radius *= TRUST_SHRINK_FACTOR;
+        } else if (ratio > TRUST_GROW_RATIO) {
+            radius = std::min(radius * TRUST_GROW_FACTOR, max_radius);
+        }
+        if (radius < MIN_TRUST_RADIUS) {
+            stats_.converged = true;
+            break;
+        }
+    }
+    stats_.active_constraints = active_constraints;
+
+    stats_.final_cost = curvatureCost(reference, closed);
+    for (size_t i = 0; i < n; ++i) {
+        stats_.max_abs_offset = std::max(stats_.max_abs_offset,
+                                         std::hypot(reference[i].x - initial[i].x, reference[i].y - initial[i].y));
+    }
+    result = std::move(reference);
+    return true;
+}
+
+bool RacelineOptimizer::solvePass(const std::vector<TrajectoryPoint>& initial, std::vector<TrajectoryPoint>& reference,
+                                  size_t count, bool closed, double radius, double& predicted_decrease) {
+    // 前後の点から法線（進行方向の左）を求める
+    std::vector<double> normal_x(count, 0.0), normal_y(count, 0.0);
+    for (size_t i = 0; i < count; ++i) {
+        size_t prev = closed ? (i + count - 1) % count : (i > 0 ? i - 1 : 0);
+        size_t next = closed ? (i + 1) % count : std::min(i + 1, count - 1);
+        double tx = reference[next].x - reference[prev].x;
+        double ty = reference[next].y - reference[prev].y;
+        double length = std::hypot(tx, ty);
+        if (length > 0.0) {
+            normal_x[i] = -ty / length;
+            normal_y[i] = tx / length;
+        }
+    }
+
+    // 境界がない側も、初期ラインから法線方向に max_offset より離れないようにする
+    std::vector<double> lower(count), upper(count);
+    for (size_t i = 0; i < count; ++i) {
+        double offset = (reference[i].x - initial[i].x) * normal_x[i] + (reference[i].y - initial[i].y) * normal_y[i];
+        lower[i] = -options_.max_offset - offset;
+        upper[i] = options_.max_offset - offset;
+    }
+
+    // 法線の両向きで最初に当たる境界までの距離から移動量の範囲を決める。
+    // 最近傍距離だと、コースが近くを並走・交差する場所で別の区間の境界を拾ってしまう
+    if (has_boundaries_) {
+        auto cast = [&](size_t i, double sign) {
+            double dx = sign * normal_x[i];
+            double dy = sign * normal_y[i];
+            return std::min(left_index_.intersectRay(reference[i].x, reference[i].y, dx, dy, options_.max_offset),
+                            right_index_.intersectRay(reference[i].x, reference[i].y, dx, dy, options_.max_offset));
+        };
+        for (size_t i = 0; i < count; ++i) {
+            upper[i] = std::min(upper[i], cast(i, 1.0) - options_.margin);
+            lower[i] = std::max(lower[i], options_.margin - cast(i, -1.0));
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (normal_x[i] == 0.0 && normal_y[i] == 0.0) {
+            lower[i] = upper[i] = 0.0;
+        } else if (lower[i] > upper[i]) {
+            // 余裕が足りない場所はコース幅の中央へ寄せる
+            lower[i] = upper[i] = 0.5 * (lower[i] + upper[i]);
+        }
+        // 線形化が成り立つ範囲（信頼半径）だけ動かす
+        lower[i] = std::clamp(lower[i], -radius, radius);
+        upper[i] = std::clamp(upper[i], -radius, radius);
+    }
+    if (!closed) {
+        lower[0] = upper[0] = 0.0;
+        lower[count - 1] = upper[count - 1] = 0.0;
+    }
+
+    // 区間の方位は α について線形化する: θ(r_c → r_b) ≈ θ0 + m1 · (α_b n_b - α_c n_c) / h1
+    // Σ (Δθ0 + e^T α)^2 / ds = α^T H α + 2 b^T α + const
+    CyclicBandMatrix hessian(count, closed);
+    std::vector<double> linear(count, 0.0);
+    forEachTerm(reference, count, closed, [&](const CurvatureTerm& term) {
+        const size_t index[3] = {term.a, term.c, term.b};
+        double e[3];
+        e[0] = (term.m0x * normal_x[term.a] + term.m0y * normal_y[term.a]) / term.h0;
+        e[1] = -(term.m1x * normal_x[term.c] + term.m1y * normal_y[term.c]) / term.h1
+               - (term.m0x * normal_x[term.c] + term.m0y * normal_y[term.c]) / term.h0;
+        e[2] = (term.m1x * normal_x[term.b] + term.m1y * normal_y[term.b]) / term.h1;
+        double weight = 1.0 / term.ds;
+        for (int j = 0; j < 3; ++j) {
+            linear[index[j]] += weight * e[j] * term.delta_heading;
+            for (int l = j; l < 3; ++l) {
+                hessian.add(index[j], index[l], weight * e[j] * e[l]);
+            }
+        }
+    });
+
+    // 区間長で重みをつけた Σ α^2 ds を足す（曲率の項だけだと平行移動で値が変わらない）
+    std::vector<double> length(count, 0.0);
+    for (size_t i = 0; i < count; ++i) {
+        size_t prev = closed ? (i + count - 1) % count : (i > 0 ? i - 1 : 0);
+        size_t next = closed ? (i + 1) % count : std::min(i + 1, count - 1);
+        length[i] = 0.5 * (std::hypot(reference[i].x - reference[prev].x, reference[i].y - reference[prev].y)
+                           + std::hypot(reference[next].x - reference[i].x, reference[next].y - reference[i].y));
+    }
+    double max_diag = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        hessian.diag[i] += options_.regularization * length[i];
+        max_diag = std::max(max_diag, hessian.diag[i]);
+    }
+    if (!(max_diag > 0.0)) {
+        return false;
+    }
+
+    // 射影ニュートン法。境界に張り付いていて勾配が外を向く点を固定し、残りの点は帯行列の
+    // ニュートン方向、固定した点は対角でスケールした勾配方向へ動かし、箱へ射影しながら
+    // Armijo 条件で刻みを決める。固定する点の集合を1反復で大きく入れ替えられるので、
+    // 接触区間が多くても反復回数が点数に比例して増えない
+    std::vector<double> alpha(count, 0.0);
+    for (size_t i = 0; i < count; ++i) {
+        alpha[i] = std::max(lower[i], std::min(upper[i], 0.0));
+    }
+
+    auto objective = [&](const std::vector<double>& x, std::vector<double>& hx) {
+        hessian.multiply(x, hx);
+        double value = 0.0;
+        for (size_t i = 0; i < count; ++i) {
+            value += x[i] * (0.5 * hx[i] + linear[i]);
+        }
+        return value;
+    };
+
+    std::vector<double> product(count), gradient(count), direction(count), trial(count), trial_product(count);
+    std::vector<char> fixed(count, 0);
+    double value = objective(alpha, product);
+    for (int iteration = 0; iteration < options_.max_active_set_iterations; ++iteration) {
+        ++stats_.active_set_iterations;
+
+        // 境界からこの距離以内で勾配が外を向く点を固定する
+        double epsilon = 0.0;
+        for (size_t i = 0; i < count; ++i) {
+            gradient[i] = product[i] + linear[i];
+            double projected = std::max(lower[i], std::min(upper[i], alpha[i] - gradient[i] / hessian.diag[i]));
+            epsilon = std::max(epsilon, std::abs(alpha[i] - projected));
+        }
+        epsilon = std::max(epsilon, ACTIVE_SET_EPSILON);
+
+        CyclicBandMatrix reduced = hessian;
+        for (size_t i = 0; i < count; ++i) {
+            fixed[i] = lower[i] == upper[i]
+                       || (alpha[i] <= lower[i] + epsilon && gradient[i] > 0.0)
+                       || (alpha[i] >= upper[i] - epsilon && gradient[i] < 0.0);
+            direction[i] = fixed[i] ? gradient[i] / hessian.diag[i] : gradient[i];
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (fixed[i]) {
+                reduced.diag[i] = 1.0;
+            }
+            for (size_t offset = 1; offset <= 2; ++offset) {
+                size_t j = (i + offset) % count;
+                if (fixed[i] || fixed[j]) {
+                    (offset == 1 ? reduced.band1[i] : reduced.band2[i]) = 0.0;
+                }
+            }
+        }
+        if (!solveCyclic(reduced, direction)) {
+            return false;
+        }
+
+        // 刻み1でもほとんど動かなければ収束（ここから先は目的関数の差が丸め誤差に埋もれる）
+        double max_change = 0.0;
+        for (size_t i = 0; i < count; ++i) {
+            double next = std::max(lower[i], std::min(upper[i], alpha[i] - direction[i]));
+            max_change = std::max(max_change, std::abs(next - alpha[i]));
+        }
+        if (max_change < STEP_TOLERANCE) {
+            break;
+        }
+
+        // alpha(t) = P(alpha - t * direction)
+        double step = 1.0;
+        double trial_value = value;
+        for (int halving = 0; halving < MAX_LINE_SEARCH_HALVINGS; ++halving, step *= 0.5) {
+            double expected = 0.0;
+            for (size_t i = 0; i < count; ++i) {
+                trial[i] = std::max(lower[i], std::min(upper[i], alpha[i] - step * direction[i]));
+                expected += fixed[i] ? gradient[i] * (alpha[i] - trial[i]) : step * gradient[i] * direction[i];
+            }
+            trial_value = objective(trial, trial_product);
+            if (value - trial_value >= ARMIJO_RATIO * expected) {
+                break;
+            }
+        }
+        if (trial_value > value) {
+            break;  // 丸め誤差の範囲まで下がりきった
+        }
+        alpha.swap(trial);
+        product.swap(trial_product);
+        value = trial_value;
+    }
+
+    // value は α^T H α / 2 + b^T α で、2次モデルの変化量の半分
+    predicted_decrease = -2.0 * value;
+    stats_.active_constraints = 0;
+    for (size_t i = 0; i < count; ++i) {
+        reference[i].x += alpha[i] * normal_x[i];
+        reference[i].y += alpha[i] * normal_y[i];
+        if (lower[i] != upper[i] && (alpha[i] <= lower[i] || alpha[i] >= upper[i])) {
+            ++stats_.active_constraints;
+        }
+    }
+    return true;
+}
+
+} // namespace trajectory_editor
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "trajectory_data.hpp"
+#include "track_boundaries.hpp"
+#include "segment_index.hpp"
+#include <vector>
+
+namespace trajectory_editor {
+
+// 最小曲率ライン最適化の設定
+struct RacelineOptions {
+    double margin = 0.5;               // 境界から確保する距離 [m]
+    double max_offset = 10.0;          // 境界がない側への最大移動量 [m]
+    int max_linearization_passes = 50; // 結果を基準線にして解き直す回数の上限
+    double trust_radius = 2.0;         // 1パスで各点を動かす量の上限の初期値 [m]（パスごとに伸縮する）
+    double cost_tolerance = 1e-6;      // 1パスでの Σ κ^2 ds の相対的な減少がこれ未満なら収束
+    int max_active_set_iterations = 100;  // 1パスあたりの射影ニュートン法の反復回数の上限
+    double regularization = 1e-9;      // Σ α^2 ds への重み [1/m^4]。周回コースの平行移動の自由度を抑える
+};
+
+// 最適化結果の統計
+struct RacelineStats {
+    bool converged = false;            // Σ κ^2 ds が下がりきったか（false ならパス数の上限で打ち切り）
+    int passes = 0;                    // 解いたパスの数
+    int accepted_passes = 0;           // そのうち Σ κ^2 ds が下がって採用したパスの数
+    int active_set_iterations = 0;     // 射影ニュートン法の反復回数（全パスの合計）
+    size_t active_constraints = 0;     // 境界に張り付いた点の数
+    double initial_cost = 0.0;         // Σ κ^2 ds [1/m]（初期ライン）
+    double final_cost = 0.0;
+    double max_abs_offset = 0.0;       // 初期ラインからの最大移動量 [m]
+};
+
+// 最小曲率ラインの最適化
+//
+// 初期ライン（読み込み中の軌跡）の各点をその法線方向へ α_i だけ動かすとし、
+// 曲率の2乗の積分 Σ κ^2 ds = Σ Δθ^2 / ds（Δθ は隣接区間の方位差）を、方位を α について
+// 線形化した2次式として組み立てる。ヘッセ行列は5重対角（周回コースなら角に要素を
+// 持つ巡回行列）になる。移動できる範囲 lo ≤ α ≤ hi は、各点から法線の両向きに
+// 半直線を飛ばして最初に当たる境界までの距離で決め、射影ニュートン法で扱う。
+// 各反復のニュートン方向は PentadiagonalSolver で O(n) で解く（巡回部分は
+// 4列のWoodbury補正）。法線と区間長を固定した線形化なので、結果を基準線にして
+// 解き直す。線形化が外れる大きな移動で曲率が逆に増えないよう、各パスの移動量を信頼半径で
+// 抑え、本来の Σ κ^2 ds が下がったパスだけを採用する（下がらなければ半径を縮めて解き直す）。
+// 結果は常に初期ライン以下のコストになる。始点と終点が一致する軌跡は周回として扱う。
+class RacelineOptimizer {
+public:
+    RacelineOptimizer();
+
+    // 設定
+    void setBoundaries(const TrackBoundaries& boundaries);
+    void setOptions(const RacelineOptions& options) { options_ = options; }
+    const RacelineOptions& getOptions() const { return options_; }
+
+    // 最適化（点数・速度・z は変えない）。点が少なすぎる場合は false
+    bool optimize(const std::vector<TrajectoryPoint>& initial, std::vector<TrajectoryPoint>& result);
+    const RacelineStats& getStatistics() const { return stats_; }
+
+    // Σ κ^2 ds（隣接区間の方位差による近似）
+    static double curvatureCost(const std::vector<TrajectoryPoint>& points, bool closed);
+
+private:
+    RacelineOptions options_;
+    SegmentIndex left_index_;
+    SegmentIndex right_index_;
+    bool has_boundaries_;
+    RacelineStats stats_;
+
+    // 1回分の線形化した問題を各点の移動量 radius 以内で解き、reference を更新する。
+    // predicted_decrease は2次モデルが予測する Σ κ^2 ds の減少量
+    bool solvePass(const std::vector<TrajectoryPoint>& initial, std::vector<TrajectoryPoint>& reference,
+                   size_t count, bool closed, double radius, double& predicted_decrease);
+};
+
+} // namespace trajectory_editor
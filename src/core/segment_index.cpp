@@ -0,0 +1,290 @@
+#include "segment_index.hpp"
+#include "../utils/trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace trajectory_editor {
+
+namespace {
+
+// 葉にまとめる区間数
+constexpr size_t LEAF_SIZE = 8;
+
+// 探索スタックの深さ（木の高さ×2で十分）
+constexpr size_t MAX_STACK_DEPTH = 128;
+
+} // namespace
+
+SegmentIndex::SegmentIndex() : leaf_base_(0) {}
+
+void SegmentIndex::clear() {
+    vertices_.clear();
+    nodes_.clear();
+    leaf_base_ = 0;
+}
+
+void SegmentIndex::build(const std::vector<BoundaryPoint>& polyline) {
+    vertices_.clear();
+    vertices_.reserve(polyline.size());
+    for (const auto& point : polyline) {
+        vertices_.push_back({point.x, point.y, 0.0});
+    }
+    buildTree();
+}
+
+void SegmentIndex::build(const std::vector<TrajectoryPoint>& polyline) {
+    vertices_.clear();
+    vertices_.reserve(polyline.size());
+    for (const auto& point : polyline) {
+        vertices_.push_back({point.x, point.y, 0.0});
+    }
+    buildTree();
+}
+
+void SegmentIndex::buildTree() {
+    TRACE_ZONE("SegmentIndex::build");
+    nodes_.clear();
+    leaf_base_ = 0;
+    if (vertices_.size() < 2) {
+        return;
+    }
+
+    size_t segment_count = vertices_.size() - 1;
+    for (size_t i = 0; i < segment_count; ++i) {
+        double dx = vertices_[i + 1].x - vertices_[i].x;
+        double dy = vertices_[i + 1].y - vertices_[i].y;
+        double length2 = dx * dx + dy * dy;
+        vertices_[i].inverse_length2 = length2 > 0.0 ? 1.0 / length2 : 0.0;
+    }
+
+    size_t leaf_count = (segment_count + LEAF_SIZE - 1) / LEAF_SIZE;
+    leaf_base_ = 1;
+    while (leaf_base_ < leaf_count) {
+        leaf_base_ <<= 1;
+    }
+
+    // 空の葉は無限遠の矩形にしておく（探索で必ず枝刈りされる）
+    const double inf = std::numeric_limits<double>::infinity();
+    nodes_.assign(2 * leaf_base_, Box{inf, inf, -inf, -inf});
+
+    for (size_t leaf = 0; leaf < leaf_count; ++leaf) {
+        Box& box = nodes_[leaf_base_ + leaf];
+        size_t first = leaf * LEAF_SIZE;
+        size_t last = std::min(first + LEAF_SIZE, segment_count);  // 区間 [first, last) の頂点は [first, last]
+        for (size_t v = first; v <= last; ++v) {
+            box.min_x = std::min(box.min_x, vertices_[v].x);
+            box.min_y = std::min(box.min_y, vertices_[v].y);
+            box.max_x = std::max(box.max_x, vertices_[v].x);
+            box.max_y = std::max(box.max_y, vertices_[v].y);
+        }
+    }
+
+    for (size_t node = leaf_base_ - 1; node >= 1; --node) {
+        const Box& left = nodes_[2 * node];
+        const Box& right = nodes_[2 * node + 1];
+        nodes_[node] = Box{std::min(left.min_x, right.min_x), std::min(left.min_y, right.min_y),
+                           std::max(left.max_x, right.max_x), std::max(left.max_y, right.max_y)};
+    }
+}
+
+void SegmentIndex::evaluateSegment(size_t segment, double x, double y, SegmentHit& best, double& best_distance2) const {
+    const Vertex& a = vertices_[segment];
+    const Vertex& b = vertices_[segment + 1];
+    double dx = b.x - a.x;
+    double dy = b.y - a.y;
+    double t = ((x - a.x) * dx + (y - a.y) * dy) * a.inverse_length2;
+    t = std::max(0.0, std::min(1.0, t));
+
+    double px = a.x + t * dx;
+    double py = a.y + t * dy;
+    double distance2 = (x - px) * (x - px) + (y - py) * (y - py);
+    // 同じ距離なら番号の小さい区間を採る（探索順によらず結果を一意にする）
+    if (best.valid && (distance2 > best_distance2 || (distance2 == best_distance2 && segment >= best.segment))) {
+        return;
+    }
+
+    double cross = dx * (y - a.y) - dy * (x - a.x);
+    best.valid = true;
+    best.segment = segment;
+    best.ratio = t;
+    best.x = px;
+    best.y = py;
+    best.signed_distance = cross < 0.0 ? -1.0 : 1.0;  // 距離は最後に掛ける
+    best_distance2 = distance2;
+}
+
+void SegmentIndex::resolveVertexSide(double x, double y, SegmentHit& hit) const {
+    // 最近傍が内部の頂点の場合、区間ごとの左右判定は曖昧なので頂点の曲がる向きで決める
+    size_t vertex;
+    if (hit.ratio <= 0.0) {
+        vertex = hit.segment;
+    } else if (hit.ratio >= 1.0) {
+        vertex = hit.segment + 1;
+    } else {
+        return;
+    }
+    if (vertex == 0 || vertex + 1 >= vertices_.size()) {
+        return;
+    }
+
+    const Vertex& prev = vertices_[vertex - 1];
+    const Vertex& v = vertices_[vertex];
+    const Vertex& next = vertices_[vertex + 1];
+    double d1x = v.x - prev.x, d1y = v.y - prev.y;
+    double d2x = next.x - v.x, d2y = next.y - v.y;
+    double px = x - v.x, py = y - v.y;
+
+    // 両隣の区間で端点にクランプされる（頂点の外側の扇形にある）場合だけ
+    bool outside_corner = (px * d1x + py * d1y) >= 0.0 && (px * d2x + py * d2y) <= 0.0;
+    double turn = d1x * d2y - d1y * d2x;
+    if (outside_corner && turn != 0.0) {
+        // 左折する頂点の外側は右側
+        hit.signed_distance = turn > 0.0 ? -hit.distance : hit.distance;
+    }
+}
+
+SegmentHit SegmentIndex::findNearest(double x, double y) const {
+    return search(x, y, nullptr);
+}
+
+SegmentHit SegmentIndex::findNearest(double x, double y, size_t hint_segment) const {
+    return search(x, y, &hint_segment);
+}
+
+SegmentHit SegmentIndex::search(double x, double y, const size_t* hint_segment) const {
+    SegmentHit best;
+    if (nodes_.empty()) {
+        return best;
+    }
+
+    auto box_distance2 = [x, y](const Box& box) {
+        double dx = std::max(0.0, std::max(box.min_x - x, x - box.max_x));
+        double dy = std::max(0.0, std::max(box.min_y - y, y - box.max_y));
+        return dx * dx + dy * dy;
+    };
+
+    size_t segment_count = vertices_.size() - 1;
+    double best_distance2 = std::numeric_limits<double>::infinity();
+
+    // ヒントの葉を先に調べて上限距離を決めておく
+    if (hint_segment && *hint_segment < segment_count) {
+        size_t first = (*hint_segment / LEAF_SIZE) * LEAF_SIZE;
+        size_t last = std::min(first + LEAF_SIZE, segment_count);
+        for (size_t s = first; s < last; ++s) {
+            evaluateSegment(s, x, y, best, best_distance2);
+        }
+    }
+    size_t stack[MAX_STACK_DEPTH];
+    size_t depth = 0;
+    stack[depth++] = 1;
+
+    // 近い子から辿る分枝限定法
+    while (depth > 0) {
+        size_t node = stack[--depth];
+        if (box_distance2(nodes_[node]) > best_distance2) {
+            continue;
+        }
+        if (node >= leaf_base_) {
+            size_t first = (node - leaf_base_) * LEAF_SIZE;
+            size_t last = std::min(first + LEAF_SIZE, segment_count);
+            for (size_t s = first; s < last; ++s) {
+                evaluateSegment(s, x, y, best, best_distance2);
+            }
+            continue;
+        }
+
+        size_t left = 2 * node;
+        size_t right = left + 1;
+        bool left_first = box_distance2(nodes_[left]) <= box_distance2(nodes_[right]);
+        stack[depth++] = left_first ? right : left;
+        stack[depth++] = left_first ? left : right;
+    }
+
+    if (best.valid) {
+        best.distance = std::sqrt(best_distance2);
+        best.signed_distance *= best.distance;
+        resolveVertexSide(x, y, best);
+    }
+    return best;
+}
+
+double SegmentIndex::intersectRay(double x, double y, double dir_x, double dir_y, double max_distance) const {
+    double best = std::numeric_limits<double>::infinity();
+    if (nodes_.empty()) {
+        return best;
+    }
+    size_t segment_count = vertices_.size() - 1;
+    double limit = max_distance;
+
+    // 矩形と線分 [0, limit] の交差判定（スラブ法）
+    auto hits_box = [&](const Box& box) {
+        if (box.min_x > box.max_x) {
+            return false;  // 空の葉
+        }
+        double t_min = 0.0;
+        double t_max = limit;
+        const double origin[2] = {x, y};
+        const double dir[2] = {dir_x, dir_y};
+        const double lo[2] = {box.min_x, box.min_y};
+        const double hi[2] = {box.max_x, box.max_y};
+        for (int axis = 0; axis < 2; ++axis) {
+            if (dir[axis] == 0.0) {
+                if (origin[axis] < lo[axis] || origin[axis] > hi[axis]) {
+                    return false;
+                }
+                continue;
+            }
+            double t0 = (lo[axis] - origin[axis]) / dir[axis];
+            double t1 = (hi[axis] - origin[axis]) / dir[axis];
+            if (t0 > t1) {
+                std::swap(t0, t1);
+            }
+            t_min = std::max(t_min, t0);
+            t_max = std::min(t_max, t1);
+            if (t_min > t_max) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    size_t stack[MAX_STACK_DEPTH];
+    size_t depth = 0;
+    stack[depth++] = 1;
+    while (depth > 0) {
+        size_t node = stack[--depth];
+        if (!hits_box(nodes_[node])) {
+            continue;
+        }
+        if (node < leaf_base_) {
+            stack[depth++] = 2 * node + 1;
+            stack[depth++] = 2 * node;
+            continue;
+        }
+
+        size_t first = (node - leaf_base_) * LEAF_SIZE;
+        size_t last = std::min(first + LEAF_SIZE, segment_count);
+        for (size_t s = first; s < last; ++s) {
+            const Vertex& a = vertices_[s];
+            const Vertex& b = vertices_[s + 1];
+            double ex = b.x - a.x;
+            double ey = b.y - a.y;
+            double denominator = dir_x * ey - dir_y * ex;
+            if (denominator == 0.0) {
+                continue;  // 平行
+            }
+            double ax = a.x - x;
+            double ay = a.y - y;
+            double t = (ax * ey - ay * ex) / denominator;
+            double u = (ax * dir_y - ay * dir_x) / denominator;
+            if (t >= 0.0 && t <= limit && u >= 0.0 && u <= 1.0) {
+                best = t;
+                limit = t;
+            }
+        }
+    }
+    return best;
+}
+
+} // namespace trajectory_editor
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "trajectory_data.hpp"
+#include "track_boundaries.hpp"
+#include <vector>
+
+namespace trajectory_editor {
+
+// 折れ線上の最近傍点の検索結果
+struct SegmentHit {
+    bool valid = false;
+    size_t segment = 0;           // 区間の始点インデックス
+    double ratio = 0.0;           // 区間内の位置 [0, 1]
+    double x = 0.0;               // 最近傍点
+    double y = 0.0;
+    double distance = 0.0;        // 最近傍点までの距離 [m]
+    double signed_distance = 0.0; // 折れ線の進行方向に対して左が正 [m]
+};
+
+// 折れ線の区間の空間インデックス
+//
+// 連続する区間をまとめた外接矩形の二分木（区間の並び順で分割する）。
+// 折れ線は並び順に空間的にも近いので矩形が小さく、点の密度に関係なく
+// 枝刈りが効く。検索はconstなので複数スレッドから呼べる。
+// （一様グリッドは密な周回でセルあたりの区間数が膨らむので使わない。境界・比較・
+// Frenet座標の射影はどれもこの木を使う）
+class SegmentIndex {
+public:
+    SegmentIndex();
+
+    // 構築
+    void build(const std::vector<BoundaryPoint>& polyline);
+    void build(const std::vector<TrajectoryPoint>& polyline);
+    void clear();
+
+    // データアクセス
+    bool empty() const { return vertices_.size() < 2; }
+    size_t getSegmentCount() const { return vertices_.size() < 2 ? 0 : vertices_.size() - 1; }
+
+    // 検索（hint_segment に近い区間から調べると枝刈りが早く効く。連続した点の検索向け）
+    SegmentHit findNearest(double x, double y) const;
+    SegmentHit findNearest(double x, double y, size_t hint_segment) const;
+
+    // 半直線 (x, y) + t (dir_x, dir_y)（0 ≤ t ≤ max_distance、方向は単位ベクトル）が
+    // 最初に交わる区間までの距離。交わらなければ +inf
+    double intersectRay(double x, double y, double dir_x, double dir_y, double max_distance) const;
+
+private:
+    struct Vertex {
+        double x;
+        double y;
+        double inverse_length2;  // この頂点から始まる区間の長さの2乗の逆数（長さ0なら0）
+    };
+
+    struct Box {
+        double min_x, min_y, max_x, max_y;
+    };
+
+    std::vector<Vertex> vertices_;
+    std::vector<Box> nodes_;   // 完全二分木（1始まり、葉は leaf_base_ 以降）
+    size_t leaf_base_;
+
+    void buildTree();
+    SegmentHit search(double x, double y, const size_t* hint_segment) const;
+    void evaluateSegment(size_t segment, double x, double y, SegmentHit& best, double& best_distance2) const;
+    void resolveVertexSide(double x, double y, SegmentHit& hit) const;
+};
+
+} // namespace trajectory_editor
@@ -0,0 +1,112 @@
+#include "synthetic_track.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace trajectory_editor {
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+
+// 方位角の正弦波（波長 [m] と振幅 [rad]）
+//
+// 振幅の和を90度未満にしておくと常にx方向へ進むので、コースは自分と交差しない。
+struct HeadingWave {
+    double wavelength;
+    double amplitude;
+};
+
+constexpr HeadingWave HEADING_WAVES[] = {
+    {90.0, 0.2},
+    {180.0, 0.3},
+    {470.0, 0.4},
+    {1300.0, 0.45},
+};
+constexpr size_t WAVE_COUNT = sizeof(HEADING_WAVES) / sizeof(HEADING_WAVES[0]);
+
+// 高低差（波長 [m] と振幅 [m]）
+constexpr double ELEVATION_WAVELENGTH = 1000.0;
+constexpr double ELEVATION_AMPLITUDE = 2.0;
+
+// SplitMix64（シードから位相を決めるだけなので品質はこれで足りる）
+uint64_t nextRandom(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+} // namespace
+
+SyntheticTrackGenerator::SyntheticTrackGenerator() {}
+
+template <typename Visit>
+void SyntheticTrackGenerator::walk(Visit&& visit) const {
+    const size_t n = options_.point_count;
+    if (n == 0) {
+        return;
+    }
+    const double ds = options_.spacing;
+
+    uint64_t state = options_.seed;
+    double phases[WAVE_COUNT];
+    double rates[WAVE_COUNT];
+    for (size_t k = 0; k < WAVE_COUNT; ++k) {
+        phases[k] = 2.0 * PI * static_cast<double>(nextRandom(state) >> 11) * 0x1.0p-53;
+        rates[k] = 2.0 * PI / HEADING_WAVES[k].wavelength;
+    }
+
+    double x = 0.0;
+    double y = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        double s = static_cast<double>(i) * ds;
+        double heading = 0.0;
+        double curvature = 0.0;
+        for (size_t k = 0; k < WAVE_COUNT; ++k) {
+            double angle = rates[k] * s + phases[k];
+            heading += HEADING_WAVES[k].amplitude * std::sin(angle);
+            curvature += HEADING_WAVES[k].amplitude * rates[k] * std::cos(angle);
+        }
+        double z = ELEVATION_AMPLITUDE * std::sin(2.0 * PI * s / ELEVATION_WAVELENGTH);
+
+        visit(x, y, z, heading, curvature);
+
+        x += ds * std::cos(heading);
+        y += ds * std::sin(heading);
+    }
+}
+
+std::vector<TrajectoryPoint> SyntheticTrackGenerator::generateTrajectory() const {
+    std::vector<TrajectoryPoint> points;
+    points.reserve(options_.point_count);
+
+    const double max_velocity = options_.max_velocity;
+    const double lateral_acceleration = options_.lateral_acceleration;
+    walk([&](double x, double y, double z, double, double curvature) {
+        double velocity = max_velocity;
+        if (std::abs(curvature) > 0.0) {
+            velocity = std::min(max_velocity, std::sqrt(lateral_acceleration / std::abs(curvature)));
+        }
+        points.emplace_back(x, y, z, velocity);
+    });
+    return points;
+}
+
+void SyntheticTrackGenerator::generateBoundaries(std::vector<BoundaryPoint>& left,
+                                                 std::vector<BoundaryPoint>& right) const {
+    left.clear();
+    right.clear();
+    left.reserve(options_.point_count);
+    right.reserve(options_.point_count);
+
+    // 中心線から法線方向に半幅ずつずらす（左が進行方向の左）
+    const double half_width = 0.5 * options_.track_width;
+    walk([&](double x, double y, double z, double heading, double) {
+        double nx = -std::sin(heading) * half_width;
+        double ny = std::cos(heading) * half_width;
+        left.emplace_back(x + nx, y + ny, z);
+        right.emplace_back(x - nx, y - ny, z);
+    });
+}
+
+} // namespace trajectory_editor
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "trajectory_data.hpp"
+#include "track_boundaries.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace trajectory_editor {
+
+// 合成コースの生成パラメータ
+struct SyntheticTrackOptions {
+    size_t point_count = 1000;
+    double spacing = 1.0;              // 点の間隔 [m]
+    double track_width = 12.0;         // コース幅 [m]
+    double lateral_acceleration = 8.0; // 速度を決める横加速度 [m/s^2]
+    double max_velocity = 80.0;        // [m/s]
+    uint64_t seed = 1;
+};
+
+// ベンチマーク・テスト用の合成コース（軌跡と左右の境界線）
+//
+// 方位角を弧長の関数（波長の異なる正弦波の和）として与え、点の間隔ごとに積分して
+// 中心線を作る（x方向へ蛇行しながら進む開いたコース）。カーブの大きさは点数によらず
+// 同じなので、点数を増やすとコースが長くなる。速度は曲率と横加速度から決める。
+// 乱数はシードから決まる位相だけに使うので、同じオプションからは常に同じ点列ができる。
+class SyntheticTrackGenerator {
+public:
+    SyntheticTrackGenerator();
+
+    // 設定
+    void setOptions(const SyntheticTrackOptions& options) { options_ = options; }
+    const SyntheticTrackOptions& getOptions() const { return options_; }
+
+    // 生成
+    std::vector<TrajectoryPoint> generateTrajectory() const;
+    void generateBoundaries(std::vector<BoundaryPoint>& left, std::vector<BoundaryPoint>& right) const;
+
+private:
+    SyntheticTrackOptions options_;
+
+    // 中心線を先頭から順にたどり、点ごとに visit(x, y, z, heading, curvature) を呼ぶ
+    template <typename Visit>
+    void walk(Visit&& visit) const;
+};
+
+} // namespace trajectory_editor
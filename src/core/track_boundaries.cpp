@@ -1,18 +1,48 @@
 #include "track_boundaries.hpp"
+#include "boundary_tiles.hpp"
 #include "../utils/csv_parser.hpp"
+#include "../utils/osm_parser.hpp"
+#include "../utils/lanelet_graph.hpp"
+#include "../utils/osm_cache.hpp"
+#include "../utils/boundary_writer.hpp"
+#include "../utils/trace.hpp"
 #include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <limits>
-#include <iostream>
 
 namespace trajectory_editor {
 
-TrackBoundaries::TrackBoundaries() : is_visible_(true) {}
+namespace {
+
+// OSM地図の境界線のタイルの大きさ [m]
+constexpr double OSM_TILE_SIZE = 50.0;
+
+bool hasExtension(const std::string& filepath, const std::string& extension) {
+    if (filepath.size() < extension.size()) {
+        return false;
+    }
+    return std::equal(extension.rbegin(), extension.rend(), filepath.rbegin(), [](char a, char b) {
+        return a == std::tolower(static_cast<unsigned char>(b));
+    });
+}
+
+} // namespace
+
+TrackBoundaries::TrackBoundaries() : is_visible_(true), skipped_rows_(0) {}
 
 TrackBoundaries::~TrackBoundaries() = default;
 
 void TrackBoundaries::clear() {
     left_boundary_.clear();
     right_boundary_.clear();
+    tiles_.reset();
+}
+
+bool TrackBoundaries::hasTiles() const {
+    return tiles_ && !tiles_->empty();
 }
 
 void TrackBoundaries::setLeftBoundary(const std::vector<BoundaryPoint>& points) {
@@ -61,26 +91,128 @@ void TrackBoundaries::getBounds(double& min_x, double& max_x, double& min_y, dou
     }
 }
 
+bool TrackBoundaries::loadFromFile(const std::string& filepath) {
+    TRACE_ZONE("TrackBoundaries::loadFromFile");
+    if (hasExtension(filepath, ".osm")) {
+        return loadFromOSM(filepath);
+    }
+    if (hasExtension(filepath, ".trkb")) {
+        return loadFromBinary(filepath);
+    }
+    return loadFromCSV(filepath);
+}
+
 bool TrackBoundaries::loadFromCSV(const std::string& filepath) {
     clear();
+    last_error_.clear();
     
     // 複数の形式を試行
-    if (loadSeparateBoundaries(filepath)) {
-        std::cout << "Loaded as separate boundaries format" << std::endl;
-        return true;
+    bool loaded = loadSeparateBoundaries(filepath) || loadInterleaved(filepath) || loadSingleBoundary(filepath);
+    
+    // 読み飛ばした行の数は採用した形式のもの
+    if (!loaded) {
+        skipped_rows_ = 0;
+        last_error_ = "No boundary points recognized in " + filepath;
+    } else if (skipped_rows_ > 0) {
+        last_error_ = "Skipped " + std::to_string(skipped_rows_) + " rows in " + filepath;
+    }
+    return loaded;
+}
+
+bool TrackBoundaries::loadFromBinary(const std::string& filepath) {
+    clear();
+    skipped_rows_ = 0;
+    
+    FILE* file = std::fopen(filepath.c_str(), "rb");
+    if (!file) {
+        last_error_ = "Cannot open: " + filepath;
+        return false;
+    }
+    
+    BoundaryBinaryHeader header;
+    if (std::fread(&header, sizeof(header), 1, file) != 1 ||
+        std::memcmp(header.magic, "TRKB", 4) != 0 ||
+        header.version != BOUNDARY_BINARY_VERSION) {
+        std::fclose(file);
+        last_error_ = "Not a boundary binary file (or unsupported version): " + filepath;
+        return false;
     }
     
-    if (loadInterleaved(filepath)) {
-        std::cout << "Loaded as interleaved format" << std::endl;
-        return true;
+    // 1行は左右の (x, y, z)。行数は掛け算する前に実際のファイルの大きさと照らし合わせる
+    constexpr size_t ROW_BYTES = 6 * sizeof(double);
+    std::error_code error;
+    uint64_t file_size = std::filesystem::file_size(filepath, error);
+    if (error || header.row_count > (file_size - sizeof(header)) / ROW_BYTES) {
+        std::fclose(file);
+        last_error_ = "Truncated file: " + filepath + " (header claims " + std::to_string(header.row_count) +
+                      " rows)";
+        return false;
+    }
+    std::vector<double> values(static_cast<size_t>(header.row_count) * 6);
+    size_t read_count = std::fread(values.data(), sizeof(double), values.size(), file);
+    std::fclose(file);
+    if (read_count != values.size()) {
+        last_error_ = "Truncated file: " + filepath;
+        return false;
     }
+    last_error_ = header.row_count == 0 ? "No boundary rows in " + filepath : std::string();
     
-    if (loadSingleBoundary(filepath)) {
-        std::cout << "Loaded as single boundary format" << std::endl;
-        return true;
+    left_boundary_.reserve(header.row_count);
+    right_boundary_.reserve(header.row_count);
+    for (size_t i = 0; i < values.size(); i += 6) {
+        left_boundary_.emplace_back(values[i], values[i + 1], values[i + 2]);
+        right_boundary_.emplace_back(values[i + 3], values[i + 4], values[i + 5]);
     }
+    return !left_boundary_.empty() && !right_boundary_.empty();
+}
+
+bool TrackBoundaries::loadFromOSM(const std::string& filepath) {
+    TRACE_ZONE("TrackBoundaries::loadFromOSM");
+    clear();
+    skipped_rows_ = 0;
+    last_error_.clear();
+    
+    // 地図のテーブルはタイル索引が参照し続ける
+    auto parser = std::make_shared<OSMParser>();
+    OSMCache cache;
+    std::vector<std::pair<LanePoint, LanePoint>> rows;
     
-    return false;
+    if (!cache.load(filepath, *parser, rows)) {
+        if (!parser->loadFromFile(filepath)) {
+            last_error_ = "Failed to parse OSM map: " + filepath + " (" + parser->getLastError() + ")";
+            return false;
+        }
+        
+        LaneletGraph graph;
+        graph.build(*parser);
+        if (graph.size() == 0) {
+            last_error_ = "No lanelets in OSM map: " + filepath;
+            return false;
+        }
+        rows = LaneletGraph::pairByArcLength(graph.stitch().front());
+        
+        // キャッシュが書けなくても読み込みは成功とし、理由だけ残す
+        if (!cache.save(filepath, *parser, rows)) {
+            last_error_ = "Failed to write OSM cache: " + cache.getStatus();
+        }
+    }
+    
+    left_boundary_.reserve(rows.size());
+    right_boundary_.reserve(rows.size());
+    for (const auto& [left_point, right_point] : rows) {
+        left_boundary_.emplace_back(left_point.x, left_point.y, left_point.z);
+        right_boundary_.emplace_back(right_point.x, right_point.y, right_point.z);
+    }
+    
+    // 地図全体の境界線は表示範囲のタイルだけを取り出して描く
+    auto tiles = std::make_shared<BoundaryTileIndex>();
+    tiles->build(parser, LaneletGraph::collectBoundaryWays(*parser), OSM_TILE_SIZE);
+    tiles_ = std::move(tiles);
+    
+    if (rows.empty()) {
+        last_error_ = "No boundary rows in OSM map: " + filepath;
+    }
+    return !left_boundary_.empty() && !right_boundary_.empty();
 }
 
 bool TrackBoundaries::loadSeparateBoundaries(const std::string& filepath) {
@@ -93,6 +225,7 @@ bool TrackBoundaries::loadSeparateBoundaries(const std::string& filepath) {
     
     // ヘッダーをスキップ
     size_t start_row = parser.hasHeader() ? 1 : 0;
+    skipped_rows_ = 0;
     
     // 6列想定: left_x, left_y, left_z, right_x, right_y, right_z
     // または4列: left_x, left_y, right_x, right_y
@@ -112,6 +245,7 @@ bool TrackBoundaries::loadSeparateBoundaries(const std::string& filepath) {
                 left_boundary_.emplace_back(left_x, left_y, left_z);
                 right_boundary_.emplace_back(right_x, right_y, right_z);
             } catch (const std::exception&) {
+                ++skipped_rows_;
                 continue;
             }
         } else if (row.size() >= 4) {
@@ -125,8 +259,11 @@ bool TrackBoundaries::loadSeparateBoundaries(const std::string& filepath) {
                 left_boundary_.emplace_back(left_x, left_y, 0.0);
                 right_boundary_.emplace_back(right_x, right_y, 0.0);
             } catch (const std::exception&) {
+                ++skipped_rows_;
                 continue;
             }
+        } else {
+            ++skipped_rows_;
         }
     }
     
@@ -143,6 +280,7 @@ bool TrackBoundaries::loadInterleaved(const std::string& filepath) {
     
     // ヘッダーをスキップ
     size_t start_row = parser.hasHeader() ? 1 : 0;
+    skipped_rows_ = 0;
     
     // 交互形式: 奇数行=左境界、偶数行=右境界
     // または type列で判定
@@ -172,8 +310,11 @@ bool TrackBoundaries::loadInterleaved(const std::string& filepath) {
                     }
                 }
             } catch (const std::exception&) {
+                ++skipped_rows_;
                 continue;
             }
+        } else {
+            ++skipped_rows_;
         }
     }
     
@@ -190,6 +331,7 @@ bool TrackBoundaries::loadSingleBoundary(const std::string& filepath) {
     
     // ヘッダーをスキップ
     size_t start_row = parser.hasHeader() ? 1 : 0;
+    skipped_rows_ = 0;
     
     // 単一境界線として左側に読み込み
     for (size_t i = start_row; i < csv_data.size(); ++i) {
@@ -203,8 +345,11 @@ bool TrackBoundaries::loadSingleBoundary(const std::string& filepath) {
                 
                 left_boundary_.emplace_back(x, y, z);
             } catch (const std::exception&) {
+                ++skipped_rows_;
                 continue;
             }
+        } else {
+            ++skipped_rows_;
         }
     }
     
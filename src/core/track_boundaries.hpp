@@ -2,9 +2,12 @@
 
 #include <vector>
 #include <string>
+#include <memory>
 
 namespace trajectory_editor {
 
+class BoundaryTileIndex;
+
 struct BoundaryPoint {
     double x = 0.0;
     double y = 0.0;
@@ -37,7 +40,18 @@ public:
     void getBounds(double& min_x, double& max_x, double& min_y, double& max_y) const;
     
     // ファイル操作
+    bool loadFromFile(const std::string& filepath);  // 拡張子（.osm / .trkb / それ以外はCSV）で読み分ける
     bool loadFromCSV(const std::string& filepath);
+    bool loadFromBinary(const std::string& filepath);
+    bool loadFromOSM(const std::string& filepath);  // Lanelet2地図（最も長いlaneletの列を左右の境界線にする）
+    
+    // 直前の読み込みの結果（失敗の理由。読み込みに成功しても読み飛ばした行・書けなかったキャッシュがあればその説明）
+    const std::string& getLastError() const { return last_error_; }
+    size_t getSkippedRowCount() const { return skipped_rows_; }
+    
+    // 地図全体の境界線のタイル索引（OSMから読み込んだ場合のみ）
+    const BoundaryTileIndex* getTiles() const { return tiles_.get(); }
+    bool hasTiles() const;
     
     // 表示設定
     bool isVisible() const { return is_visible_; }
@@ -47,6 +61,9 @@ private:
     std::vector<BoundaryPoint> left_boundary_;
     std::vector<BoundaryPoint> right_boundary_;
     bool is_visible_;
+    std::shared_ptr<const BoundaryTileIndex> tiles_;  // 読み込み後は変更しないのでコピー間で共有する
+    std::string last_error_;
+    size_t skipped_rows_;
     
     // CSVファイル形式の判定と読み込み
     bool loadSeparateBoundaries(const std::string& filepath);  // 左右別々の列
@@ -0,0 +1,192 @@
+#include "track_clearance.hpp"
+#include "../utils/parallel.hpp"
+#include "../utils/trace.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace trajectory_editor {
+
+namespace {
+
+// 並列化する最小のチャンク（これより少ない点数なら呼び出し元で計算）
+constexpr size_t PARALLEL_CHUNK = 2048;
+
+// 反対側の境界線の中間点がどちら側にあるかでコース内側を決める
+double findInsideSign(const SegmentIndex& index, const std::vector<BoundaryPoint>& opposite,
+                      double default_sign) {
+    if (index.empty() || opposite.empty()) {
+        return default_sign;
+    }
+    const auto& probe = opposite[opposite.size() / 2];
+    SegmentHit hit = index.findNearest(probe.x, probe.y);
+    if (!hit.valid || hit.signed_distance == 0.0) {
+        return default_sign;
+    }
+    return hit.signed_distance > 0.0 ? 1.0 : -1.0;
+}
+
+} // namespace
+
+TrackClearance::TrackClearance()
+    : left_inside_sign_(-1.0), right_inside_sign_(1.0), margin_(0.0),
+      data_(nullptr), revision_(0), violation_count_(0),
+      min_clearance_(-std::numeric_limits<double>::infinity()), last_recomputed_(0) {}
+
+void TrackClearance::setBoundaries(const TrackBoundaries& boundaries) {
+    left_index_.build(boundaries.getLeftBoundary());
+    right_index_.build(boundaries.getRightBoundary());
+
+    // 進行方向に対して左境界は右側、右境界は左側がコース内側（境界が逆向きでも判定する）
+    left_inside_sign_ = findInsideSign(left_index_, boundaries.getRightBoundary(), -1.0);
+    right_inside_sign_ = findInsideSign(right_index_, boundaries.getLeftBoundary(), 1.0);
+    data_ = nullptr;
+}
+
+void TrackClearance::setMargin(double margin) {
+    margin_ = margin;
+    changed_violations_.clear();
+    classify(0, flags_.size());
+}
+
+void TrackClearance::clear() {
+    data_ = nullptr;
+    revision_ = 0;
+    left_clearance_.clear();
+    right_clearance_.clear();
+    flags_.clear();
+    violation_count_ = 0;
+    changed_violations_.clear();
+    updateMinimum(0, 0, true);
+    last_recomputed_ = 0;
+}
+
+void TrackClearance::build(const TrajectoryData& data) {
+    data_ = &data;
+    revision_ = data.getRevision();
+
+    size_t n = data.size();
+    left_clearance_.assign(n, std::numeric_limits<double>::infinity());
+    right_clearance_.assign(n, std::numeric_limits<double>::infinity());
+    // 点数が同じなら前のフラグと比べて変わった点を残す
+    if (flags_.size() != n) {
+        flags_.assign(n, 0);
+        violation_count_ = 0;
+    }
+    changed_violations_.clear();
+    recompute(data, 0, n);
+    updateMinimum(0, n, true);
+}
+
+void TrackClearance::update(const TrajectoryData& data) {
+    TRACE_ZONE("TrackClearance::update");
+    if (data_ != &data) {
+        build(data);
+        return;
+    }
+
+    TrajectoryChange change = data.getChangesSince(revision_);
+    revision_ = data.getRevision();
+    last_recomputed_ = 0;
+    changed_violations_.clear();
+    if (change.none || !change.geometric) {
+        return;
+    }
+
+    // 各点の距離はその点の座標だけで決まる
+    size_t n = data.size();
+    size_t old_size = flags_.size();
+    size_t begin = 0;
+    size_t end = 0;
+    change.getRecomputeRange(n, 0, begin, end);
+
+    // 再計算する範囲に入る前の点の違反を数え直す（範囲より後ろは点数の差だけずれるだけ）
+    size_t old_end = end + old_size >= n ? std::min(old_size, end + old_size - n) : begin;
+    size_t replaced = 0;
+    for (size_t i = std::min(begin, old_end); i < old_end; ++i) {
+        replaced += flags_[i];
+    }
+    change.shiftColumn(left_clearance_, n);
+    change.shiftColumn(right_clearance_, n);
+    change.shiftColumn(flags_, n);
+    size_t shifted = 0;
+    for (size_t i = begin; i < end; ++i) {
+        shifted += flags_[i];
+    }
+    violation_count_ = violation_count_ - replaced + shifted;
+
+    recompute(data, begin, end);
+    updateMinimum(begin, end, n != old_size);
+}
+
+void TrackClearance::recompute(const TrajectoryData& data, size_t begin, size_t end) {
+    const auto& points = data.getPoints();
+    end = std::min(end, points.size());
+    if (begin >= end) {
+        return;
+    }
+    last_recomputed_ = end - begin;
+
+    parallelFor(begin, end, PARALLEL_CHUNK, [&](size_t chunk_begin, size_t chunk_end) {
+        size_t left_hint = SIZE_MAX;  // 前の点の最近傍区間から探す
+        size_t right_hint = SIZE_MAX;
+        for (size_t i = chunk_begin; i < chunk_end; ++i) {
+            const auto& point = points[i];
+            double left = std::numeric_limits<double>::infinity();
+            double right = std::numeric_limits<double>::infinity();
+            if (!left_index_.empty()) {
+                SegmentHit hit = left_index_.findNearest(point.x, point.y, left_hint);
+                left = left_inside_sign_ * hit.signed_distance;
+                left_hint = hit.segment;
+            }
+            if (!right_index_.empty()) {
+                SegmentHit hit = right_index_.findNearest(point.x, point.y, right_hint);
+                right = right_inside_sign_ * hit.signed_distance;
+                right_hint = hit.segment;
+            }
+            left_clearance_[i] = left;
+            right_clearance_[i] = right;
+        }
+    });
+    classify(begin, end);
+}
+
+void TrackClearance::classify(size_t begin, size_t end) {
+    end = std::min(end, flags_.size());
+    for (size_t i = begin; i < end; ++i) {
+        uint8_t flag = getClearance(i) < margin_ ? 1 : 0;
+        if (flag != flags_[i]) {
+            changed_violations_.push_back(i);
+            violation_count_ = flag ? violation_count_ + 1 : violation_count_ - 1;
+        }
+        flags_[i] = flag;
+    }
+}
+
+void TrackClearance::updateMinimum(size_t begin, size_t end, bool rebuild) {
+    // 点数が変わると後ろの点の添字がずれるので作り直す
+    if (rebuild) {
+        begin = 0;
+        end = left_clearance_.size();
+        min_clearance_.resize(end);
+    }
+    for (size_t i = begin; i < end; ++i) {
+        min_clearance_.set(i, -getClearance(i));
+    }
+    min_clearance_.refresh(begin, end);
+}
+
+double TrackClearance::getClearance(size_t index) const {
+    return std::min(left_clearance_[index], right_clearance_[index]);
+}
+
+std::vector<size_t> TrackClearance::getViolations() const {
+    std::vector<size_t> violations;
+    for (size_t i = 0; i < flags_.size(); ++i) {
+        if (flags_[i]) {
+            violations.push_back(i);
+        }
+    }
+    return violations;
+}
+
+} // namespace trajectory_editor
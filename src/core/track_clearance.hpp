@@ -0,0 +1,77 @@
+#pragma once
+
+#include "trajectory_data.hpp"
+#include "track_boundaries.hpp"
+#include "segment_index.hpp"
+#include "max_tree.hpp"
+#include <vector>
+#include <cstdint>
+
+namespace trajectory_editor {
+
+// 軌跡の各点からコース境界までの余裕距離
+//
+// 左右の境界線それぞれに SegmentIndex を作り、点ごとに符号付き距離を求める
+// （コース内側が正）。全点の計算は並列に行い、update() では変更ジャーナルで
+// 動いた点だけを再評価する。
+// 最小値と違反の数も再計算した範囲だけで更新する（最小値は符号を反転して MaxTree で持つ）。
+// 表示側は getChangedViolations() の点だけを描き直せばよい。
+class TrackClearance {
+public:
+    TrackClearance();
+
+    // 境界の設定（インデックスを作り直し、次の update() で全点を再計算する）
+    void setBoundaries(const TrackBoundaries& boundaries);
+    bool hasBoundaries() const { return !left_index_.empty() || !right_index_.empty(); }
+
+    // 違反とみなす余裕距離 [m]（これ未満で違反。変更すると違反フラグだけを付け直す）
+    void setMargin(double margin);
+    double getMargin() const { return margin_; }
+
+    // 構築・更新
+    void build(const TrajectoryData& data);
+    void update(const TrajectoryData& data);
+    void clear();
+
+    // データアクセス（境界がない側は無限大）
+    size_t size() const { return left_clearance_.size(); }
+    const std::vector<double>& getLeftClearances() const { return left_clearance_; }
+    const std::vector<double>& getRightClearances() const { return right_clearance_; }
+    double getClearance(size_t index) const;
+    const std::vector<uint8_t>& getViolationFlags() const { return flags_; }  // 点ごとに違反なら1
+
+    // 統計（最小値と違反の数は O(1)。点がなければ無限大と点0を返す）
+    double getMinClearance(size_t* index = nullptr) const { return -min_clearance_.getMax(index); }
+    std::vector<size_t> getViolations() const;
+    size_t countViolations() const { return violation_count_; }
+
+    // 直近にフラグを付け直した build/update/setMargin で違反の有無が変わった点（現在の添字。
+    // 点数が変わった場合は編集点より後ろが前後にずれているので、表示側は全体を付け直す）
+    const std::vector<size_t>& getChangedViolations() const { return changed_violations_; }
+
+    // 直近の update() で再計算した点数
+    size_t getLastRecomputedCount() const { return last_recomputed_; }
+
+private:
+    SegmentIndex left_index_;
+    SegmentIndex right_index_;
+    double left_inside_sign_;   // 左境界の符号付き距離をコース内側が正になるように変換する係数
+    double right_inside_sign_;
+    double margin_;
+
+    const TrajectoryData* data_;
+    uint64_t revision_;
+    std::vector<double> left_clearance_;
+    std::vector<double> right_clearance_;
+    std::vector<uint8_t> flags_;
+    size_t violation_count_;
+    std::vector<size_t> changed_violations_;
+    MaxTree min_clearance_;  // -clearance の最大値
+    size_t last_recomputed_;
+
+    void recompute(const TrajectoryData& data, size_t begin, size_t end);
+    void classify(size_t begin, size_t end);
+    void updateMinimum(size_t begin, size_t end, bool rebuild);
+};
+
+} // namespace trajectory_editor
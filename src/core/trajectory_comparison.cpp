@@ -0,0 +1,213 @@
+#include "trajectory_comparison.hpp"
+#include "../utils/parallel.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace trajectory_editor {
+
+namespace {
+
+// 並列化する最小のチャンク
+constexpr size_t PARALLEL_CHUNK = 2048;
+
+// 始点と終点がこれより近い基準軌跡は閉じた周回とみなす [m]
+constexpr double CLOSED_LOOP_TOLERANCE = 1e-3;
+
+} // namespace
+
+TrajectoryComparison::TrajectoryComparison()
+    : reference_(nullptr)
+    , reference_revision_(0)
+    , reference_closed_(false)
+    , target_(nullptr)
+    , target_revision_(0)
+    , last_recomputed_(0)
+    , sum_lateral_(0.0)
+    , sum_lateral2_(0.0)
+    , sum_speed_(0.0) {}
+
+void TrajectoryComparison::clear() {
+    reference_ = nullptr;
+    reference_revision_ = 0;
+    reference_index_.clear();
+    reference_distance_.clear();
+    reference_closed_ = false;
+    target_ = nullptr;
+    target_revision_ = 0;
+    lateral_offset_.clear();
+    reference_station_.clear();
+    speed_delta_.clear();
+    target_distance_.clear();
+    stats_ = ComparisonStats();
+    last_recomputed_ = 0;
+    sum_lateral_ = 0.0;
+    sum_lateral2_ = 0.0;
+    sum_speed_ = 0.0;
+    max_abs_lateral_.resize(0);
+    max_abs_speed_delta_.resize(0);
+}
+
+void TrajectoryComparison::buildReference(const TrajectoryData& reference) {
+    reference_ = &reference;
+    reference_revision_ = reference.getRevision();
+
+    const auto& points = reference.getPoints();
+    reference_index_.build(points);
+    reference_distance_.assign(points.size(), 0.0);
+    for (size_t i = 1; i < points.size(); ++i) {
+        double dx = points[i].x - points[i - 1].x;
+        double dy = points[i].y - points[i - 1].y;
+        reference_distance_[i] = reference_distance_[i - 1] + std::sqrt(dx * dx + dy * dy);
+    }
+    reference_closed_ = points.size() > 3 &&
+                        std::hypot(points.front().x - points.back().x,
+                                   points.front().y - points.back().y) < CLOSED_LOOP_TOLERANCE;
+}
+
+void TrajectoryComparison::build(const TrajectoryData& target, const TrajectoryData& reference) {
+    buildReference(reference);
+
+    target_ = &target;
+    target_revision_ = target.getRevision();
+    size_t n = target.size();
+    lateral_offset_.assign(n, 0.0);
+    reference_station_.assign(n, 0.0);
+    speed_delta_.assign(n, 0.0);
+    project(target, 0, n);
+    target_distance_.build(target);
+
+    sum_lateral_ = 0.0;
+    sum_lateral2_ = 0.0;
+    sum_speed_ = 0.0;
+    accumulate(0, n, 1.0);
+    updateStatistics(target, 0, n, true);
+}
+
+void TrajectoryComparison::update(const TrajectoryData& target, const TrajectoryData& reference) {
+    if (target_ != &target || reference_ != &reference || reference_revision_ != reference.getRevision()) {
+        build(target, reference);
+        return;
+    }
+
+    TrajectoryChange change = target.getChangesSince(target_revision_);
+    target_revision_ = target.getRevision();
+    last_recomputed_ = 0;
+    if (change.none) {
+        return;
+    }
+
+    // 射影はその点だけで決まる
+    size_t n = target.size();
+    size_t old_size = lateral_offset_.size();
+    size_t begin = 0;
+    size_t end = 0;
+    change.getRecomputeRange(n, 0, begin, end);
+
+    // 射影し直す範囲に入る前の点を和から引く（範囲より後ろは点数の差だけずれるだけ）
+    size_t old_end = end + old_size >= n ? std::min(old_size, end + old_size - n) : begin;
+    accumulate(std::min(begin, old_end), old_end, -1.0);
+    change.shiftColumn(lateral_offset_, n);
+    change.shiftColumn(reference_station_, n);
+    change.shiftColumn(speed_delta_, n);
+
+    project(target, begin, end);
+    accumulate(begin, end, 1.0);
+    updateStatistics(target, begin, end, n != old_size);
+}
+
+double TrajectoryComparison::getArcLengthOffset(size_t index) const {
+    double offset = reference_station_[index] - target_distance_.getDistanceAt(index);
+    // 閉じた周回では始点をまたいだ対応も近い方の周回で測る
+    double reference_length = stats_.reference_length;
+    if (reference_closed_ && reference_length > 0.0) {
+        offset -= reference_length * std::round(offset / reference_length);
+    }
+    return offset;
+}
+
+void TrajectoryComparison::project(const TrajectoryData& target, size_t begin, size_t end) {
+    const auto& points = target.getPoints();
+    const auto& reference_points = reference_->getPoints();
+    end = std::min(end, points.size());
+    if (begin >= end) {
+        return;
+    }
+    last_recomputed_ = end - begin;
+
+    // 基準軌跡が1点以下なら比較できない
+    if (reference_index_.empty()) {
+        std::fill(lateral_offset_.begin() + begin, lateral_offset_.begin() + end, 0.0);
+        std::fill(reference_station_.begin() + begin, reference_station_.begin() + end, 0.0);
+        for (size_t i = begin; i < end; ++i) {
+            speed_delta_[i] = reference_points.empty() ? 0.0 : points[i].velocity - reference_points[0].velocity;
+        }
+        return;
+    }
+
+    parallelFor(begin, end, PARALLEL_CHUNK, [&](size_t chunk_begin, size_t chunk_end) {
+        size_t hint = SIZE_MAX;  // 連続した点は近い区間に射影されることが多い
+        for (size_t i = chunk_begin; i < chunk_end; ++i) {
+            const auto& point = points[i];
+            SegmentHit hit = reference_index_.findNearest(point.x, point.y, hint);
+            size_t s = hit.segment;
+            hint = s;
+            double segment_length = reference_distance_[s + 1] - reference_distance_[s];
+            double reference_velocity = reference_points[s].velocity
+                + hit.ratio * (reference_points[s + 1].velocity - reference_points[s].velocity);
+
+            lateral_offset_[i] = hit.signed_distance;
+            reference_station_[i] = reference_distance_[s] + hit.ratio * segment_length;
+            speed_delta_[i] = point.velocity - reference_velocity;
+        }
+    });
+}
+
+void TrajectoryComparison::accumulate(size_t begin, size_t end, double sign) {
+    double sum_lateral = 0.0;
+    double sum_lateral2 = 0.0;
+    double sum_speed = 0.0;
+    for (size_t i = begin; i < end; ++i) {
+        double lateral = lateral_offset_[i];
+        sum_lateral += lateral;
+        sum_lateral2 += lateral * lateral;
+        sum_speed += speed_delta_[i];
+    }
+    sum_lateral_ += sign * sum_lateral;
+    sum_lateral2_ += sign * sum_lateral2;
+    sum_speed_ += sign * sum_speed;
+}
+
+void TrajectoryComparison::updateStatistics(const TrajectoryData& target, size_t begin, size_t end, bool rebuild) {
+    size_t n = lateral_offset_.size();
+    // 点数が変わると後ろの点の添字がずれるので最大値の木は作り直す
+    if (rebuild) {
+        begin = 0;
+        end = n;
+        max_abs_lateral_.resize(n);
+        max_abs_speed_delta_.resize(n);
+    }
+    end = std::min(end, n);
+    for (size_t i = begin; i < end; ++i) {
+        max_abs_lateral_.set(i, std::abs(lateral_offset_[i]));
+        max_abs_speed_delta_.set(i, std::abs(speed_delta_[i]));
+    }
+    max_abs_lateral_.refresh(begin, end);
+    max_abs_speed_delta_.refresh(begin, end);
+    target_distance_.update(target);
+
+    ComparisonStats stats;
+    stats.count = n;
+    stats.reference_length = reference_distance_.empty() ? 0.0 : reference_distance_.back();
+    stats.target_length = target_distance_.getTotalLength();
+    stats.max_abs_lateral_offset = max_abs_lateral_.getMax(&stats.max_lateral_index);
+    stats.max_abs_speed_delta = max_abs_speed_delta_.getMax(&stats.max_speed_delta_index);
+    if (n > 0) {
+        stats.mean_lateral_offset = sum_lateral_ / static_cast<double>(n);
+        // 差し引きの丸め誤差で2乗和が負になっても0に留める
+        stats.rms_lateral_offset = std::sqrt(std::max(0.0, sum_lateral2_) / static_cast<double>(n));
+        stats.mean_speed_delta = sum_speed_ / static_cast<double>(n);
+    }
+    stats_ = stats;
+}
+
+} // namespace trajectory_editor
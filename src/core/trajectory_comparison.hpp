@@ -0,0 +1,87 @@
+#pragma once
+
+#include "trajectory_data.hpp"
+#include "segment_index.hpp"
+#include "arc_length_index.hpp"
+#include "max_tree.hpp"
+#include <vector>
+#include <cstdint>
+
+namespace trajectory_editor {
+
+// 比較結果の統計
+struct ComparisonStats {
+    size_t count = 0;
+    double mean_lateral_offset = 0.0;        // [m]
+    double rms_lateral_offset = 0.0;         // [m]
+    double max_abs_lateral_offset = 0.0;     // [m]
+    size_t max_lateral_index = 0;
+    double mean_speed_delta = 0.0;           // [m/s]
+    double max_abs_speed_delta = 0.0;        // [m/s]
+    size_t max_speed_delta_index = 0;
+    double target_length = 0.0;              // 比較対象の全長 [m]
+    double reference_length = 0.0;           // 基準軌跡の全長 [m]
+};
+
+// 2本の軌跡の比較（比較対象の各点を基準軌跡の最近傍区間へ射影する）
+//
+// 基準軌跡には SegmentIndex を作り、射影は並列に計算する。update() は
+// 比較対象の変更ジャーナルを見て、動いた点だけを射影し直す。基準軌跡が
+// 変わった場合は全点を計算し直す。
+// 統計の和と最大値も射影し直した点だけで更新する（最大値は MaxTree で持つ）。
+// 距離の差は編集点より後ろの全点が一緒にずれるので列としては持たず、比較対象の
+// 累積距離（ArcLengthIndex）から点ごとに求める。基準軌跡が閉じた周回なら、
+// 距離の差は基準軌跡の全長で折り返して ±全長/2 に収める。
+class TrajectoryComparison {
+public:
+    TrajectoryComparison();
+
+    // 構築・更新
+    void build(const TrajectoryData& target, const TrajectoryData& reference);
+    void update(const TrajectoryData& target, const TrajectoryData& reference);
+    void clear();
+
+    // データアクセス（添字は比較対象の点）
+    size_t size() const { return lateral_offset_.size(); }
+    bool empty() const { return lateral_offset_.empty(); }
+    const std::vector<double>& getLateralOffsets() const { return lateral_offset_; }      // 基準の進行方向に対して左が正 [m]
+    const std::vector<double>& getReferenceStations() const { return reference_station_; } // 射影点の基準軌跡上の距離 [m]
+    double getArcLengthOffset(size_t index) const;                                         // 射影点の距離 - 自身の距離 [m]
+    const std::vector<double>& getSpeedDeltas() const { return speed_delta_; }             // 自身 - 基準 [m/s]
+    const ComparisonStats& getStatistics() const { return stats_; }
+
+    // 直近の update() で射影し直した点数
+    size_t getLastRecomputedCount() const { return last_recomputed_; }
+
+private:
+    // 基準軌跡
+    const TrajectoryData* reference_;
+    uint64_t reference_revision_;
+    SegmentIndex reference_index_;
+    std::vector<double> reference_distance_;  // 基準軌跡の累積距離
+    bool reference_closed_;                   // 始点と終点が一致する周回
+
+    // 比較対象
+    const TrajectoryData* target_;
+    uint64_t target_revision_;
+    std::vector<double> lateral_offset_;
+    std::vector<double> reference_station_;
+    std::vector<double> speed_delta_;
+    ArcLengthIndex target_distance_;
+    ComparisonStats stats_;
+    size_t last_recomputed_;
+
+    // 統計の和と最大値（射影し直した点だけ差し替える）
+    double sum_lateral_;
+    double sum_lateral2_;
+    double sum_speed_;
+    MaxTree max_abs_lateral_;
+    MaxTree max_abs_speed_delta_;
+
+    void buildReference(const TrajectoryData& reference);
+    void project(const TrajectoryData& target, size_t begin, size_t end);
+    void accumulate(size_t begin, size_t end, double sign);  // 点 [begin, end) の値を和に足す（sign = -1 で引く）
+    void updateStatistics(const TrajectoryData& target, size_t begin, size_t end, bool rebuild);
+};
+
+} // namespace trajectory_editor
@@ -1,12 +1,32 @@
 #include "trajectory_data.hpp"
 #include "../utils/csv_parser.hpp"
+#include "../utils/memory_usage.hpp"
+#include "../utils/trace.hpp"
 #include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <limits>
 #include <stdexcept>
+#include <type_traits>
 
 namespace trajectory_editor {
 
-TrajectoryData::TrajectoryData() : is_modified_(false), has_extended_format_(false) {}
+// バイナリ形式はTrajectoryPointをそのままファイルに並べる
+static_assert(std::is_trivially_copyable<TrajectoryPoint>::value, "TrajectoryPoint must be trivially copyable");
+static_assert(sizeof(TrajectoryPoint) == 4 * sizeof(double), "TrajectoryPoint must be tightly packed");
+static_assert(sizeof(TrajectoryBinaryHeader) == 16, "Unexpected binary header size");
+
+namespace {
+
+// 保持する変更ジャーナルの最大件数（超えた分の差分は全体再計算扱い）
+constexpr size_t MAX_JOURNAL_SIZE = 1024;
+
+} // namespace
+
+TrajectoryData::TrajectoryData()
+    : is_modified_(false), revision_(0), journal_floor_(0), has_extended_format_(false), skipped_rows_(0) {}
 
 TrajectoryData::~TrajectoryData() = default;
 
@@ -16,35 +36,37 @@ void TrajectoryData::clear() {
     original_extra_columns_.clear();
     has_extended_format_ = false;
     is_modified_ = true;
+    recordReset();
 }
 
 void TrajectoryData::addPoint(const TrajectoryPoint& point) {
     points_.push_back(point);
     is_modified_ = true;
+    recordChange(points_.size() - 1, points_.size() - 1, true, true);
 }
 
 void TrajectoryData::insertPoint(size_t index, const TrajectoryPoint& point) {
     if (index > points_.size()) {
         throw std::out_of_range("Index out of range");
     }
-    points_.insert(points_.begin() + index, point);
-    is_modified_ = true;
+    replaceSpan(index, 0, &point, 1);
 }
 
 void TrajectoryData::removePoint(size_t index) {
     if (!isValidIndex(index)) {
         throw std::out_of_range("Index out of range");
     }
-    points_.erase(points_.begin() + index);
-    is_modified_ = true;
+    replaceSpan(index, 1, nullptr, 0);
 }
 
 void TrajectoryData::updatePoint(size_t index, const TrajectoryPoint& point) {
     if (!isValidIndex(index)) {
         throw std::out_of_range("Index out of range");
     }
+    bool geometric = points_[index].x != point.x || points_[index].y != point.y || points_[index].z != point.z;
     points_[index] = point;
     is_modified_ = true;
+    recordChange(index, index, false, geometric);
 }
 
 void TrajectoryData::movePoint(size_t index, double new_x, double new_y) {
@@ -54,6 +76,7 @@ void TrajectoryData::movePoint(size_t index, double new_x, double new_y) {
     points_[index].x = new_x;
     points_[index].y = new_y;
     is_modified_ = true;
+    recordChange(index, index, false, true);
 }
 
 void TrajectoryData::updateVelocityRange(size_t start_index, size_t end_index, double velocity) {
@@ -65,6 +88,129 @@ void TrajectoryData::updateVelocityRange(size_t start_index, size_t end_index, d
         points_[i].velocity = velocity;
     }
     is_modified_ = true;
+    recordChange(start_index, end_index, false, false);
+}
+
+void TrajectoryData::setVelocities(size_t start_index, const std::vector<double>& velocities) {
+    if (velocities.empty()) {
+        return;
+    }
+    if (start_index >= points_.size() || velocities.size() > points_.size() - start_index) {
+        throw std::out_of_range("Invalid range");
+    }
+    
+    for (size_t i = 0; i < velocities.size(); ++i) {
+        points_[start_index + i].velocity = velocities[i];
+    }
+    is_modified_ = true;
+    recordChange(start_index, start_index + velocities.size() - 1, false, false);
+}
+
+std::vector<TrajectoryPoint> TrajectoryData::getRange(size_t start_index, size_t end_index) const {
+    if (start_index >= points_.size() || end_index >= points_.size() || start_index > end_index) {
+        throw std::out_of_range("Invalid range");
+    }
+    return std::vector<TrajectoryPoint>(points_.begin() + start_index, points_.begin() + end_index + 1);
+}
+
+void TrajectoryData::insertRange(size_t index, const std::vector<TrajectoryPoint>& points,
+                                 const std::vector<std::vector<std::string>>* extra_columns) {
+    if (index > points_.size()) {
+        throw std::out_of_range("Index out of range");
+    }
+    if (points.empty()) {
+        return;
+    }
+    if (extra_columns && extra_columns->size() != points.size()) {
+        extra_columns = nullptr;
+    }
+    replaceSpan(index, 0, points.data(), points.size(), extra_columns);
+}
+
+void TrajectoryData::removeRange(size_t start_index, size_t end_index) {
+    if (start_index >= points_.size() || end_index >= points_.size() || start_index > end_index) {
+        throw std::out_of_range("Invalid range");
+    }
+    replaceSpan(start_index, end_index - start_index + 1, nullptr, 0);
+}
+
+void TrajectoryData::replaceRange(size_t start_index, size_t end_index, const std::vector<TrajectoryPoint>& points,
+                                  const std::vector<std::vector<std::string>>* extra_columns) {
+    if (start_index >= points_.size() || end_index >= points_.size() || start_index > end_index) {
+        throw std::out_of_range("Invalid range");
+    }
+    if (extra_columns && extra_columns->size() != points.size()) {
+        extra_columns = nullptr;
+    }
+    replaceSpan(start_index, end_index - start_index + 1, points.data(), points.size(), extra_columns);
+}
+
+void TrajectoryData::spliceFrom(const TrajectoryData& other, size_t other_start, size_t other_end, size_t index) {
+    if (other_start >= other.points_.size() || other_end >= other.points_.size() || other_start > other_end) {
+        throw std::out_of_range("Invalid source range");
+    }
+    if (index > points_.size()) {
+        throw std::out_of_range("Index out of range");
+    }
+    
+    if (&other == this) {
+        // 自身からのコピーは挿入でソースが動くので先に退避する
+        std::vector<TrajectoryPoint> copied = getRange(other_start, other_end);
+        std::vector<std::vector<std::string>> copied_extra = getExtraColumns(other_start, other_end);
+        insertRange(index, copied, &copied_extra);
+        return;
+    }
+    
+    // 両方が8列形式なら姿勢列もコピーする
+    const std::vector<std::vector<std::string>>* source_extra = nullptr;
+    if (other.has_extended_format_ && other.original_extra_columns_.size() == other.points_.size()) {
+        source_extra = &other.original_extra_columns_;
+    }
+    replaceSpan(index, 0, other.points_.data() + other_start, other_end - other_start + 1,
+                source_extra, other_start);
+}
+
+void TrajectoryData::updateOrientations(size_t start_index, size_t end_index) {
+    if (start_index >= points_.size() || end_index >= points_.size() || start_index > end_index) {
+        throw std::out_of_range("Invalid range");
+    }
+    if (!has_extended_format_ || original_extra_columns_.size() != points_.size() || points_.size() < 2) {
+        return;
+    }
+    
+    for (size_t i = start_index; i <= end_index; ++i) {
+        // 前後の点の差分（端点は隣の点との差分）で進行方向を決める
+        const auto& prev = points_[i > 0 ? i - 1 : 0];
+        const auto& next = points_[std::min(i + 1, points_.size() - 1)];
+        double yaw = std::atan2(next.y - prev.y, next.x - prev.x);
+        original_extra_columns_[i] = {"0", "0", std::to_string(std::sin(0.5 * yaw)), std::to_string(std::cos(0.5 * yaw))};
+    }
+    is_modified_ = true;
+}
+
+std::vector<std::vector<std::string>> TrajectoryData::getExtraColumns(size_t start_index, size_t end_index) const {
+    if (start_index >= points_.size() || end_index >= points_.size() || start_index > end_index) {
+        throw std::out_of_range("Invalid range");
+    }
+    if (!has_extended_format_ || original_extra_columns_.size() != points_.size()) {
+        return {};
+    }
+    return std::vector<std::vector<std::string>>(original_extra_columns_.begin() + start_index,
+                                                 original_extra_columns_.begin() + end_index + 1);
+}
+
+void TrajectoryData::setExtraColumns(size_t start_index, const std::vector<std::vector<std::string>>& extra_columns) {
+    if (extra_columns.empty()) {
+        return;
+    }
+    if (start_index >= points_.size() || extra_columns.size() > points_.size() - start_index) {
+        throw std::out_of_range("Invalid range");
+    }
+    if (!has_extended_format_ || original_extra_columns_.size() != points_.size()) {
+        return;
+    }
+    std::copy(extra_columns.begin(), extra_columns.end(), original_extra_columns_.begin() + start_index);
+    is_modified_ = true;
 }
 
 void TrajectoryData::getBounds(double& min_x, double& max_x, double& min_y, double& max_y) const {
@@ -99,12 +245,16 @@ void TrajectoryData::getVelocityRange(double& min_vel, double& max_vel) const {
 }
 
 bool TrajectoryData::loadFromCSV(const std::string& filepath) {
+    TRACE_ZONE("TrajectoryData::loadFromCSV");
     CSVParser parser;
     auto csv_data = parser.parseFile(filepath);
+    skipped_rows_ = 0;
     
     if (csv_data.empty()) {
+        last_error_ = "Cannot read or empty file: " + filepath;
         return false;
     }
+    last_error_.clear();
     
     points_.clear();
     original_header_.clear();
@@ -122,6 +272,13 @@ bool TrajectoryData::loadFromCSV(const std::string& filepath) {
     // ヘッダーをスキップ
     size_t start_row = parser.hasHeader() ? 1 : 0;
     
+    // 読めない行は飛ばして続ける（最初の1行の理由と行数を残す）
+    auto skipRow = [&](size_t row_index, const std::string& reason) {
+        if (skipped_rows_++ == 0) {
+            last_error_ = "row " + std::to_string(row_index + 1) + ": " + reason;
+        }
+    };
+    
     for (size_t i = start_row; i < csv_data.size(); ++i) {
         const auto& row = csv_data[i];
         if (row.size() >= 4) {
@@ -149,16 +306,29 @@ bool TrajectoryData::loadFromCSV(const std::string& filepath) {
                 
                 points_.emplace_back(x, y, z, velocity);
             } catch (const std::exception&) {
+                skipRow(i, "invalid number");
                 continue;
             }
+        } else {
+            skipRow(i, "expected at least 4 columns");
         }
     }
     
+    if (skipped_rows_ > 0) {
+        last_error_ = "Skipped " + std::to_string(skipped_rows_) + " rows in " + filepath +
+                      " (first: " + last_error_ + ")";
+    }
+    if (points_.empty() && last_error_.empty()) {
+        last_error_ = "No trajectory points in " + filepath;
+    }
+    
     is_modified_ = false;
+    recordReset();
     return !points_.empty();
 }
 
 bool TrajectoryData::saveToCSV(const std::string& filepath) const {
+    TRACE_ZONE("TrajectoryData::saveToCSV");
     CSVParser parser;
     
     std::vector<std::vector<std::string>> csv_data;
@@ -205,13 +375,200 @@ bool TrajectoryData::saveToCSV(const std::string& filepath) const {
     bool success = parser.writeFile(filepath, csv_data);
     if (success) {
         const_cast<TrajectoryData*>(this)->is_modified_ = false;
+        last_error_.clear();
+    } else {
+        last_error_ = "Cannot write: " + filepath;
     }
     
     return success;
 }
 
+bool TrajectoryData::loadFromBinary(const std::string& filepath) {
+    TRACE_ZONE("TrajectoryData::loadFromBinary");
+    skipped_rows_ = 0;
+    FILE* file = std::fopen(filepath.c_str(), "rb");
+    if (!file) {
+        last_error_ = "Cannot open: " + filepath;
+        return false;
+    }
+    
+    TrajectoryBinaryHeader header;
+    if (std::fread(&header, sizeof(header), 1, file) != 1 ||
+        std::memcmp(header.magic, "TRJB", 4) != 0 ||
+        header.version != TRAJECTORY_BINARY_VERSION) {
+        std::fclose(file);
+        last_error_ = "Not a trajectory binary file (or unsupported version): " + filepath;
+        return false;
+    }
+    
+    // ヘッダーの点数は確保する前に実際のファイルの大きさと照らし合わせる
+    std::error_code error;
+    uint64_t file_size = std::filesystem::file_size(filepath, error);
+    if (error || header.point_count > (file_size - sizeof(header)) / sizeof(TrajectoryPoint)) {
+        std::fclose(file);
+        last_error_ = "Truncated file: " + filepath + " (header claims " + std::to_string(header.point_count) +
+                      " points)";
+        return false;
+    }
+
+    std::vector<TrajectoryPoint> points(static_cast<size_t>(header.point_count));
+    size_t read_count = std::fread(points.data(), sizeof(TrajectoryPoint), points.size(), file);
+    std::fclose(file);
+    if (read_count != points.size()) {
+        last_error_ = "Truncated file: " + filepath + " (" + std::to_string(read_count) + " of " +
+                      std::to_string(points.size()) + " points)";
+        return false;
+    }
+    last_error_ = points.empty() ? "No trajectory points in " + filepath : std::string();
+    
+    points_ = std::move(points);
+    original_header_.clear();
+    original_extra_columns_.clear();
+    has_extended_format_ = false;
+    is_modified_ = false;
+    recordReset();
+    return !points_.empty();
+}
+
+bool TrajectoryData::saveToBinary(const std::string& filepath) const {
+    TRACE_ZONE("TrajectoryData::saveToBinary");
+    // .trjb は x, y, z, 速度しか持てないので、姿勢列を黙って落とさない
+    if (has_extended_format_) {
+        last_error_ = "Cannot write " + filepath + ": .trjb has no orientation columns, write .csv instead";
+        return false;
+    }
+    FILE* file = std::fopen(filepath.c_str(), "wb");
+    if (!file) {
+        last_error_ = "Cannot write: " + filepath;
+        return false;
+    }
+    
+    TrajectoryBinaryHeader header;
+    std::memcpy(header.magic, "TRJB", 4);
+    header.version = TRAJECTORY_BINARY_VERSION;
+    header.point_count = points_.size();
+    
+    bool success = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   std::fwrite(points_.data(), sizeof(TrajectoryPoint), points_.size(), file) == points_.size();
+    success = (std::fclose(file) == 0) && success;
+    
+    if (success) {
+        const_cast<TrajectoryData*>(this)->is_modified_ = false;
+        last_error_.clear();
+    } else {
+        last_error_ = "Cannot write: " + filepath;
+    }
+    return success;
+}
+
+size_t TrajectoryData::getMemoryUsage() const {
+    size_t bytes = points_.capacity() * sizeof(TrajectoryPoint) + journal_.size() * sizeof(JournalEntry);
+    for (const auto& column : original_header_) {
+        bytes += sizeof(column) + stringHeapBytes(column);
+    }
+    
+    // 8列形式の元の列は点ごとに持つので、点数に比例して大きくなる
+    return bytes + stringTableBytes(original_extra_columns_);
+}
+
+TrajectoryChange TrajectoryData::getChangesSince(uint64_t revision) const {
+    TrajectoryChange change;
+    if (revision >= revision_) {
+        return change;
+    }
+    
+    change.none = false;
+    if (revision < journal_floor_) {
+        change.full = true;
+        change.structural = true;
+        change.geometric = true;
+        change.first = 0;
+        change.last = points_.empty() ? 0 : points_.size() - 1;
+        return change;
+    }
+    
+    // 新しい方から走査して対象範囲を統合する
+    bool first_entry = true;
+    for (auto it = journal_.rbegin(); it != journal_.rend() && it->revision > revision; ++it) {
+        if (first_entry) {
+            change.first = it->first;
+            change.last = it->last;
+            first_entry = false;
+        } else {
+            change.first = std::min(change.first, it->first);
+            change.last = std::max(change.last, it->last);
+        }
+        change.structural = change.structural || it->structural;
+        change.geometric = change.geometric || it->geometric;
+        ++change.edit_count;
+    }
+    
+    if (change.structural && change.edit_count > 1) {
+        change.last = points_.empty() ? 0 : points_.size() - 1;
+    }
+    return change;
+}
+
+void TrajectoryData::recordChange(size_t first, size_t last, bool structural, bool geometric) {
+    ++revision_;
+    journal_.push_back({revision_, first, last, structural, geometric});
+    if (journal_.size() > MAX_JOURNAL_SIZE) {
+        journal_floor_ = journal_.front().revision;
+        journal_.pop_front();
+    }
+}
+
+void TrajectoryData::recordReset() {
+    ++revision_;
+    journal_.clear();
+    journal_floor_ = revision_;
+}
+
 bool TrajectoryData::isValidIndex(size_t index) const {
     return index < points_.size();
 }
 
+void TrajectoryData::replaceSpan(size_t first, size_t count, const TrajectoryPoint* points, size_t point_count,
+                                 const std::vector<std::vector<std::string>>* source_extra_columns,
+                                 size_t source_first) {
+    // 点数の差分だけ一度にシフトしてから上書きする
+    auto it = points_.begin() + first;
+    if (point_count > count) {
+        points_.insert(it + count, point_count - count, TrajectoryPoint());
+    } else if (point_count < count) {
+        points_.erase(it + point_count, it + count);
+    }
+    std::copy(points, points + point_count, points_.begin() + first);
+    
+    // 8列形式の姿勢列も行を揃える
+    if (has_extended_format_ && original_extra_columns_.size() >= first + count) {
+        auto extra_it = original_extra_columns_.begin() + first;
+        if (point_count > count) {
+            // 新しい行の姿勢は元の列が渡されなければ近傍の点からコピーする
+            std::vector<std::string> fallback;
+            if (!original_extra_columns_.empty()) {
+                size_t neighbor = first > 0 ? first - 1 : 0;
+                fallback = original_extra_columns_[neighbor];
+            }
+            original_extra_columns_.insert(extra_it + count, point_count - count, fallback);
+        } else if (point_count < count) {
+            original_extra_columns_.erase(extra_it + point_count, extra_it + count);
+        }
+        if (source_extra_columns) {
+            std::copy(source_extra_columns->begin() + source_first,
+                      source_extra_columns->begin() + source_first + point_count,
+                      original_extra_columns_.begin() + first);
+        }
+    }
+    
+    is_modified_ = true;
+    if (point_count == count) {
+        if (count > 0) {
+            recordChange(first, first + count - 1, false, true);
+        }
+    } else {
+        recordChange(first, first + std::max(count, point_count) - 1, true, true);
+    }
+}
+
 } // namespace trajectory_editor
\ No newline at end of file
@@ -1,7 +1,10 @@
 #pragma once
 
 #include <vector>
+#include <deque>
+#include <algorithm>
 #include <string>
+#include <cstdint>
 
 namespace trajectory_editor {
 
@@ -16,6 +19,51 @@ struct TrajectoryPoint {
         : x(x), y(y), z(z), velocity(vel) {}
 };
 
+// バイナリ軌跡形式（.trjb）: ヘッダーの直後にTrajectoryPoint配列が続く
+struct TrajectoryBinaryHeader {
+    char magic[4];          // "TRJB"
+    uint32_t version;
+    uint64_t point_count;
+};
+
+constexpr uint32_t TRAJECTORY_BINARY_VERSION = 1;
+
+// あるリビジョン以降の変更範囲（差分再計算用）
+struct TrajectoryChange {
+    bool none = true;         // 変更なし
+    bool full = false;        // 全体の再計算が必要（読み込み・履歴切れ）
+    bool structural = false;  // 点数が変わる変更を含む（first以降のインデックスがずれる）
+    bool geometric = false;   // 座標の変更を含む（速度のみの変更ならfalse）
+    size_t first = 0;         // 変更された最初のインデックス
+    size_t last = 0;          // 変更された最後のインデックス（複数の変更に構造変更が混ざる場合は末尾まで）
+    size_t edit_count = 0;    // 統合された変更の数（1件の構造変更なら [first, last] の外はシフトのみ）
+    
+    // 点ごとのキャッシュで再計算が必要な範囲 [begin, end)（radiusは計算に使う近傍点数）
+    void getRecomputeRange(size_t new_size, size_t radius, size_t& begin, size_t& end) const {
+        if (none) {
+            begin = end = 0;
+            return;
+        }
+        begin = full ? 0 : (first > radius ? first - radius : 0);
+        end = (full || (structural && edit_count > 1)) ? new_size : std::min(new_size, last + radius + 1);
+        begin = std::min(begin, end);
+    }
+    
+    // 点ごとのキャッシュ列を点数の変化に合わせてずらす
+    template <typename T>
+    void shiftColumn(std::vector<T>& column, size_t new_size) const {
+        if (structural && !full && edit_count == 1 && first <= column.size()) {
+            if (new_size > column.size()) {
+                column.insert(column.begin() + first, new_size - column.size(), T());
+            } else if (new_size < column.size()) {
+                size_t removed = std::min(column.size() - new_size, column.size() - first);
+                column.erase(column.begin() + first, column.begin() + first + removed);
+            }
+        }
+        column.resize(new_size);
+    }
+};
+
 class TrajectoryData {
 public:
     TrajectoryData();
@@ -34,8 +82,27 @@ public:
     void updatePoint(size_t index, const TrajectoryPoint& point);
     void movePoint(size_t index, double new_x, double new_y);
     
-    // 範囲操作
+    // 範囲操作（end_indexは含む）
     void updateVelocityRange(size_t start_index, size_t end_index, double velocity);
+    void setVelocities(size_t start_index, const std::vector<double>& velocities);  // 点ごとの速度を一括設定
+    std::vector<TrajectoryPoint> getRange(size_t start_index, size_t end_index) const;
+    // extra_columns を渡すと8列形式の姿勢列も復元する（省略時・行数が合わない場合は近傍の点からコピー）
+    void insertRange(size_t index, const std::vector<TrajectoryPoint>& points,
+                     const std::vector<std::vector<std::string>>* extra_columns = nullptr);
+    void removeRange(size_t start_index, size_t end_index);
+    void replaceRange(size_t start_index, size_t end_index, const std::vector<TrajectoryPoint>& points,
+                      const std::vector<std::vector<std::string>>* extra_columns = nullptr);
+    // other[other_start..other_end] を index の前に直接コピーする（中間の配列を作らない。
+    // 両方が8列形式なら姿勢列もコピーする）
+    void spliceFrom(const TrajectoryData& other, size_t other_start, size_t other_end, size_t index);
+    
+    // 8列形式の姿勢列（qx,qy,qz,qw）を進行方向のヨー角から計算し直す（end_indexは含む）
+    bool hasOrientation() const { return has_extended_format_; }
+    void updateOrientations(size_t start_index, size_t end_index);
+    
+    // 8列形式の元の列（取り消しで復元するため編集コマンドが保持する。8列形式でなければ空）
+    std::vector<std::vector<std::string>> getExtraColumns(size_t start_index, size_t end_index) const;
+    void setExtraColumns(size_t start_index, const std::vector<std::vector<std::string>>& extra_columns);
     
     // バウンディング情報
     void getBounds(double& min_x, double& max_x, double& min_y, double& max_y) const;
@@ -44,21 +111,56 @@ public:
     // ファイル操作
     bool loadFromCSV(const std::string& filepath);
     bool saveToCSV(const std::string& filepath) const;
+    bool loadFromBinary(const std::string& filepath);
+    bool saveToBinary(const std::string& filepath) const;  // 8列形式（姿勢列あり）は書けないので false
+    
+    // 直前のファイル操作の結果（失敗の理由。読み込みに成功しても読み飛ばした行があればその説明）
+    const std::string& getLastError() const { return last_error_; }
+    size_t getSkippedRowCount() const { return skipped_rows_; }
     
     // 状態管理
     bool isModified() const { return is_modified_; }
     void setModified(bool modified) { is_modified_ = modified; }
+    size_t getMemoryUsage() const;  // 点列・元のCSV列・変更ジャーナルの大きさ [bytes]
+    
+    // 変更追跡（リビジョンは変更ごとに増加する）
+    uint64_t getRevision() const { return revision_; }
+    TrajectoryChange getChangesSince(uint64_t revision) const;
     
 private:
     std::vector<TrajectoryPoint> points_;
     bool is_modified_;
     
+    // 変更ジャーナル
+    struct JournalEntry {
+        uint64_t revision;
+        size_t first;
+        size_t last;
+        bool structural;
+        bool geometric;
+    };
+    std::deque<JournalEntry> journal_;
+    uint64_t revision_;
+    uint64_t journal_floor_;  // これより前のリビジョンからの差分は取得できない
+    
+    void recordChange(size_t first, size_t last, bool structural, bool geometric);
+    void recordReset();
+    
     // 元のCSV形式保持用
     std::vector<std::string> original_header_;
     std::vector<std::vector<std::string>> original_extra_columns_;
     bool has_extended_format_;
     
+    // ファイル操作の結果
+    mutable std::string last_error_;
+    size_t skipped_rows_;
+    
     bool isValidIndex(size_t index) const;
+    
+    // 範囲置換の共通処理（要素のシフトは1回だけ）
+    void replaceSpan(size_t first, size_t count, const TrajectoryPoint* points, size_t point_count,
+                     const std::vector<std::vector<std::string>>* source_extra_columns = nullptr,
+                     size_t source_first = 0);
 };
 
 } // namespace trajectory_editor
\ No newline at end of file
@@ -0,0 +1,253 @@
+#include "trajectory_engine.hpp"
+#include "../utils/parallel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+
+namespace trajectory_editor {
+
+namespace {
+
+// 点ごとの速度変換を並列化する最小のチャンク
+constexpr size_t PARALLEL_CHUNK = 16384;
+
+bool isBinaryPath(const std::string& filepath) {
+    const std::string suffix = ".trjb";
+    return filepath.size() >= suffix.size() &&
+           filepath.compare(filepath.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+TrajectoryEngine::TrajectoryEngine() : autosave_(snapshots_), publishing_(false) {}
+
+bool TrajectoryEngine::load(const std::string& filepath) {
+    bool success = isBinaryPath(filepath) ? data_.loadFromBinary(filepath) : data_.loadFromCSV(filepath);
+    last_error_ = data_.getLastError();
+    history_.clear();
+    resetAnalyses();
+    publishSnapshot();
+    return success;
+}
+
+bool TrajectoryEngine::save(const std::string& filepath) {
+    bool success = isBinaryPath(filepath) ? data_.saveToBinary(filepath) : data_.saveToCSV(filepath);
+    last_error_ = data_.getLastError();
+    return success;
+}
+
+bool TrajectoryEngine::loadBoundaries(const std::string& filepath) {
+    bool success = boundaries_.loadFromFile(filepath) && !boundaries_.empty();
+    last_error_ = boundaries_.getLastError();
+    if (!success && last_error_.empty()) {
+        last_error_ = "No track boundaries in " + filepath;
+    }
+
+    // 失敗した場合も空の境界線にそろえる
+    clearance_.setBoundaries(boundaries_);
+    clearance_.clear();
+    return success;
+}
+
+void TrajectoryEngine::setPoints(const std::vector<TrajectoryPoint>& points) {
+    data_.clear();
+    data_.insertRange(0, points);
+    data_.setModified(false);
+    history_.clear();
+    resetAnalyses();
+    publishSnapshot();
+    last_error_.clear();
+}
+
+bool TrajectoryEngine::setVelocities(size_t start_index, const std::vector<double>& velocities) {
+    if (velocities.empty()) {
+        last_error_.clear();
+        return true;
+    }
+    if (!checkRange(start_index, start_index + velocities.size() - 1)) {
+        return false;
+    }
+
+    std::vector<double> old_velocities(velocities.size());
+    for (size_t i = 0; i < velocities.size(); ++i) {
+        old_velocities[i] = data_.getPoints()[start_index + i].velocity;
+    }
+    execute(std::make_unique<SetVelocitiesCommand>(start_index, std::move(old_velocities), velocities));
+    return true;
+}
+
+bool TrajectoryEngine::scaleVelocities(size_t start_index, size_t end_index, double factor) {
+    if (!std::isfinite(factor) || factor < 0.0) {
+        last_error_ = "Invalid velocity factor";
+        return false;
+    }
+    return transformVelocities(start_index, end_index, [factor](double v) { return v * factor; },
+                               "Scale velocities");
+}
+
+bool TrajectoryEngine::clampVelocities(size_t start_index, size_t end_index,
+                                       double min_velocity, double max_velocity) {
+    if (std::isnan(min_velocity) || std::isnan(max_velocity) || min_velocity > max_velocity) {
+        last_error_ = "Invalid velocity limits";
+        return false;
+    }
+    return transformVelocities(start_index, end_index,
+                               [=](double v) { return std::clamp(v, min_velocity, max_velocity); },
+                               "Clamp velocities");
+}
+
+bool TrajectoryEngine::movePoint(size_t index, double x, double y) {
+    if (!checkRange(index, index)) {
+        return false;
+    }
+    const auto& point = data_.getPoints()[index];
+    execute(std::make_unique<MovePointCommand>(index, point.x, point.y, x, y));
+    return true;
+}
+
+bool TrajectoryEngine::resample(size_t start_index, size_t end_index, const ResampleOptions& options) {
+    if (!checkRange(start_index, end_index)) {
+        return false;
+    }
+    if (end_index == start_index || !(options.spacing > 0.0)) {
+        last_error_ = "Resampling needs at least 2 points and a positive spacing";
+        return false;
+    }
+
+    TrajectoryResampler resampler;
+    resampler.setOptions(options);
+    std::vector<TrajectoryPoint> points;
+    try {
+        points = resampler.resample(data_.getPoints(), start_index, end_index);
+    } catch (const std::length_error& e) {
+        last_error_ = e.what();
+        return false;
+    }
+    execute(std::make_unique<ResampleCommand>(start_index, data_.getRange(start_index, end_index),
+                                              std::move(points), options.spacing));
+    return true;
+}
+
+bool TrajectoryEngine::undo() {
+    if (!history_.canUndo()) {
+        last_error_ = "Nothing to undo";
+        return false;
+    }
+    history_.undo(data_);
+    publishSnapshot();
+    last_error_.clear();
+    return true;
+}
+
+bool TrajectoryEngine::redo() {
+    if (!history_.canRedo()) {
+        last_error_ = "Nothing to redo";
+        return false;
+    }
+    history_.redo(data_);
+    publishSnapshot();
+    last_error_.clear();
+    return true;
+}
+
+TrajectorySnapshotPtr TrajectoryEngine::getSnapshot() {
+    publishing_ = true;
+    return snapshots_.publish(data_);  // 変わっていなければ前回のバージョンを返す
+}
+
+void TrajectoryEngine::startAutosave(const std::string& filepath) {
+    publishing_ = true;
+    snapshots_.publish(data_);
+    autosave_.start(filepath);
+}
+
+bool TrajectoryEngine::flushAutosave() {
+    bool success = autosave_.flush();
+    last_error_ = autosave_.getLastError();
+    return success;
+}
+
+const TrajectoryGeometry& TrajectoryEngine::getGeometry() {
+    geometry_.update(data_);
+    return geometry_;
+}
+
+const KinematicChecker& TrajectoryEngine::getKinematics() {
+    kinematics_.update(data_);
+    return kinematics_;
+}
+
+const TrackClearance& TrajectoryEngine::getClearance() {
+    if (clearance_.hasBoundaries()) {
+        clearance_.update(data_);
+    }
+    return clearance_;
+}
+
+bool TrajectoryEngine::checkRange(size_t start_index, size_t end_index) {
+    if (start_index > end_index || end_index >= data_.size()) {
+        last_error_ = "Invalid range " + std::to_string(start_index) + "-" + std::to_string(end_index) +
+                      " for " + std::to_string(data_.size()) + " points";
+        return false;
+    }
+    last_error_.clear();
+    return true;
+}
+
+template <typename Transform>
+bool TrajectoryEngine::transformVelocities(size_t start_index, size_t end_index, Transform&& transform,
+                                           const std::string& description) {
+    if (!checkRange(start_index, end_index)) {
+        return false;
+    }
+
+    const auto& points = data_.getPoints();
+    size_t count = end_index - start_index + 1;
+    std::vector<double> old_velocities(count);
+    std::vector<double> new_velocities(count);
+    std::atomic<bool> changed{false};
+    parallelFor(0, count, PARALLEL_CHUNK, [&](size_t begin, size_t end) {
+        bool chunk_changed = false;
+        for (size_t i = begin; i < end; ++i) {
+            old_velocities[i] = points[start_index + i].velocity;
+            new_velocities[i] = transform(old_velocities[i]);
+            chunk_changed = chunk_changed || new_velocities[i] != old_velocities[i];
+        }
+        if (chunk_changed) {
+            changed = true;
+        }
+    });
+
+    // 何も変わらない編集は履歴に積まない
+    if (changed) {
+        execute(std::make_unique<SetVelocitiesCommand>(start_index, std::move(old_velocities),
+                                                       std::move(new_velocities), description));
+    }
+    return true;
+}
+
+void TrajectoryEngine::execute(std::unique_ptr<EditCommand> command) {
+    history_.executeCommand(std::move(command), data_);
+    publishSnapshot();
+}
+
+void TrajectoryEngine::publishSnapshot() {
+    // 誰も読まないうちは発行しない（CLIの一括変換などで全点のコピーを作らない）
+    if (!publishing_) {
+        return;
+    }
+    snapshots_.publish(data_);
+    if (autosave_.isRunning()) {
+        autosave_.notify();
+    }
+}
+
+void TrajectoryEngine::resetAnalyses() {
+    geometry_.clear();
+    kinematics_.clear();
+    clearance_.clear();
+}
+
+} // namespace trajectory_editor
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "trajectory_data.hpp"
+#include "edit_history.hpp"
+#include "track_boundaries.hpp"
+#include "trajectory_geometry.hpp"
+#include "kinematic_checker.hpp"
+#include "track_clearance.hpp"
+#include "trajectory_resampler.hpp"
+#include "trajectory_snapshot.hpp"
+#include <string>
+#include <vector>
+
+namespace trajectory_editor {
+
+// GUIなしで軌跡を読み込み・編集・解析・保存する窓口（シミュレーションツールやCLIへの組み込み用）
+//
+// 編集はGUIと同じ編集コマンドで行うので取り消し・やり直しができる。失敗した操作は
+// 例外を投げずに false を返し、理由は getLastError() で取れる。解析結果は問い合わせた
+// ときに前回からの変更分だけ更新する。
+// getSnapshot() か自動保存を使い始めると、以後は編集のたびに不変のスナップショットを
+// 発行する（触れたチャンクだけをコピーする）。他のスレッドはそれを読み、自動保存は
+// 別スレッドで最新のバージョンを書き出す。
+class TrajectoryEngine {
+public:
+    TrajectoryEngine();
+
+    // ファイル操作（拡張子 .trjb はバイナリ、それ以外はCSV。境界線は TrackBoundaries::loadFromFile と同じ）
+    bool load(const std::string& filepath);
+    bool save(const std::string& filepath);
+    bool loadBoundaries(const std::string& filepath);
+    void setPoints(const std::vector<TrajectoryPoint>& points);  // 呼び出し側で作った点列を読み込む
+
+    // 編集（end_indexは含む）
+    bool setVelocities(size_t start_index, const std::vector<double>& velocities);
+    bool scaleVelocities(size_t start_index, size_t end_index, double factor);
+    bool clampVelocities(size_t start_index, size_t end_index, double min_velocity, double max_velocity);
+    bool movePoint(size_t index, double x, double y);
+    bool resample(size_t start_index, size_t end_index, const ResampleOptions& options);
+    bool undo();
+    bool redo();
+    const EditHistory& getHistory() const { return history_; }
+    void setMaxHistorySize(size_t max_size) { history_.setMaxHistorySize(max_size); }
+
+    // 不変のスナップショット（任意のスレッドから読める。初回の呼び出しで発行を始める）
+    TrajectorySnapshotPtr getSnapshot();
+
+    // 自動保存（編集のたびに別スレッドで .trjb に書き出す。flushAutosave は書き終えるまで待つ）
+    void startAutosave(const std::string& filepath);
+    void stopAutosave() { autosave_.stop(); }
+    bool flushAutosave();
+    uint64_t getAutosavedRevision() const { return autosave_.getSavedRevision(); }
+
+    // データアクセス
+    const TrajectoryData& getData() const { return data_; }
+    const TrackBoundaries& getBoundaries() const { return boundaries_; }
+    size_t size() const { return data_.size(); }
+
+    // 解析（変更分だけ更新してから返す。境界線がなければクリアランスは空）
+    const TrajectoryGeometry& getGeometry();
+    const KinematicChecker& getKinematics();
+    const TrackClearance& getClearance();
+    void setKinematicLimits(const KinematicLimits& limits) { kinematics_.setLimits(limits); }
+    void setClearanceMargin(double margin) { clearance_.setMargin(margin); }
+
+    // 直前の操作の失敗理由（読み込みに成功しても読み飛ばした行があればその説明）
+    const std::string& getLastError() const { return last_error_; }
+
+private:
+    TrajectoryData data_;
+    EditHistory history_;
+    TrackBoundaries boundaries_;
+    TrajectoryGeometry geometry_;
+    KinematicChecker kinematics_;
+    TrackClearance clearance_;
+    std::string last_error_;
+    SnapshotPublisher snapshots_;
+    SnapshotAutosave autosave_;  // snapshots_ より後に宣言する（先に止める）
+    bool publishing_;
+
+    bool checkRange(size_t start_index, size_t end_index);
+    void execute(std::unique_ptr<EditCommand> command);
+    void publishSnapshot();
+    template <typename Transform>
+    bool transformVelocities(size_t start_index, size_t end_index, Transform&& transform,
+                             const std::string& description);
+    void resetAnalyses();
+};
+
+} // namespace trajectory_editor
@@ -0,0 +1,246 @@
+#include "trajectory_geometry.hpp"
+#include "../utils/trace.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace trajectory_editor {
+
+namespace geometry_kernels {
+
+namespace {
+
+// 3点がほぼ重なる場合は曲率0とする
+constexpr double MIN_TRIANGLE_SCALE = 1e-12;
+
+inline void curvatureScalar(const double* x, const double* y, const double* v, size_t i,
+                            double* curvature, double* lateral_acceleration) {
+    double abx = x[i] - x[i - 1];
+    double aby = y[i] - y[i - 1];
+    double bcx = x[i + 1] - x[i];
+    double bcy = y[i + 1] - y[i];
+    double acx = x[i + 1] - x[i - 1];
+    double acy = y[i + 1] - y[i - 1];
+
+    double cross = abx * bcy - aby * bcx;
+    double scale = std::sqrt((abx * abx + aby * aby) * (bcx * bcx + bcy * bcy) * (acx * acx + acy * acy));
+    double kappa = scale > MIN_TRIANGLE_SCALE ? 2.0 * cross / scale : 0.0;
+
+    curvature[i] = kappa;
+    lateral_acceleration[i] = v[i] * v[i] * kappa;
+}
+
+} // namespace
+
+void computeCurvature(const double* x, const double* y, const double* v,
+                      size_t begin, size_t end,
+                      double* curvature, double* lateral_acceleration) {
+    size_t i = begin;
+
+#if defined(__SSE2__)
+    // 2点ずつ処理する（分岐はマスクで置き換える）
+    const __m128d two = _mm_set1_pd(2.0);
+    const __m128d min_scale = _mm_set1_pd(MIN_TRIANGLE_SCALE);
+    for (; i + 2 <= end; i += 2) {
+        __m128d ax = _mm_loadu_pd(x + i - 1);
+        __m128d bx = _mm_loadu_pd(x + i);
+        __m128d cx = _mm_loadu_pd(x + i + 1);
+        __m128d ay = _mm_loadu_pd(y + i - 1);
+        __m128d by = _mm_loadu_pd(y + i);
+        __m128d cy = _mm_loadu_pd(y + i + 1);
+
+        __m128d abx = _mm_sub_pd(bx, ax);
+        __m128d aby = _mm_sub_pd(by, ay);
+        __m128d bcx = _mm_sub_pd(cx, bx);
+        __m128d bcy = _mm_sub_pd(cy, by);
+        __m128d acx = _mm_sub_pd(cx, ax);
+        __m128d acy = _mm_sub_pd(cy, ay);
+
+        __m128d cross = _mm_sub_pd(_mm_mul_pd(abx, bcy), _mm_mul_pd(aby, bcx));
+        __m128d ab2 = _mm_add_pd(_mm_mul_pd(abx, abx), _mm_mul_pd(aby, aby));
+        __m128d bc2 = _mm_add_pd(_mm_mul_pd(bcx, bcx), _mm_mul_pd(bcy, bcy));
+        __m128d ac2 = _mm_add_pd(_mm_mul_pd(acx, acx), _mm_mul_pd(acy, acy));
+        __m128d scale = _mm_sqrt_pd(_mm_mul_pd(_mm_mul_pd(ab2, bc2), ac2));
+
+        __m128d valid = _mm_cmpgt_pd(scale, min_scale);
+        __m128d kappa = _mm_div_pd(_mm_mul_pd(two, cross), _mm_max_pd(scale, min_scale));
+        kappa = _mm_and_pd(valid, kappa);
+
+        __m128d vel = _mm_loadu_pd(v + i);
+        __m128d lateral = _mm_mul_pd(_mm_mul_pd(vel, vel), kappa);
+
+        _mm_storeu_pd(curvature + i, kappa);
+        _mm_storeu_pd(lateral_acceleration + i, lateral);
+    }
+#endif
+
+    for (; i < end; ++i) {
+        curvatureScalar(x, y, v, i, curvature, lateral_acceleration);
+    }
+}
+
+} // namespace geometry_kernels
+
+namespace {
+
+// 曲率・方位の計算に使う近傍点数（端点は隣の曲率を複製するため2）
+constexpr size_t STENCIL_RADIUS = 2;
+
+} // namespace
+
+TrajectoryGeometry::TrajectoryGeometry() : data_(nullptr), revision_(0), last_recomputed_(0) {}
+
+void TrajectoryGeometry::clear() {
+    data_ = nullptr;
+    revision_ = 0;
+    heading_.clear();
+    curvature_.clear();
+    lateral_acc_.clear();
+    last_recomputed_ = 0;
+}
+
+void TrajectoryGeometry::build(const TrajectoryData& data) {
+    data_ = &data;
+    revision_ = data.getRevision();
+
+    size_t n = data.size();
+    heading_.assign(n, 0.0);
+    curvature_.assign(n, 0.0);
+    lateral_acc_.assign(n, 0.0);
+    recompute(data, 0, n, false);
+}
+
+void TrajectoryGeometry::update(const TrajectoryData& data) {
+    TRACE_ZONE("TrajectoryGeometry::update");
+    if (data_ != &data) {
+        build(data);
+        return;
+    }
+
+    TrajectoryChange change = data.getChangesSince(revision_);
+    revision_ = data.getRevision();
+    last_recomputed_ = 0;
+    if (change.none) {
+        return;
+    }
+
+    size_t n = data.size();
+    change.shiftColumn(heading_, n);
+    change.shiftColumn(curvature_, n);
+    change.shiftColumn(lateral_acc_, n);
+
+    size_t begin = 0;
+    size_t end = 0;
+    change.getRecomputeRange(n, change.geometric ? STENCIL_RADIUS : 0, begin, end);
+    recompute(data, begin, end, !change.geometric);
+}
+
+void TrajectoryGeometry::recompute(const TrajectoryData& data, size_t begin, size_t end, bool velocity_only) {
+    const auto& points = data.getPoints();
+    size_t n = points.size();
+    end = std::min(end, n);
+    if (begin >= end) {
+        return;
+    }
+    last_recomputed_ = end - begin;
+
+    if (velocity_only) {
+        // 曲率は変わらないので横加速度だけ更新
+        for (size_t i = begin; i < end; ++i) {
+            double v = points[i].velocity;
+            lateral_acc_[i] = v * v * curvature_[i];
+        }
+        return;
+    }
+
+    // ウィンドウ [lo, hi) をSoAに展開してからカーネルに渡す
+    size_t lo = begin > 0 ? begin - 1 : 0;
+    size_t hi = std::min(end + 1, n);
+    size_t count = hi - lo;
+    xs_.resize(count);
+    ys_.resize(count);
+    vs_.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const auto& point = points[lo + i];
+        xs_[i] = point.x;
+        ys_[i] = point.y;
+        vs_[i] = point.velocity;
+    }
+
+    // 局所インデックスでの内点範囲（全体の端点は除く）
+    size_t local_begin = std::max(begin, static_cast<size_t>(1)) - lo;
+    size_t local_end = std::min(end, n - 1) - lo;
+    if (n >= 3 && local_begin < local_end) {
+        geometry_kernels::computeCurvature(xs_.data(), ys_.data(), vs_.data(), local_begin, local_end,
+                                           curvature_.data() + lo, lateral_acc_.data() + lo);
+    }
+
+    // 端点は隣の曲率を使う
+    if (n >= 3) {
+        if (begin == 0) {
+            curvature_[0] = curvature_[1];
+            lateral_acc_[0] = points[0].velocity * points[0].velocity * curvature_[0];
+        }
+        if (end == n) {
+            curvature_[n - 1] = curvature_[n - 2];
+            lateral_acc_[n - 1] = points[n - 1].velocity * points[n - 1].velocity * curvature_[n - 1];
+        }
+    } else {
+        for (size_t i = begin; i < end; ++i) {
+            curvature_[i] = 0.0;
+            lateral_acc_[i] = 0.0;
+        }
+    }
+
+    // 方位は全体のインデックスで端点を判定する
+    const double* x = xs_.data();
+    const double* y = ys_.data();
+    for (size_t i = begin; i < end; ++i) {
+        size_t prev = (i > 0 ? i - 1 : 0) - lo;
+        size_t next = (i + 1 < n ? i + 1 : n - 1) - lo;
+        heading_[i] = (n < 2) ? 0.0 : std::atan2(y[next] - y[prev], x[next] - x[prev]);
+    }
+}
+
+double TrajectoryGeometry::getMaxAbsCurvature(size_t* index) const {
+    double max_value = 0.0;
+    size_t max_index = 0;
+    for (size_t i = 0; i < curvature_.size(); ++i) {
+        if (std::abs(curvature_[i]) > max_value) {
+            max_value = std::abs(curvature_[i]);
+            max_index = i;
+        }
+    }
+    if (index) {
+        *index = max_index;
+    }
+    return max_value;
+}
+
+double TrajectoryGeometry::getMaxAbsLateralAcceleration(size_t* index) const {
+    double max_value = 0.0;
+    size_t max_index = 0;
+    for (size_t i = 0; i < lateral_acc_.size(); ++i) {
+        if (std::abs(lateral_acc_[i]) > max_value) {
+            max_value = std::abs(lateral_acc_[i]);
+            max_index = i;
+        }
+    }
+    if (index) {
+        *index = max_index;
+    }
+    return max_value;
+}
+
+size_t TrajectoryGeometry::countExceeding(double lateral_acceleration_limit) const {
+    size_t count = 0;
+    for (double value : lateral_acc_) {
+        count += std::abs(value) > lateral_acceleration_limit ? 1 : 0;
+    }
+    return count;
+}
+
+} // namespace trajectory_editor
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "trajectory_data.hpp"
+#include <vector>
+#include <cstdint>
+
+namespace trajectory_editor {
+
+// 微分幾何カーネル（列指向の配列に対して一括計算する）
+namespace geometry_kernels {
+
+// 3点（Menger）曲率と横加速度 v^2 * kappa を計算する
+// x, y, v は [begin-1, end+1) を参照できること。結果は curvature[i], lateral_acceleration[i] に書く
+void computeCurvature(const double* x, const double* y, const double* v,
+                      size_t begin, size_t end,
+                      double* curvature, double* lateral_acceleration);
+
+} // namespace geometry_kernels
+
+// 点ごとの方位・符号付き曲率・横加速度のキャッシュ
+//
+// update() は TrajectoryData の変更ジャーナルを見て、編集された点の
+// 近傍ウィンドウだけを再計算する。
+class TrajectoryGeometry {
+public:
+    TrajectoryGeometry();
+
+    // 構築・更新
+    void build(const TrajectoryData& data);
+    void update(const TrajectoryData& data);
+    void clear();
+
+    // データアクセス
+    size_t size() const { return heading_.size(); }
+    bool empty() const { return heading_.empty(); }
+    const std::vector<double>& getHeadings() const { return heading_; }
+    const std::vector<double>& getCurvatures() const { return curvature_; }               // [1/m]（左旋回が正）
+    const std::vector<double>& getLateralAccelerations() const { return lateral_acc_; }   // [m/s^2]（左旋回が正）
+
+    // 統計
+    double getMaxAbsCurvature(size_t* index = nullptr) const;
+    double getMaxAbsLateralAcceleration(size_t* index = nullptr) const;
+    size_t countExceeding(double lateral_acceleration_limit) const;
+
+    // 直近の update() で再計算した点数
+    size_t getLastRecomputedCount() const { return last_recomputed_; }
+
+private:
+    const TrajectoryData* data_;
+    uint64_t revision_;
+    std::vector<double> heading_;
+    std::vector<double> curvature_;
+    std::vector<double> lateral_acc_;
+    size_t last_recomputed_;
+
+    // カーネル入力用の列（SoA）
+    std::vector<double> xs_, ys_, vs_;
+
+    void recompute(const TrajectoryData& data, size_t begin, size_t end, bool velocity_only);
+};
+
+} // namespace trajectory_editor
@@ -0,0 +1,399 @@
+#include "trajectory_overlay.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace trajectory_editor {
+
+namespace {
+
+// ストリーム書き出し用のバッファサイズ
+constexpr size_t STREAM_BUFFER_SIZE = 1 << 20;
+
+// 書き出し先のファイル（mmap中のベースを上書きしないよう一時ファイル経由で置き換える）
+class AtomicOutputFile {
+public:
+    explicit AtomicOutputFile(const std::string& filepath)
+        : filepath_(filepath), temp_path_(filepath + ".tmp"), file_(std::fopen(temp_path_.c_str(), "wb")) {
+        if (file_) {
+            std::setvbuf(file_, nullptr, _IOFBF, STREAM_BUFFER_SIZE);
+        }
+    }
+
+    ~AtomicOutputFile() {
+        if (file_) {
+            std::fclose(file_);
+            std::remove(temp_path_.c_str());
+        }
+    }
+
+    FILE* get() const { return file_; }
+
+    bool commit() {
+        bool success = std::fclose(file_) == 0;
+        file_ = nullptr;
+        if (!success || std::rename(temp_path_.c_str(), filepath_.c_str()) != 0) {
+            std::remove(temp_path_.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::string filepath_;
+    std::string temp_path_;
+    FILE* file_;
+};
+
+} // namespace
+
+// Cursor implementation
+TrajectoryOverlay::Cursor::Cursor(const TrajectoryOverlay* owner, size_t index)
+    : owner_(owner), piece_(owner->pieces_.size()), offset_(0), index_(index), current_(nullptr) {
+    if (index < owner_->size_) {
+        piece_ = owner_->findPiece(index);
+        offset_ = index - owner_->piece_offsets_[piece_];
+    }
+    loadPiece();
+}
+
+void TrajectoryOverlay::Cursor::loadPiece() {
+    if (valid()) {
+        current_ = owner_->pieceData(owner_->pieces_[piece_]) + offset_;
+    } else {
+        current_ = nullptr;
+    }
+}
+
+void TrajectoryOverlay::Cursor::next() {
+    skip(1);
+}
+
+const TrajectoryPoint* TrajectoryOverlay::Cursor::span(size_t& count) const {
+    if (!valid()) {
+        count = 0;
+        return nullptr;
+    }
+    count = owner_->pieces_[piece_].length - offset_;
+    return current_;
+}
+
+void TrajectoryOverlay::Cursor::skip(size_t count) {
+    index_ += count;
+    offset_ += count;
+    while (valid() && offset_ >= owner_->pieces_[piece_].length) {
+        offset_ -= owner_->pieces_[piece_].length;
+        ++piece_;
+    }
+    loadPiece();
+}
+
+// TrajectoryOverlay implementation
+TrajectoryOverlay::TrajectoryOverlay()
+    : base_points_(nullptr), base_size_(0), size_(0), is_modified_(false) {}
+
+TrajectoryOverlay::~TrajectoryOverlay() = default;
+
+bool TrajectoryOverlay::openBase(const std::string& filepath) {
+    close();
+
+    if (!base_file_.open(filepath)) {
+        last_error_ = "Cannot open: " + filepath;
+        return false;
+    }
+
+    TrajectoryBinaryHeader header;
+    if (base_file_.size() < sizeof(header)) {
+        base_file_.close();
+        last_error_ = "Not a trajectory binary file (or unsupported version): " + filepath;
+        return false;
+    }
+    std::memcpy(&header, base_file_.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, "TRJB", 4) != 0 || header.version != TRAJECTORY_BINARY_VERSION) {
+        base_file_.close();
+        last_error_ = "Not a trajectory binary file (or unsupported version): " + filepath;
+        return false;
+    }
+    if (header.point_count > (base_file_.size() - sizeof(header)) / sizeof(TrajectoryPoint)) {
+        base_file_.close();
+        last_error_ = "Truncated file: " + filepath;
+        return false;
+    }
+
+    // ヘッダーは16バイトなのでページ境界からのオフセットでもdoubleの整列は保たれる
+    base_points_ = reinterpret_cast<const TrajectoryPoint*>(base_file_.data() + sizeof(header));
+    base_size_ = static_cast<size_t>(header.point_count);
+    revert();
+    last_error_.clear();
+    return true;
+}
+
+void TrajectoryOverlay::close() {
+    base_file_.close();
+    base_points_ = nullptr;
+    base_size_ = 0;
+    added_points_.clear();
+    pieces_.clear();
+    piece_offsets_.clear();
+    size_ = 0;
+    is_modified_ = false;
+}
+
+void TrajectoryOverlay::revert() {
+    added_points_.clear();
+    added_points_.shrink_to_fit();
+    pieces_.clear();
+    if (base_size_ > 0) {
+        pieces_.push_back({BASE, 0, base_size_});
+    }
+    rebuildOffsets(0);
+    is_modified_ = false;
+}
+
+const TrajectoryPoint& TrajectoryOverlay::getPoint(size_t index) const {
+    if (index >= size_) {
+        throw std::out_of_range("Index out of range");
+    }
+    size_t piece_index = findPiece(index);
+    const Piece& piece = pieces_[piece_index];
+    return pieceData(piece)[index - piece_offsets_[piece_index]];
+}
+
+void TrajectoryOverlay::updatePoint(size_t index, const TrajectoryPoint& point) {
+    if (index >= size_) {
+        throw std::out_of_range("Index out of range");
+    }
+
+    // 既に追加バッファにある点はその場で書き換える（同じ点の繰り返しドラッグでメモリが増えない）
+    size_t piece_index = findPiece(index);
+    const Piece& piece = pieces_[piece_index];
+    if (piece.source == ADDED) {
+        added_points_[piece.start + (index - piece_offsets_[piece_index])] = point;
+        is_modified_ = true;
+        return;
+    }
+
+    // ベース上の点は1点の追加ピースで置き換える
+    size_t first = splitAt(index);
+    splitAt(index + 1);
+    pieces_[first] = {ADDED, added_points_.size(), 1};
+    added_points_.push_back(point);
+    mergeAround(first);
+    is_modified_ = true;
+}
+
+void TrajectoryOverlay::movePoint(size_t index, double new_x, double new_y) {
+    TrajectoryPoint point = getPoint(index);
+    point.x = new_x;
+    point.y = new_y;
+    updatePoint(index, point);
+}
+
+void TrajectoryOverlay::insertPoint(size_t index, const TrajectoryPoint& point) {
+    insertRange(index, std::vector<TrajectoryPoint>{point});
+}
+
+void TrajectoryOverlay::removePoint(size_t index) {
+    if (index >= size_) {
+        throw std::out_of_range("Index out of range");
+    }
+    removeRange(index, 1);
+}
+
+void TrajectoryOverlay::insertRange(size_t index, const std::vector<TrajectoryPoint>& points) {
+    if (index > size_) {
+        throw std::out_of_range("Index out of range");
+    }
+    if (points.empty()) {
+        return;
+    }
+
+    size_t position = splitAt(index);
+    Piece piece{ADDED, added_points_.size(), points.size()};
+    added_points_.insert(added_points_.end(), points.begin(), points.end());
+    insertPiece(position, piece);
+    is_modified_ = true;
+}
+
+void TrajectoryOverlay::removeRange(size_t first, size_t count) {
+    if (first > size_ || count > size_ - first) {
+        throw std::out_of_range("Invalid range");
+    }
+    if (count == 0) {
+        return;
+    }
+
+    size_t begin_piece = splitAt(first);
+    size_t end_piece = splitAt(first + count);
+    pieces_.erase(pieces_.begin() + begin_piece, pieces_.begin() + end_piece);
+    rebuildOffsets(begin_piece);
+    mergeAround(begin_piece);
+    is_modified_ = true;
+}
+
+size_t TrajectoryOverlay::getOverlayMemoryUsage() const {
+    return added_points_.capacity() * sizeof(TrajectoryPoint) +
+           pieces_.capacity() * sizeof(Piece) +
+           piece_offsets_.capacity() * sizeof(size_t);
+}
+
+bool TrajectoryOverlay::saveToBinary(const std::string& filepath) const {
+    AtomicOutputFile output(filepath);
+    if (!output.get()) {
+        last_error_ = "Cannot write: " + filepath;
+        return false;
+    }
+
+    TrajectoryBinaryHeader header;
+    std::memcpy(header.magic, "TRJB", 4);
+    header.version = TRAJECTORY_BINARY_VERSION;
+    header.point_count = size_;
+    bool success = std::fwrite(&header, sizeof(header), 1, output.get()) == 1;
+
+    // ピース単位で連続領域をそのまま書き出す
+    success = success && streamPoints([&](const TrajectoryPoint* data, size_t count) {
+        return std::fwrite(data, sizeof(TrajectoryPoint), count, output.get()) == count;
+    });
+
+    if (!success || !output.commit()) {
+        last_error_ = "Failed to write " + filepath;
+        return false;
+    }
+    last_error_.clear();
+    return true;
+}
+
+bool TrajectoryOverlay::saveToCSV(const std::string& filepath) const {
+    AtomicOutputFile output(filepath);
+    if (!output.get()) {
+        last_error_ = "Cannot write: " + filepath;
+        return false;
+    }
+
+    std::fputs("x,y,z,velocity_ms\n", output.get());
+
+    // 行ごとのstd::string生成を避けてバッファに直接整形する（TrajectoryData::saveToCSV と同じ %f 表記）
+    std::vector<char> buffer(STREAM_BUFFER_SIZE);
+    size_t used = 0;
+    auto flush = [&]() {
+        bool flushed = std::fwrite(buffer.data(), 1, used, output.get()) == used;
+        used = 0;
+        return flushed;
+    };
+    auto format = [&](const TrajectoryPoint& point) {
+        return std::snprintf(buffer.data() + used, buffer.size() - used, "%f,%f,%f,%f\n",
+                             point.x, point.y, point.z, point.velocity);
+    };
+
+    bool success = streamPoints([&](const TrajectoryPoint* data, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            // %f は値の桁数だけ長くなるので、収まらなかった行は書き出してから整形し直す
+            int written = format(data[i]);
+            if (written >= 0 && static_cast<size_t>(written) >= buffer.size() - used) {
+                if (!flush()) {
+                    return false;
+                }
+                if (static_cast<size_t>(written) >= buffer.size()) {
+                    buffer.resize(static_cast<size_t>(written) + 1);
+                }
+                written = format(data[i]);
+            }
+            if (written < 0) {
+                return false;
+            }
+            used += static_cast<size_t>(written);
+        }
+        return true;
+    });
+
+    if (!success || !flush() || !output.commit()) {
+        last_error_ = "Failed to write " + filepath;
+        return false;
+    }
+    last_error_.clear();
+    return true;
+}
+
+const TrajectoryPoint* TrajectoryOverlay::pieceData(const Piece& piece) const {
+    return (piece.source == BASE ? base_points_ : added_points_.data()) + piece.start;
+}
+
+size_t TrajectoryOverlay::findPiece(size_t index) const {
+    // index を含むピース（開始位置が index 以下で最大のもの）
+    auto it = std::upper_bound(piece_offsets_.begin(), piece_offsets_.end(), index);
+    return static_cast<size_t>(it - piece_offsets_.begin()) - 1;
+}
+
+size_t TrajectoryOverlay::splitAt(size_t index) {
+    if (index >= size_) {
+        return pieces_.size();
+    }
+
+    size_t piece_index = findPiece(index);
+    size_t offset = index - piece_offsets_[piece_index];
+    if (offset == 0) {
+        return piece_index;
+    }
+
+    Piece& piece = pieces_[piece_index];
+    Piece tail{piece.source, piece.start + offset, piece.length - offset};
+    piece.length = offset;
+    pieces_.insert(pieces_.begin() + piece_index + 1, tail);
+    rebuildOffsets(piece_index + 1);
+    return piece_index + 1;
+}
+
+void TrajectoryOverlay::insertPiece(size_t position, const Piece& piece) {
+    pieces_.insert(pieces_.begin() + position, piece);
+    rebuildOffsets(position);
+    mergeAround(position);
+}
+
+void TrajectoryOverlay::mergeAround(size_t position) {
+    // 同じソース上で連続するピースを結合してピース数を抑える
+    auto contiguous = [&](size_t a) {
+        const Piece& left = pieces_[a];
+        const Piece& right = pieces_[a + 1];
+        return left.source == right.source && left.start + left.length == right.start;
+    };
+
+    size_t first = position > 0 ? position - 1 : 0;
+    size_t last = std::min(position + 1, pieces_.size());
+    bool merged = false;
+    for (size_t i = last; i > first; --i) {
+        size_t a = i - 1;
+        if (a + 1 < pieces_.size() && contiguous(a)) {
+            pieces_[a].length += pieces_[a + 1].length;
+            pieces_.erase(pieces_.begin() + a + 1);
+            merged = true;
+        }
+    }
+    if (merged) {
+        rebuildOffsets(first);
+    }
+}
+
+void TrajectoryOverlay::rebuildOffsets(size_t from_piece) {
+    piece_offsets_.resize(pieces_.size());
+    size_t offset = from_piece > 0 ? piece_offsets_[from_piece - 1] + pieces_[from_piece - 1].length : 0;
+    for (size_t i = from_piece; i < pieces_.size(); ++i) {
+        piece_offsets_[i] = offset;
+        offset += pieces_[i].length;
+    }
+    size_ = offset;
+}
+
+template <typename Writer>
+bool TrajectoryOverlay::streamPoints(Writer&& writer) const {
+    base_file_.adviseSequential();  // 書き出しはベースを先頭から1回読むだけ
+    for (const auto& piece : pieces_) {
+        if (!writer(pieceData(piece), piece.length)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace trajectory_editor
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "trajectory_data.hpp"
+#include "../utils/mapped_file.hpp"
+#include <vector>
+#include <string>
+
+namespace trajectory_editor {
+
+// 読み取り専用のベース軌跡（メモリマップ）と疎な編集オーバーレイ
+//
+// ベースはバイナリ形式（.trjb）をmmapしたままコピーせず、編集結果は
+// ピーステーブル（ベース区間・追加区間の並び）として保持する。
+// 置換・挿入・削除はピースの分割で表現するため、メモリ使用量は
+// ファイルサイズではなく編集量に比例する。
+class TrajectoryOverlay {
+public:
+    // 先頭から順に点を読むカーソル
+    class Cursor {
+    public:
+        bool valid() const { return piece_ < owner_->pieces_.size(); }
+        const TrajectoryPoint& point() const { return *current_; }
+        size_t index() const { return index_; }
+        void next();
+
+        // 現在のピース内で連続している残りの点（まとめて処理する場合用）
+        const TrajectoryPoint* span(size_t& count) const;
+        void skip(size_t count);
+
+    private:
+        friend class TrajectoryOverlay;
+        Cursor(const TrajectoryOverlay* owner, size_t index);
+        void loadPiece();
+
+        const TrajectoryOverlay* owner_;
+        size_t piece_;
+        size_t offset_;         // ピース内オフセット
+        size_t index_;          // 論理インデックス
+        const TrajectoryPoint* current_;
+    };
+
+    TrajectoryOverlay();
+    ~TrajectoryOverlay();
+
+    TrajectoryOverlay(const TrajectoryOverlay&) = delete;
+    TrajectoryOverlay& operator=(const TrajectoryOverlay&) = delete;
+
+    // ファイル操作（失敗した理由は getLastError()）
+    bool openBase(const std::string& filepath);
+    bool saveToBinary(const std::string& filepath) const;
+    bool saveToCSV(const std::string& filepath) const;
+    void close();
+    const std::string& getLastError() const { return last_error_; }
+
+    // データアクセス
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const TrajectoryPoint& getPoint(size_t index) const;
+    Cursor cursor(size_t start_index = 0) const { return Cursor(this, start_index); }
+
+    // データ操作（TrajectoryDataと同じ意味論）
+    void updatePoint(size_t index, const TrajectoryPoint& point);
+    void movePoint(size_t index, double new_x, double new_y);
+    void insertPoint(size_t index, const TrajectoryPoint& point);
+    void removePoint(size_t index);
+    void insertRange(size_t index, const std::vector<TrajectoryPoint>& points);
+    void removeRange(size_t first, size_t count);
+
+    // 編集を破棄してベースの状態に戻す
+    void revert();
+
+    // 状態管理
+    bool isModified() const { return is_modified_; }
+    size_t getPieceCount() const { return pieces_.size(); }
+    size_t getOverlayMemoryUsage() const;
+
+private:
+    enum PieceSource : uint8_t {
+        BASE,   // mmapされたベース配列
+        ADDED   // 追加バッファ
+    };
+
+    struct Piece {
+        PieceSource source;
+        size_t start;    // ソース配列内の開始位置
+        size_t length;
+    };
+
+    MappedFile base_file_;
+    const TrajectoryPoint* base_points_;
+    size_t base_size_;
+
+    std::vector<TrajectoryPoint> added_points_;  // 追記専用
+    std::vector<Piece> pieces_;
+    std::vector<size_t> piece_offsets_;          // 各ピースの論理開始インデックス
+    size_t size_;
+    bool is_modified_;
+    mutable std::string last_error_;
+
+    const TrajectoryPoint* pieceData(const Piece& piece) const;
+    size_t findPiece(size_t index) const;
+    size_t splitAt(size_t index);
+    void insertPiece(size_t position, const Piece& piece);
+    void mergeAround(size_t position);
+    void rebuildOffsets(size_t from_piece);
+    template <typename Writer>
+    bool streamPoints(Writer&& writer) const;
+};
+
+} // namespace trajectory_editor
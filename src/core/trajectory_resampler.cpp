@@ -0,0 +1,237 @@
+#include "trajectory_resampler.hpp"
+#include "../utils/parallel.hpp"
+#include "../utils/trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace trajectory_editor {
+
+namespace {
+
+// 並列化する最小のチャンク
+constexpr size_t PARALLEL_CHUNK = 16384;
+
+// 区間内のパラメータを逆算するニュートン法の反復回数
+constexpr int NEWTON_ITERATIONS = 3;
+
+// 区間の速さ |p'(t)| の2次近似 q0 + q1 t + q2 t^2
+struct SpeedFit {
+    double q0, q1, q2;
+};
+
+// 1区間分の3次式 p(t) = a + b t + c t^2 + d t^3（t は [0, 1]）
+//
+// 弧長は xy 平面での速さ |p'(t)| を t = 0, 0.5, 1 の3点で2次式に近似して積分する
+// （全長はSimpson則と同じ）。区間内の逆算は平方根なしの多項式で済む。
+struct SegmentCurve {
+    double ax, bx, cx, dx;
+    double ay, by, cy, dy;
+    double az, bz, cz, dz;
+    double v0, v1;
+    SpeedFit q;  // 速さの近似 q0 + q1 t + q2 t^2
+
+    double speed(double t) const {
+        double tx = bx + t * (2.0 * cx + t * 3.0 * dx);
+        double ty = by + t * (2.0 * cy + t * 3.0 * dy);
+        return std::sqrt(tx * tx + ty * ty);
+    }
+
+    void fitSpeed() {
+        double s0 = speed(0.0);
+        double s1 = speed(0.5);
+        double s2 = speed(1.0);
+        q.q0 = s0;
+        q.q1 = -3.0 * s0 + 4.0 * s1 - s2;
+        q.q2 = 2.0 * s0 - 4.0 * s1 + 2.0 * s2;
+    }
+
+    // [0, t] の弧長
+    double length(double t) const {
+        return t * (q.q0 + t * (0.5 * q.q1 + t * q.q2 / 3.0));
+    }
+
+    // 区間内の弧長 s に対応するパラメータ
+    double parameterAt(double s) const {
+        double total = length(1.0);
+        if (total <= 0.0) {
+            return 0.0;
+        }
+        double t = s / total;
+        for (int i = 0; i < NEWTON_ITERATIONS; ++i) {
+            double v = q.q0 + t * (q.q1 + t * q.q2);
+            if (v <= 0.0) {
+                break;
+            }
+            t = std::max(0.0, std::min(1.0, t - (length(t) - s) / v));
+        }
+        return t;
+    }
+
+    TrajectoryPoint evaluate(double t) const {
+        return TrajectoryPoint(ax + t * (bx + t * (cx + t * dx)),
+                               ay + t * (by + t * (cy + t * dy)),
+                               az + t * (bz + t * (cz + t * dz)),
+                               v0 + t * (v1 - v0));
+    }
+};
+
+// ノット間隔 |p1 - p0|^alpha（xy平面の距離）
+double knotInterval(const TrajectoryPoint& p0, const TrajectoryPoint& p1, double alpha) {
+    double dx = p1.x - p0.x;
+    double dy = p1.y - p0.y;
+    double d2 = dx * dx + dy * dy;
+    if (alpha == 0.5) {
+        return std::sqrt(std::sqrt(d2));
+    }
+    return alpha == 0.0 ? 1.0 : std::pow(d2, 0.5 * alpha);
+}
+
+// 端点の外側は反対側の点を折り返した仮想の制御点を使う（ノット間隔は隣と同じになる）
+TrajectoryPoint reflect(const TrajectoryPoint& center, const TrajectoryPoint& other) {
+    return TrajectoryPoint(2.0 * center.x - other.x, 2.0 * center.y - other.y, 2.0 * center.z - other.z, 0.0);
+}
+
+// points[segment] → points[segment + 1] の区間のスプライン（Hermite形式に直す）
+// 速さの近似は呼び出し側で fitSpeed するか、先に求めたものを入れる
+// knots[k] は区間 knot_first + k のノット間隔
+SegmentCurve makeCurve(const std::vector<TrajectoryPoint>& points, size_t segment,
+                       const std::vector<double>& knots, size_t knot_first) {
+    const TrajectoryPoint& p1 = points[segment];
+    const TrajectoryPoint& p2 = points[segment + 1];
+    size_t k = segment - knot_first;
+    double dt1 = knots[k];
+
+    SegmentCurve curve{p1.x, 0.0, 0.0, 0.0, p1.y, 0.0, 0.0, 0.0, p1.z, 0.0, 0.0, 0.0,
+                       p1.velocity, p2.velocity, {0.0, 0.0, 0.0}};
+    if (dt1 <= 0.0) {
+        return curve;  // 長さ0の区間は1点に潰れる
+    }
+
+    TrajectoryPoint p0 = segment > 0 ? points[segment - 1] : reflect(p1, p2);
+    TrajectoryPoint p3 = segment + 2 < points.size() ? points[segment + 2] : reflect(p2, p1);
+    double dt0 = segment > 0 ? knots[k - 1] : dt1;
+    double dt2 = segment + 2 < points.size() ? knots[k + 1] : dt1;
+    if (dt0 <= 0.0) {
+        dt0 = dt1;
+    }
+    if (dt2 <= 0.0) {
+        dt2 = dt1;
+    }
+
+    // 接線（区間のパラメータ幅 dt1 で正規化済み）。割り算は先にまとめる
+    double w0 = dt1 / dt0;
+    double w01 = dt1 / (dt0 + dt1);
+    double w12 = dt1 / (dt1 + dt2);
+    double w2 = dt1 / dt2;
+    auto hermite = [&](double c0, double c1, double c2, double c3, double& a, double& b, double& c, double& d) {
+        double m1 = w0 * (c1 - c0) - w01 * (c2 - c0) + (c2 - c1);
+        double m2 = (c2 - c1) - w12 * (c3 - c1) + w2 * (c3 - c2);
+        a = c1;
+        b = m1;
+        c = -3.0 * c1 - 2.0 * m1 + 3.0 * c2 - m2;
+        d = 2.0 * c1 + m1 - 2.0 * c2 + m2;
+    };
+    hermite(p0.x, p1.x, p2.x, p3.x, curve.ax, curve.bx, curve.cx, curve.dx);
+    hermite(p0.y, p1.y, p2.y, p3.y, curve.ay, curve.by, curve.cy, curve.dy);
+    hermite(p0.z, p1.z, p2.z, p3.z, curve.az, curve.bz, curve.cz, curve.dz);
+    return curve;
+}
+
+} // namespace
+
+TrajectoryResampler::TrajectoryResampler() = default;
+
+std::vector<TrajectoryPoint> TrajectoryResampler::resample(const TrajectoryData& data) const {
+    if (data.empty()) {
+        return {};
+    }
+    return resample(data.getPoints(), 0, data.size() - 1);
+}
+
+std::vector<TrajectoryPoint> TrajectoryResampler::resample(const std::vector<TrajectoryPoint>& points,
+                                                           size_t start_index, size_t end_index) const {
+    TRACE_ZONE("TrajectoryResampler::resample");
+    if (start_index >= points.size() || end_index >= points.size() || start_index > end_index) {
+        throw std::out_of_range("Invalid range");
+    }
+    if (!(options_.spacing > 0.0)) {
+        throw std::invalid_argument("Resample spacing must be positive");
+    }
+
+    size_t segment_count = end_index - start_index;
+    if (segment_count == 0) {
+        return {points[start_index]};
+    }
+
+    // ノット間隔は範囲の前後1区間まで先に求めておく（各区間の計算で3回ずつ使う）
+    size_t knot_first = start_index > 0 ? start_index - 1 : 0;
+    size_t knot_last = std::min(end_index + 1, points.size() - 1);  // 区間 [knot_first, knot_last)
+    std::vector<double> knots(knot_last - knot_first);
+    parallelFor(0, knots.size(), PARALLEL_CHUNK, [&](size_t chunk_begin, size_t chunk_end) {
+        for (size_t k = chunk_begin; k < chunk_end; ++k) {
+            knots[k] = knotInterval(points[knot_first + k], points[knot_first + k + 1], options_.alpha);
+        }
+    });
+
+    // 区間ごとのスプライン長の累積（cumulative[j] は start_index + j までの距離）
+    // 速さの近似（平方根3回）は出力点の計算でも使うので区間ごとに残しておく
+    std::vector<SpeedFit> speeds(segment_count);
+    std::vector<double> cumulative(segment_count + 1, 0.0);
+    parallelFor(0, segment_count, PARALLEL_CHUNK, [&](size_t chunk_begin, size_t chunk_end) {
+        for (size_t j = chunk_begin; j < chunk_end; ++j) {
+            SegmentCurve curve = makeCurve(points, start_index + j, knots, knot_first);
+            curve.fitSpeed();
+            speeds[j] = curve.q;
+            cumulative[j + 1] = curve.length(1.0);
+        }
+    });
+    for (size_t j = 0; j < segment_count; ++j) {
+        cumulative[j + 1] += cumulative[j];
+    }
+
+    double total = cumulative.back();
+    if (total <= 0.0) {
+        return std::vector<TrajectoryPoint>(points.begin() + start_index, points.begin() + end_index + 1);
+    }
+
+    double intervals = std::max(1.0, std::round(total / options_.spacing));
+    if (intervals >= static_cast<double>(options_.max_points)) {
+        throw std::length_error("Resample spacing is too small: " +
+                                std::to_string(static_cast<unsigned long long>(intervals)) + " points (limit " +
+                                std::to_string(options_.max_points) + ")");
+    }
+    size_t interval_count = static_cast<size_t>(intervals);
+    double step = total / static_cast<double>(interval_count);
+
+    std::vector<TrajectoryPoint> result(interval_count + 1);
+    parallelFor(0, interval_count + 1, PARALLEL_CHUNK, [&](size_t chunk_begin, size_t chunk_end) {
+        // チャンク先頭の区間だけ二分探索し、あとは距離の増加に合わせて進める
+        double s = static_cast<double>(chunk_begin) * step;
+        size_t segment = std::upper_bound(cumulative.begin(), cumulative.end(), s) - cumulative.begin();
+        segment = std::min(segment_count, std::max<size_t>(segment, 1)) - 1;
+        SegmentCurve curve = makeCurve(points, start_index + segment, knots, knot_first);
+        curve.q = speeds[segment];
+
+        for (size_t k = chunk_begin; k < chunk_end; ++k) {
+            s = static_cast<double>(k) * step;
+            if (segment + 1 < segment_count && cumulative[segment + 1] <= s) {
+                // 間引く場合は飛ばす区間のスプラインを作らない
+                do {
+                    ++segment;
+                } while (segment + 1 < segment_count && cumulative[segment + 1] <= s);
+                curve = makeCurve(points, start_index + segment, knots, knot_first);
+                curve.q = speeds[segment];
+            }
+            result[k] = curve.evaluate(curve.parameterAt(s - cumulative[segment]));
+        }
+    });
+
+    // 端点は丸め誤差を残さず元の点にする
+    result.front() = points[start_index];
+    result.back() = points[end_index];
+    return result;
+}
+
+} // namespace trajectory_editor
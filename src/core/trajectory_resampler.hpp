@@ -0,0 +1,40 @@
+#pragma once
+
+#include "trajectory_data.hpp"
+#include <vector>
+
+namespace trajectory_editor {
+
+// リサンプリングの設定
+struct ResampleOptions {
+    double spacing = 1.0;  // 点の間隔 [m]
+    double alpha = 0.5;    // Catmull-Romのパラメータ化（0: uniform, 0.5: centripetal, 1: chordal）
+    size_t max_points = 50000000;  // 出力点数の上限（小さすぎる spacing で確保しきれない点数を作らない）
+};
+
+// Catmull-Romスプラインによる等間隔リサンプリング
+//
+// 区間ごとのスプライン長を求めて累積し、出力点の距離から
+// 区間内のパラメータをニュートン法で逆算する。範囲の両端点はそのまま残し、
+// 間隔は範囲の長さを等分できるように spacing から少し調整する。
+// x, y, z はスプライン、速度は区間内で線形に補間する（上限を超えないように）。
+// 範囲の外側に点があれば制御点に使うので、つなぎ目でも接線が連続する。
+class TrajectoryResampler {
+public:
+    TrajectoryResampler();
+
+    // 設定
+    void setOptions(const ResampleOptions& options) { options_ = options; }
+    const ResampleOptions& getOptions() const { return options_; }
+
+    // points[start_index..end_index] を等間隔にした点列（end_indexは含む）
+    // 出力が max_points を超える spacing では std::length_error を投げる
+    std::vector<TrajectoryPoint> resample(const std::vector<TrajectoryPoint>& points,
+                                          size_t start_index, size_t end_index) const;
+    std::vector<TrajectoryPoint> resample(const TrajectoryData& data) const;
+
+private:
+    ResampleOptions options_;
+};
+
+} // namespace trajectory_editor
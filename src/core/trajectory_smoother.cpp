@@ -0,0 +1,84 @@
+#include "trajectory_smoother.hpp"
+#include "pentadiagonal_solver.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace trajectory_editor {
+
+TrajectorySmoother::TrajectorySmoother() = default;
+
+std::vector<TrajectoryPoint> TrajectorySmoother::smooth(const std::vector<TrajectoryPoint>& points,
+                                                        size_t start_index, size_t end_index) const {
+    if (start_index >= points.size() || end_index >= points.size() || start_index > end_index) {
+        throw std::out_of_range("Invalid range");
+    }
+    if (options_.smoothness < 0.0) {
+        throw std::invalid_argument("Smoothness must not be negative");
+    }
+
+    std::vector<TrajectoryPoint> result(points.begin() + start_index, points.begin() + end_index + 1);
+    if (end_index - start_index < 2 || options_.smoothness == 0.0) {
+        return result;  // 動かせる点がない
+    }
+
+    // 未知数は内部の点 start_index + 1 + k（k = 0..m-1）
+    const size_t first = start_index + 1;
+    const size_t m = end_index - start_index - 1;
+    const double lambda = options_.smoothness;
+
+    // 5重対角の対称行列（対角・1つ右・2つ右）と右辺
+    std::vector<double> diag(m, 1.0), off1(m, 0.0), off2(m, 0.0);
+    std::vector<double> rhs_x(m), rhs_y(m);
+    for (size_t k = 0; k < m; ++k) {
+        rhs_x[k] = points[first + k].x;
+        rhs_y[k] = points[first + k].y;
+    }
+
+    // 2階差分の項 (c-1, c, c+1) の係数 (1, -2, 1) を正規方程式に足す
+    const double weight[3] = {1.0, -2.0, 1.0};
+    size_t c_begin = std::max<size_t>(start_index, 1);
+    size_t c_end = std::min(end_index, points.size() - 2);
+    for (size_t c = c_begin; c <= c_end; ++c) {
+        for (int a = 0; a < 3; ++a) {
+            size_t i = c - 1 + a;
+            if (i < first || i > end_index - 1) {
+                continue;
+            }
+            size_t ki = i - first;
+            for (int b = 0; b < 3; ++b) {
+                size_t j = c - 1 + b;
+                double value = lambda * weight[a] * weight[b];
+                if (j >= first && j <= end_index - 1) {
+                    // 上三角だけ持つ
+                    if (b == a) {
+                        diag[ki] += value;
+                    } else if (b == a + 1) {
+                        off1[ki] += value;
+                    } else if (b == a + 2) {
+                        off2[ki] += value;
+                    }
+                } else {
+                    // 固定点は右辺へ移す
+                    rhs_x[ki] -= value * points[j].x;
+                    rhs_y[ki] -= value * points[j].y;
+                }
+            }
+        }
+    }
+
+    // x, y で分解を共有する
+    PentadiagonalSolver solver;
+    if (!solver.factor(diag, off1, off2)) {
+        return result;
+    }
+    solver.solve(rhs_x);
+    solver.solve(rhs_y);
+
+    for (size_t k = 0; k < m; ++k) {
+        result[k + 1].x = rhs_x[k];
+        result[k + 1].y = rhs_y[k];
+    }
+    return result;
+}
+
+} // namespace trajectory_editor
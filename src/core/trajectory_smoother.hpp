@@ -0,0 +1,36 @@
+#pragma once
+
+#include "trajectory_data.hpp"
+#include <vector>
+
+namespace trajectory_editor {
+
+// 平滑化の設定
+struct SmoothingOptions {
+    double smoothness = 4.0;  // 2階差分（曲がり）への重み。大きいほど元の点から離れてなめらかになる
+};
+
+// 範囲を限定した最小二乗平滑化
+//
+// 窓 [start, end] の両端を固定し、内部の点 p について
+//   Σ |p_i - q_i|^2 + smoothness * Σ |p_{i-1} - 2 p_i + p_{i+1}|^2
+// を最小にする（q は元の点）。2階差分には窓の外側の隣接点も固定値として入れるので、
+// つなぎ目の向きも保たれる。正規方程式は5重対角なので PentadiagonalSolver で O(窓の点数)。
+// x, y だけを動かし、z と速度はそのまま残す。
+class TrajectorySmoother {
+public:
+    TrajectorySmoother();
+
+    // 設定
+    void setOptions(const SmoothingOptions& options) { options_ = options; }
+    const SmoothingOptions& getOptions() const { return options_; }
+
+    // points[start_index..end_index] を平滑化した点列（end_indexは含む。点数は変わらない）
+    std::vector<TrajectoryPoint> smooth(const std::vector<TrajectoryPoint>& points,
+                                        size_t start_index, size_t end_index) const;
+
+private:
+    SmoothingOptions options_;
+};
+
+} // namespace trajectory_editor
@@ -0,0 +1,257 @@
+#include "trajectory_snapshot.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace trajectory_editor {
+
+namespace {
+
+// スナップショットをチャンクごとに .trjb へ書く（一時ファイルに書いてから置き換える）
+bool writeSnapshot(const TrajectorySnapshot& snapshot, const std::string& filepath, std::string& error) {
+    const std::string temp_path = filepath + ".tmp";
+    FILE* file = std::fopen(temp_path.c_str(), "wb");
+    if (!file) {
+        error = "Cannot write: " + temp_path;
+        return false;
+    }
+
+    TrajectoryBinaryHeader header;
+    std::memcpy(header.magic, "TRJB", 4);
+    header.version = TRAJECTORY_BINARY_VERSION;
+    header.point_count = snapshot.size();
+    bool success = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    for (size_t c = 0; success && c < snapshot.getChunkCount(); ++c) {
+        const auto& points = snapshot.getChunk(c).points;
+        success = std::fwrite(points.data(), sizeof(TrajectoryPoint), points.size(), file) == points.size();
+    }
+    success = std::fclose(file) == 0 && success;
+
+    if (!success || std::rename(temp_path.c_str(), filepath.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        error = "Failed to write " + filepath;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+// TrajectorySnapshot implementation
+void TrajectorySnapshot::getBounds(double& min_x, double& max_x, double& min_y, double& max_y) const {
+    if (chunks_.empty()) {
+        min_x = max_x = min_y = max_y = 0.0;
+        return;
+    }
+
+    min_x = chunks_[0]->min_x;
+    max_x = chunks_[0]->max_x;
+    min_y = chunks_[0]->min_y;
+    max_y = chunks_[0]->max_y;
+
+    for (const auto& chunk : chunks_) {
+        min_x = std::min(min_x, chunk->min_x);
+        max_x = std::max(max_x, chunk->max_x);
+        min_y = std::min(min_y, chunk->min_y);
+        max_y = std::max(max_y, chunk->max_y);
+    }
+}
+
+void TrajectorySnapshot::getVelocityRange(double& min_vel, double& max_vel) const {
+    if (chunks_.empty()) {
+        min_vel = max_vel = 0.0;
+        return;
+    }
+
+    min_vel = chunks_[0]->min_velocity;
+    max_vel = chunks_[0]->max_velocity;
+
+    for (const auto& chunk : chunks_) {
+        min_vel = std::min(min_vel, chunk->min_velocity);
+        max_vel = std::max(max_vel, chunk->max_velocity);
+    }
+}
+
+std::vector<TrajectoryPoint> TrajectorySnapshot::toVector() const {
+    std::vector<TrajectoryPoint> result;
+    result.reserve(size_);
+    for (const auto& chunk : chunks_) {
+        result.insert(result.end(), chunk->points.begin(), chunk->points.end());
+    }
+    return result;
+}
+
+// SnapshotPublisher implementation
+SnapshotPublisher::SnapshotPublisher() : source_(nullptr), last_copied_chunks_(0) {}
+
+TrajectorySnapshotPtr SnapshotPublisher::publish(const TrajectoryData& data) {
+    TrajectorySnapshotPtr previous = latest();
+    bool same_source = previous && source_ == &data;
+
+    if (same_source && previous->revision_ == data.getRevision()) {
+        last_copied_chunks_ = 0;
+        return previous;
+    }
+
+    TrajectoryChange change;
+    if (same_source) {
+        change = data.getChangesSince(previous->revision_);
+    } else {
+        change.none = false;
+        change.full = true;
+    }
+
+    const auto& points = data.getPoints();
+    const size_t chunk_size = TrajectorySnapshot::CHUNK_SIZE;
+    const size_t chunk_count = (points.size() + chunk_size - 1) / chunk_size;
+
+    auto snapshot = std::make_shared<TrajectorySnapshot>();
+    snapshot->chunks_.reserve(chunk_count);
+    snapshot->size_ = points.size();
+    snapshot->revision_ = data.getRevision();
+
+    last_copied_chunks_ = 0;
+    for (size_t c = 0; c < chunk_count; ++c) {
+        size_t begin = c * chunk_size;
+        size_t end = std::min(points.size(), begin + chunk_size);
+
+        // 変更範囲に触れていないチャンクは前バージョンと共有する
+        bool untouched = !change.full && c < previous->chunks_.size() &&
+                         previous->chunks_[c]->points.size() == end - begin &&
+                         (end - 1 < change.first || (!change.structural && begin > change.last));
+
+        if (untouched) {
+            snapshot->chunks_.push_back(previous->chunks_[c]);
+        } else {
+            snapshot->chunks_.push_back(makeChunk(points, begin, end));
+            ++last_copied_chunks_;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        latest_ = snapshot;
+        source_ = &data;
+    }
+    return snapshot;
+}
+
+TrajectorySnapshotPtr SnapshotPublisher::latest() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return latest_;
+}
+
+std::shared_ptr<const TrajectoryChunk> SnapshotPublisher::makeChunk(const std::vector<TrajectoryPoint>& points,
+                                                                    size_t begin, size_t end) {
+    auto chunk = std::make_shared<TrajectoryChunk>();
+    chunk->points.assign(points.begin() + begin, points.begin() + end);
+
+    const auto& first = chunk->points.front();
+    chunk->min_x = chunk->max_x = first.x;
+    chunk->min_y = chunk->max_y = first.y;
+    chunk->min_velocity = chunk->max_velocity = first.velocity;
+
+    for (const auto& point : chunk->points) {
+        chunk->min_x = std::min(chunk->min_x, point.x);
+        chunk->max_x = std::max(chunk->max_x, point.x);
+        chunk->min_y = std::min(chunk->min_y, point.y);
+        chunk->max_y = std::max(chunk->max_y, point.y);
+        chunk->min_velocity = std::min(chunk->min_velocity, point.velocity);
+        chunk->max_velocity = std::max(chunk->max_velocity, point.velocity);
+    }
+    return chunk;
+}
+
+// SnapshotAutosave implementation
+SnapshotAutosave::SnapshotAutosave(const SnapshotPublisher& publisher)
+    : publisher_(publisher), pending_(false), busy_(false), stopping_(false) {}
+
+SnapshotAutosave::~SnapshotAutosave() {
+    stop();
+}
+
+void SnapshotAutosave::start(const std::string& filepath) {
+    stop();
+    filepath_ = filepath;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ = true;  // 開始時点の最新も書く
+        stopping_ = false;
+        saved_.reset();
+        last_error_.clear();
+    }
+    worker_ = std::thread([this]() { run(); });
+}
+
+void SnapshotAutosave::stop() {
+    if (!worker_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    worker_.join();
+}
+
+void SnapshotAutosave::notify() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ = true;
+    }
+    wake_.notify_one();
+}
+
+bool SnapshotAutosave::flush() {
+    if (!worker_.joinable()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        last_error_ = "Autosave is not running";
+        return false;
+    }
+    notify();
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this]() { return !pending_ && !busy_; });
+    return last_error_.empty();
+}
+
+uint64_t SnapshotAutosave::getSavedRevision() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return saved_ ? saved_->getRevision() : 0;
+}
+
+std::string SnapshotAutosave::getLastError() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_error_;
+}
+
+void SnapshotAutosave::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this]() { return pending_ || stopping_; });
+        if (!pending_) {
+            break;  // 停止（残っている保存は済ませてから抜ける）
+        }
+        pending_ = false;
+
+        TrajectorySnapshotPtr snapshot = publisher_.latest();
+        if (snapshot && snapshot != saved_) {
+            busy_ = true;
+            lock.unlock();
+            std::string error;
+            bool success = writeSnapshot(*snapshot, filepath_, error);
+            lock.lock();
+            busy_ = false;
+            if (success) {
+                saved_ = snapshot;
+                last_error_.clear();
+            } else {
+                last_error_ = error;
+            }
+        }
+        idle_.notify_all();
+    }
+    idle_.notify_all();
+}
+
+} // namespace trajectory_editor
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "trajectory_data.hpp"
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <thread>
+
+namespace trajectory_editor {
+
+// 固定長チャンク（不変・複数バージョンで共有される）
+struct TrajectoryChunk {
+    std::vector<TrajectoryPoint> points;
+
+    // チャンク単位の集計（スナップショットの範囲計算を O(チャンク数) にする）
+    double min_x, max_x, min_y, max_y;
+    double min_velocity, max_velocity;
+};
+
+// TrajectoryDataのある時点の不変バージョン
+//
+// 読み取り専用なので任意のスレッドから参照できる。保持しているチャンクは
+// 後続のバージョンと共有され、編集で触れたチャンクだけが新しく作られる。
+class TrajectorySnapshot {
+public:
+    static constexpr size_t CHUNK_SIZE = 4096;
+
+    // データアクセス
+    uint64_t getRevision() const { return revision_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const TrajectoryPoint& operator[](size_t index) const {
+        return chunks_[index / CHUNK_SIZE]->points[index % CHUNK_SIZE];
+    }
+
+    size_t getChunkCount() const { return chunks_.size(); }
+    const TrajectoryChunk& getChunk(size_t chunk_index) const { return *chunks_[chunk_index]; }
+
+    // バウンディング情報（TrajectoryDataと同じ意味論）
+    void getBounds(double& min_x, double& max_x, double& min_y, double& max_y) const;
+    void getVelocityRange(double& min_vel, double& max_vel) const;
+
+    // 連続配列へのコピー（エクスポート用）
+    std::vector<TrajectoryPoint> toVector() const;
+
+private:
+    friend class SnapshotPublisher;
+
+    std::vector<std::shared_ptr<const TrajectoryChunk>> chunks_;
+    size_t size_ = 0;
+    uint64_t revision_ = 0;
+};
+
+using TrajectorySnapshotPtr = std::shared_ptr<const TrajectorySnapshot>;
+
+// 編集スレッド（GUIスレッド）でスナップショットを発行し、他スレッドへ渡す
+class SnapshotPublisher {
+public:
+    SnapshotPublisher();
+
+    // 前回発行以降の変更チャンクだけをコピーして新しいバージョンを発行
+    TrajectorySnapshotPtr publish(const TrajectoryData& data);
+
+    // 最新バージョンの取得（スレッドセーフ）
+    TrajectorySnapshotPtr latest() const;
+
+    // 統計
+    size_t getLastCopiedChunkCount() const { return last_copied_chunks_; }
+
+private:
+    mutable std::mutex mutex_;
+    TrajectorySnapshotPtr latest_;
+    const TrajectoryData* source_;
+    size_t last_copied_chunks_;
+
+    static std::shared_ptr<const TrajectoryChunk> makeChunk(const std::vector<TrajectoryPoint>& points,
+                                                            size_t begin, size_t end);
+};
+
+// 最新のスナップショットを別スレッドで .trjb に書き出す（編集中の自動保存）
+//
+// 編集スレッドは発行した後に notify() を呼ぶだけで、書き出しを待たない。書き出し中に
+// 発行されたバージョンは飛ばし、書き終えた時点の最新だけを次に書く。一時ファイルに
+// 書いてから置き換えるので、途中で止まっても前回の内容が残る。
+class SnapshotAutosave {
+public:
+    explicit SnapshotAutosave(const SnapshotPublisher& publisher);
+    ~SnapshotAutosave();
+
+    SnapshotAutosave(const SnapshotAutosave&) = delete;
+    SnapshotAutosave& operator=(const SnapshotAutosave&) = delete;
+
+    // 開始・停止（停止は書きかけの保存を終えてから戻る）
+    void start(const std::string& filepath);
+    void stop();
+    bool isRunning() const { return worker_.joinable(); }
+
+    // 新しいバージョンを発行したことを知らせる
+    void notify();
+
+    // 最新のバージョンを書き終えるまで待つ（失敗した理由は getLastError()）
+    bool flush();
+
+    uint64_t getSavedRevision() const;
+    std::string getLastError() const;
+
+private:
+    const SnapshotPublisher& publisher_;
+    std::string filepath_;
+    std::thread worker_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    bool pending_;
+    bool busy_;
+    bool stopping_;
+    TrajectorySnapshotPtr saved_;  // 最後に書き出したバージョン
+    std::string last_error_;
+
+    void run();
+};
+
+} // namespace trajectory_editor
@@ -0,0 +1,174 @@
+#include "velocity_profile.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace trajectory_editor {
+
+namespace {
+
+// 上限速度・区間長の計算に使う近傍点数（曲率の計算範囲と同じ）
+constexpr size_t STENCIL_RADIUS = 2;
+
+// これより小さい曲率は直線とみなす
+constexpr double MIN_CURVATURE = 1e-9;
+
+} // namespace
+
+VelocityProfile::VelocityProfile()
+    : data_(nullptr), revision_(0), has_updated_range_(false), updated_first_(0), updated_last_(0) {}
+
+void VelocityProfile::setLimits(const VelocityLimits& limits) {
+    limits_ = limits;
+    data_ = nullptr;  // 次の update() で全体を再計算
+}
+
+void VelocityProfile::clear() {
+    data_ = nullptr;
+    revision_ = 0;
+    geometry_.clear();
+    segment_length_.clear();
+    limit_.clear();
+    forward_.clear();
+    profile_.clear();
+    has_updated_range_ = false;
+}
+
+void VelocityProfile::build(const TrajectoryData& data) {
+    data_ = &data;
+    revision_ = data.getRevision();
+    geometry_.build(data);
+
+    size_t n = data.size();
+    segment_length_.assign(n, 0.0);
+    limit_.assign(n, 0.0);
+    forward_.assign(n, 0.0);
+    profile_.assign(n, 0.0);
+    has_updated_range_ = false;
+
+    recomputeLimits(data, 0, n);
+    propagate(0, n, false);
+}
+
+void VelocityProfile::update(const TrajectoryData& data) {
+    if (data_ != &data) {
+        build(data);
+        return;
+    }
+
+    TrajectoryChange change = data.getChangesSince(revision_);
+    revision_ = data.getRevision();
+    has_updated_range_ = false;
+
+    // 速度だけの変更は入力に影響しない
+    if (change.none || !change.geometric) {
+        return;
+    }
+
+    geometry_.update(data);
+
+    size_t n = data.size();
+    change.shiftColumn(segment_length_, n);
+    change.shiftColumn(limit_, n);
+    change.shiftColumn(forward_, n);
+    change.shiftColumn(profile_, n);
+
+    size_t begin = 0;
+    size_t end = 0;
+    change.getRecomputeRange(n, STENCIL_RADIUS, begin, end);
+    recomputeLimits(data, begin, end);
+    propagate(begin, end, !change.full);
+}
+
+bool VelocityProfile::getLastUpdatedRange(size_t& start_index, size_t& end_index) const {
+    if (!has_updated_range_) {
+        return false;
+    }
+    start_index = updated_first_;
+    end_index = updated_last_;
+    return true;
+}
+
+double VelocityProfile::availableAcceleration(double velocity, double curvature, double max_acceleration) const {
+    // 横方向で使った分を摩擦円から差し引く
+    double ratio = velocity * velocity * std::abs(curvature) / limits_.max_lateral_acceleration;
+    if (ratio >= 1.0) {
+        return 0.0;
+    }
+    return max_acceleration * std::sqrt(1.0 - ratio * ratio);
+}
+
+void VelocityProfile::recomputeLimits(const TrajectoryData& data, size_t begin, size_t end) {
+    const auto& points = data.getPoints();
+    const auto& curvatures = geometry_.getCurvatures();
+    size_t n = points.size();
+    end = std::min(end, n);
+
+    for (size_t i = begin; i < end; ++i) {
+        double kappa = std::abs(curvatures[i]);
+        double limit = limits_.max_velocity;
+        if (kappa > MIN_CURVATURE) {
+            limit = std::min(limit, std::sqrt(limits_.max_lateral_acceleration / kappa));
+        }
+        limit_[i] = limit;
+    }
+
+    // 区間 i-1 → i も点 i の変更で変わる（hypotは遅いのでsqrtで計算）
+    size_t segment_begin = begin > 0 ? begin - 1 : 0;
+    for (size_t i = segment_begin; i < end; ++i) {
+        if (i + 1 < n) {
+            double dx = points[i + 1].x - points[i].x;
+            double dy = points[i + 1].y - points[i].y;
+            segment_length_[i] = std::sqrt(dx * dx + dy * dy);
+        } else {
+            segment_length_[i] = 0.0;
+        }
+    }
+}
+
+void VelocityProfile::propagate(size_t begin, size_t end, bool converge) {
+    size_t n = profile_.size();
+    end = std::min(end, n);
+    if (begin >= end) {
+        return;
+    }
+    const auto& curvatures = geometry_.getCurvatures();
+
+    // 前進パス（加速制約）: end以降で前回と一致したら打ち切る
+    size_t forward_end = begin;
+    for (size_t i = begin; i < n; ++i) {
+        double value = limit_[i];
+        if (i > 0 && forward_[i - 1] < value) {  // 既に上限以上なら加速の計算は不要
+            double v = forward_[i - 1];
+            double a = availableAcceleration(v, curvatures[i - 1], limits_.max_acceleration);
+            value = std::min(value, std::sqrt(v * v + 2.0 * a * segment_length_[i - 1]));
+        }
+        if (converge && i >= end && value == forward_[i]) {
+            break;
+        }
+        forward_[i] = value;
+        forward_end = i + 1;
+    }
+
+    // 後退パス（減速制約）: begin より前で前回と一致したら打ち切る
+    size_t hi = std::max(end, forward_end);
+    size_t lowest = hi - 1;
+    for (size_t i = hi; i-- > 0;) {
+        double value = forward_[i];
+        if (i + 1 < n && profile_[i + 1] < value) {
+            double v = profile_[i + 1];
+            double a = availableAcceleration(v, curvatures[i + 1], limits_.max_deceleration);
+            value = std::min(value, std::sqrt(v * v + 2.0 * a * segment_length_[i]));
+        }
+        if (converge && i < begin && value == profile_[i]) {
+            break;
+        }
+        profile_[i] = value;
+        lowest = i;
+    }
+
+    has_updated_range_ = true;
+    updated_first_ = lowest;
+    updated_last_ = hi - 1;
+}
+
+} // namespace trajectory_editor
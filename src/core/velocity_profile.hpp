@@ -0,0 +1,64 @@
+#pragma once
+
+#include "trajectory_data.hpp"
+#include "trajectory_geometry.hpp"
+#include <vector>
+#include <cstdint>
+
+namespace trajectory_editor {
+
+// 速度プロファイルの制約（単位は m/s, m/s^2）
+struct VelocityLimits {
+    double max_velocity = 30.0;
+    double max_lateral_acceleration = 9.8;  // 摩擦円の半径
+    double max_acceleration = 3.0;
+    double max_deceleration = 6.0;          // 正の値で指定
+};
+
+// 摩擦円制約つきの速度プロファイル
+//
+// 曲率から決まる上限速度に対して前進パス（加速制約）と後退パス（減速制約）を
+// 1回ずつ流す O(n) の計算。縦方向に使える加速度は横加速度の分だけ摩擦円で減らす。
+// update() は変更ジャーナルを見て編集点の近傍から前後に再計算し、
+// 前回の結果と一致した時点で打ち切る。
+class VelocityProfile {
+public:
+    VelocityProfile();
+
+    // 設定（変更すると次の update() で全体を再計算する）
+    void setLimits(const VelocityLimits& limits);
+    const VelocityLimits& getLimits() const { return limits_; }
+
+    // 構築・更新
+    void build(const TrajectoryData& data);
+    void update(const TrajectoryData& data);
+    void clear();
+
+    // データアクセス
+    size_t size() const { return profile_.size(); }
+    bool empty() const { return profile_.empty(); }
+    const std::vector<double>& getVelocities() const { return profile_; }  // [m/s]
+
+    // 直近の build()/update() で再計算した範囲（end_indexは含む）。再計算がなければfalse
+    bool getLastUpdatedRange(size_t& start_index, size_t& end_index) const;
+
+private:
+    VelocityLimits limits_;
+    const TrajectoryData* data_;
+    uint64_t revision_;
+    TrajectoryGeometry geometry_;
+
+    std::vector<double> segment_length_;  // i → i+1 の区間長（末尾は0）
+    std::vector<double> limit_;           // 曲率による上限速度
+    std::vector<double> forward_;         // 前進パスの結果
+    std::vector<double> profile_;         // 後退パス後の最終結果
+
+    bool has_updated_range_;
+    size_t updated_first_, updated_last_;
+
+    double availableAcceleration(double velocity, double curvature, double max_acceleration) const;
+    void recomputeLimits(const TrajectoryData& data, size_t begin, size_t end);
+    void propagate(size_t begin, size_t end, bool converge);
+};
+
+} // namespace trajectory_editor
@@ -1,19 +1,42 @@
 #include "graphics_trajectory_view.hpp"
+#include "../utils/trace.hpp"
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QScrollBar>
 #include <QtGui/QMouseEvent>
 #include <QtGui/QWheelEvent>
+#include <QtGui/QResizeEvent>
+#include <QtGui/QPainterPath>
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QDebug>
 #include <cmath>
 #include <algorithm>
 
 namespace trajectory_editor {
 
+namespace {
+
+// スクロール・ズーム後にタイルを更新するまでの待ち時間 [ms]
+constexpr int TILE_UPDATE_DELAY_MS = 30;
+
+// 地図の境界線は画面上でこの画素数より近い頂点を間引いて描く
+constexpr double TILE_LOD_PIXELS = 2.0;
+
+// 性能表示をビューポートの左上から離す距離 [px]
+constexpr int HUD_MARGIN = 8;
+
+// シーンのメモリの見積もりに使うアイテム1つの大きさ [bytes]（実測ではなく、アイテム本体と
+// 内部データのおおよその想定値。テキストは文書オブジェクトを持つので大きい。パスはこれに頂点の分を足す）
+constexpr size_t SCENE_SHAPE_ITEM_BYTES = 400;
+constexpr size_t SCENE_TEXT_ITEM_BYTES = 2500;
+
+} // namespace
+
 GraphicsTrajectoryView::GraphicsTrajectoryView(QWidget* parent)
     : QGraphicsView(parent)
     , trajectory_data_(nullptr)
     , trajectory_data_2_(nullptr)
     , track_boundaries_(nullptr)
+    , edit_history_(nullptr)
     , scene_(new QGraphicsScene(this))
     , point_size_(0.5)
     , line_width_(0.5)
@@ -22,10 +45,18 @@ GraphicsTrajectoryView::GraphicsTrajectoryView(QWidget* parent)
     , max_speed_(40.0)
     , coordinate_system_(EAST_SOUTH)
     , show_speed_text_(false)  // デフォルトは非表示
+    , color_mode_(COLOR_BY_SPEED)
+    , curvature_color_limit_(0.1)
+    , lateral_acc_color_limit_(9.8)
+    , boundaries_visible_(true)
+    , tile_timer_(new QTimer(this))
+    , hud_(new PerformanceHud(this))
+    , data_memory_bytes_(0)
     , edit_mode_(VIEWING)
     , selected_point_index_(SIZE_MAX)
     , dragging_point_index_(SIZE_MAX)
     , is_dragging_(false)
+    , is_brushing_(false)
     , is_selecting_(false)
     , selection_start_index_(0)
     , is_panning_(false)
@@ -46,6 +77,14 @@ GraphicsTrajectoryView::GraphicsTrajectoryView(QWidget* parent)
     
     connect(scene_, &QGraphicsScene::selectionChanged,
             this, &GraphicsTrajectoryView::onSceneSelectionChanged);
+    
+    tile_timer_->setSingleShot(true);
+    tile_timer_->setInterval(TILE_UPDATE_DELAY_MS);
+    connect(tile_timer_, &QTimer::timeout, this, &GraphicsTrajectoryView::updateVisibleTiles);
+    
+    // 性能表示は既定で隠す（隠している間は計測もしない）
+    hud_->hide();
+    placeHud();
 }
 
 GraphicsTrajectoryView::~GraphicsTrajectoryView() = default;
@@ -63,14 +102,18 @@ void GraphicsTrajectoryView::setTrajectoryData2(const TrajectoryData* data) {
 
 void GraphicsTrajectoryView::setTrackBoundaries(const TrackBoundaries* boundaries) {
     track_boundaries_ = boundaries;
+    clearTileItems();  // 読み直した地図のタイルは作り直す
     updateDisplay();
 }
 
 void GraphicsTrajectoryView::updateDisplay() {
+    TRACE_ZONE("GraphicsTrajectoryView::updateDisplay");
+    QElapsedTimer timer;
+    timer.start();
     clearScene();
     
-    // 境界線を最初に描画（背景として）
-    if (track_boundaries_ && !track_boundaries_->empty()) {
+    // 境界線を最初に描画（背景として）。地図のタイルがあればタイル側で描く
+    if (track_boundaries_ && !track_boundaries_->empty() && !track_boundaries_->hasTiles()) {
         createBoundaryItems();
     }
     
@@ -84,10 +127,18 @@ void GraphicsTrajectoryView::updateDisplay() {
         createTrajectoryItems2();
     }
     
+    updateSceneRect();
+    
     // ズーム維持フラグが設定されていない場合のみ自動フィット
     if (!maintain_zoom_on_update_) {
         fitTrajectoryInView();
     }
+    scheduleTileUpdate();
+    
+    hud_->setUpdateDisplayTime(timer.nsecsElapsed());
+    if (!hud_->isHidden()) {
+        updateHudStats(true);
+    }
 }
 
 void GraphicsTrajectoryView::setSpeedColorRange(double min_speed, double mid_speed, double max_speed) {
@@ -118,9 +169,15 @@ void GraphicsTrajectoryView::setLineWidth(double width) {
 }
 
 void GraphicsTrajectoryView::setBoundariesVisible(bool visible) {
+    boundaries_visible_ = visible;
     for (auto* item : boundary_items_) {
         item->setVisible(visible);
     }
+    for (auto& [key, tile] : tile_items_) {
+        for (auto* item : tile.items) {
+            item->setVisible(visible);
+        }
+    }
 }
 
 void GraphicsTrajectoryView::fitTrajectoryInView() {
@@ -156,16 +213,19 @@ void GraphicsTrajectoryView::fitTrajectoryInView() {
                   (display_max_y - display_min_y) + 2 * margin);
     
     fitInView(bounds, Qt::KeepAspectRatio);
+    scheduleTileUpdate();
 }
 
 void GraphicsTrajectoryView::zoomIn() {
     scale(1.25, 1.25);
     maintain_zoom_on_update_ = true;  // ズーム維持を有効化
+    scheduleTileUpdate();
 }
 
 void GraphicsTrajectoryView::zoomOut() {
     scale(0.8, 0.8);
     maintain_zoom_on_update_ = true;  // ズーム維持を有効化
+    scheduleTileUpdate();
 }
 
 void GraphicsTrajectoryView::resetZoom() {
@@ -236,6 +296,15 @@ void GraphicsTrajectoryView::mousePressEvent(QMouseEvent* event) {
             emit pointAdded(insert_index, original_pos.x(), original_pos.y(), velocity);
             break;
         }
+        case SMOOTHING_BRUSH: {
+            is_brushing_ = true;
+            size_t index = findNearestPointIndex(scene_pos);
+            if (index < trajectory_data_->size()) {
+                QPointF original_pos = inverseTransformPoint(scene_pos);
+                emit brushMoved(index, original_pos.x(), original_pos.y());
+            }
+            break;
+        }
         case DRAGGING_POINT:
             // すでにドラッグモードの場合は何もしない
             break;
@@ -272,6 +341,17 @@ void GraphicsTrajectoryView::mouseMoveEvent(QMouseEvent* event) {
         return;
     }
     
+    if (is_brushing_ && (event->buttons() & Qt::LeftButton) && trajectory_data_) {
+        QPointF scene_pos = mapToScene(event->pos());
+        size_t index = findNearestPointIndex(scene_pos);
+        if (index < trajectory_data_->size()) {
+            QPointF original_pos = inverseTransformPoint(scene_pos);
+            emit brushMoved(index, original_pos.x(), original_pos.y());
+        }
+        event->accept();
+        return;
+    }
+    
     if (event->buttons() & Qt::LeftButton && trajectory_data_ && 
         dragging_point_index_ < trajectory_data_->size()) {
         
@@ -306,6 +386,11 @@ void GraphicsTrajectoryView::mouseReleaseEvent(QMouseEvent* event) {
     }
     
     if (event->button() == Qt::LeftButton) {
+        if (is_brushing_) {
+            // ブラシ操作の終了（ここで1つの編集として確定する）
+            is_brushing_ = false;
+            emit brushReleased();
+        }
         if (is_dragging_) {
             // ドラッグ終了
             is_dragging_ = false;
@@ -330,6 +415,31 @@ void GraphicsTrajectoryView::wheelEvent(QWheelEvent* event) {
     }
     
     maintain_zoom_on_update_ = true;  // ズーム維持を有効化
+    scheduleTileUpdate();
+}
+
+void GraphicsTrajectoryView::scrollContentsBy(int dx, int dy) {
+    QGraphicsView::scrollContentsBy(dx, dy);
+    scheduleTileUpdate();
+}
+
+void GraphicsTrajectoryView::resizeEvent(QResizeEvent* event) {
+    QGraphicsView::resizeEvent(event);
+    placeHud();
+    scheduleTileUpdate();
+}
+
+void GraphicsTrajectoryView::paintEvent(QPaintEvent* event) {
+    TRACE_ZONE("GraphicsTrajectoryView::paintEvent");
+    if (hud_->isHidden()) {
+        QGraphicsView::paintEvent(event);
+        return;
+    }
+    
+    QElapsedTimer timer;
+    timer.start();
+    QGraphicsView::paintEvent(event);
+    hud_->recordFrame(timer.nsecsElapsed());
 }
 
 void GraphicsTrajectoryView::onSceneSelectionChanged() {
@@ -337,6 +447,7 @@ void GraphicsTrajectoryView::onSceneSelectionChanged() {
 }
 
 void GraphicsTrajectoryView::clearScene() {
+    TRACE_ZONE("GraphicsTrajectoryView::clearScene");
     // 1つ目の軌跡アイテムをクリア
     for (auto* item : point_items_) {
         scene_->removeItem(item);
@@ -384,6 +495,7 @@ void GraphicsTrajectoryView::clearScene() {
 }
 
 void GraphicsTrajectoryView::createTrajectoryItems() {
+    TRACE_ZONE("GraphicsTrajectoryView::createTrajectoryItems");
     if (!trajectory_data_ || trajectory_data_->empty()) {
         return;
     }
@@ -411,6 +523,11 @@ void GraphicsTrajectoryView::createTrajectoryItems() {
         line_items_.push_back(line);
     }
     
+    // 曲率・横加速度で色分けする場合は変更箇所だけ再計算
+    if (color_mode_ != COLOR_BY_SPEED) {
+        geometry_.update(*trajectory_data_);
+    }
+    
     // 点を作成
     for (size_t i = 0; i < points.size(); ++i) {
         const auto& point = points[i];
@@ -423,10 +540,10 @@ void GraphicsTrajectoryView::createTrajectoryItems() {
             transformed_point.y() - point_size_/2,
             point_size_, point_size_);
         
-        // 速度に基づく色設定
-        QColor color = getSpeedColor(point.velocity);
+        // 速度（または曲率・横加速度）に基づく色設定
+        QColor color = getPointColor(i);
         circle->setBrush(QBrush(color));
-        circle->setPen(QPen(Qt::NoPen));  // 枠線をなしに
+        circle->setPen(getPointPen(i));  // 違反点以外は枠線なし
         
         // クリック可能にする
         circle->setFlag(QGraphicsItem::ItemIsSelectable, true);
@@ -460,6 +577,7 @@ void GraphicsTrajectoryView::createTrajectoryItems() {
 }
 
 void GraphicsTrajectoryView::createTrajectoryItems2() {
+    TRACE_ZONE("GraphicsTrajectoryView::createTrajectoryItems2");
     if (!trajectory_data_2_ || trajectory_data_2_->empty()) {
         return;
     }
@@ -536,6 +654,7 @@ void GraphicsTrajectoryView::createTrajectoryItems2() {
 }
 
 void GraphicsTrajectoryView::createBoundaryItems() {
+    TRACE_ZONE("GraphicsTrajectoryView::createBoundaryItems");
     if (!track_boundaries_ || track_boundaries_->empty()) {
         return;
     }
@@ -560,6 +679,7 @@ void GraphicsTrajectoryView::createBoundaryItems() {
         circle->setBrush(QBrush(QColor(128, 128, 128)));  // グレー色で塗りつぶし
         circle->setPen(QPen(QColor(128, 128, 128), 0.5));  // グレー色の輪郭
         circle->setZValue(-1);  // 軌跡より背景に
+        circle->setVisible(boundaries_visible_);
         
         boundary_items_.push_back(circle);
     }
@@ -581,11 +701,104 @@ void GraphicsTrajectoryView::createBoundaryItems() {
         circle->setBrush(QBrush(QColor(128, 128, 128)));  // グレー色で塗りつぶし
         circle->setPen(QPen(QColor(128, 128, 128), 0.5));  // グレー色の輪郭
         circle->setZValue(-1);  // 軌跡より背景に
+        circle->setVisible(boundaries_visible_);
         
         boundary_items_.push_back(circle);
     }
 }
 
+void GraphicsTrajectoryView::clearTileItems() {
+    for (auto& [key, tile] : tile_items_) {
+        for (auto* item : tile.items) {
+            scene_->removeItem(item);
+            delete item;
+        }
+    }
+    tile_items_.clear();
+}
+
+void GraphicsTrajectoryView::scheduleTileUpdate() {
+    if (track_boundaries_ && track_boundaries_->hasTiles()) {
+        tile_timer_->start();
+    }
+}
+
+void GraphicsTrajectoryView::updateSceneRect() {
+    if (!track_boundaries_ || !track_boundaries_->hasTiles()) {
+        scene_->setSceneRect(QRectF());  // アイテムに合わせる既定の動作に戻す
+        return;
+    }
+    
+    // タイルは表示範囲の分しか置かないので、地図全体までスクロールできるように広げる
+    double min_x, max_x, min_y, max_y;
+    track_boundaries_->getTiles()->getBounds(min_x, max_x, min_y, max_y);
+    QRectF map_rect = QRectF(transformPoint(min_x, min_y), transformPoint(max_x, max_y)).normalized();
+    scene_->setSceneRect(map_rect.united(scene_->itemsBoundingRect()));
+}
+
+void GraphicsTrajectoryView::updateVisibleTiles() {
+    TRACE_ZONE("GraphicsTrajectoryView::updateVisibleTiles");
+    if (!track_boundaries_ || !track_boundaries_->hasTiles()) {
+        clearTileItems();
+        return;
+    }
+    const BoundaryTileIndex* tiles = track_boundaries_->getTiles();
+    
+    // 表示範囲を元座標に戻し、1タイル分の余白を足す
+    QRectF view_rect = mapToScene(viewport()->rect()).boundingRect();
+    QRectF original_rect = QRectF(inverseTransformPoint(view_rect.topLeft()),
+                                  inverseTransformPoint(view_rect.bottomRight())).normalized();
+    double margin = tiles->getTileSize();
+    std::vector<TileKey> visible = tiles->findTiles(original_rect.left() - margin, original_rect.top() - margin,
+                                                    original_rect.right() + margin, original_rect.bottom() + margin);
+    
+    // 間引き間隔は2の冪に丸め、少しのズームでは取り出し直さない
+    double pixels_per_meter = std::hypot(transform().m11(), transform().m12());
+    double min_spacing = 0.0;
+    if (pixels_per_meter > 0.0) {
+        min_spacing = std::exp2(std::floor(std::log2(TILE_LOD_PIXELS / pixels_per_meter)));
+    }
+    
+    // 表示範囲に残っていて間引き間隔も同じタイルはそのまま使い、それ以外は捨てる
+    std::map<TileKey, TileItems> kept;
+    for (const auto& key : visible) {
+        auto it = tile_items_.find(key);
+        if (it != tile_items_.end() && it->second.min_spacing == min_spacing) {
+            kept.insert(tile_items_.extract(it));
+        }
+    }
+    clearTileItems();
+    tile_items_ = std::move(kept);
+    
+    // 新しく見えたタイルを取り出して描く
+    QPen pen(QColor(128, 128, 128));
+    pen.setCosmetic(true);  // ズームしても1画素幅
+    for (const auto& key : visible) {
+        if (tile_items_.count(key)) {
+            continue;
+        }
+        TileItems& tile = tile_items_[key];
+        tile.min_spacing = min_spacing;
+        for (const auto& polyline : tiles->decodeTile(key, min_spacing)) {
+            if (polyline.size() < 2) {
+                continue;
+            }
+            QPainterPath path(transformPoint(polyline.front().x, polyline.front().y));
+            for (size_t i = 1; i < polyline.size(); ++i) {
+                path.lineTo(transformPoint(polyline[i].x, polyline[i].y));
+            }
+            QGraphicsPathItem* item = scene_->addPath(path, pen);
+            item->setZValue(-1);  // 軌跡より背景に
+            item->setVisible(boundaries_visible_);
+            tile.items.push_back(item);
+        }
+    }
+    
+    if (!hud_->isHidden()) {
+        updateHudStats(false);
+    }
+}
+
 
 QColor GraphicsTrajectoryView::getSpeedColor(double velocity) const {
     // 速度に基づく色分け (グリーン系)
@@ -623,7 +836,122 @@ QColor GraphicsTrajectoryView::getSpeedColorBlue(double velocity) const {
     }
 }
 
+QColor GraphicsTrajectoryView::getMetricColor(double value, double limit) const {
+    // 絶対値で色分け（緑 → 黄 → 赤、limit 以上は赤）
+    double t = limit > 0.0 ? std::min(1.0, std::abs(value) / limit) : 0.0;
+    if (t <= 0.5) {
+        int red = static_cast<int>(255 * (t / 0.5));
+        return QColor(red, 200, 0);  // 緑から黄
+    }
+    int green = static_cast<int>(200 * (1.0 - (t - 0.5) / 0.5));
+    return QColor(255, green, 0);  // 黄から赤
+}
+
+QColor GraphicsTrajectoryView::getPointColor(size_t index) const {
+    switch (color_mode_) {
+    case COLOR_BY_CURVATURE:
+        if (index < geometry_.size()) {
+            return getMetricColor(geometry_.getCurvatures()[index], curvature_color_limit_);
+        }
+        break;
+    case COLOR_BY_LATERAL_ACCELERATION:
+        if (index < geometry_.size()) {
+            return getMetricColor(geometry_.getLateralAccelerations()[index], lateral_acc_color_limit_);
+        }
+        break;
+    case COLOR_BY_SPEED:
+        break;
+    }
+    return getSpeedColor(trajectory_data_->getPoints()[index].velocity);
+}
+
+QPen GraphicsTrajectoryView::getPointPen(size_t index) const {
+    if (index < clearance_violations_.size() && clearance_violations_[index]) {
+        QPen pen(QColor(255, 0, 255));  // マゼンタの枠線（ズームに依存しない太さ）
+        pen.setCosmetic(true);
+        pen.setWidth(2);
+        return pen;
+    }
+    if (index < kinematic_violations_.size() && kinematic_violations_[index]) {
+        QPen pen(QColor(255, 140, 0));  // オレンジの枠線
+        pen.setCosmetic(true);
+        pen.setWidth(2);
+        return pen;
+    }
+    return QPen(Qt::NoPen);
+}
+
+void GraphicsTrajectoryView::updateClearanceViolations(const std::vector<uint8_t>& flags,
+                                                       const std::vector<size_t>& changed) {
+    if (flags.size() != clearance_violations_.size()) {
+        // 点数が変わると編集点より後ろの添字がずれるので、全体を付け直す
+        clearance_violations_.assign(flags.size(), false);
+        for (size_t i = 0; i < flags.size(); ++i) {
+            clearance_violations_[i] = flags[i] != 0;
+        }
+        for (size_t i = 0; i < point_items_.size(); ++i) {
+            if (i != selected_point_index_) {
+                point_items_[i]->setPen(getPointPen(i));
+            }
+        }
+        return;
+    }
+
+    for (size_t index : changed) {
+        if (index >= flags.size()) {
+            continue;
+        }
+        clearance_violations_[index] = flags[index] != 0;
+        if (index < point_items_.size() && index != selected_point_index_) {
+            point_items_[index]->setPen(getPointPen(index));
+        }
+    }
+}
+
+void GraphicsTrajectoryView::updateKinematicViolations(const std::vector<uint8_t>& flags,
+                                                       const std::vector<size_t>& changed) {
+    if (flags.size() != kinematic_violations_.size()) {
+        // 点数が変わると編集点より後ろの添字がずれるので、全体を付け直す
+        kinematic_violations_.assign(flags.size(), false);
+        for (size_t i = 0; i < flags.size(); ++i) {
+            kinematic_violations_[i] = flags[i] != 0;
+        }
+        for (size_t i = 0; i < point_items_.size(); ++i) {
+            if (i != selected_point_index_) {
+                point_items_[i]->setPen(getPointPen(i));
+            }
+        }
+        return;
+    }
+
+    for (size_t index : changed) {
+        if (index >= flags.size()) {
+            continue;
+        }
+        kinematic_violations_[index] = flags[index] != 0;
+        if (index < point_items_.size() && index != selected_point_index_) {
+            point_items_[index]->setPen(getPointPen(index));
+        }
+    }
+}
+
+void GraphicsTrajectoryView::setColorMode(ColorMode mode) {
+    color_mode_ = mode;
+    updateItemColors();
+}
+
+void GraphicsTrajectoryView::setCurvatureColorLimit(double limit) {
+    curvature_color_limit_ = limit;
+    updateItemColors();
+}
+
+void GraphicsTrajectoryView::setLateralAccelerationColorLimit(double limit) {
+    lateral_acc_color_limit_ = limit;
+    updateItemColors();
+}
+
 size_t GraphicsTrajectoryView::findNearestPointIndex(const QPointF& scene_pos) const {
+    TRACE_ZONE("GraphicsTrajectoryView::findNearestPointIndex");
     if (!trajectory_data_ || trajectory_data_->empty()) {
         return 0;
     }
@@ -669,22 +997,26 @@ void GraphicsTrajectoryView::highlightPoint(size_t index, bool highlight) {
         QPen pen(QColor(255, 255, 0), 1);  // 黄色の細い枠線
         item->setPen(pen);
     } else {
-        // 枠線をなしに戻す
-        item->setPen(QPen(Qt::NoPen));
+        // 通常の枠線に戻す
+        item->setPen(getPointPen(index));
     }
 }
 
 void GraphicsTrajectoryView::updateItemColors() {
+    TRACE_ZONE("GraphicsTrajectoryView::updateItemColors");
     if (!trajectory_data_ || point_items_.empty()) {
         return;
     }
     
     const auto& points = trajectory_data_->getPoints();
+    if (color_mode_ != COLOR_BY_SPEED) {
+        geometry_.update(*trajectory_data_);
+    }
     
     for (size_t i = 0; i < point_items_.size() && i < points.size(); ++i) {
-        QColor color = getSpeedColor(points[i].velocity);
+        QColor color = getPointColor(i);
         point_items_[i]->setBrush(QBrush(color));
-        point_items_[i]->setPen(QPen(Qt::NoPen));  // 枠線をなしに
+        point_items_[i]->setPen(getPointPen(i));  // 違反点以外は枠線なし
         
         // 速度テキストも更新
         if (i < speed_text_items_.size()) {
@@ -714,10 +1046,15 @@ void GraphicsTrajectoryView::setEditMode(EditMode mode) {
         setCursor(Qt::ClosedHandCursor);
         setDragMode(QGraphicsView::NoDrag);
         break;
+    case SMOOTHING_BRUSH:
+        setCursor(Qt::CrossCursor);
+        setDragMode(QGraphicsView::NoDrag);
+        break;
     }
 }
 
 size_t GraphicsTrajectoryView::findInsertIndex(const QPointF& scene_pos) const {
+    TRACE_ZONE("GraphicsTrajectoryView::findInsertIndex");
     if (!trajectory_data_ || trajectory_data_->empty()) {
         return 0;
     }
@@ -775,6 +1112,7 @@ void GraphicsTrajectoryView::clearSelection() {
 
 void GraphicsTrajectoryView::setCoordinateSystem(CoordinateSystem coord_system) {
     coordinate_system_ = coord_system;
+    clearTileItems();  // タイルは変換後の座標で描いている
     updateDisplay();  // 座標系変更時に表示を更新
     fitTrajectoryInView();  // 座標系変更後、トラックをフレームに自動フィット
 }
@@ -831,4 +1169,62 @@ void GraphicsTrajectoryView::setSpeedTextVisible(bool visible) {
     }
 }
 
-} // namespace trajectory_editor
\ No newline at end of file
+void GraphicsTrajectoryView::setPerformanceHudVisible(bool visible) {
+    if (visible) {
+        updateHudStats(true);
+        placeHud();
+        hud_->raise();
+        hud_->show();
+    } else {
+        hud_->hide();
+    }
+}
+
+void GraphicsTrajectoryView::setEditHistory(const EditHistory* history) {
+    edit_history_ = history;
+}
+
+void GraphicsTrajectoryView::updateHudStats(bool count_data) {
+    size_t tile_item_count = 0;
+    for (const auto& entry : tile_items_) {
+        tile_item_count += entry.second.items.size();
+    }
+    hud_->setLayerCounts({
+        {"points", point_items_.size()},
+        {"lines", line_items_.size()},
+        {"speed text", speed_text_items_.size()},
+        {"boundary", boundary_items_.size()},
+        {"points 2", point_items_2_.size()},
+        {"lines 2", line_items_2_.size()},
+        {"speed text 2", speed_text_items_2_.size()},
+        {"map tiles", tile_item_count},
+    });
+    
+    // 8列形式の軌跡データは点数に比例して数えるので、データが変わったときだけ数え直す
+    if (count_data) {
+        data_memory_bytes_ = (trajectory_data_ ? trajectory_data_->getMemoryUsage() : 0) +
+                             (trajectory_data_2_ ? trajectory_data_2_->getMemoryUsage() : 0);
+    }
+    hud_->setMemoryUsage(data_memory_bytes_, edit_history_ ? edit_history_->getMemoryUsage() : 0,
+                         estimateSceneMemory());
+}
+
+void GraphicsTrajectoryView::placeHud() {
+    hud_->move(viewport()->geometry().topLeft() + QPoint(HUD_MARGIN, HUD_MARGIN));
+}
+
+size_t GraphicsTrajectoryView::estimateSceneMemory() const {
+    size_t shape_items = point_items_.size() + line_items_.size() + point_items_2_.size() +
+                         line_items_2_.size() + boundary_items_.size();
+    size_t text_items = speed_text_items_.size() + speed_text_items_2_.size();
+    size_t bytes = shape_items * SCENE_SHAPE_ITEM_BYTES + text_items * SCENE_TEXT_ITEM_BYTES;
+    for (const auto& entry : tile_items_) {
+        for (const auto* item : entry.second.items) {
+            bytes += SCENE_SHAPE_ITEM_BYTES +
+                     static_cast<size_t>(item->path().elementCount()) * sizeof(QPainterPath::Element);
+        }
+    }
+    return bytes;
+}
+
+} // namespace trajectory_editor
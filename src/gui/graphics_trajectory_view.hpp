@@ -5,10 +5,17 @@
 #include <QtWidgets/QGraphicsEllipseItem>
 #include <QtWidgets/QGraphicsLineItem>
 #include <QtWidgets/QGraphicsTextItem>
+#include <QtWidgets/QGraphicsPathItem>
 #include <QtGui/QColor>
 #include <QtCore/QTimer>
 #include "../core/trajectory_data.hpp"
+#include "../core/edit_history.hpp"
 #include "../core/track_boundaries.hpp"
+#include "../core/boundary_tiles.hpp"
+#include "../core/trajectory_geometry.hpp"
+#include "performance_hud.hpp"
+#include <cstdint>
+#include <map>
 
 namespace trajectory_editor {
 
@@ -21,7 +28,8 @@ public:
         VIEWING,
         SELECTING,
         DRAGGING_POINT,
-        ADDING_POINT
+        ADDING_POINT,
+        SMOOTHING_BRUSH  // ドラッグした付近を平滑化
     };
     
     // 座標系モード
@@ -31,6 +39,13 @@ public:
         SOUTH_WEST,    // 南西基準（X=西+, Y=南+）
         NORTH_WEST     // 北西基準（X=西+, Y=北+）
     };
+    
+    // 点の色分け対象
+    enum ColorMode {
+        COLOR_BY_SPEED,
+        COLOR_BY_CURVATURE,
+        COLOR_BY_LATERAL_ACCELERATION
+    };
 
 public:
     explicit GraphicsTrajectoryView(QWidget* parent = nullptr);
@@ -49,6 +64,21 @@ public:
     void setLineWidth(double width);
     void setBoundariesVisible(bool visible);
     
+    // 色分け設定（曲率・横加速度は limit で赤になる）
+    void setColorMode(ColorMode mode);
+    ColorMode getColorMode() const { return color_mode_; }
+    void setCurvatureColorLimit(double limit);
+    void setLateralAccelerationColorLimit(double limit);
+    const TrajectoryGeometry& getGeometry() const { return geometry_; }
+    
+    // コース境界違反の点を枠線で強調表示
+    // flags は点ごとの違反フラグ、changed は前回から変わった点。点数が同じなら changed の点だけを描き直す
+    void updateClearanceViolations(const std::vector<uint8_t>& flags, const std::vector<size_t>& changed);
+    
+    // 加速度・加加速度の制限を超えた点を枠線で強調表示（境界違反の表示が優先）
+    // flags は点ごとの違反フラグ、changed は前回から変わった点。点数が同じなら changed の点だけを描き直す
+    void updateKinematicViolations(const std::vector<uint8_t>& flags, const std::vector<size_t>& changed);
+    
     // 座標系設定
     void setCoordinateSystem(CoordinateSystem coord_system);
     CoordinateSystem getCoordinateSystem() const { return coordinate_system_; }
@@ -69,6 +99,11 @@ public:
     // 速度テキスト表示制御
     void setSpeedTextVisible(bool visible);
     bool isSpeedTextVisible() const { return show_speed_text_; }
+    
+    // 性能表示（描画時間・FPS・レイヤーごとのアイテム数・メモリを左上に重ねる）
+    void setPerformanceHudVisible(bool visible);
+    bool isPerformanceHudVisible() const { return !hud_->isHidden(); }
+    void setEditHistory(const EditHistory* history);  // 性能表示でメモリを数える履歴
 
 signals:
     void pointClicked(size_t index);
@@ -77,6 +112,8 @@ signals:
     void pointDeleted(size_t index);
     void selectionCleared();
     void rangeSelected(size_t start_index, size_t end_index);
+    void brushMoved(size_t index, double x, double y);  // ブラシ位置に最も近い点と元座標
+    void brushReleased();
 
 protected:
     // マウスイベント
@@ -84,15 +121,20 @@ protected:
     void mouseMoveEvent(QMouseEvent* event) override;
     void mouseReleaseEvent(QMouseEvent* event) override;
     void wheelEvent(QWheelEvent* event) override;
+    void scrollContentsBy(int dx, int dy) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void paintEvent(QPaintEvent* event) override;
 
 private slots:
     void onSceneSelectionChanged();
+    void updateVisibleTiles();  // 表示範囲のタイルを取り出し、範囲外のタイルを捨てる
 
 private:
     // データ
     const TrajectoryData* trajectory_data_;
     const TrajectoryData* trajectory_data_2_;  // 2つ目の軌跡データ
     const TrackBoundaries* track_boundaries_;
+    const EditHistory* edit_history_;
     QGraphicsScene* scene_;
     
     // 表示設定
@@ -101,6 +143,12 @@ private:
     double min_speed_, mid_speed_, max_speed_;
     CoordinateSystem coordinate_system_;  // 座標系モード
     bool show_speed_text_;  // 速度テキスト表示フラグ
+    ColorMode color_mode_;
+    double curvature_color_limit_;      // [1/m]
+    double lateral_acc_color_limit_;    // [m/s^2]
+    TrajectoryGeometry geometry_;       // 1つ目の軌跡の曲率・横加速度キャッシュ
+    std::vector<bool> clearance_violations_;  // 点ごとのコース境界違反フラグ
+    std::vector<bool> kinematic_violations_;  // 点ごとの加速度・加加速度違反フラグ
     
     // グラフィックアイテム
     std::vector<QGraphicsEllipseItem*> point_items_;
@@ -110,6 +158,19 @@ private:
     std::vector<QGraphicsLineItem*> line_items_2_;      // 2つ目の軌跡の線
     std::vector<QGraphicsTextItem*> speed_text_items_2_;  // 2つ目の軌跡の速度テキスト
     std::vector<QGraphicsItem*> boundary_items_;
+    bool boundaries_visible_;
+    
+    // 地図の境界線のタイル（表示範囲と余白の分だけシーンに置く）
+    struct TileItems {
+        double min_spacing;  // 取り出したときの頂点の間引き間隔 [m]
+        std::vector<QGraphicsPathItem*> items;
+    };
+    std::map<TileKey, TileItems> tile_items_;
+    QTimer* tile_timer_;  // スクロール・ズームが続く間はまとめて1回だけ更新する
+    
+    // 性能表示
+    PerformanceHud* hud_;
+    size_t data_memory_bytes_;  // 軌跡データの大きさ（データが変わる updateDisplay でだけ数える）
     
     
     // 編集状態  
@@ -118,6 +179,7 @@ private:
     size_t dragging_point_index_;
     QPointF last_mouse_pos_;
     bool is_dragging_;
+    bool is_brushing_;
     
     // 選択状態
     bool is_selecting_;
@@ -135,8 +197,17 @@ private:
     void createTrajectoryItems();
     void createTrajectoryItems2();  // 2つ目の軌跡描画
     void createBoundaryItems();
+    void clearTileItems();
+    void scheduleTileUpdate();
+    void updateSceneRect();  // 地図があればシーン範囲を地図全体に広げる
+    void updateHudStats(bool count_data);  // count_data なら軌跡データの大きさも数え直す
+    void placeHud();
+    size_t estimateSceneMemory() const;
     QColor getSpeedColor(double velocity) const;
     QColor getSpeedColorBlue(double velocity) const;  // ブルー系の色
+    QColor getMetricColor(double value, double limit) const;  // 0 → 緑, limit → 赤
+    QColor getPointColor(size_t index) const;
+    QPen getPointPen(size_t index) const;
     size_t findNearestPointIndex(const QPointF& scene_pos) const;
     size_t findInsertIndex(const QPointF& scene_pos) const;
     double distanceToLineSegment(const QPointF& point, const QPointF& line_start, const QPointF& line_end) const;
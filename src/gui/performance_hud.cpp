@@ -0,0 +1,229 @@
+#include "performance_hud.hpp"
+#include <QtGui/QFontDatabase>
+#include <QtGui/QPainter>
+#include <algorithm>
+
+namespace trajectory_editor {
+
+namespace {
+
+// 表示を更新する間隔 [ms]
+constexpr int REFRESH_INTERVAL_MS = 250;
+
+// これより間が空いたフレームは操作の切れ目とみなし、FPSの分布に数えない [ns]
+constexpr qint64 IDLE_GAP_NS = 1000000000;
+
+// 60 FPSで1フレームに使える時間 [ms]
+constexpr double FRAME_BUDGET_MS = 1000.0 / 60.0;
+
+// パネルの大きさ [px]
+constexpr int PANEL_WIDTH = 300;
+constexpr int PADDING = 6;
+constexpr int GRAPH_HEIGHT = 36;
+
+// FPSの分布の区間（下限 [fps] と表示名）
+struct FpsBucket {
+    double min_fps;
+    const char* label;
+};
+
+constexpr FpsBucket FPS_BUCKETS[] = {
+    {60.0, ">=60"},
+    {30.0, "30-60"},
+    {15.0, "15-30"},
+    {0.0, "<15"},
+};
+constexpr int FPS_BUCKET_COUNT = sizeof(FPS_BUCKETS) / sizeof(FPS_BUCKETS[0]);
+
+// アイテム数・メモリの行数（レイヤーは1行に2つ）
+constexpr int MEMORY_LINES = 3;
+
+QString formatMs(qint64 ns) {
+    return QString::number(static_cast<double>(ns) / 1e6, 'f', 1);
+}
+
+QString formatBytes(size_t bytes) {
+    if (bytes >= 1024 * 1024) {
+        return QString::number(static_cast<double>(bytes) / (1024.0 * 1024.0), 'f', 1) + " MB";
+    }
+    if (bytes >= 1024) {
+        return QString::number(static_cast<double>(bytes) / 1024.0, 'f', 1) + " KB";
+    }
+    return QString::number(static_cast<qulonglong>(bytes)) + " B";
+}
+
+} // namespace
+
+PerformanceHud::PerformanceHud(QWidget* parent)
+    : QWidget(parent)
+    , frames_()
+    , frame_count_(0)
+    , next_frame_(0)
+    , update_display_ns_(-1)
+    , trajectory_bytes_(0)
+    , history_bytes_(0)
+    , scene_bytes_(0)
+    , refresh_timer_(new QTimer(this)) {
+
+    // 下のビューの操作を妨げない。背景は自分で塗りつぶす
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+
+    clock_.start();
+    refresh_timer_->setInterval(REFRESH_INTERVAL_MS);
+    connect(refresh_timer_, &QTimer::timeout, this, [this]() { update(); });
+    resize(sizeHint());
+}
+
+void PerformanceHud::recordFrame(qint64 paint_ns) {
+    frames_[next_frame_] = {clock_.nsecsElapsed(), paint_ns};
+    next_frame_ = (next_frame_ + 1) % FRAME_HISTORY;
+    frame_count_ = std::min(frame_count_ + 1, FRAME_HISTORY);
+}
+
+void PerformanceHud::setUpdateDisplayTime(qint64 ns) {
+    update_display_ns_ = ns;
+}
+
+void PerformanceHud::setLayerCounts(const std::vector<std::pair<QString, size_t>>& counts) {
+    bool resized = counts.size() != layer_counts_.size();
+    layer_counts_ = counts;
+    if (resized) {
+        resize(sizeHint());
+    }
+}
+
+void PerformanceHud::setMemoryUsage(size_t trajectory_bytes, size_t history_bytes, size_t scene_bytes) {
+    trajectory_bytes_ = trajectory_bytes;
+    history_bytes_ = history_bytes;
+    scene_bytes_ = scene_bytes;
+}
+
+QSize PerformanceHud::sizeHint() const {
+    // 描画時間・FPS・分布・updateDisplay・レイヤー・メモリの行とグラフ
+    int layer_lines = static_cast<int>((layer_counts_.size() + 1) / 2);
+    int lines = 2 + FPS_BUCKET_COUNT + 1 + layer_lines + MEMORY_LINES;
+    return QSize(PANEL_WIDTH, 2 * PADDING + lines * fontMetrics().lineSpacing() + GRAPH_HEIGHT + PADDING);
+}
+
+void PerformanceHud::showEvent(QShowEvent* event) {
+    QWidget::showEvent(event);
+    refresh_timer_->start();
+}
+
+void PerformanceHud::hideEvent(QHideEvent* event) {
+    QWidget::hideEvent(event);
+    refresh_timer_->stop();
+}
+
+const PerformanceHud::Frame& PerformanceHud::frameAt(int age) const {
+    return frames_[(next_frame_ - 1 - age + FRAME_HISTORY) % FRAME_HISTORY];
+}
+
+void PerformanceHud::paintEvent(QPaintEvent* /*event*/) {
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor(30, 30, 30));
+
+    const QColor text_color(220, 220, 220);
+    const QFontMetrics metrics = fontMetrics();
+    const int line_height = metrics.lineSpacing();
+    int y = PADDING + metrics.ascent();  // 次の行のベースライン
+    painter.setPen(text_color);
+    auto drawLine = [&](const QString& text) {
+        painter.drawText(PADDING, y, text);
+        y += line_height;
+    };
+
+    // 描画時間（直近のフレーム）
+    qint64 total_paint_ns = 0;
+    qint64 max_paint_ns = 0;
+    for (int age = 0; age < frame_count_; ++age) {
+        total_paint_ns += frameAt(age).paint_ns;
+        max_paint_ns = std::max(max_paint_ns, frameAt(age).paint_ns);
+    }
+    if (frame_count_ > 0) {
+        drawLine(QString("Paint  last %1 ms  avg %2  max %3")
+                 .arg(formatMs(frameAt(0).paint_ns))
+                 .arg(formatMs(total_paint_ns / frame_count_))
+                 .arg(formatMs(max_paint_ns)));
+    } else {
+        drawLine("Paint  -");
+    }
+
+    // 直近1秒に描いたフレーム数
+    const qint64 now_ns = clock_.nsecsElapsed();
+    int recent_frames = 0;
+    while (recent_frames < frame_count_ && now_ns - frameAt(recent_frames).time_ns <= IDLE_GAP_NS) {
+        ++recent_frames;
+    }
+    drawLine(QString("FPS    %1 (last 1 s)").arg(recent_frames));
+
+    // 描画時間の推移（右端が最新。破線は60 FPSの予算、超えたフレームは赤）
+    const QRect graph(PADDING, y - metrics.ascent(), width() - 2 * PADDING, GRAPH_HEIGHT);
+    painter.fillRect(graph, QColor(50, 50, 50));
+    const double scale_ms = std::max(2.0 * FRAME_BUDGET_MS, static_cast<double>(max_paint_ns) / 1e6);
+    const double bar_width = static_cast<double>(graph.width()) / FRAME_HISTORY;
+    for (int age = 0; age < frame_count_; ++age) {
+        double ms = static_cast<double>(frameAt(age).paint_ns) / 1e6;
+        double height = std::min(1.0, ms / scale_ms) * graph.height();
+        double x = graph.left() + graph.width() - (age + 1) * bar_width;
+        painter.fillRect(QRectF(x, graph.top() + graph.height() - height, std::max(1.0, bar_width - 1.0), height),
+                         ms > FRAME_BUDGET_MS ? QColor(230, 90, 60) : QColor(90, 200, 120));
+    }
+    const double budget_y = graph.top() + graph.height() * (1.0 - FRAME_BUDGET_MS / scale_ms);
+    painter.setPen(QPen(QColor(200, 200, 200), 1, Qt::DashLine));
+    painter.drawLine(QPointF(graph.left(), budget_y), QPointF(graph.left() + graph.width(), budget_y));
+    painter.setPen(text_color);
+    y += GRAPH_HEIGHT + PADDING;
+
+    // FPSの分布（続けて描いたフレームの間隔から求める）
+    int bucket_counts[FPS_BUCKET_COUNT] = {};
+    int interval_count = 0;
+    for (int age = 0; age + 1 < frame_count_; ++age) {
+        qint64 interval_ns = frameAt(age).time_ns - frameAt(age + 1).time_ns;
+        if (interval_ns <= 0 || interval_ns > IDLE_GAP_NS) {
+            continue;
+        }
+        double fps = 1e9 / static_cast<double>(interval_ns);
+        for (int b = 0; b < FPS_BUCKET_COUNT; ++b) {
+            if (fps >= FPS_BUCKETS[b].min_fps) {
+                ++bucket_counts[b];
+                break;
+            }
+        }
+        ++interval_count;
+    }
+    const int label_width = metrics.boundingRect("30-60 ").width();
+    const int count_width = metrics.boundingRect(" 000").width();
+    const int bar_max_width = graph.width() - label_width - count_width;
+    for (int b = 0; b < FPS_BUCKET_COUNT; ++b) {
+        int bar_width_px = interval_count > 0 ? bar_max_width * bucket_counts[b] / interval_count : 0;
+        painter.drawText(PADDING, y, FPS_BUCKETS[b].label);
+        painter.fillRect(PADDING + label_width, y - metrics.ascent() + 2, bar_width_px, line_height - 4,
+                         QColor(100, 150, 230));
+        painter.drawText(PADDING + label_width + bar_width_px + 2, y, QString::number(bucket_counts[b]));
+        y += line_height;
+    }
+
+    drawLine(update_display_ns_ >= 0 ? QString("updateDisplay  %1 ms").arg(formatMs(update_display_ns_))
+                                     : QString("updateDisplay  -"));
+
+    // レイヤーごとのアイテム数
+    for (size_t i = 0; i < layer_counts_.size(); i += 2) {
+        QString text = QString("%1 %2").arg(layer_counts_[i].first, -12)
+                                        .arg(static_cast<qulonglong>(layer_counts_[i].second), 7);
+        if (i + 1 < layer_counts_.size()) {
+            text += QString("  %1 %2").arg(layer_counts_[i + 1].first, -12)
+                                      .arg(static_cast<qulonglong>(layer_counts_[i + 1].second), 7);
+        }
+        drawLine(text);
+    }
+
+    // メモリ（シーンは計測できないので、アイテム数と1アイテムあたりの想定値からの見積もり）
+    drawLine("Trajectory  " + formatBytes(trajectory_bytes_));
+    drawLine("History     " + formatBytes(history_bytes_));
+    drawLine("Scene       ~" + formatBytes(scene_bytes_) + " (estimate)");
+}
+
+} // namespace trajectory_editor
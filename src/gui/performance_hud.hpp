@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QtWidgets/QWidget>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QString>
+#include <QtCore/QTimer>
+#include <array>
+#include <utility>
+#include <vector>
+
+namespace trajectory_editor {
+
+// ビューの負荷を重ねて表示するパネル（描画時間・FPSの分布・レイヤーごとのアイテム数・メモリ）
+//
+// ビューポートではなくビューの子として重ね、不透明に塗る。ビューポートのスクロール（画素の
+// コピー）やシーンの部分更新に巻き込まれず、パネルを描き直してもシーンは描き直さない。
+// 計測値はビューから渡し、1フレームの記録は配列への書き込みだけで済ませる。集計と表示は
+// 表示中だけ一定間隔で行う。
+class PerformanceHud : public QWidget {
+public:
+    explicit PerformanceHud(QWidget* parent = nullptr);
+
+    // 計測値（ビューから渡す）
+    void recordFrame(qint64 paint_ns);  // 1フレームの描画時間。呼ばれた間隔からFPSを求める
+    void setUpdateDisplayTime(qint64 ns);
+    void setLayerCounts(const std::vector<std::pair<QString, size_t>>& counts);
+    void setMemoryUsage(size_t trajectory_bytes, size_t history_bytes, size_t scene_bytes);  // scene は見積もり
+
+    QSize sizeHint() const override;
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
+
+private:
+    static constexpr int FRAME_HISTORY = 120;  // 集計する直近のフレーム数
+
+    struct Frame {
+        qint64 time_ns;   // 描画を終えた時刻
+        qint64 paint_ns;  // 描画にかかった時間
+    };
+    std::array<Frame, FRAME_HISTORY> frames_;
+    int frame_count_;
+    int next_frame_;
+    QElapsedTimer clock_;
+
+    qint64 update_display_ns_;  // 負なら未計測
+    std::vector<std::pair<QString, size_t>> layer_counts_;
+    size_t trajectory_bytes_;
+    size_t history_bytes_;
+    size_t scene_bytes_;
+
+    QTimer* refresh_timer_;
+
+    const Frame& frameAt(int age) const;  // age=0 が最新のフレーム
+};
+
+} // namespace trajectory_editor
@@ -16,11 +16,28 @@
 #include <QtWidgets/QComboBox>
 #include <QtWidgets/QFrame>
 #include <QtCore/QDebug>
+#include <QtCore/QFileInfo>
+#include <QtGui/QKeySequence>
+#include <cmath>
 
 #include "core/trajectory_data.hpp"
 #include "core/track_boundaries.hpp"
 #include "core/edit_history.hpp"
+#include "core/arc_length_index.hpp"
+#include "core/velocity_profile.hpp"
+#include "core/track_clearance.hpp"
+#include "core/kinematic_checker.hpp"
+#include "core/trajectory_comparison.hpp"
+#include "core/trajectory_resampler.hpp"
+#include "core/trajectory_smoother.hpp"
+#include "core/raceline_optimizer.hpp"
+#include "core/frenet_frame.hpp"
+#include "core/trajectory_snapshot.hpp"
 #include "gui/graphics_trajectory_view.hpp"
+#include "utils/trace.hpp"
+
+// 横方向オフセットの両端でなめらかに移動量を増やす区間の長さ [m]
+constexpr double LATERAL_OFFSET_TAPER = 10.0;
 
 // 単位変換関数
 inline double msToKmh(double velocity_ms) {
@@ -35,7 +52,8 @@ class TrajectoryEditor : public QMainWindow {
     Q_OBJECT
 
 public:
-    TrajectoryEditor(QWidget* parent = nullptr) : QMainWindow(parent), current_selected_index_(SIZE_MAX) {
+    TrajectoryEditor(QWidget* parent = nullptr)
+        : QMainWindow(parent), autosave_(snapshots_), brush_first_(0), current_selected_index_(SIZE_MAX) {
         setupUI();
         connectSignals();
         loadDefaultBoundaries();
@@ -54,12 +72,14 @@ private slots:
                 QString basename = filename.split('/').last().split('\\').last();
                 filename_label_1_->setText(basename);
                 edit_history_.clear(); // 新しいファイル読み込み時は履歴をクリア
+                startAutosave(filename.toStdString());
                 updateInfoDisplay();
                 updateVelocityUI();
                 updateHistoryButtons();
-                statusBar()->showMessage("Loaded (Green): " + filename, 3000);
+                statusBar()->showMessage("Loaded (Green): " + filename + skippedRowsText(trajectory_data_.getSkippedRowCount()), 3000);
             } else {
-                QMessageBox::warning(this, "Error", "Failed to load file: " + filename);
+                QMessageBox::warning(this, "Error", "Failed to load file: " + filename + "\n" +
+                                     QString::fromStdString(trajectory_data_.getLastError()));
             }
         }
     }
@@ -74,10 +94,28 @@ private slots:
                 // ファイル名ラベルを更新
                 QString basename = filename.split('/').last().split('\\').last();
                 filename_label_2_->setText(basename);
+                rebuildFrenetFrame();
+                updateInfoDisplay();
+                statusBar()->showMessage("Loaded (Blue): " + filename + skippedRowsText(trajectory_data_2_.getSkippedRowCount()), 3000);
+            } else {
+                QMessageBox::warning(this, "Error", "Failed to load file: " + filename + "\n" +
+                                     QString::fromStdString(trajectory_data_2_.getLastError()));
+            }
+        }
+    }
+    
+    void openBoundaries() {
+        QString filename = QFileDialog::getOpenFileName(
+            this, "Open Track Boundaries", "data", "Track Boundaries (*.csv *.trkb *.osm);;CSV Files (*.csv);;Binary Boundaries (*.trkb);;Lanelet2 Maps (*.osm)");
+        
+        if (!filename.isEmpty()) {
+            if (loadBoundaries(filename.toStdString())) {
                 updateInfoDisplay();
-                statusBar()->showMessage("Loaded (Blue): " + filename, 3000);
+                statusBar()->showMessage("Loaded boundaries: " + filename +
+                                         skippedRowsText(track_boundaries_.getSkippedRowCount()), 3000);
             } else {
-                QMessageBox::warning(this, "Error", "Failed to load file: " + filename);
+                QMessageBox::warning(this, "Error", "Failed to load boundaries: " + filename + "\n" +
+                                     QString::fromStdString(track_boundaries_.getLastError()));
             }
         }
     }
@@ -95,7 +133,8 @@ private slots:
             if (trajectory_data_.saveToCSV(filename.toStdString())) {
                 statusBar()->showMessage("Saved (Green): " + filename, 3000);
             } else {
-                QMessageBox::warning(this, "Error", "Failed to save file: " + filename);
+                QMessageBox::warning(this, "Error", "Failed to save file: " + filename + "\n" +
+                                     QString::fromStdString(trajectory_data_.getLastError()));
             }
         }
     }
@@ -113,7 +152,8 @@ private slots:
             if (trajectory_data_2_.saveToCSV(filename.toStdString())) {
                 statusBar()->showMessage("Saved (Blue): " + filename, 3000);
             } else {
-                QMessageBox::warning(this, "Error", "Failed to save file: " + filename);
+                QMessageBox::warning(this, "Error", "Failed to save file: " + filename + "\n" +
+                                     QString::fromStdString(trajectory_data_2_.getLastError()));
             }
         }
     }
@@ -134,6 +174,40 @@ private slots:
         trajectory_view_->resetZoom();
     }
     
+    // トレースの記録開始・停止（開始すると前回の記録は捨てる）
+    void onRecordTraceToggled(bool record) {
+        auto& recorder = trajectory_editor::TraceRecorder::instance();
+        if (record) {
+            recorder.clear();
+        }
+        recorder.setEnabled(record);
+        if (record) {
+            statusBar()->showMessage("Recording trace");
+        } else {
+            statusBar()->showMessage(QString("Trace stopped (%1 zones)").arg(recorder.getEventCount()), 3000);
+        }
+    }
+    
+    void onSaveTrace() {
+        auto& recorder = trajectory_editor::TraceRecorder::instance();
+        if (recorder.getEventCount() == 0) {
+            QMessageBox::information(this, "Info", "No trace recorded - press Record Trace first");
+            return;
+        }
+        
+        QString filename = QFileDialog::getSaveFileName(
+            this, "Save Trace", "trace.json", "Chrome Trace (*.json)");
+        
+        if (!filename.isEmpty()) {
+            if (recorder.writeChromeTrace(filename.toStdString())) {
+                statusBar()->showMessage("Saved trace: " + filename + " (open in ui.perfetto.dev or chrome://tracing)", 5000);
+            } else {
+                QMessageBox::warning(this, "Error", "Failed to save trace: " + filename + "\n" +
+                                     QString::fromStdString(recorder.getLastError()));
+            }
+        }
+    }
+    
     void onPointSizeChanged(double value) {
         trajectory_view_->setPointSize(value);
     }
@@ -153,6 +227,16 @@ private slots:
                           .arg(point.y, 0, 'f', 2)
                           .arg(point.z, 0, 'f', 2)
                           .arg(msToKmh(point.velocity), 0, 'f', 2);
+            if (!trajectory_data_2_.empty() && index < comparison_.size()) {
+                info += QString("  vs Blue: lateral %1 m, arc %2 m, dv %3 km/h")
+                       .arg(comparison_.getLateralOffsets()[index], 0, 'f', 2)
+                       .arg(comparison_.getArcLengthOffset(index), 0, 'f', 2)
+                       .arg(msToKmh(comparison_.getSpeedDeltas()[index]), 0, 'f', 1);
+            }
+            if (!frenet_frame_.empty()) {
+                auto frenet = frenet_frame_.toFrenet(point.x, point.y);
+                info += QString("  s %1 m, d %2 m").arg(frenet.s, 0, 'f', 1).arg(frenet.d, 0, 'f', 2);
+            }
             statusBar()->showMessage(info, 5000);
             
             // 速度編集UIを更新
@@ -175,8 +259,10 @@ private slots:
                 auto command = std::make_unique<trajectory_editor::MovePointCommand>(
                     index, point.x, point.y, new_x, new_y);
                 edit_history_.executeCommand(std::move(command), trajectory_data_);
+                applyAutoVelocityProfile();
                 trajectory_view_->updateDisplay();
                 updateHistoryButtons();
+                updateInfoDisplay();
                 statusBar()->showMessage(QString("Point %1 moved to (%2, %3)")
                                        .arg(index).arg(new_x, 0, 'f', 2).arg(new_y, 0, 'f', 2), 2000);
             }
@@ -191,9 +277,11 @@ private slots:
             trajectory_editor::TrajectoryPoint new_point(x, y, 6.5, kmhToMs(velocity));
             auto command = std::make_unique<trajectory_editor::AddPointCommand>(index, new_point);
             edit_history_.executeCommand(std::move(command), trajectory_data_);
+            applyAutoVelocityProfile();
             trajectory_view_->updateDisplay();
             updateHistoryButtons();
             updateVelocityUI();
+            updateInfoDisplay();
             statusBar()->showMessage(QString("Point added at index %1").arg(index), 2000);
         } catch (const std::exception& e) {
             QMessageBox::warning(this, "Error", QString("Failed to add point: %1").arg(e.what()));
@@ -212,9 +300,11 @@ private slots:
                 trajectory_editor::TrajectoryPoint deleted_point = points[index];
                 auto command = std::make_unique<trajectory_editor::RemovePointCommand>(index, deleted_point);
                 edit_history_.executeCommand(std::move(command), trajectory_data_);
+                applyAutoVelocityProfile();
                 trajectory_view_->updateDisplay();
                 updateHistoryButtons();
                 updateVelocityUI();
+                updateInfoDisplay();
                 statusBar()->showMessage(QString("Point %1 deleted").arg(index), 2000);
             }
         } catch (const std::exception& e) {
@@ -230,6 +320,10 @@ private slots:
         trajectory_view_->setSpeedTextVisible(visible);
     }
     
+    void togglePerformanceHud(bool visible) {
+        trajectory_view_->setPerformanceHudVisible(visible);
+    }
+    
     void onCoordinateSystemChanged(int index) {
         trajectory_editor::GraphicsTrajectoryView::CoordinateSystem coord_system;
         QString message;
@@ -261,9 +355,29 @@ private slots:
         statusBar()->showMessage(message, 3000);
     }
     
+    void onColorModeChanged(int index) {
+        using View = trajectory_editor::GraphicsTrajectoryView;
+        View::ColorMode mode = View::COLOR_BY_SPEED;
+        if (index == 1) {
+            mode = View::COLOR_BY_CURVATURE;
+        } else if (index == 2) {
+            mode = View::COLOR_BY_LATERAL_ACCELERATION;
+        }
+        trajectory_view_->setColorMode(mode);
+        
+        if (mode != View::COLOR_BY_SPEED && !trajectory_data_.empty()) {
+            const auto& geometry = trajectory_view_->getGeometry();
+            size_t max_index = 0;
+            double max_lat_acc = geometry.getMaxAbsLateralAcceleration(&max_index);
+            statusBar()->showMessage(QString("Max lateral acceleration: %1 m/s² at point %2")
+                                   .arg(max_lat_acc, 0, 'f', 2).arg(max_index), 5000);
+        }
+    }
+    
     void onViewModeClicked() {
         if (view_mode_button_->isChecked()) {
             add_mode_button_->setChecked(false);
+            smooth_brush_button_->setChecked(false);
             trajectory_view_->setEditMode(trajectory_editor::GraphicsTrajectoryView::VIEWING);
             edit_info_label_->setText("View Mode:\n• Click: Select point\n• Drag: Move point\n• Right-click: Delete");
         }
@@ -272,11 +386,94 @@ private slots:
     void onAddModeClicked() {
         if (add_mode_button_->isChecked()) {
             view_mode_button_->setChecked(false);
+            smooth_brush_button_->setChecked(false);
             trajectory_view_->setEditMode(trajectory_editor::GraphicsTrajectoryView::ADDING_POINT);
             edit_info_label_->setText("Add Mode:\n• Click: Add new point\n• Point will be inserted automatically");
         }
     }
     
+    void onSmoothBrushClicked() {
+        if (smooth_brush_button_->isChecked()) {
+            view_mode_button_->setChecked(false);
+            add_mode_button_->setChecked(false);
+            trajectory_view_->setEditMode(trajectory_editor::GraphicsTrajectoryView::SMOOTHING_BRUSH);
+            edit_info_label_->setText("Smooth Brush:\n• Drag along the path to smooth it\n• One drag = one undo step");
+        }
+    }
+    
+    // ブラシ位置の前後 radius [m] の窓だけを平滑化する（確定はマウスを離したとき）
+    void onBrushMoved(size_t index, double x, double y) {
+        if (index >= trajectory_data_.size() || trajectory_data_.size() < 3) {
+            return;
+        }
+        const auto& points = trajectory_data_.getPoints();
+        double radius = brush_radius_spin_->value();
+        if (std::hypot(points[index].x - x, points[index].y - y) > radius) {
+            return;
+        }
+        
+        arc_length_index_.update(trajectory_data_);
+        double s = arc_length_index_.getDistanceAt(index);
+        size_t start_idx = arc_length_index_.findIndexAtDistance(s - radius);
+        size_t end_idx = arc_length_index_.findIndexAtOrAfterDistance(s + radius);
+        if (end_idx >= trajectory_data_.size() || end_idx - start_idx < 2) {
+            return;
+        }
+        
+        try {
+            // 元の点はブラシが触れた範囲だけ退避する
+            if (brush_original_.empty()) {
+                brush_first_ = start_idx;
+                brush_original_ = trajectory_data_.getRange(start_idx, end_idx);
+            } else {
+                size_t brush_last = brush_first_ + brush_original_.size() - 1;
+                if (start_idx < brush_first_) {
+                    auto head = trajectory_data_.getRange(start_idx, brush_first_ - 1);
+                    brush_original_.insert(brush_original_.begin(), head.begin(), head.end());
+                    brush_first_ = start_idx;
+                }
+                if (end_idx > brush_last) {
+                    auto tail = trajectory_data_.getRange(brush_last + 1, end_idx);
+                    brush_original_.insert(brush_original_.end(), tail.begin(), tail.end());
+                }
+            }
+            
+            trajectory_editor::SmoothingOptions options;
+            options.smoothness = brush_strength_spin_->value();
+            trajectory_editor::TrajectorySmoother smoother;
+            smoother.setOptions(options);
+            trajectory_data_.replaceRange(start_idx, end_idx, smoother.smooth(points, start_idx, end_idx));
+            publishSnapshot();  // ドラッグ中の途中経過も自動保存に渡す
+            trajectory_view_->updateDisplay();
+        } catch (const std::exception& e) {
+            QMessageBox::warning(this, "Error", QString("Failed to smooth: %1").arg(e.what()));
+        }
+    }
+    
+    void onBrushReleased() {
+        if (brush_original_.empty()) {
+            return;
+        }
+        try {
+            // ドラッグ中の変更は適用済みなので、同じ内容を1つのコマンドとして履歴に積む
+            size_t end_idx = brush_first_ + brush_original_.size() - 1;
+            auto command = std::make_unique<trajectory_editor::ReplaceRangeCommand>(
+                brush_first_, std::move(brush_original_), trajectory_data_.getRange(brush_first_, end_idx),
+                QString("Smooth points %1-%2").arg(brush_first_).arg(end_idx).toStdString());
+            brush_original_.clear();
+            edit_history_.executeCommand(std::move(command), trajectory_data_);
+            applyAutoVelocityProfile();
+            trajectory_view_->updateDisplay();
+            updateHistoryButtons();
+            updateVelocityUI();
+            updateInfoDisplay();
+            statusBar()->showMessage(QString("Smoothed points %1-%2").arg(brush_first_).arg(end_idx), 3000);
+        } catch (const std::exception& e) {
+            brush_original_.clear();
+            QMessageBox::warning(this, "Error", QString("Failed to smooth: %1").arg(e.what()));
+        }
+    }
+    
     void onApplyVelocity() {
         size_t current_index = getCurrentSelectedIndex();
         if (current_index != SIZE_MAX) {
@@ -305,8 +502,11 @@ private slots:
     
     void onApplyRangeVelocity() {
         try {
-            size_t start_idx = static_cast<size_t>(range_start_spin_->value());
-            size_t end_idx = static_cast<size_t>(range_end_spin_->value());
+            size_t start_idx = 0;
+            size_t end_idx = 0;
+            if (!resolveRangeIndices(trajectory_data_, arc_length_index_, start_idx, end_idx)) {
+                return;
+            }
             double new_velocity_kmh = range_velocity_spin_->value();  // km/h単位（UI）
             double new_velocity = kmhToMs(new_velocity_kmh);       // m/s単位に変換
             
@@ -344,6 +544,229 @@ private slots:
         }
     }
     
+    void onGenerateVelocityProfile() {
+        try {
+            if (trajectory_data_.empty()) {
+                QMessageBox::information(this, "Info", "Load a trajectory first");
+                return;
+            }
+            
+            velocity_profile_.setLimits(readVelocityLimits());
+            velocity_profile_.update(trajectory_data_);
+            size_t changed = applyVelocityProfile(0, trajectory_data_.size() - 1);
+            trajectory_view_->updateDisplay();
+            updateHistoryButtons();
+            updateVelocityUI();
+            updateInfoDisplay();
+            statusBar()->showMessage(QString("Velocity profile applied (%1 points changed)").arg(changed), 3000);
+        } catch (const std::exception& e) {
+            QMessageBox::warning(this, "Error", QString("Failed to generate velocity profile: %1").arg(e.what()));
+        }
+    }
+    
+    void onVelocityProfileLimitsChanged() {
+        velocity_profile_.setLimits(readVelocityLimits());
+        kinematic_checker_.setLimits(readKinematicLimits());
+        trajectory_view_->updateKinematicViolations(kinematic_checker_.getViolationFlags(),
+                                                    kinematic_checker_.getChangedViolations());
+    }
+    
+    void onDeleteRange() {
+        try {
+            size_t start_idx = 0;
+            size_t end_idx = 0;
+            if (!resolveRangeIndices(trajectory_data_, arc_length_index_, start_idx, end_idx)) {
+                return;
+            }
+            
+            if (start_idx > end_idx || end_idx >= trajectory_data_.size()) {
+                QMessageBox::information(this, "Info", QString("Invalid range %1-%2 for trajectory size %3")
+                                        .arg(start_idx).arg(end_idx).arg(trajectory_data_.size()));
+                return;
+            }
+            
+            if (trajectory_data_.size() - (end_idx - start_idx + 1) < 2) {
+                QMessageBox::information(this, "Info", "Cannot delete range: minimum 2 points required");
+                return;
+            }
+            
+            auto command = std::make_unique<trajectory_editor::RemoveRangeCommand>(
+                start_idx, trajectory_data_.getRange(start_idx, end_idx));
+            edit_history_.executeCommand(std::move(command), trajectory_data_);
+            current_selected_index_ = SIZE_MAX;
+            trajectory_view_->clearSelection();
+            trajectory_view_->updateDisplay();
+            updateHistoryButtons();
+            updateVelocityUI();
+            updateInfoDisplay();
+            statusBar()->showMessage(QString("Deleted points %1-%2").arg(start_idx).arg(end_idx), 3000);
+        } catch (const std::exception& e) {
+            QMessageBox::warning(this, "Error", QString("Failed to delete range: %1").arg(e.what()));
+        }
+    }
+    
+    void onImportBlueRange() {
+        try {
+            if (trajectory_data_2_.empty()) {
+                QMessageBox::information(this, "Info", "No blue trajectory loaded");
+                return;
+            }
+            
+            size_t start_idx = 0;
+            size_t end_idx = 0;
+            if (!resolveRangeIndices(trajectory_data_2_, arc_length_index_2_, start_idx, end_idx)) {
+                return;
+            }
+            
+            if (start_idx > end_idx || end_idx >= trajectory_data_2_.size()) {
+                QMessageBox::information(this, "Info", QString("Invalid range %1-%2 for blue trajectory size %3")
+                                        .arg(start_idx).arg(end_idx).arg(trajectory_data_2_.size()));
+                return;
+            }
+            
+            // 選択点の直後（未選択なら末尾）に挿入
+            size_t insert_index = trajectory_data_.size();
+            if (current_selected_index_ != SIZE_MAX && current_selected_index_ < trajectory_data_.size()) {
+                insert_index = current_selected_index_ + 1;
+            }
+            
+            // 姿勢列も一緒に取り込む
+            auto command = std::make_unique<trajectory_editor::SpliceRangeCommand>(
+                insert_index, trajectory_data_2_, start_idx, end_idx);
+            edit_history_.executeCommand(std::move(command), trajectory_data_);
+            trajectory_view_->updateDisplay();
+            updateHistoryButtons();
+            updateVelocityUI();
+            updateInfoDisplay();
+            statusBar()->showMessage(QString("Imported blue points %1-%2 at index %3")
+                                   .arg(start_idx).arg(end_idx).arg(insert_index), 3000);
+        } catch (const std::exception& e) {
+            QMessageBox::warning(this, "Error", QString("Failed to import range: %1").arg(e.what()));
+        }
+    }
+    
+    void onResampleRange() {
+        size_t start_idx = 0;
+        size_t end_idx = 0;
+        if (!resolveRangeIndices(trajectory_data_, arc_length_index_, start_idx, end_idx)) {
+            return;
+        }
+        if (start_idx >= end_idx || end_idx >= trajectory_data_.size()) {
+            QMessageBox::information(this, "Info", QString("Invalid range %1-%2 for trajectory size %3")
+                                    .arg(start_idx).arg(end_idx).arg(trajectory_data_.size()));
+            return;
+        }
+        resampleRange(start_idx, end_idx);
+    }
+    
+    void onResampleAll() {
+        if (trajectory_data_.size() < 2) {
+            QMessageBox::information(this, "Info", "No trajectory data loaded");
+            return;
+        }
+        resampleRange(0, trajectory_data_.size() - 1);
+    }
+    
+    void onOptimizeRaceline() {
+        if (trajectory_data_.size() < 5) {
+            QMessageBox::information(this, "Info", "Not enough trajectory points to optimise");
+            return;
+        }
+        if (track_boundaries_.empty()) {
+            QMessageBox::information(this, "Info", "No track boundaries loaded");
+            return;
+        }
+        
+        trajectory_editor::RacelineOptions options;
+        options.margin = raceline_margin_spin_->value();
+        trajectory_editor::RacelineOptimizer optimizer;
+        optimizer.setBoundaries(track_boundaries_);
+        optimizer.setOptions(options);
+        
+        std::vector<trajectory_editor::TrajectoryPoint> points;
+        if (!optimizer.optimize(trajectory_data_.getPoints(), points)) {
+            QMessageBox::warning(this, "Error", "Failed to optimise the raceline");
+            return;
+        }
+        const auto& stats = optimizer.getStatistics();
+        if (stats.final_cost >= stats.initial_cost) {
+            QMessageBox::information(this, "Info", QString("The raceline could not be improved (curvature cost %1)")
+                                    .arg(stats.initial_cost, 0, 'f', 4));
+            return;
+        }
+        
+        try {
+            // 点数は変わらないので全体を1つのコマンドで置き換える
+            size_t end_idx = trajectory_data_.size() - 1;
+            auto command = std::make_unique<trajectory_editor::ReplaceRangeCommand>(
+                0, trajectory_data_.getPoints(), std::move(points), "Optimise raceline");
+            edit_history_.executeCommand(std::move(command), trajectory_data_);
+            applyAutoVelocityProfile();
+            current_selected_index_ = SIZE_MAX;
+            trajectory_view_->clearSelection();
+            trajectory_view_->updateDisplay();
+            updateHistoryButtons();
+            updateVelocityUI();
+            updateInfoDisplay();
+            
+            statusBar()->showMessage(QString("Optimised raceline 0-%1: curvature cost %2 -> %3, max offset %4 m%5")
+                                   .arg(end_idx)
+                                   .arg(stats.initial_cost, 0, 'f', 4)
+                                   .arg(stats.final_cost, 0, 'f', 4)
+                                   .arg(stats.max_abs_offset, 0, 'f', 2)
+                                   .arg(stats.converged ? "" : " (not converged)"), 5000);
+        } catch (const std::exception& e) {
+            QMessageBox::warning(this, "Error", QString("Failed to optimise the raceline: %1").arg(e.what()));
+        }
+    }
+    
+    void onOffsetRange() {
+        if (frenet_frame_.empty()) {
+            QMessageBox::information(this, "Info", "Load track boundaries or a blue trajectory as the reference line");
+            return;
+        }
+        size_t start_idx = 0;
+        size_t end_idx = 0;
+        if (!resolveRangeIndices(trajectory_data_, arc_length_index_, start_idx, end_idx)) {
+            return;
+        }
+        if (start_idx > end_idx || end_idx >= trajectory_data_.size()) {
+            QMessageBox::information(this, "Info", QString("Invalid range %1-%2 for trajectory size %3")
+                                    .arg(start_idx).arg(end_idx).arg(trajectory_data_.size()));
+            return;
+        }
+        
+        try {
+            double offset = lateral_offset_spin_->value();
+            auto points = frenet_frame_.offsetRange(trajectory_data_.getPoints(), start_idx, end_idx,
+                                                    offset, LATERAL_OFFSET_TAPER);
+            auto command = std::make_unique<trajectory_editor::ReplaceRangeCommand>(
+                start_idx, trajectory_data_.getRange(start_idx, end_idx), std::move(points),
+                QString("Offset points %1-%2 by %3 m").arg(start_idx).arg(end_idx)
+                    .arg(offset, 0, 'f', 2).toStdString());
+            edit_history_.executeCommand(std::move(command), trajectory_data_);
+            applyAutoVelocityProfile();
+            trajectory_view_->updateDisplay();
+            updateHistoryButtons();
+            updateVelocityUI();
+            updateInfoDisplay();
+            statusBar()->showMessage(QString("Offset points %1-%2 by %3 m")
+                                   .arg(start_idx).arg(end_idx).arg(offset, 0, 'f', 2), 3000);
+        } catch (const std::exception& e) {
+            QMessageBox::warning(this, "Error", QString("Failed to offset range: %1").arg(e.what()));
+        }
+    }
+    
+    void onRangeUnitChanged(int index) {
+        bool distance_mode = (index == 1);
+        for (QDoubleSpinBox* spin : {range_start_spin_, range_end_spin_}) {
+            spin->setDecimals(distance_mode ? 1 : 0);
+            spin->setSuffix(distance_mode ? " m" : "");
+            spin->setValue(0);
+        }
+        updateRangeLimits();
+    }
+    
     void onUndo() {
         edit_history_.undo(trajectory_data_);
         trajectory_view_->updateDisplay();
@@ -380,6 +803,29 @@ private:
     trajectory_editor::TrackBoundaries track_boundaries_;
     trajectory_editor::EditHistory edit_history_;
     
+    // 距離（m）による範囲指定用
+    trajectory_editor::ArcLengthIndex arc_length_index_;
+    trajectory_editor::ArcLengthIndex arc_length_index_2_;
+    
+    // 自動速度プロファイル
+    trajectory_editor::VelocityProfile velocity_profile_;
+    
+    // コース境界までの余裕距離
+    trajectory_editor::TrackClearance track_clearance_;
+    trajectory_editor::KinematicChecker kinematic_checker_;
+    
+    // グリーン（比較対象）とブルー（基準）の比較
+    trajectory_editor::TrajectoryComparison comparison_;
+    trajectory_editor::FrenetFrame frenet_frame_;  // コース中央線（境界がなければ青の軌跡）に沿った座標
+    
+    // 緑の軌跡の不変スナップショットと、それを別スレッドで書き出す自動保存
+    trajectory_editor::SnapshotPublisher snapshots_;
+    trajectory_editor::SnapshotAutosave autosave_;  // snapshots_ より後に宣言する（先に止める）
+    
+    // 平滑化ブラシのドラッグ中に触れた範囲の元の点（マウスを離したときに1つのコマンドにする）
+    size_t brush_first_;
+    std::vector<trajectory_editor::TrajectoryPoint> brush_original_;
+    
     // 選択状態
     size_t current_selected_index_;
     
@@ -400,6 +846,7 @@ private:
     
     QPushButton* open_button_;
     QPushButton* open_button_2_;   // 2つ目のCSV読み込み
+    QPushButton* open_boundaries_button_;  // 境界線（CSV/OSM）読み込み
     QPushButton* save_button_;
     QPushButton* save_button_2_;   // 2つ目のCSV保存
     QLabel* filename_label_1_;     // 1つ目のファイル名表示
@@ -410,17 +857,33 @@ private:
     QPushButton* zoom_in_button_;
     QPushButton* zoom_out_button_;
     QPushButton* reset_zoom_button_;
+    QPushButton* record_trace_button_;  // トレースの記録開始・停止
+    QPushButton* save_trace_button_;
     
     QDoubleSpinBox* point_size_spin_;
     QDoubleSpinBox* line_width_spin_;
     QCheckBox* boundaries_checkbox_;
     QCheckBox* speed_text_checkbox_;
+    QCheckBox* performance_hud_checkbox_;  // 描画時間・アイテム数・メモリの表示
     QComboBox* coordinate_system_combo_;
+    QComboBox* color_mode_combo_;
     
     // 編集モード
     QGroupBox* edit_group_;
     QPushButton* view_mode_button_;
     QPushButton* add_mode_button_;
+    QPushButton* delete_range_button_;
+    QPushButton* import_range_button_;
+    QDoubleSpinBox* resample_spacing_spin_;
+    QPushButton* resample_range_button_;
+    QPushButton* resample_all_button_;
+    QDoubleSpinBox* raceline_margin_spin_;
+    QPushButton* optimize_raceline_button_;
+    QDoubleSpinBox* lateral_offset_spin_;
+    QPushButton* offset_range_button_;
+    QPushButton* smooth_brush_button_;
+    QDoubleSpinBox* brush_radius_spin_;
+    QDoubleSpinBox* brush_strength_spin_;
     QLabel* edit_info_label_;
     
     // 速度編集
@@ -429,9 +892,17 @@ private:
     QDoubleSpinBox* velocity_spin_;
     QPushButton* apply_velocity_button_;
     QPushButton* range_velocity_button_;
+    QComboBox* range_unit_combo_;
     QDoubleSpinBox* range_start_spin_;
     QDoubleSpinBox* range_end_spin_;
     QDoubleSpinBox* range_velocity_spin_;
+    QDoubleSpinBox* profile_max_speed_spin_;
+    QDoubleSpinBox* profile_lat_acc_spin_;
+    QDoubleSpinBox* profile_accel_spin_;
+    QDoubleSpinBox* profile_decel_spin_;
+    QDoubleSpinBox* profile_jerk_spin_;
+    QPushButton* generate_profile_button_;
+    QCheckBox* auto_profile_checkbox_;
     
     QLabel* info_label_;
     
@@ -448,6 +919,7 @@ private:
         // 軌跡表示ビュー
         trajectory_view_ = new trajectory_editor::GraphicsTrajectoryView;
         trajectory_view_->setMinimumSize(600, 400);
+        trajectory_view_->setEditHistory(&edit_history_);  // 性能表示で履歴のメモリを数える
         
         // 左側コントロールパネル
         left_control_panel_ = new QWidget;
@@ -497,6 +969,8 @@ private:
         open_button_->setStyleSheet("font-size: 11px; padding: 4px 8px; background-color: #e8f5e8;");
         open_button_2_ = new QPushButton("Open CSV (Blue)");
         open_button_2_->setStyleSheet("font-size: 11px; padding: 4px 8px; background-color: #e8f0ff;");
+        open_boundaries_button_ = new QPushButton("Open Boundaries (CSV/OSM)");
+        open_boundaries_button_->setStyleSheet("font-size: 11px; padding: 4px 8px;");
         save_button_ = new QPushButton("Save CSV (Green)");
         save_button_->setStyleSheet("font-size: 11px; padding: 4px 8px; background-color: #e8f5e8;");
         save_button_2_ = new QPushButton("Save CSV (Blue)");
@@ -520,6 +994,7 @@ private:
         filename_label_2_->setMaximumHeight(16);
         file_layout->addWidget(filename_label_2_);
         
+        file_layout->addWidget(open_boundaries_button_);
         file_layout->addWidget(save_button_);
         file_layout->addWidget(save_button_2_);
         
@@ -556,6 +1031,28 @@ private:
         view_layout->addWidget(zoom_out_button_);
         view_layout->addWidget(reset_zoom_button_);
         
+        // トレース（どこで時間がかかっているかを chrome://tracing / Perfetto で見る）
+        QHBoxLayout* trace_layout = new QHBoxLayout;
+        record_trace_button_ = new QPushButton("Record Trace");
+        record_trace_button_->setStyleSheet("font-size: 11px; padding: 2px 6px;");
+        record_trace_button_->setCheckable(true);
+        record_trace_button_->setShortcut(QKeySequence(Qt::Key_F8));
+        save_trace_button_ = new QPushButton("Save Trace");
+        save_trace_button_->setStyleSheet("font-size: 11px; padding: 2px 6px;");
+        save_trace_button_->setShortcut(QKeySequence(Qt::SHIFT + Qt::Key_F8));
+        if (trajectory_editor::TraceRecorder::isAvailable()) {
+            record_trace_button_->setToolTip("Start/stop recording a trace (F8)");
+            save_trace_button_->setToolTip("Save the recorded trace as Chrome trace JSON (Shift+F8)");
+        } else {
+            record_trace_button_->setEnabled(false);
+            save_trace_button_->setEnabled(false);
+            record_trace_button_->setToolTip("Built with ENABLE_TRACING=OFF");
+            save_trace_button_->setToolTip("Built with ENABLE_TRACING=OFF");
+        }
+        trace_layout->addWidget(record_trace_button_);
+        trace_layout->addWidget(save_trace_button_);
+        view_layout->addLayout(trace_layout);
+        
         left_layout_->addWidget(view_group_);
     }
     
@@ -570,8 +1067,99 @@ private:
         add_mode_button_ = new QPushButton("Add Points");
         add_mode_button_->setCheckable(true);
         
+        smooth_brush_button_ = new QPushButton("Smooth Brush");
+        smooth_brush_button_->setCheckable(true);
+        
         edit_layout->addWidget(view_mode_button_);
         edit_layout->addWidget(add_mode_button_);
+        edit_layout->addWidget(smooth_brush_button_);
+        
+        // ブラシの半径（弧長）と強さ
+        QHBoxLayout* brush_layout = new QHBoxLayout;
+        brush_radius_spin_ = new QDoubleSpinBox;
+        brush_radius_spin_->setRange(1.0, 200.0);
+        brush_radius_spin_->setValue(10.0);
+        brush_radius_spin_->setDecimals(1);
+        brush_radius_spin_->setPrefix("R ");
+        brush_radius_spin_->setSuffix(" m");
+        brush_radius_spin_->setStyleSheet("font-size: 10px;");
+        brush_radius_spin_->setToolTip("Brush radius along the path");
+        brush_strength_spin_ = new QDoubleSpinBox;
+        brush_strength_spin_->setRange(0.1, 100.0);
+        brush_strength_spin_->setValue(4.0);
+        brush_strength_spin_->setDecimals(1);
+        brush_strength_spin_->setPrefix("S ");
+        brush_strength_spin_->setStyleSheet("font-size: 10px;");
+        brush_strength_spin_->setToolTip("Smoothing strength per brush step");
+        brush_layout->addWidget(brush_radius_spin_);
+        brush_layout->addWidget(brush_strength_spin_);
+        edit_layout->addLayout(brush_layout);
+        
+        // 範囲編集（From/Toは速度エディタの範囲指定を使用）
+        QHBoxLayout* range_edit_layout = new QHBoxLayout;
+        delete_range_button_ = new QPushButton("Delete Range");
+        delete_range_button_->setStyleSheet("font-size: 10px; padding: 2px 6px;");
+        delete_range_button_->setToolTip("Delete points From-To of the green trajectory");
+        import_range_button_ = new QPushButton("Import Blue Range");
+        import_range_button_->setStyleSheet("font-size: 10px; padding: 2px 6px;");
+        import_range_button_->setToolTip("Insert blue points From-To after the selected green point");
+        range_edit_layout->addWidget(delete_range_button_);
+        range_edit_layout->addWidget(import_range_button_);
+        edit_layout->addLayout(range_edit_layout);
+        
+        // 等間隔リサンプリング
+        QHBoxLayout* resample_layout = new QHBoxLayout;
+        resample_spacing_spin_ = new QDoubleSpinBox;
+        resample_spacing_spin_->setRange(0.1, 50.0);
+        resample_spacing_spin_->setValue(1.0);
+        resample_spacing_spin_->setSingleStep(0.5);
+        resample_spacing_spin_->setDecimals(1);
+        resample_spacing_spin_->setSuffix(" m");
+        resample_spacing_spin_->setStyleSheet("font-size: 10px;");
+        resample_range_button_ = new QPushButton("Resample Range");
+        resample_range_button_->setStyleSheet("font-size: 10px; padding: 2px 6px;");
+        resample_range_button_->setToolTip("Resample points From-To of the green trajectory at a fixed spacing");
+        resample_all_button_ = new QPushButton("Resample All");
+        resample_all_button_->setStyleSheet("font-size: 10px; padding: 2px 6px;");
+        resample_all_button_->setToolTip("Resample the whole green trajectory at a fixed spacing");
+        resample_layout->addWidget(resample_spacing_spin_);
+        resample_layout->addWidget(resample_range_button_);
+        resample_layout->addWidget(resample_all_button_);
+        edit_layout->addLayout(resample_layout);
+        
+        // 最小曲率ライン
+        QHBoxLayout* raceline_layout = new QHBoxLayout;
+        raceline_margin_spin_ = new QDoubleSpinBox;
+        raceline_margin_spin_->setRange(0.0, 5.0);
+        raceline_margin_spin_->setValue(0.5);
+        raceline_margin_spin_->setSingleStep(0.1);
+        raceline_margin_spin_->setDecimals(1);
+        raceline_margin_spin_->setSuffix(" m");
+        raceline_margin_spin_->setStyleSheet("font-size: 10px;");
+        raceline_margin_spin_->setToolTip("Distance to keep from the track boundaries");
+        optimize_raceline_button_ = new QPushButton("Optimise Raceline");
+        optimize_raceline_button_->setStyleSheet("font-size: 10px; padding: 2px 6px;");
+        optimize_raceline_button_->setToolTip("Move the green trajectory laterally to minimise curvature within the track boundaries");
+        raceline_layout->addWidget(raceline_margin_spin_);
+        raceline_layout->addWidget(optimize_raceline_button_);
+        edit_layout->addLayout(raceline_layout);
+        
+        // 横方向オフセット
+        QHBoxLayout* offset_layout = new QHBoxLayout;
+        lateral_offset_spin_ = new QDoubleSpinBox;
+        lateral_offset_spin_->setRange(-5.0, 5.0);
+        lateral_offset_spin_->setValue(0.5);
+        lateral_offset_spin_->setSingleStep(0.1);
+        lateral_offset_spin_->setDecimals(2);
+        lateral_offset_spin_->setSuffix(" m");
+        lateral_offset_spin_->setStyleSheet("font-size: 10px;");
+        lateral_offset_spin_->setToolTip("Lateral offset (positive to the left of the driving direction)");
+        offset_range_button_ = new QPushButton("Offset Range");
+        offset_range_button_->setStyleSheet("font-size: 10px; padding: 2px 6px;");
+        offset_range_button_->setToolTip("Move points From-To of the green trajectory sideways along the track centre line");
+        offset_layout->addWidget(lateral_offset_spin_);
+        offset_layout->addWidget(offset_range_button_);
+        edit_layout->addLayout(offset_layout);
         
         edit_info_label_ = new QLabel("View Mode:\n• Click: Select point\n• Drag: Move point\n• Right-click: Delete");
         edit_info_label_->setWordWrap(true);
@@ -654,6 +1242,15 @@ private:
         
         velocity_layout->addSpacing(2);
         
+        // 範囲の単位（点インデックス / 始点からの距離）
+        range_unit_combo_ = new QComboBox;
+        range_unit_combo_->addItem("Index");
+        range_unit_combo_->addItem("Distance [m]");
+        range_unit_combo_->setStyleSheet("font-size: 9px;");
+        range_unit_combo_->setMinimumHeight(20);
+        range_unit_combo_->setMaximumHeight(20);
+        velocity_layout->addWidget(range_unit_combo_);
+        
         // From/To を横配置で1行に
         QHBoxLayout* range_indices_layout = new QHBoxLayout;
         range_indices_layout->setSpacing(4);
@@ -715,6 +1312,63 @@ private:
         range_velocity_button_->setStyleSheet("font-size: 9px; padding: 1px 6px;");
         velocity_layout->addWidget(range_velocity_button_);
         
+        velocity_layout->addSpacing(4);
+        
+        QFrame* profile_separator = new QFrame;
+        profile_separator->setFrameShape(QFrame::HLine);
+        profile_separator->setFrameShadow(QFrame::Sunken);
+        profile_separator->setMaximumHeight(1);
+        velocity_layout->addWidget(profile_separator);
+        
+        velocity_layout->addSpacing(4);
+        
+        // 摩擦円による速度プロファイル生成
+        QLabel* profile_label = new QLabel("Velocity Profile:");
+        profile_label->setStyleSheet("font-size: 10px; font-weight: bold; color: #333; padding: 1px;");
+        profile_label->setMinimumHeight(14);
+        profile_label->setMaximumHeight(14);
+        velocity_layout->addWidget(profile_label);
+        
+        auto add_profile_spin = [velocity_layout](const QString& label_text, double max_value,
+                                                  double value, const QString& suffix) {
+            QHBoxLayout* row = new QHBoxLayout;
+            row->setSpacing(4);
+            QLabel* label = new QLabel(label_text);
+            label->setStyleSheet("font-size: 9px;");
+            label->setMinimumWidth(70);
+            row->addWidget(label);
+            
+            QDoubleSpinBox* spin = new QDoubleSpinBox;
+            spin->setRange(0.1, max_value);
+            spin->setValue(value);
+            spin->setSuffix(suffix);
+            spin->setDecimals(1);
+            spin->setMinimumHeight(20);
+            spin->setMaximumHeight(20);
+            spin->setStyleSheet("font-size: 9px;");
+            row->addWidget(spin);
+            velocity_layout->addLayout(row);
+            return spin;
+        };
+        profile_max_speed_spin_ = add_profile_spin("Max Speed:", 300.0, 100.0, " km/h");
+        profile_lat_acc_spin_ = add_profile_spin("Lateral Acc:", 50.0, 9.8, " m/s²");
+        profile_accel_spin_ = add_profile_spin("Accel:", 50.0, 3.0, " m/s²");
+        profile_decel_spin_ = add_profile_spin("Decel:", 50.0, 6.0, " m/s²");
+        profile_jerk_spin_ = add_profile_spin("Jerk:", 100.0, 10.0, " m/s³");
+        profile_jerk_spin_->setToolTip("Points whose acceleration or jerk exceed these limits are outlined in orange");
+        
+        velocity_layout->addSpacing(3);
+        
+        generate_profile_button_ = new QPushButton("Generate Profile");
+        generate_profile_button_->setMinimumHeight(22);
+        generate_profile_button_->setMaximumHeight(22);
+        generate_profile_button_->setStyleSheet("font-size: 9px; padding: 1px 6px;");
+        velocity_layout->addWidget(generate_profile_button_);
+        
+        auto_profile_checkbox_ = new QCheckBox("Update profile after point edits");
+        auto_profile_checkbox_->setStyleSheet("font-size: 9px;");
+        velocity_layout->addWidget(auto_profile_checkbox_);
+        
         // Clear selectionボタンのシグナル接続
         connect(clear_selection_button_, &QPushButton::clicked, this, &TrajectoryEditor::clearSelection);
         
@@ -757,6 +1411,11 @@ private:
         speed_text_checkbox_->setChecked(false);  // デフォルトは非表示
         display_layout->addWidget(speed_text_checkbox_);
         
+        // 性能表示（ビューの左上に重ねる）
+        performance_hud_checkbox_ = new QCheckBox("Show Performance HUD");
+        performance_hud_checkbox_->setChecked(false);
+        display_layout->addWidget(performance_hud_checkbox_);
+        
         // 座標系設定
         QHBoxLayout* coord_layout = new QHBoxLayout;
         QLabel* coord_label = new QLabel("Coordinate:");
@@ -773,6 +1432,20 @@ private:
         coord_layout->addWidget(coordinate_system_combo_);
         display_layout->addLayout(coord_layout);
         
+        // 点の色分け（速度 / 曲率 / 横加速度）
+        QHBoxLayout* color_mode_layout = new QHBoxLayout;
+        QLabel* color_mode_label = new QLabel("Color by:");
+        color_mode_label->setStyleSheet("font-size: 10px;");
+        color_mode_layout->addWidget(color_mode_label);
+        
+        color_mode_combo_ = new QComboBox;
+        color_mode_combo_->addItem("Speed");
+        color_mode_combo_->addItem("Curvature (red ≥ 0.1 1/m)");
+        color_mode_combo_->addItem("Lateral Accel (red ≥ 9.8 m/s²)");
+        color_mode_combo_->setStyleSheet("font-size: 9px;");
+        color_mode_layout->addWidget(color_mode_combo_);
+        display_layout->addLayout(color_mode_layout);
+        
         right_layout_->addWidget(display_group_);
     }
     
@@ -792,6 +1465,7 @@ private:
         // ファイル操作
         connect(open_button_, &QPushButton::clicked, this, &TrajectoryEditor::openFile);
         connect(open_button_2_, &QPushButton::clicked, this, &TrajectoryEditor::openFile2);
+        connect(open_boundaries_button_, &QPushButton::clicked, this, &TrajectoryEditor::openBoundaries);
         connect(save_button_, &QPushButton::clicked, this, &TrajectoryEditor::saveFile);
         connect(save_button_2_, &QPushButton::clicked, this, &TrajectoryEditor::saveFile2);
         connect(undo_button_, &QPushButton::clicked, this, &TrajectoryEditor::onUndo);
@@ -802,6 +1476,8 @@ private:
         connect(zoom_in_button_, &QPushButton::clicked, this, &TrajectoryEditor::zoomIn);
         connect(zoom_out_button_, &QPushButton::clicked, this, &TrajectoryEditor::zoomOut);
         connect(reset_zoom_button_, &QPushButton::clicked, this, &TrajectoryEditor::resetZoom);
+        connect(record_trace_button_, &QPushButton::toggled, this, &TrajectoryEditor::onRecordTraceToggled);
+        connect(save_trace_button_, &QPushButton::clicked, this, &TrajectoryEditor::onSaveTrace);
         
         // 表示設定
         connect(point_size_spin_, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
@@ -812,20 +1488,47 @@ private:
                 this, &TrajectoryEditor::toggleBoundaries);
         connect(speed_text_checkbox_, &QCheckBox::toggled,
                 this, &TrajectoryEditor::toggleSpeedText);
+        connect(performance_hud_checkbox_, &QCheckBox::toggled,
+                this, &TrajectoryEditor::togglePerformanceHud);
         connect(coordinate_system_combo_, QOverload<int>::of(&QComboBox::currentIndexChanged),
                 this, &TrajectoryEditor::onCoordinateSystemChanged);
+        connect(color_mode_combo_, QOverload<int>::of(&QComboBox::currentIndexChanged),
+                this, &TrajectoryEditor::onColorModeChanged);
         
         // 編集モード
         connect(view_mode_button_, &QPushButton::clicked,
                 this, &TrajectoryEditor::onViewModeClicked);
         connect(add_mode_button_, &QPushButton::clicked,
                 this, &TrajectoryEditor::onAddModeClicked);
+        connect(smooth_brush_button_, &QPushButton::clicked,
+                this, &TrajectoryEditor::onSmoothBrushClicked);
+        connect(delete_range_button_, &QPushButton::clicked,
+                this, &TrajectoryEditor::onDeleteRange);
+        connect(import_range_button_, &QPushButton::clicked,
+                this, &TrajectoryEditor::onImportBlueRange);
+        connect(resample_range_button_, &QPushButton::clicked,
+                this, &TrajectoryEditor::onResampleRange);
+        connect(resample_all_button_, &QPushButton::clicked,
+                this, &TrajectoryEditor::onResampleAll);
+        connect(optimize_raceline_button_, &QPushButton::clicked,
+                this, &TrajectoryEditor::onOptimizeRaceline);
+        connect(offset_range_button_, &QPushButton::clicked,
+                this, &TrajectoryEditor::onOffsetRange);
         
         // 速度編集
         connect(apply_velocity_button_, &QPushButton::clicked,
                 this, &TrajectoryEditor::onApplyVelocity);
         connect(range_velocity_button_, &QPushButton::clicked,
                 this, &TrajectoryEditor::onApplyRangeVelocity);
+        connect(generate_profile_button_, &QPushButton::clicked,
+                this, &TrajectoryEditor::onGenerateVelocityProfile);
+        for (QDoubleSpinBox* spin : {profile_max_speed_spin_, profile_lat_acc_spin_,
+                                     profile_accel_spin_, profile_decel_spin_, profile_jerk_spin_}) {
+            connect(spin, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+                    this, &TrajectoryEditor::onVelocityProfileLimitsChanged);
+        }
+        connect(range_unit_combo_, QOverload<int>::of(&QComboBox::currentIndexChanged),
+                this, &TrajectoryEditor::onRangeUnitChanged);
         
         // 軌跡ビュー
         connect(trajectory_view_, &trajectory_editor::GraphicsTrajectoryView::pointClicked,
@@ -836,11 +1539,18 @@ private:
                 this, &TrajectoryEditor::onPointAdded);
         connect(trajectory_view_, &trajectory_editor::GraphicsTrajectoryView::pointDeleted,
                 this, &TrajectoryEditor::onPointDeleted);
+        connect(trajectory_view_, &trajectory_editor::GraphicsTrajectoryView::brushMoved,
+                this, &TrajectoryEditor::onBrushMoved);
+        connect(trajectory_view_, &trajectory_editor::GraphicsTrajectoryView::brushReleased,
+                this, &TrajectoryEditor::onBrushReleased);
         connect(trajectory_view_, &trajectory_editor::GraphicsTrajectoryView::selectionCleared,
                 this, &TrajectoryEditor::clearSelection);
     }
     
     void updateInfoDisplay() {
+        publishSnapshot();
+        updateClearance();
+        updateKinematics();
         QString info;
         
         // 1つ目の軌跡情報（グリーン系）
@@ -874,6 +1584,44 @@ private:
         info += QString("Velocity:\n[%1, %2] km/h\n\n")
                .arg(min_vel, 0, 'f', 1).arg(max_vel, 0, 'f', 1);
         
+        if (track_clearance_.hasBoundaries() && !trajectory_data_.empty()) {
+            size_t min_index = 0;
+            double min_clearance = track_clearance_.getMinClearance(&min_index);
+            info += QString("Track Clearance:\nMin: %1 m (point %2)\nViolations: %3\n\n")
+                   .arg(min_clearance, 0, 'f', 2).arg(min_index).arg(track_clearance_.countViolations());
+        }
+        
+        if (!trajectory_data_.empty()) {
+            size_t accel_index = 0;
+            size_t decel_index = 0;
+            size_t jerk_index = 0;
+            double max_accel = kinematic_checker_.getMaxAcceleration(&accel_index);
+            double max_decel = kinematic_checker_.getMaxDeceleration(&decel_index);
+            double max_jerk = kinematic_checker_.getMaxAbsJerk(&jerk_index);
+            info += QString("Kinematics:\nMax accel: %1 m/s² (point %2)\nMax decel: %3 m/s² (point %4)\n")
+                   .arg(max_accel, 0, 'f', 2).arg(accel_index).arg(max_decel, 0, 'f', 2).arg(decel_index);
+            info += QString("Max |jerk|: %1 m/s³ (point %2)\nViolations: %3\n\n")
+                   .arg(max_jerk, 0, 'f', 2).arg(jerk_index).arg(kinematic_checker_.countViolations());
+        }
+        
+        if (!trajectory_data_.empty() && trajectory_data_2_.size() >= 2) {
+            comparison_.update(trajectory_data_, trajectory_data_2_);
+            const auto& stats = comparison_.getStatistics();
+            info += QString("Green vs Blue:\nLateral: mean %1 m, RMS %2 m\nMax |lateral|: %3 m (point %4)\n")
+                   .arg(stats.mean_lateral_offset, 0, 'f', 2).arg(stats.rms_lateral_offset, 0, 'f', 2)
+                   .arg(stats.max_abs_lateral_offset, 0, 'f', 2).arg(stats.max_lateral_index);
+            info += QString("Speed delta: mean %1 km/h\nMax |delta|: %2 km/h (point %3)\nLength: %4 m / %5 m\n\n")
+                   .arg(msToKmh(stats.mean_speed_delta), 0, 'f', 1)
+                   .arg(msToKmh(stats.max_abs_speed_delta), 0, 'f', 1).arg(stats.max_speed_delta_index)
+                   .arg(stats.target_length, 0, 'f', 1).arg(stats.reference_length, 0, 'f', 1);
+        }
+        
+        // 自動保存は別スレッドなので、失敗は次の表示更新で知らせる
+        std::string autosave_error = autosave_.isRunning() ? autosave_.getLastError() : std::string();
+        if (!autosave_error.empty()) {
+            info += "Autosave failed:\n" + QString::fromStdString(autosave_error) + "\n\n";
+        }
+        
         info += "Speed Colors:\n";
         info += "• Blue: Low speed\n";
         info += "• Green: Medium speed\n";
@@ -887,15 +1635,44 @@ private:
         info_label_->setText(info);
     }
     
+    // 横方向オフセットの基準線はコース中央線を優先し、境界がなければ青の軌跡を使う
+    void rebuildFrenetFrame() {
+        if (!track_boundaries_.empty()) {
+            frenet_frame_.buildFromBoundaries(track_boundaries_);
+        } else if (trajectory_data_2_.size() >= 2) {
+            frenet_frame_.build(trajectory_data_2_.getPoints());
+        } else {
+            frenet_frame_.clear();
+        }
+    }
+    
+    // 拡張子でCSV・バイナリ・Lanelet2地図を切り替える（OSMは表示範囲のタイルだけを描く）
+    bool loadBoundaries(const std::string& path) {
+        bool loaded = track_boundaries_.loadFromFile(path);
+        
+        // 失敗した場合も前の境界線は消えているので表示と判定を空に合わせる
+        trajectory_view_->setTrackBoundaries(&track_boundaries_);
+        track_clearance_.setBoundaries(track_boundaries_);
+        rebuildFrenetFrame();
+        return loaded;
+    }
+    
     void loadDefaultBoundaries() {
-        if (track_boundaries_.loadFromCSV("data/track_boundaries.csv")) {
-            trajectory_view_->setTrackBoundaries(&track_boundaries_);
+        // 地図があればCSVに変換せずに直接読む（2回目以降は地図の隣のキャッシュから読む）
+        if (QFileInfo::exists("data/lanelet2_map.osm") && loadBoundaries("data/lanelet2_map.osm")) {
+            qDebug() << "Track boundaries loaded from Lanelet2 map";
+        } else if (loadBoundaries("data/track_boundaries.csv")) {
             qDebug() << "Track boundaries loaded successfully";
         } else {
-            qDebug() << "Failed to load track boundaries";
+            qDebug() << "Failed to load track boundaries:" << QString::fromStdString(track_boundaries_.getLastError());
         }
     }
     
+    // 読み込みで読み飛ばした行があればステータスバーに添える
+    static QString skippedRowsText(size_t skipped_rows) {
+        return skipped_rows > 0 ? QString(" (skipped %1 invalid rows)").arg(skipped_rows) : QString();
+    }
+    
     size_t getCurrentSelectedIndex() const {
         return current_selected_index_;
     }
@@ -911,13 +1688,7 @@ private:
             apply_velocity_button_->setEnabled(true);
             
             // 範囲編集の上限を更新
-            size_t max_index = trajectory_data_.size() - 1;
-            range_start_spin_->setMaximum(max_index);
-            range_end_spin_->setMaximum(max_index);
-            
-            if (range_end_spin_->value() == 0) {
-                range_end_spin_->setValue(max_index);
-            }
+            updateRangeLimits();
         } else {
             selected_point_label_->setText("No point selected");
             velocity_spin_->setEnabled(false);
@@ -925,6 +1696,196 @@ private:
         }
     }
     
+    bool isDistanceRangeMode() const {
+        return range_unit_combo_->currentIndex() == 1;
+    }
+    
+    void updateRangeLimits() {
+        if (trajectory_data_.empty()) {
+            return;
+        }
+        
+        double max_value = static_cast<double>(trajectory_data_.size() - 1);
+        if (isDistanceRangeMode()) {
+            arc_length_index_.update(trajectory_data_);
+            max_value = arc_length_index_.getTotalLength();
+        }
+        range_start_spin_->setMaximum(max_value);
+        range_end_spin_->setMaximum(max_value);
+        
+        if (range_end_spin_->value() == 0) {
+            range_end_spin_->setValue(max_value);
+        }
+    }
+    
+    // From/Toの入力を点インデックスに変換（距離モードでは [From, To] m に含まれる点）
+    bool resolveRangeIndices(const trajectory_editor::TrajectoryData& data,
+                             trajectory_editor::ArcLengthIndex& index,
+                             size_t& start_idx, size_t& end_idx) {
+        if (!isDistanceRangeMode()) {
+            start_idx = static_cast<size_t>(range_start_spin_->value());
+            end_idx = static_cast<size_t>(range_end_spin_->value());
+            return true;
+        }
+        
+        if (data.empty()) {
+            QMessageBox::information(this, "Info", "No trajectory data loaded");
+            return false;
+        }
+        
+        index.update(data);
+        double start_s = range_start_spin_->value();
+        double end_s = range_end_spin_->value();
+        start_idx = index.findIndexAtOrAfterDistance(start_s);
+        end_idx = index.findIndexAtDistance(end_s);
+        
+        if (start_s > end_s || start_idx > end_idx) {
+            QMessageBox::information(this, "Info", QString("No points between %1 m and %2 m")
+                                    .arg(start_s, 0, 'f', 1).arg(end_s, 0, 'f', 1));
+            return false;
+        }
+        return true;
+    }
+
+    // [start_idx, end_idx] を等間隔の点に置き換える（1つのコマンドで元に戻せる）
+    void resampleRange(size_t start_idx, size_t end_idx) {
+        try {
+            trajectory_editor::ResampleOptions options;
+            options.spacing = resample_spacing_spin_->value();
+            trajectory_editor::TrajectoryResampler resampler;
+            resampler.setOptions(options);
+            
+            auto points = resampler.resample(trajectory_data_.getPoints(), start_idx, end_idx);
+            size_t old_count = end_idx - start_idx + 1;
+            size_t new_count = points.size();
+            auto command = std::make_unique<trajectory_editor::ResampleCommand>(
+                start_idx, trajectory_data_.getRange(start_idx, end_idx), std::move(points), options.spacing);
+            edit_history_.executeCommand(std::move(command), trajectory_data_);
+            current_selected_index_ = SIZE_MAX;
+            trajectory_view_->clearSelection();
+            trajectory_view_->updateDisplay();
+            updateHistoryButtons();
+            updateVelocityUI();
+            updateInfoDisplay();
+            statusBar()->showMessage(QString("Resampled points %1-%2: %3 -> %4 points at %5 m")
+                                   .arg(start_idx).arg(end_idx).arg(old_count).arg(new_count)
+                                   .arg(options.spacing, 0, 'f', 1), 3000);
+        } catch (const std::exception& e) {
+            QMessageBox::warning(this, "Error", QString("Failed to resample: %1").arg(e.what()));
+        }
+    }
+    
+    trajectory_editor::KinematicLimits readKinematicLimits() const {
+        trajectory_editor::KinematicLimits limits;
+        limits.max_acceleration = profile_accel_spin_->value();
+        limits.max_deceleration = profile_decel_spin_->value();
+        limits.max_jerk = profile_jerk_spin_->value();
+        return limits;
+    }
+
+    trajectory_editor::VelocityLimits readVelocityLimits() const {
+        trajectory_editor::VelocityLimits limits;
+        limits.max_velocity = kmhToMs(profile_max_speed_spin_->value());
+        limits.max_lateral_acceleration = profile_lat_acc_spin_->value();
+        limits.max_acceleration = profile_accel_spin_->value();
+        limits.max_deceleration = profile_decel_spin_->value();
+        return limits;
+    }
+
+    // [start_idx, end_idx] のうち速度が変わる部分だけを1つのコマンドで適用し、変わった点数を返す
+    // （merge_with_last なら直前の編集と一緒に取り消せるようにまとめる）
+    size_t applyVelocityProfile(size_t start_idx, size_t end_idx, bool merge_with_last = false) {
+        const auto& points = trajectory_data_.getPoints();
+        const auto& profile = velocity_profile_.getVelocities();
+        end_idx = std::min(end_idx, std::min(points.size(), profile.size()) - 1);
+
+        auto unchanged = [&](size_t i) { return std::abs(points[i].velocity - profile[i]) < 1e-9; };
+        while (start_idx <= end_idx && unchanged(start_idx)) {
+            ++start_idx;
+        }
+        if (start_idx > end_idx) {
+            return 0;
+        }
+        while (end_idx > start_idx && unchanged(end_idx)) {
+            --end_idx;
+        }
+
+        std::vector<double> old_velocities;
+        old_velocities.reserve(end_idx - start_idx + 1);
+        size_t changed = 0;
+        for (size_t i = start_idx; i <= end_idx; ++i) {
+            old_velocities.push_back(points[i].velocity);
+            changed += unchanged(i) ? 0 : 1;
+        }
+        std::vector<double> new_velocities(profile.begin() + start_idx, profile.begin() + end_idx + 1);
+
+        auto command = std::make_unique<trajectory_editor::SetVelocitiesCommand>(
+            start_idx, std::move(old_velocities), std::move(new_velocities),
+            QString("Apply velocity profile %1-%2").arg(start_idx).arg(end_idx).toStdString());
+        if (merge_with_last) {
+            edit_history_.mergeIntoLastCommand(std::move(command), trajectory_data_);
+        } else {
+            edit_history_.executeCommand(std::move(command), trajectory_data_);
+        }
+        return changed;
+    }
+
+    // 点の編集後、影響範囲だけ速度プロファイルを再計算して適用する（編集と同じ1回で取り消せる）
+    void applyAutoVelocityProfile() {
+        if (!auto_profile_checkbox_->isChecked() || trajectory_data_.empty()) {
+            return;
+        }
+        velocity_profile_.update(trajectory_data_);
+        size_t start_idx = 0;
+        size_t end_idx = 0;
+        if (velocity_profile_.getLastUpdatedRange(start_idx, end_idx)) {
+            applyVelocityProfile(start_idx, end_idx, true);
+        }
+    }
+
+    // 読み込んだファイルの隣の <name>.autosave.trjb に編集中の点列を書き出す
+    // （.trjb なので姿勢列は残らない。点列の復旧用）
+    void startAutosave(const std::string& filepath) {
+        snapshots_.publish(trajectory_data_);
+        autosave_.start(filepath + ".autosave.trjb");
+    }
+    
+    // 編集のたびに触れたチャンクだけをコピーしたスナップショットを発行し、自動保存に知らせる
+    // （書き出しは別スレッドなので、ブラシのドラッグ中に呼んでも編集を待たせない）
+    void publishSnapshot() {
+        if (!autosave_.isRunning()) {
+            return;
+        }
+        snapshots_.publish(trajectory_data_);
+        autosave_.notify();
+    }
+    
+    // 境界からはみ出した点を再評価して強調表示する（動いた点だけ再計算し、
+    // 違反の有無が変わった点だけを描き直す）
+    void updateClearance() {
+        if (!track_clearance_.hasBoundaries() || trajectory_data_.empty()) {
+            track_clearance_.clear();
+            trajectory_view_->updateClearanceViolations({}, {});
+            return;
+        }
+        track_clearance_.update(trajectory_data_);
+        trajectory_view_->updateClearanceViolations(track_clearance_.getViolationFlags(),
+                                                    track_clearance_.getChangedViolations());
+    }
+
+    // 加速度・加加速度の制限を超えた点を再評価して強調表示する（編集点の前後だけ再計算し、
+    // 違反の有無が変わった点だけを描き直す）
+    void updateKinematics() {
+        if (trajectory_data_.empty()) {
+            kinematic_checker_.clear();
+            trajectory_view_->updateKinematicViolations({}, {});
+            return;
+        }
+        kinematic_checker_.update(trajectory_data_);
+        trajectory_view_->updateKinematicViolations(kinematic_checker_.getViolationFlags(),
+                                                    kinematic_checker_.getChangedViolations());
+    }
+
     void updateHistoryButtons() {
         bool can_undo = edit_history_.canUndo();
         bool can_redo = edit_history_.canRedo();
@@ -0,0 +1,127 @@
+#include "boundary_writer.hpp"
+#include <charconv>
+#include <cstring>
+
+namespace trajectory_editor {
+
+namespace {
+
+constexpr size_t WRITE_BUFFER_BYTES = 1 << 20;
+
+// 変換器がこれまで出力していた std::setprecision(12) と同じ桁数
+constexpr int CSV_PRECISION = 12;
+
+constexpr char CSV_HEADER[] = "left_x,left_y,left_z,right_x,right_y,right_z\n";
+
+} // namespace
+
+static_assert(sizeof(BoundaryBinaryHeader) == 16, "Unexpected binary header size");
+
+BoundaryWriter::BoundaryWriter()
+    : file_(nullptr), format_(BOUNDARY_FORMAT_CSV), used_(0), row_count_(0), failed_(false) {}
+
+BoundaryWriter::~BoundaryWriter() {
+    close();
+}
+
+BoundaryFormat BoundaryWriter::formatFromPath(const std::string& filepath) {
+    const std::string suffix = ".trkb";
+    bool is_binary = filepath.size() >= suffix.size() &&
+                     filepath.compare(filepath.size() - suffix.size(), suffix.size(), suffix) == 0;
+    return is_binary ? BOUNDARY_FORMAT_BINARY : BOUNDARY_FORMAT_CSV;
+}
+
+bool BoundaryWriter::open(const std::string& filepath, BoundaryFormat format) {
+    close();
+    file_ = std::fopen(filepath.c_str(), "wb");
+    if (!file_) {
+        return false;
+    }
+    format_ = format;
+    buffer_.resize(WRITE_BUFFER_BYTES);
+    used_ = 0;
+    row_count_ = 0;
+    failed_ = false;
+
+    if (format_ == BOUNDARY_FORMAT_BINARY) {
+        BoundaryBinaryHeader header;
+        std::memcpy(header.magic, "TRKB", 4);
+        header.version = BOUNDARY_BINARY_VERSION;
+        header.row_count = 0;
+        append(reinterpret_cast<const char*>(&header), sizeof(header));
+    } else {
+        append(CSV_HEADER, sizeof(CSV_HEADER) - 1);
+    }
+    return true;
+}
+
+void BoundaryWriter::writeRow(const LanePoint& left, const LanePoint& right) {
+    if (!file_) {
+        return;
+    }
+    if (format_ == BOUNDARY_FORMAT_BINARY) {
+        const double values[6] = {left.x, left.y, left.z, right.x, right.y, right.z};
+        append(reinterpret_cast<const char*>(values), sizeof(values));
+    } else {
+        appendNumber(left.x);
+        append(",", 1);
+        appendNumber(left.y);
+        append(",", 1);
+        appendNumber(left.z);
+        append(",", 1);
+        appendNumber(right.x);
+        append(",", 1);
+        appendNumber(right.y);
+        append(",", 1);
+        appendNumber(right.z);
+        append("\n", 1);
+    }
+    ++row_count_;
+}
+
+bool BoundaryWriter::close() {
+    if (!file_) {
+        return !failed_;
+    }
+    flushBuffer();
+
+    // バイナリ形式はヘッダーの行数を埋める
+    if (format_ == BOUNDARY_FORMAT_BINARY && !failed_) {
+        BoundaryBinaryHeader header;
+        std::memcpy(header.magic, "TRKB", 4);
+        header.version = BOUNDARY_BINARY_VERSION;
+        header.row_count = row_count_;
+        failed_ = std::fseek(file_, 0, SEEK_SET) != 0 ||
+                  std::fwrite(&header, sizeof(header), 1, file_) != 1;
+    }
+
+    failed_ = (std::fclose(file_) != 0) || failed_;
+    file_ = nullptr;
+    buffer_.clear();
+    buffer_.shrink_to_fit();
+    return !failed_;
+}
+
+void BoundaryWriter::append(const char* data, size_t size) {
+    if (used_ + size > buffer_.size()) {
+        flushBuffer();
+    }
+    std::memcpy(buffer_.data() + used_, data, size);
+    used_ += size;
+}
+
+void BoundaryWriter::appendNumber(double value) {
+    // %.12g と同じ表記
+    char text[32];
+    auto result = std::to_chars(text, text + sizeof(text), value, std::chars_format::general, CSV_PRECISION);
+    append(text, static_cast<size_t>(result.ptr - text));
+}
+
+void BoundaryWriter::flushBuffer() {
+    if (used_ > 0 && std::fwrite(buffer_.data(), 1, used_, file_) != used_) {
+        failed_ = true;
+    }
+    used_ = 0;
+}
+
+} // namespace trajectory_editor
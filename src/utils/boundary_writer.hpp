@@ -0,0 +1,59 @@
+#pragma once
+
+#include "lanelet_graph.hpp"
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace trajectory_editor {
+
+// バイナリ境界線形式（.trkb）: ヘッダーの直後に1行あたり左右の (x, y, z) の6つのdoubleが続く
+struct BoundaryBinaryHeader {
+    char magic[4];          // "TRKB"
+    uint32_t version;
+    uint64_t row_count;
+};
+
+constexpr uint32_t BOUNDARY_BINARY_VERSION = 1;
+
+enum BoundaryFormat {
+    BOUNDARY_FORMAT_CSV,     // left_x,left_y,left_z,right_x,right_y,right_z
+    BOUNDARY_FORMAT_BINARY
+};
+
+// 左右の境界線の組を1行ずつ書き出す
+//
+// 行は固定長のバッファにためて、いっぱいになったときだけファイルへ書く（行ごとに
+// フラッシュしない）。バイナリ形式の行数はヘッダーに仮の値を書いておき close() で埋める。
+class BoundaryWriter {
+public:
+    BoundaryWriter();
+    ~BoundaryWriter();
+
+    BoundaryWriter(const BoundaryWriter&) = delete;
+    BoundaryWriter& operator=(const BoundaryWriter&) = delete;
+
+    bool open(const std::string& filepath, BoundaryFormat format);
+    void writeRow(const LanePoint& left, const LanePoint& right);
+    bool close();  // 書き込みのどこかで失敗していれば false
+
+    uint64_t getRowCount() const { return row_count_; }
+
+    // 拡張子から形式を決める（.trkb はバイナリ、それ以外はCSV）
+    static BoundaryFormat formatFromPath(const std::string& filepath);
+
+private:
+    FILE* file_;
+    BoundaryFormat format_;
+    std::vector<char> buffer_;
+    size_t used_;
+    uint64_t row_count_;
+    bool failed_;
+
+    void append(const char* data, size_t size);
+    void appendNumber(double value);
+    void flushBuffer();
+};
+
+} // namespace trajectory_editor
@@ -0,0 +1,290 @@
+#include "lanelet_graph.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+namespace trajectory_editor {
+
+namespace {
+
+// 左右の頂点の弧長の割合がこれより近ければ同じ行にまとめる
+constexpr double FRACTION_EPSILON = 1e-9;
+
+double polylineLength(const std::vector<OSMNode>& nodes) {
+    double length = 0.0;
+    for (size_t i = 1; i < nodes.size(); ++i) {
+        length += std::hypot(nodes[i].local_x - nodes[i - 1].local_x, nodes[i].local_y - nodes[i - 1].local_y);
+    }
+    return length;
+}
+
+// nodes[begin..end]（end を含む）の各頂点の弧長の割合（長さ0なら頂点の番号で等分）
+std::vector<double> arcFractions(const std::vector<OSMNode>& nodes, size_t begin, size_t end) {
+    size_t count = end - begin + 1;
+    std::vector<double> fractions(count, 0.0);
+    for (size_t i = 1; i < count; ++i) {
+        const OSMNode& a = nodes[begin + i - 1];
+        const OSMNode& b = nodes[begin + i];
+        fractions[i] = fractions[i - 1] + std::hypot(b.local_x - a.local_x, b.local_y - a.local_y);
+    }
+    double total = fractions.back();
+    for (size_t i = 1; i < count; ++i) {
+        fractions[i] = total > 0.0 ? fractions[i] / total : static_cast<double>(i) / static_cast<double>(count - 1);
+    }
+    if (count > 1) {
+        fractions.back() = 1.0;
+    }
+    return fractions;
+}
+
+LanePoint toLanePoint(const OSMNode& node) {
+    LanePoint point;
+    point.x = node.local_x;
+    point.y = node.local_y;
+    point.z = node.elevation;
+    return point;
+}
+
+// 頂点 index（割合 t がその頂点なら頂点そのもの、そうでなければ次の頂点との間を補間）
+LanePoint pointAt(const std::vector<OSMNode>& nodes, size_t begin, const std::vector<double>& fractions,
+                  size_t index, double t) {
+    if (index + 1 >= fractions.size() || std::abs(fractions[index] - t) <= FRACTION_EPSILON) {
+        return toLanePoint(nodes[begin + index]);
+    }
+    const OSMNode& a = nodes[begin + index];
+    const OSMNode& b = nodes[begin + index + 1];
+    double ratio = (t - fractions[index]) / (fractions[index + 1] - fractions[index]);
+    LanePoint point;
+    point.x = a.local_x + (b.local_x - a.local_x) * ratio;
+    point.y = a.local_y + (b.local_y - a.local_y) * ratio;
+    point.z = a.elevation + (b.elevation - a.elevation) * ratio;
+    return point;
+}
+
+} // namespace
+
+void LaneletGraph::clear() {
+    lanelets_.clear();
+    successors_.clear();
+    predecessors_.clear();
+}
+
+void LaneletGraph::build(const OSMParser& parser, const LaneletFilter& filter) {
+    clear();
+
+    const StringPool& strings = parser.getStrings();
+    uint32_t type_key = strings.find("type");
+    uint32_t lanelet_value = strings.find("lanelet");
+    uint32_t left_role = strings.find("left");
+    uint32_t right_role = strings.find("right");
+    if (type_key == StringPool::npos || lanelet_value == StringPool::npos) {
+        return;
+    }
+
+    // 絞り込みのタグを文字列プールの番号に直す（地図にない文字列なら一致するlaneletはない）
+    std::vector<OSMTag> required_tags;
+    for (const auto& [key, value] : filter.tags) {
+        OSMTag tag;
+        tag.key = strings.find(key);
+        tag.value = strings.find(value);
+        if (tag.key == StringPool::npos || tag.value == StringPool::npos) {
+            return;
+        }
+        required_tags.push_back(tag);
+    }
+
+    // 左右の境界線を解決する
+    for (const auto& relation : parser.getRelations()) {
+        bool is_lanelet = std::any_of(relation.tags.begin(), relation.tags.end(), [&](const OSMTag& tag) {
+            return tag.key == type_key && tag.value == lanelet_value;
+        });
+        if (!is_lanelet) {
+            continue;
+        }
+        if (!filter.ids.empty() && !std::binary_search(filter.ids.begin(), filter.ids.end(), relation.id)) {
+            continue;
+        }
+        bool has_tags = std::all_of(required_tags.begin(), required_tags.end(), [&](const OSMTag& required) {
+            return std::any_of(relation.tags.begin(), relation.tags.end(), [&](const OSMTag& tag) {
+                return tag.key == required.key && tag.value == required.value;
+            });
+        });
+        if (!has_tags) {
+            continue;
+        }
+
+        Lanelet lanelet;
+        lanelet.id = relation.id;
+        for (const auto& member : relation.members) {
+            bool is_left = member.role == left_role;
+            if ((!is_left && member.role != right_role) ||
+                (member.type != OSM_MEMBER_WAY && member.type != OSM_MEMBER_UNKNOWN)) {
+                continue;
+            }
+            const OSMWay* way = parser.findWay(member.ref);
+            if (!way) {
+                continue;
+            }
+            auto& boundary = is_left ? lanelet.left : lanelet.right;
+            boundary.clear();
+            for (OSMId node_id : way->node_refs) {
+                if (const OSMNode* node = parser.findNode(node_id)) {
+                    boundary.push_back(*node);
+                }
+            }
+        }
+        if (!lanelet.left.empty() && !lanelet.right.empty()) {
+            lanelets_.push_back(std::move(lanelet));
+        }
+    }
+
+    // 左の始点ノードで引ける表を作って後続を探す
+    size_t n = lanelets_.size();
+    successors_.assign(n, {});
+    predecessors_.assign(n, {});
+    std::unordered_map<OSMId, std::vector<size_t>> by_left_start;
+    by_left_start.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        by_left_start[lanelets_[i].left.front().id].push_back(i);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        auto candidates = by_left_start.find(lanelets_[i].left.back().id);
+        if (candidates == by_left_start.end()) {
+            continue;
+        }
+        for (size_t j : candidates->second) {
+            if (j != i && lanelets_[j].right.front().id == lanelets_[i].right.back().id) {
+                successors_[i].push_back(j);
+                predecessors_[j].push_back(i);
+            }
+        }
+    }
+}
+
+std::vector<LaneletCorridor> LaneletGraph::stitch() const {
+    std::vector<LaneletCorridor> corridors;
+    std::vector<bool> visited(lanelets_.size(), false);
+
+    // 継ぎ目は前のlaneletの終点と同じノードなので2つ目以降は先頭の点を飛ばす
+    auto append = [&](LaneletCorridor& corridor, size_t index) {
+        const Lanelet& lanelet = lanelets_[index];
+        bool first = corridor.lanelets.empty();
+        corridor.lanelets.push_back(index);
+        corridor.left_starts.push_back(first ? 0 : corridor.left.size() - 1);
+        corridor.right_starts.push_back(first ? 0 : corridor.right.size() - 1);
+        corridor.left.insert(corridor.left.end(), lanelet.left.begin() + (first ? 0 : 1), lanelet.left.end());
+        corridor.right.insert(corridor.right.end(), lanelet.right.begin() + (first ? 0 : 1), lanelet.right.end());
+    };
+
+    auto walk = [&](size_t start) {
+        LaneletCorridor corridor;
+        size_t current = start;
+        while (true) {
+            visited[current] = true;
+            append(corridor, current);
+
+            const auto& successors = successors_[current];
+            auto next = std::find_if(successors.begin(), successors.end(), [&](size_t s) { return !visited[s]; });
+            if (next == successors.end()) {
+                corridor.closed = std::find(successors.begin(), successors.end(), start) != successors.end();
+                break;
+            }
+            current = *next;
+        }
+        corridor.length = 0.5 * (polylineLength(corridor.left) + polylineLength(corridor.right));
+        corridors.push_back(std::move(corridor));
+    };
+
+    // 前のないlaneletから始め、残ったもの（閉路）はID順に始める
+    for (size_t i = 0; i < lanelets_.size(); ++i) {
+        if (predecessors_[i].empty()) {
+            walk(i);
+        }
+    }
+    for (size_t i = 0; i < lanelets_.size(); ++i) {
+        if (!visited[i]) {
+            walk(i);
+        }
+    }
+
+    std::stable_sort(corridors.begin(), corridors.end(),
+                     [](const LaneletCorridor& a, const LaneletCorridor& b) { return a.length > b.length; });
+    return corridors;
+}
+
+std::vector<std::pair<LanePoint, LanePoint>> LaneletGraph::pairByArcLength(const LaneletCorridor& corridor) {
+    std::vector<std::pair<LanePoint, LanePoint>> rows;
+    pairByArcLength(corridor, [&](const LanePoint& left, const LanePoint& right) { rows.push_back({left, right}); });
+    return rows;
+}
+
+void LaneletGraph::pairByArcLength(const LaneletCorridor& corridor,
+                                   const std::function<void(const LanePoint&, const LanePoint&)>& emit) {
+    const auto& left = corridor.left;
+    const auto& right = corridor.right;
+    size_t count = corridor.lanelets.size();
+
+    for (size_t k = 0; k < count; ++k) {
+        size_t left_begin = corridor.left_starts[k];
+        size_t left_end = k + 1 < count ? corridor.left_starts[k + 1] : left.size() - 1;
+        size_t right_begin = corridor.right_starts[k];
+        size_t right_end = k + 1 < count ? corridor.right_starts[k + 1] : right.size() - 1;
+        std::vector<double> left_fractions = arcFractions(left, left_begin, left_end);
+        std::vector<double> right_fractions = arcFractions(right, right_begin, right_end);
+
+        // 始点の行（2つ目以降のlaneletでは前のlaneletの終点の行と同じなので出さない）
+        size_t i = 0;
+        size_t j = 0;
+        if (k == 0) {
+            emit(toLanePoint(left[left_begin]), toLanePoint(right[right_begin]));
+        }
+
+        // 左右の頂点の割合を小さい順に併合する
+        const double infinity = std::numeric_limits<double>::infinity();
+        while (i + 1 < left_fractions.size() || j + 1 < right_fractions.size()) {
+            double next_left = i + 1 < left_fractions.size() ? left_fractions[i + 1] : infinity;
+            double next_right = j + 1 < right_fractions.size() ? right_fractions[j + 1] : infinity;
+            double t = std::min(next_left, next_right);
+            if (next_left <= t + FRACTION_EPSILON) {
+                ++i;
+            }
+            if (next_right <= t + FRACTION_EPSILON) {
+                ++j;
+            }
+            emit(pointAt(left, left_begin, left_fractions, i, t), pointAt(right, right_begin, right_fractions, j, t));
+        }
+    }
+}
+
+std::vector<OSMId> LaneletGraph::collectBoundaryWays(const OSMParser& parser) {
+    std::vector<OSMId> way_ids;
+    const StringPool& strings = parser.getStrings();
+    uint32_t type_key = strings.find("type");
+    uint32_t lanelet_value = strings.find("lanelet");
+    uint32_t left_role = strings.find("left");
+    uint32_t right_role = strings.find("right");
+    if (type_key == StringPool::npos || lanelet_value == StringPool::npos) {
+        return way_ids;
+    }
+
+    for (const auto& relation : parser.getRelations()) {
+        bool is_lanelet = std::any_of(relation.tags.begin(), relation.tags.end(), [&](const OSMTag& tag) {
+            return tag.key == type_key && tag.value == lanelet_value;
+        });
+        if (!is_lanelet) {
+            continue;
+        }
+        for (const auto& member : relation.members) {
+            if ((member.role == left_role || member.role == right_role) &&
+                (member.type == OSM_MEMBER_WAY || member.type == OSM_MEMBER_UNKNOWN)) {
+                way_ids.push_back(member.ref);
+            }
+        }
+    }
+    std::sort(way_ids.begin(), way_ids.end());
+    way_ids.erase(std::unique(way_ids.begin(), way_ids.end()), way_ids.end());
+    return way_ids;
+}
+
+} // namespace trajectory_editor
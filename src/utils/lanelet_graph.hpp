@@ -0,0 +1,82 @@
+#pragma once
+
+#include "osm_parser.hpp"
+#include <functional>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+namespace trajectory_editor {
+
+// 境界線上の点
+struct LanePoint {
+    double x = 0.0;
+    double y = 0.0;
+    double z = 0.0;
+};
+
+// 左右の境界線が解決できたlanelet
+struct Lanelet {
+    OSMId id = 0;
+    std::vector<OSMNode> left;
+    std::vector<OSMNode> right;
+};
+
+// 前後につながったlaneletの列（左右の境界線は継ぎ目の重複点を除いてつないだもの）
+struct LaneletCorridor {
+    std::vector<size_t> lanelets;       // LaneletGraph::getLanelets() の添字（進行順）
+    std::vector<OSMNode> left;
+    std::vector<OSMNode> right;
+    std::vector<size_t> left_starts;    // 各laneletの left 上の開始位置
+    std::vector<size_t> right_starts;   // 各laneletの right 上の開始位置
+    bool closed = false;                // 最後のlaneletが最初のlaneletにつながる
+    double length = 0.0;                // 左右の境界線の長さの平均 [m]
+};
+
+// build() で使うlaneletの絞り込み（空なら全て）
+struct LaneletFilter {
+    std::vector<OSMId> ids;                                  // relationのID（昇順）
+    std::vector<std::pair<std::string, std::string>> tags;   // キーと値（すべて一致するもの）
+
+    bool empty() const { return ids.empty() && tags.empty(); }
+};
+
+// laneletの接続グラフ
+//
+// lanelet A の左右の境界線の終点が lanelet B の左右の境界線の始点と同じノードIDなら
+// B を A の後続とする。stitch() は前のないlaneletから（残りは閉路として最小IDから）後続を
+// たどり、全laneletを1回ずつ訪れて列に分ける。分岐では未訪問の最初の後続へ進み、
+// 残りの枝は別の列になる。
+class LaneletGraph {
+public:
+    // 構築（type=lanelet のrelationのうち左右の境界線がそろうもの。ID順）
+    void build(const OSMParser& parser, const LaneletFilter& filter = LaneletFilter());
+    void clear();
+
+    // データアクセス
+    size_t size() const { return lanelets_.size(); }
+    const std::vector<Lanelet>& getLanelets() const { return lanelets_; }
+    const std::vector<size_t>& getSuccessors(size_t index) const { return successors_[index]; }
+    const std::vector<size_t>& getPredecessors(size_t index) const { return predecessors_[index]; }
+
+    // 接続をたどって列に分ける（長い順）
+    std::vector<LaneletCorridor> stitch() const;
+
+    // 左右の境界線を弧長の割合で対応付けた点の組（laneletごとに左右どちらかの頂点がある
+    // 割合すべてで1行。継ぎ目の重複は除き、閉じた列は始点の行で閉じる）
+    static std::vector<std::pair<LanePoint, LanePoint>> pairByArcLength(const LaneletCorridor& corridor);
+    // 行を求めるたびに emit に渡す（配列にためずに書き出す場合）
+    static void pairByArcLength(const LaneletCorridor& corridor,
+                                const std::function<void(const LanePoint&, const LanePoint&)>& emit);
+
+    // type=lanelet のrelationが左右の境界線として参照するwayのID（重複なし、昇順）
+    static std::vector<OSMId> collectBoundaryWays(const OSMParser& parser);
+
+private:
+    std::vector<Lanelet> lanelets_;
+    std::vector<std::vector<size_t>> successors_;
+    std::vector<std::vector<size_t>> predecessors_;
+};
+
+} // namespace trajectory_editor
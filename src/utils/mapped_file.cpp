@@ -0,0 +1,80 @@
+#include "mapped_file.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace trajectory_editor {
+
+MappedFile::MappedFile() : data_(nullptr), size_(0), is_empty_file_(false) {}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(other.data_), size_(other.size_), is_empty_file_(other.is_empty_file_) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.is_empty_file_ = false;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(is_empty_file_, other.is_empty_file_);
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string& filepath) {
+    close();
+
+    int fd = ::open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    // 空ファイルはmmapできないので長さ0として扱う
+    if (st.st_size == 0) {
+        ::close(fd);
+        is_empty_file_ = true;
+        return true;
+    }
+
+    void* addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // マッピングはfdを閉じても有効
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+
+    data_ = static_cast<const char*>(addr);
+    size_ = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    is_empty_file_ = false;
+}
+
+void MappedFile::adviseSequential() const {
+    if (data_) {
+        ::madvise(const_cast<char*>(data_), size_, MADV_SEQUENTIAL);
+    }
+}
+
+} // namespace trajectory_editor
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace trajectory_editor {
+
+// 読み取り専用のメモリマップドファイル
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // ファイル操作
+    bool open(const std::string& filepath);
+    void close();
+
+    // データアクセス
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool isOpen() const { return data_ != nullptr || is_empty_file_; }
+
+    // アクセスパターンのヒント（先頭から順に読む場合）
+    void adviseSequential() const;
+
+private:
+    const char* data_;
+    size_t size_;
+    bool is_empty_file_;
+};
+
+} // namespace trajectory_editor
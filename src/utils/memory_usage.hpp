@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace trajectory_editor {
+
+// 文字列がヒープに確保している大きさ（短い文字列はオブジェクト内に収まる）
+inline size_t stringHeapBytes(const std::string& str) {
+    return str.capacity() > std::string().capacity() ? str.capacity() + 1 : 0;
+}
+
+// 文字列の表（行ごとの列）がヒープに確保している大きさ
+inline size_t stringTableBytes(const std::vector<std::vector<std::string>>& rows) {
+    size_t bytes = rows.capacity() * sizeof(std::vector<std::string>);
+    for (const auto& row : rows) {
+        bytes += row.capacity() * sizeof(std::string);
+        for (const auto& column : row) {
+            bytes += stringHeapBytes(column);
+        }
+    }
+    return bytes;
+}
+
+} // namespace trajectory_editor
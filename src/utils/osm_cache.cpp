@@ -0,0 +1,422 @@
+#include "osm_cache.hpp"
+#include "mapped_file.hpp"
+#include "trace.hpp"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+namespace trajectory_editor {
+
+namespace {
+
+constexpr char CACHE_MAGIC[8] = {'O', 'S', 'M', 'C', 'A', 'C', 'H', 'E'};
+constexpr uint32_t CACHE_VERSION = 1;
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t source_hash;
+    uint64_t node_count;
+    uint64_t way_count;
+    uint64_t way_ref_count;
+    uint64_t way_tag_count;
+    uint64_t relation_count;
+    uint64_t member_count;
+    uint64_t relation_tag_count;
+    uint64_t boundary_count;
+    uint64_t string_count;
+    uint64_t string_bytes;
+};
+
+// way・relation の固定長部分（参照・タグは別の配列に続けて並べる）
+struct CacheEntity {
+    int64_t id;
+    uint32_t item_count;   // way は node_refs、relation は members の数
+    uint32_t tag_count;
+};
+
+struct CacheMember {
+    int64_t ref;
+    uint32_t role;
+    uint32_t type;
+};
+
+struct CacheBoundary {
+    double left_x, left_y, left_z;
+    double right_x, right_y, right_z;
+};
+
+static_assert(std::is_trivially_copyable<OSMNode>::value, "OSMNode is written as raw bytes");
+static_assert(std::is_trivially_copyable<OSMTag>::value, "OSMTag is written as raw bytes");
+static_assert(sizeof(CacheHeader) % 8 == 0 && sizeof(OSMNode) % 8 == 0 && sizeof(OSMTag) % 8 == 0,
+              "cache sections keep 8-byte alignment");
+
+// 8バイト単位で混ぜる64ビットハッシュ（変更の検出用。暗号学的な強さはない）
+uint64_t hashBytes(const char* data, size_t size) {
+    const uint64_t k1 = 0x9e3779b97f4a7c15ull;
+    const uint64_t k2 = 0xc2b2ae3d27d4eb4full;
+    uint64_t h = size * k1;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        h ^= word * k2;
+        h = ((h << 31) | (h >> 33)) * k1;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, data + i, size - i);
+    h ^= tail * k2;
+
+    // splitmix64 の最終段
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+    return h ^ (h >> 31);
+}
+
+template <typename T>
+void writeArray(std::ofstream& out, const std::vector<T>& values) {
+    if (!values.empty()) {
+        out.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+    }
+}
+
+// マップしたキャッシュを先頭から読む（範囲外は失敗）
+class CacheReader {
+public:
+    CacheReader(const char* data, size_t size) : pos_(data), end_(data + size) {}
+
+    template <typename T>
+    bool read(uint64_t count, std::vector<T>& values) {
+        if (count > static_cast<uint64_t>(end_ - pos_) / sizeof(T)) {
+            return false;
+        }
+        values.resize(static_cast<size_t>(count));
+        if (count > 0) {
+            std::memcpy(values.data(), pos_, static_cast<size_t>(count) * sizeof(T));
+        }
+        pos_ += count * sizeof(T);
+        return true;
+    }
+
+    bool atEnd() const { return pos_ == end_; }
+
+private:
+    const char* pos_;
+    const char* end_;
+};
+
+template <typename Entity>
+bool isStrictlyIncreasing(const std::vector<Entity>& table) {
+    for (size_t i = 1; i < table.size(); ++i) {
+        if (table[i - 1].id >= table[i].id) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+std::string OSMCache::getCachePath(const std::string& source_path) {
+    return source_path + ".cache";
+}
+
+bool OSMCache::readSourceStamp(const std::string& source_path, bool compute_hash, SourceStamp& stamp) {
+    std::error_code error;
+    auto size = std::filesystem::file_size(source_path, error);
+    if (error) {
+        return false;
+    }
+    auto mtime = std::filesystem::last_write_time(source_path, error);
+    if (error) {
+        return false;
+    }
+    stamp.size = static_cast<uint64_t>(size);
+    stamp.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+    stamp.hash = 0;
+
+    if (compute_hash) {
+        MappedFile file;
+        if (!file.open(source_path)) {
+            return false;
+        }
+        file.adviseSequential();
+        stamp.hash = hashBytes(file.data(), file.size());
+    }
+    return true;
+}
+
+bool OSMCache::load(const std::string& source_path, OSMParser& parser,
+                    std::vector<std::pair<LanePoint, LanePoint>>& boundaries) {
+    TRACE_ZONE("OSMCache::load");
+    SourceStamp stamp;
+    if (!readSourceStamp(source_path, false, stamp)) {
+        status_ = "source not found";
+        return false;
+    }
+
+    MappedFile file;
+    if (!file.open(getCachePath(source_path))) {
+        status_ = "no cache";
+        return false;
+    }
+
+    CacheHeader header;
+    if (file.size() < sizeof(header)) {
+        status_ = "corrupt cache";
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION) {
+        status_ = "unknown cache format";
+        return false;
+    }
+
+    // 大きさが違えば古い。更新時刻だけが違えば内容で判断する
+    if (header.source_size != stamp.size) {
+        status_ = "source size changed";
+        return false;
+    }
+    bool touched = header.source_mtime != stamp.mtime;
+    if (touched) {
+        if (!readSourceStamp(source_path, true, stamp) || header.source_hash != stamp.hash) {
+            status_ = "source content changed";
+            return false;
+        }
+    }
+
+    // 各配列
+    CacheReader reader(file.data() + sizeof(header), file.size() - sizeof(header));
+    std::vector<OSMNode> nodes;
+    std::vector<CacheEntity> way_records, relation_records;
+    std::vector<int64_t> way_refs;
+    std::vector<OSMTag> way_tags, relation_tags;
+    std::vector<CacheMember> members;
+    std::vector<CacheBoundary> boundary_rows;
+    std::vector<uint64_t> string_offsets;
+    std::vector<char> chars;
+    if (!reader.read(header.node_count, nodes) ||
+        !reader.read(header.way_count, way_records) ||
+        !reader.read(header.way_ref_count, way_refs) ||
+        !reader.read(header.way_tag_count, way_tags) ||
+        !reader.read(header.relation_count, relation_records) ||
+        !reader.read(header.member_count, members) ||
+        !reader.read(header.relation_tag_count, relation_tags) ||
+        !reader.read(header.boundary_count, boundary_rows) ||
+        header.string_count == UINT64_MAX ||
+        !reader.read(header.string_count + 1, string_offsets) ||
+        !reader.read(header.string_bytes, chars) ||
+        !reader.atEnd()) {
+        status_ = "corrupt cache";
+        return false;
+    }
+
+    // 文字列プール（同じ順に登録すれば同じ番号になる）
+    StringPool strings;
+    if (string_offsets.front() != 0 || string_offsets.back() != header.string_bytes) {
+        status_ = "corrupt cache";
+        return false;
+    }
+    for (uint64_t i = 0; i < header.string_count; ++i) {
+        uint64_t begin = string_offsets[i];
+        uint64_t end = string_offsets[i + 1];
+        if (begin > end || end > header.string_bytes ||
+            strings.intern(std::string_view(chars.data() + begin, static_cast<size_t>(end - begin))) != i) {
+            status_ = "corrupt cache";
+            return false;
+        }
+    }
+    auto valid_tags = [&](const std::vector<OSMTag>& tags) {
+        for (const auto& tag : tags) {
+            if (tag.key >= header.string_count || tag.value >= header.string_count) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // way と relation を組み立て直す
+    std::vector<OSMWay> ways(way_records.size());
+    size_t ref_pos = 0;
+    size_t tag_pos = 0;
+    for (size_t i = 0; i < way_records.size(); ++i) {
+        const CacheEntity& record = way_records[i];
+        if (record.item_count > way_refs.size() - ref_pos || record.tag_count > way_tags.size() - tag_pos) {
+            status_ = "corrupt cache";
+            return false;
+        }
+        ways[i].id = record.id;
+        ways[i].node_refs.assign(way_refs.begin() + ref_pos, way_refs.begin() + ref_pos + record.item_count);
+        ways[i].tags.assign(way_tags.begin() + tag_pos, way_tags.begin() + tag_pos + record.tag_count);
+        ref_pos += record.item_count;
+        tag_pos += record.tag_count;
+    }
+
+    std::vector<OSMRelation> relations(relation_records.size());
+    size_t member_pos = 0;
+    tag_pos = 0;
+    for (size_t i = 0; i < relation_records.size(); ++i) {
+        const CacheEntity& record = relation_records[i];
+        if (record.item_count > members.size() - member_pos || record.tag_count > relation_tags.size() - tag_pos) {
+            status_ = "corrupt cache";
+            return false;
+        }
+        relations[i].id = record.id;
+        relations[i].members.reserve(record.item_count);
+        for (size_t k = member_pos; k < member_pos + record.item_count; ++k) {
+            const CacheMember& member = members[k];
+            if (member.role >= header.string_count || member.type > OSM_MEMBER_RELATION) {
+                status_ = "corrupt cache";
+                return false;
+            }
+            relations[i].members.push_back({member.ref, member.role, static_cast<OSMMemberType>(member.type)});
+        }
+        relations[i].tags.assign(relation_tags.begin() + tag_pos, relation_tags.begin() + tag_pos + record.tag_count);
+        member_pos += record.item_count;
+        tag_pos += record.tag_count;
+    }
+
+    if (ref_pos != way_refs.size() || member_pos != members.size() || !valid_tags(way_tags) ||
+        !valid_tags(relation_tags) || !isStrictlyIncreasing(nodes) || !isStrictlyIncreasing(ways) ||
+        !isStrictlyIncreasing(relations)) {
+        status_ = "corrupt cache";
+        return false;
+    }
+
+    // 読み込み結果を置き換える
+    parser.nodes_ = std::move(nodes);
+    parser.ways_ = std::move(ways);
+    parser.relations_ = std::move(relations);
+    parser.strings_ = std::move(strings);
+    parser.buildIndexes();
+
+    boundaries.clear();
+    boundaries.reserve(boundary_rows.size());
+    for (const auto& row : boundary_rows) {
+        LanePoint left, right;
+        left.x = row.left_x;
+        left.y = row.left_y;
+        left.z = row.left_z;
+        right.x = row.right_x;
+        right.y = row.right_y;
+        right.z = row.right_z;
+        boundaries.push_back({left, right});
+    }
+
+    // 内容が同じなら更新時刻を書き直して次回のハッシュ計算を省く（失敗しても読み込みは有効）
+    if (touched) {
+        std::fstream out(getCachePath(source_path), std::ios::in | std::ios::out | std::ios::binary);
+        out.seekp(static_cast<std::streamoff>(offsetof(CacheHeader, source_mtime)));
+        out.write(reinterpret_cast<const char*>(&stamp.mtime), sizeof(stamp.mtime));
+    }
+
+    status_ = "loaded";
+    return true;
+}
+
+bool OSMCache::save(const std::string& source_path, const OSMParser& parser,
+                    const std::vector<std::pair<LanePoint, LanePoint>>& boundaries) {
+    TRACE_ZONE("OSMCache::save");
+    SourceStamp stamp;
+    if (!readSourceStamp(source_path, true, stamp)) {
+        status_ = "source not found";
+        return false;
+    }
+
+    // way・relation を平らな配列にする
+    std::vector<CacheEntity> way_records, relation_records;
+    std::vector<int64_t> way_refs;
+    std::vector<OSMTag> way_tags, relation_tags;
+    std::vector<CacheMember> members;
+    way_records.reserve(parser.ways_.size());
+    for (const auto& way : parser.ways_) {
+        way_records.push_back({way.id, static_cast<uint32_t>(way.node_refs.size()), static_cast<uint32_t>(way.tags.size())});
+        way_refs.insert(way_refs.end(), way.node_refs.begin(), way.node_refs.end());
+        way_tags.insert(way_tags.end(), way.tags.begin(), way.tags.end());
+    }
+    relation_records.reserve(parser.relations_.size());
+    for (const auto& relation : parser.relations_) {
+        relation_records.push_back({relation.id, static_cast<uint32_t>(relation.members.size()),
+                                    static_cast<uint32_t>(relation.tags.size())});
+        for (const auto& member : relation.members) {
+            members.push_back({member.ref, member.role, static_cast<uint32_t>(member.type)});
+        }
+        relation_tags.insert(relation_tags.end(), relation.tags.begin(), relation.tags.end());
+    }
+
+    std::vector<CacheBoundary> boundary_rows;
+    boundary_rows.reserve(boundaries.size());
+    for (const auto& [left, right] : boundaries) {
+        boundary_rows.push_back({left.x, left.y, left.z, right.x, right.y, right.z});
+    }
+
+    const StringPool& strings = parser.strings_;
+    std::vector<uint64_t> string_offsets{0};
+    std::string chars;
+    for (uint32_t id = 0; id < strings.size(); ++id) {
+        std::string_view text = strings.get(id);
+        chars.append(text.data(), text.size());
+        string_offsets.push_back(chars.size());
+    }
+
+    CacheHeader header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.source_size = stamp.size;
+    header.source_mtime = stamp.mtime;
+    header.source_hash = stamp.hash;
+    header.node_count = parser.nodes_.size();
+    header.way_count = way_records.size();
+    header.way_ref_count = way_refs.size();
+    header.way_tag_count = way_tags.size();
+    header.relation_count = relation_records.size();
+    header.member_count = members.size();
+    header.relation_tag_count = relation_tags.size();
+    header.boundary_count = boundary_rows.size();
+    header.string_count = strings.size();
+    header.string_bytes = chars.size();
+
+    // 書きかけのキャッシュを読まないよう一時ファイルから置き換える
+    std::string cache_path = getCachePath(source_path);
+    std::string temp_path = cache_path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            status_ = "cannot write cache";
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writeArray(out, parser.nodes_);
+        writeArray(out, way_records);
+        writeArray(out, way_refs);
+        writeArray(out, way_tags);
+        writeArray(out, relation_records);
+        writeArray(out, members);
+        writeArray(out, relation_tags);
+        writeArray(out, boundary_rows);
+        writeArray(out, string_offsets);
+        out.write(chars.data(), static_cast<std::streamsize>(chars.size()));
+        if (!out) {
+            out.close();
+            std::remove(temp_path.c_str());
+            status_ = "cannot write cache";
+            return false;
+        }
+    }
+    if (std::rename(temp_path.c_str(), cache_path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        status_ = "cannot write cache";
+        return false;
+    }
+
+    status_ = "saved";
+    return true;
+}
+
+} // namespace trajectory_editor
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "osm_parser.hpp"
+#include "lanelet_graph.hpp"
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+namespace trajectory_editor {
+
+// 変換元ファイルの識別情報
+struct SourceStamp {
+    uint64_t size = 0;
+    int64_t mtime = 0;     // 更新時刻（ファイルシステムの時刻の生の値）
+    uint64_t hash = 0;     // 内容の64ビットハッシュ
+};
+
+// OSMファイルを読み込んだ結果のバイナリキャッシュ（変換元の隣の "<ファイル名>.cache"）
+//
+// OSMParser のテーブル・文字列プールと、抽出した左右の境界線の組を平らな配列として保存し、
+// 次回はメモリマップして配列へ写すだけで復元する。ヘッダーに変換元の大きさ・更新時刻・
+// 内容のハッシュを持ち、大きさが違えば無効、更新時刻だけが違えば内容のハッシュを計算し
+// 直して一致すれば有効とする（touchしただけのファイルでは読み直さない）。
+// 形式はこのビルドのエンディアンと構造体の並びに依存するので、別の環境とは共有しない。
+class OSMCache {
+public:
+    static std::string getCachePath(const std::string& source_path);
+
+    // 変換元の識別情報（compute_hash が false なら hash は0のまま）
+    static bool readSourceStamp(const std::string& source_path, bool compute_hash, SourceStamp& stamp);
+
+    // キャッシュの読み込み（無い・古い・壊れている場合は false で、理由は getStatus()）
+    bool load(const std::string& source_path, OSMParser& parser,
+              std::vector<std::pair<LanePoint, LanePoint>>& boundaries);
+
+    // キャッシュの書き込み（一時ファイルに書いてから置き換える）
+    bool save(const std::string& source_path, const OSMParser& parser,
+              const std::vector<std::pair<LanePoint, LanePoint>>& boundaries);
+
+    const std::string& getStatus() const { return status_; }
+
+private:
+    std::string status_;
+};
+
+} // namespace trajectory_editor
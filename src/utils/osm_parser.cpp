@@ -1,227 +1,516 @@
 #include "osm_parser.hpp"
-#include <fstream>
-#include <sstream>
-#include <iostream>
-#include <regex>
+#include "mapped_file.hpp"
+#include "xml_tokenizer.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <charconv>
+#include <string_view>
+#include <cstring>
+#include <iterator>
 
 namespace trajectory_editor {
 
-bool OSMParser::loadFromFile(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open file: " << filename << std::endl;
-        return false;
+namespace {
+
+// これより小さいファイルは分割せずに1スレッドで読む
+constexpr size_t MIN_SLICE_BYTES = 1 << 20;
+// スレッドあたりの分割数（要素の偏りをならす）
+constexpr size_t SLICES_PER_WORKER = 4;
+// 境界線抽出で1スレッドが受け持つ最小のlanelet数
+constexpr size_t LANELET_CHUNK = 64;
+// IDの範囲が要素数のこの倍数以内なら検索表を直接引きにする
+constexpr uint64_t DENSE_ID_RATIO = 4;
+
+// 1つの区間から読み出した要素（スレッドごとの作業領域）
+struct DecodedSlice {
+    std::vector<OSMNode> nodes;
+    std::vector<OSMWay> ways;
+    std::vector<OSMRelation> relations;
+    StringPool strings;       // タグ・役割の番号はこの区間のプールのもの
+    bool error = false;
+    size_t error_offset = 0;
+};
+
+bool parseId(std::string_view text, OSMId& value) {
+    const char* end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, value);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+bool parseDouble(std::string_view text, double& value) {
+    const char* end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, value);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+// pos が node・way・relation の開始タグの '<' を指しているか
+bool isEntityStart(const char* pos, const char* end) {
+    static const std::string_view names[] = {"node", "way", "relation"};
+    std::string_view rest(pos + 1, static_cast<size_t>(end - pos - 1));
+    for (const auto& name : names) {
+        if (rest.size() > name.size() && rest.compare(0, name.size(), name) == 0) {
+            char c = rest[name.size()];
+            if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '>' || c == '/') {
+                return true;
+            }
+        }
     }
-    
-    nodes_.clear();
-    ways_.clear();
-    relations_.clear();
-    
-    std::string line;
-    std::string current_section = "";
-    std::string multi_line_content = "";
-    
-    while (std::getline(file, line)) {
-        // 空行やコメント行をスキップ
-        if (line.empty() || line.find("<?xml") != std::string::npos || 
-            line.find("<osm") != std::string::npos || line.find("<MetaInfo") != std::string::npos) {
-            continue;
+    return false;
+}
+
+// 区間の分割位置（要素の開始タグの直前で切る）
+//
+// 分割位置から次の node・way・relation の開始タグを探すだけなので、コメントやCDATAの
+// 中に開始タグのような文字列があるファイルでは setParallel(false) で読むこと。
+std::vector<size_t> findSliceBounds(const char* data, size_t size, size_t slices) {
+    std::vector<size_t> bounds{0};
+    const char* end = data + size;
+    for (size_t k = 1; k < slices; ++k) {
+        size_t target = std::max(size * k / slices, bounds.back());
+        const char* pos = data + target;
+        while (pos < end) {
+            pos = static_cast<const char*>(std::memchr(pos, '<', static_cast<size_t>(end - pos)));
+            if (!pos || isEntityStart(pos, end)) {
+                break;
+            }
+            ++pos;
         }
-        
-        // ノード処理
-        if (line.find("<node id=") != std::string::npos) {
-            current_section = "node";
-            multi_line_content = line;
-            continue;
+        if (!pos || pos >= end) {
+            break;
+        }
+        size_t bound = static_cast<size_t>(pos - data);
+        if (bound > bounds.back()) {
+            bounds.push_back(bound);
+        }
+    }
+    bounds.push_back(size);
+    return bounds;
+}
+
+// [begin, end) の要素を読み出す（元の実装と同じく座標のないnode・参照のないwayは捨てる）
+void decodeSlice(const char* data, size_t begin, size_t end, DecodedSlice& out) {
+    enum Section { SECTION_NONE, SECTION_NODE, SECTION_WAY, SECTION_RELATION };
+    Section section = SECTION_NONE;
+    bool valid = false;       // 現在の要素のIDが読めたか
+    bool has_x = false;
+    bool has_y = false;
+
+    OSMNode node{};
+    OSMWay way;
+    OSMRelation relation;
+    std::string key, value;   // エンティティ展開用（使い回す）
+
+    auto finish = [&]() {
+        if (valid) {
+            if (section == SECTION_NODE && has_x && has_y) {
+                out.nodes.push_back(node);
+            } else if (section == SECTION_WAY && !way.node_refs.empty()) {
+                out.ways.push_back(std::move(way));
+            } else if (section == SECTION_RELATION) {
+                out.relations.push_back(std::move(relation));
+            }
         }
-        
-        // ウェイ処理
-        if (line.find("<way id=") != std::string::npos) {
-            current_section = "way";
-            multi_line_content = line;
+        section = SECTION_NONE;
+    };
+
+    XmlTokenizer tokenizer(data + begin, end - begin);
+    XmlToken token;
+    while (tokenizer.next(token)) {
+        if (token.type == XML_END_ELEMENT) {
+            if ((section == SECTION_NODE && token.name == "node") ||
+                (section == SECTION_WAY && token.name == "way") ||
+                (section == SECTION_RELATION && token.name == "relation")) {
+                finish();
+            }
             continue;
         }
-        
-        // リレーション処理
-        if (line.find("<relation id=") != std::string::npos) {
-            current_section = "relation";
-            multi_line_content = line;
+
+        // 要素の開始
+        if (section == SECTION_NONE) {
+            if (token.name == "node") {
+                section = SECTION_NODE;
+                node = OSMNode{};
+                has_x = has_y = false;
+            } else if (token.name == "way") {
+                section = SECTION_WAY;
+                way = OSMWay{};
+            } else if (token.name == "relation") {
+                section = SECTION_RELATION;
+                relation = OSMRelation{};
+            } else {
+                continue;
+            }
+
+            OSMId id = 0;
+            valid = parseId(token.attribute("id"), id);
+            node.id = way.id = relation.id = id;
+            if (token.self_closing) {
+                finish();
+            }
             continue;
         }
-        
-        // セクション内のコンテンツを蓄積
-        if (!current_section.empty()) {
-            multi_line_content += "\n" + line;
-        }
-        
-        // セクション終了の検出と処理
-        if (line.find("</node>") != std::string::npos) {
-            parseNode(multi_line_content);
-            current_section = "";
-            multi_line_content = "";
-        } else if (line.find("</way>") != std::string::npos) {
-            parseWay(multi_line_content);
-            current_section = "";
-            multi_line_content = "";
-        } else if (line.find("</relation>") != std::string::npos) {
-            parseRelation(multi_line_content);
-            current_section = "";
-            multi_line_content = "";
-        }
-    }
-    
-    std::cout << "OSM file loaded: " << nodes_.size() << " nodes, " 
-              << ways_.size() << " ways, " << relations_.size() << " relations" << std::endl;
-    
-    return true;
-}
 
-void OSMParser::parseNode(const std::string& content) {
-    OSMNode node;
-    
-    // IDを抽出
-    std::string id_str = extractAttribute(content, "id");
-    if (id_str.empty()) return;
-    node.id = std::stoi(id_str);
-    
-    // タグから座標を抽出
-    std::string x_str = extractTagValue(content, "local_x");
-    std::string y_str = extractTagValue(content, "local_y");
-    std::string ele_str = extractTagValue(content, "ele");
-    
-    if (x_str.empty() || y_str.empty()) return;
-    
-    node.local_x = std::stod(x_str);
-    node.local_y = std::stod(y_str);
-    node.elevation = ele_str.empty() ? 0.0 : std::stod(ele_str);
-    
-    nodes_[node.id] = node;
-}
-
-void OSMParser::parseWay(const std::string& content) {
-    OSMWay way;
-    
-    // IDを抽出
-    std::string id_str = extractAttribute(content, "id");
-    if (id_str.empty()) return;
-    way.id = std::stoi(id_str);
-    
-    // ノード参照を抽出
-    std::istringstream iss(content);
-    std::string line;
-    while (std::getline(iss, line)) {
-        if (line.find("<nd ref=") != std::string::npos) {
-            std::string ref_str = extractAttribute(line, "ref");
-            if (!ref_str.empty()) {
-                way.node_refs.push_back(std::stoi(ref_str));
+        // 要素の子
+        if (token.name == "tag") {
+            std::string_view k = token.attribute("k");
+            std::string_view v = token.attribute("v");
+            if (section == SECTION_NODE) {
+                if (k == "local_x") {
+                    has_x = parseDouble(v, node.local_x);
+                } else if (k == "local_y") {
+                    has_y = parseDouble(v, node.local_y);
+                } else if (k == "ele") {
+                    parseDouble(v, node.elevation);
+                }
+            } else if (!k.empty() && !v.empty()) {
+                decodeXmlEntities(k, key);
+                decodeXmlEntities(v, value);
+                uint32_t key_id = out.strings.intern(key);
+                uint32_t value_id = out.strings.intern(value);
+
+                // 同じキーは後の値で上書きする
+                auto& tags = section == SECTION_WAY ? way.tags : relation.tags;
+                auto tag = std::find_if(tags.begin(), tags.end(),
+                                        [key_id](const OSMTag& t) { return t.key == key_id; });
+                if (tag != tags.end()) {
+                    tag->value = value_id;
+                } else {
+                    tags.push_back({key_id, value_id});
+                }
+            }
+        } else if (token.name == "nd" && section == SECTION_WAY) {
+            OSMId ref = 0;
+            if (parseId(token.attribute("ref"), ref)) {
+                way.node_refs.push_back(ref);
             }
-        } else if (line.find("<tag k=") != std::string::npos) {
-            // タグ抽出（将来の拡張用）
-            std::string key = extractAttribute(line, "k");
-            std::string value = extractAttribute(line, "v");
-            if (!key.empty() && !value.empty()) {
-                way.tags[key] = value;
+        } else if (token.name == "member" && section == SECTION_RELATION) {
+            std::string_view role = token.attribute("role");
+            OSMId ref = 0;
+            if (!role.empty() && parseId(token.attribute("ref"), ref)) {
+                std::string_view type = token.attribute("type");
+                OSMMember member;
+                member.ref = ref;
+                decodeXmlEntities(role, value);
+                member.role = out.strings.intern(value);
+                member.type = type == "way" ? OSM_MEMBER_WAY
+                            : type == "node" ? OSM_MEMBER_NODE
+                            : type == "relation" ? OSM_MEMBER_RELATION
+                            : OSM_MEMBER_UNKNOWN;
+                relation.members.push_back(member);
             }
         }
     }
-    
-    if (!way.node_refs.empty()) {
-        ways_[way.id] = way;
+
+    if (tokenizer.hasError()) {
+        out.error = true;
+        out.error_offset = begin + tokenizer.getOffset();
     }
 }
 
-void OSMParser::parseRelation(const std::string& content) {
-    OSMRelation relation;
-    
-    // IDを抽出
-    std::string id_str = extractAttribute(content, "id");
-    if (id_str.empty()) return;
-    relation.id = std::stoi(id_str);
-    
-    // メンバーとタグを抽出
-    std::istringstream iss(content);
-    std::string line;
-    while (std::getline(iss, line)) {
-        if (line.find("<member") != std::string::npos) {
-            std::string role = extractAttribute(line, "role");
-            std::string ref_str = extractAttribute(line, "ref");
-            if (!role.empty() && !ref_str.empty()) {
-                relation.members.push_back({role, std::stoi(ref_str)});
-            }
-        } else if (line.find("<tag k=") != std::string::npos) {
-            std::string key = extractAttribute(line, "k");
-            std::string value = extractAttribute(line, "v");
-            if (!key.empty() && !value.empty()) {
-                relation.tags[key] = value;
+// 区間ごとの結果をファイルの順につなげてIDの昇順に並べる（同じIDは後の要素が残る）
+template <typename Entity, typename Member>
+void mergeSlices(std::vector<DecodedSlice>& slices, Member member, std::vector<Entity>& table) {
+    size_t total = 0;
+    for (const auto& slice : slices) {
+        total += (slice.*member).size();
+    }
+    table.reserve(total);
+    for (auto& slice : slices) {
+        auto& entities = slice.*member;
+        std::move(entities.begin(), entities.end(), std::back_inserter(table));
+        entities.clear();
+        entities.shrink_to_fit();
+    }
+
+    // 出力はふつうID順なので並べ替えが要らないことが多い
+    auto by_id = [](const Entity& a, const Entity& b) { return a.id < b.id; };
+    if (!std::is_sorted(table.begin(), table.end(), by_id)) {
+        std::stable_sort(table.begin(), table.end(), by_id);
+    }
+
+    // 重複したIDは最後のものだけを残す
+    size_t kept = 0;
+    for (size_t i = 0; i < table.size(); ++i) {
+        if (kept > 0 && table[kept - 1].id == table[i].id) {
+            table[kept - 1] = std::move(table[i]);
+        } else {
+            if (kept != i) {
+                table[kept] = std::move(table[i]);
             }
+            ++kept;
+        }
+    }
+    table.resize(kept);
+    table.shrink_to_fit();
+}
+
+// 区間のプールの番号を共通のプールの番号に付け替える
+void remapStrings(DecodedSlice& slice, StringPool& strings) {
+    std::vector<uint32_t> remap(slice.strings.size());
+    for (uint32_t id = 0; id < remap.size(); ++id) {
+        remap[id] = strings.intern(slice.strings.get(id));
+    }
+    for (auto& way : slice.ways) {
+        for (auto& tag : way.tags) {
+            tag.key = remap[tag.key];
+            tag.value = remap[tag.value];
+        }
+    }
+    for (auto& relation : slice.relations) {
+        for (auto& tag : relation.tags) {
+            tag.key = remap[tag.key];
+            tag.value = remap[tag.value];
+        }
+        for (auto& member : relation.members) {
+            member.role = remap[member.role];
+        }
+    }
+    slice.strings.clear();
+}
+
+inline size_t hashId(OSMId id) {
+    // splitmix64 の最終段（連番のIDも表全体に散らす）
+    uint64_t x = static_cast<uint64_t>(id);
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return static_cast<size_t>(x ^ (x >> 31));
+}
+
+} // namespace
+
+OSMParser::OSMParser() : parallel_(true) {}
+
+template <typename Entity>
+void OSMParser::buildIndex(const std::vector<Entity>& table, IdIndex& index) {
+    index.slots.clear();
+    if (table.empty()) {
+        index.direct = false;
+        index.base = 0;
+        return;
+    }
+
+    // テーブルはID順なので範囲は両端で分かる。要素数の DENSE_ID_RATIO 倍以内なら直接引く
+    index.base = table.front().id;
+    uint64_t range = static_cast<uint64_t>(table.back().id) - static_cast<uint64_t>(table.front().id) + 1;
+    index.direct = range <= table.size() * DENSE_ID_RATIO;
+    if (index.direct) {
+        index.slots.assign(static_cast<size_t>(range), 0);
+        for (size_t i = 0; i < table.size(); ++i) {
+            index.slots[static_cast<size_t>(table[i].id - index.base)] = static_cast<uint32_t>(i + 1);
+        }
+        return;
+    }
+
+    // ハッシュ表（使用率は1/2以下）
+    size_t slot_count = 16;
+    while (slot_count < table.size() * 2) {
+        slot_count *= 2;
+    }
+    index.slots.assign(slot_count, 0);
+    size_t mask = slot_count - 1;
+    for (size_t i = 0; i < table.size(); ++i) {
+        size_t slot = hashId(table[i].id) & mask;
+        while (index.slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        index.slots[slot] = static_cast<uint32_t>(i + 1);
+    }
+}
+
+template <typename Entity>
+const Entity* OSMParser::findById(const std::vector<Entity>& table, const IdIndex& index, OSMId id) {
+    if (index.slots.empty()) {
+        return nullptr;
+    }
+    if (index.direct) {
+        uint64_t offset = static_cast<uint64_t>(id) - static_cast<uint64_t>(index.base);
+        if (offset >= index.slots.size() || index.slots[offset] == 0) {
+            return nullptr;
+        }
+        return &table[index.slots[offset] - 1];
+    }
+
+    size_t mask = index.slots.size() - 1;
+    for (size_t slot = hashId(id) & mask;; slot = (slot + 1) & mask) {
+        uint32_t entry = index.slots[slot];
+        if (entry == 0) {
+            return nullptr;
+        }
+        if (table[entry - 1].id == id) {
+            return &table[entry - 1];
+        }
+    }
+}
+
+bool OSMParser::loadFromFile(const std::string& filename) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        last_error_ = "Cannot open: " + filename;
+        return false;
+    }
+    file.adviseSequential();
+    return loadFromBuffer(file.data(), file.size());
+}
+
+bool OSMParser::loadFromBuffer(const char* data, size_t size) {
+    last_error_.clear();
+    nodes_.clear();
+    ways_.clear();
+    relations_.clear();
+    strings_.clear();
+    node_index_ = IdIndex();
+    way_index_ = IdIndex();
+    relation_index_ = IdIndex();
+
+    // 1段目: 要素の境界で分割した区間を並列に読む
+    size_t slice_count = 1;
+    if (parallel_ && getWorkerCount() > 1) {
+        slice_count = std::min(getWorkerCount() * SLICES_PER_WORKER, std::max<size_t>(size / MIN_SLICE_BYTES, 1));
+    }
+    std::vector<size_t> bounds = findSliceBounds(data, size, slice_count);
+    std::vector<DecodedSlice> slices(bounds.size() - 1);
+    parallelFor(0, slices.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            decodeSlice(data, bounds[k], bounds[k + 1], slices[k]);
+        }
+    });
+
+    for (const auto& slice : slices) {
+        if (slice.error) {
+            last_error_ = "OSM parse error at byte " + std::to_string(slice.error_offset);
+            return false;
         }
     }
-    
-    relations_[relation.id] = relation;
+
+    // 文字列の番号はプールが小さいので1スレッドで付け替える（要素の走査だけが区間数倍になる）
+    for (auto& slice : slices) {
+        remapStrings(slice, strings_);
+    }
+
+    // 2段目: node・way・relation のテーブルをそれぞれ別のスレッドで組み立てる
+    parallelFor(0, 3, 1, [&](size_t begin, size_t end) {
+        for (size_t table = begin; table < end; ++table) {
+            if (table == 0) {
+                mergeSlices(slices, &DecodedSlice::nodes, nodes_);
+                buildIndex(nodes_, node_index_);
+            } else if (table == 1) {
+                mergeSlices(slices, &DecodedSlice::ways, ways_);
+                buildIndex(ways_, way_index_);
+            } else {
+                mergeSlices(slices, &DecodedSlice::relations, relations_);
+                buildIndex(relations_, relation_index_);
+            }
+        }
+    });
+    return true;
+}
+
+const OSMNode* OSMParser::findNode(OSMId id) const {
+    return findById(nodes_, node_index_, id);
+}
+
+const OSMWay* OSMParser::findWay(OSMId id) const {
+    return findById(ways_, way_index_, id);
+}
+
+const OSMRelation* OSMParser::findRelation(OSMId id) const {
+    return findById(relations_, relation_index_, id);
 }
 
-std::string OSMParser::extractAttribute(const std::string& line, const std::string& attr) const {
-    std::string pattern = attr + "=\"([^\"]+)\"";
-    std::regex regex(pattern);
-    std::smatch match;
-    
-    if (std::regex_search(line, match, regex)) {
-        return match[1];
+std::string_view OSMParser::findTag(const std::vector<OSMTag>& tags, std::string_view key) const {
+    uint32_t key_id = strings_.find(key);
+    if (key_id == StringPool::npos) {
+        return std::string_view();
+    }
+    for (const auto& tag : tags) {
+        if (tag.key == key_id) {
+            return strings_.get(tag.value);
+        }
     }
-    return "";
+    return std::string_view();
 }
 
-std::string OSMParser::extractTagValue(const std::string& content, const std::string& key) const {
-    std::string pattern = "<tag k=\"" + key + "\" v=\"([^\"]+)\"";
-    std::regex regex(pattern);
-    std::smatch match;
-    
-    if (std::regex_search(content, match, regex)) {
-        return match[1];
+size_t OSMParser::getMemoryUsage() const {
+    size_t bytes = nodes_.capacity() * sizeof(OSMNode) + strings_.getMemoryUsage();
+    bytes += (node_index_.slots.capacity() + way_index_.slots.capacity() + relation_index_.slots.capacity()) *
+             sizeof(uint32_t);
+    bytes += ways_.capacity() * sizeof(OSMWay);
+    for (const auto& way : ways_) {
+        bytes += way.node_refs.capacity() * sizeof(OSMId) + way.tags.capacity() * sizeof(OSMTag);
+    }
+    bytes += relations_.capacity() * sizeof(OSMRelation);
+    for (const auto& relation : relations_) {
+        bytes += relation.members.capacity() * sizeof(OSMMember) + relation.tags.capacity() * sizeof(OSMTag);
     }
-    return "";
+    return bytes;
+}
+
+void OSMParser::buildIndexes() {
+    buildIndex(nodes_, node_index_);
+    buildIndex(ways_, way_index_);
+    buildIndex(relations_, relation_index_);
 }
 
 std::vector<std::pair<std::vector<OSMNode>, std::vector<OSMNode>>> 
 OSMParser::extractTrackBoundaries() const {
     std::vector<std::pair<std::vector<OSMNode>, std::vector<OSMNode>>> boundaries;
-    
+
+    // 比較は文字列プールの番号で行う（どれかが無ければlaneletも無い）
+    uint32_t type_key = strings_.find("type");
+    uint32_t lanelet_value = strings_.find("lanelet");
+    uint32_t left_role = strings_.find("left");
+    uint32_t right_role = strings_.find("right");
+    if (type_key == StringPool::npos || lanelet_value == StringPool::npos) {
+        return boundaries;
+    }
+
     // laneletリレーションを探す
-    for (const auto& [rel_id, relation] : relations_) {
-        if (relation.tags.find("type") != relation.tags.end() && 
-            relation.tags.at("type") == "lanelet") {
-            
-            std::vector<OSMNode> left_boundary, right_boundary;
-            
-            // left と right の境界線を取得
-            for (const auto& [role, ref_id] : relation.members) {
-                if (ways_.find(ref_id) != ways_.end()) {
-                    const OSMWay& way = ways_.at(ref_id);
-                    std::vector<OSMNode> boundary_nodes;
-                    
-                    // wayのノードを順番に取得
-                    for (int node_id : way.node_refs) {
-                        if (nodes_.find(node_id) != nodes_.end()) {
-                            boundary_nodes.push_back(nodes_.at(node_id));
-                        }
-                    }
-                    
-                    if (role == "left") {
-                        left_boundary = boundary_nodes;
-                    } else if (role == "right") {
-                        right_boundary = boundary_nodes;
+    std::vector<const OSMRelation*> lanelets;
+    for (const auto& relation : relations_) {
+        for (const auto& tag : relation.tags) {
+            if (tag.key == type_key && tag.value == lanelet_value) {
+                lanelets.push_back(&relation);
+                break;
+            }
+        }
+    }
+
+    // laneletごとに left と right の境界線を並列に解決する
+    std::vector<std::pair<std::vector<OSMNode>, std::vector<OSMNode>>> resolved(lanelets.size());
+    size_t min_chunk = parallel_ ? LANELET_CHUNK : lanelets.size();
+    parallelFor(0, lanelets.size(), min_chunk, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            auto& [left_boundary, right_boundary] = resolved[i];
+            for (const auto& member : lanelets[i]->members) {
+                bool is_left = member.role == left_role;
+                if ((!is_left && member.role != right_role) ||
+                    (member.type != OSM_MEMBER_WAY && member.type != OSM_MEMBER_UNKNOWN)) {
+                    continue;
+                }
+                const OSMWay* way = findWay(member.ref);
+                if (!way) {
+                    continue;
+                }
+
+                // wayのノードを順番に取得
+                std::vector<OSMNode> boundary_nodes;
+                boundary_nodes.reserve(way->node_refs.size());
+                for (OSMId node_id : way->node_refs) {
+                    if (const OSMNode* node = findNode(node_id)) {
+                        boundary_nodes.push_back(*node);
                     }
                 }
+                (is_left ? left_boundary : right_boundary) = std::move(boundary_nodes);
             }
-            
-            if (!left_boundary.empty() && !right_boundary.empty()) {
-                boundaries.push_back({left_boundary, right_boundary});
-            }
+        }
+    });
+
+    for (auto& boundary : resolved) {
+        if (!boundary.first.empty() && !boundary.second.empty()) {
+            boundaries.push_back(std::move(boundary));
         }
     }
-    
-    std::cout << "Found " << boundaries.size() << " lane boundaries" << std::endl;
     return boundaries;
 }
 
-} // namespace trajectory_editor
\ No newline at end of file
+} // namespace trajectory_editor
@@ -1,54 +1,126 @@
 #pragma once
 
+#include "string_pool.hpp"
 #include <string>
+#include <string_view>
 #include <vector>
-#include <map>
-#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
 
 namespace trajectory_editor {
 
+// OSMの要素ID（Lanelet2の出力は32ビットに収まらないことがある）
+using OSMId = int64_t;
+
+// タグ（キーと値は OSMParser の文字列プールの番号）
+struct OSMTag {
+    uint32_t key;
+    uint32_t value;
+};
+
 struct OSMNode {
-    int id;
+    OSMId id;
     double local_x;
     double local_y;
     double elevation;
 };
 
 struct OSMWay {
-    int id;
-    std::vector<int> node_refs;
-    std::map<std::string, std::string> tags;
+    OSMId id;
+    std::vector<OSMId> node_refs;
+    std::vector<OSMTag> tags;
+};
+
+enum OSMMemberType : uint8_t {
+    OSM_MEMBER_UNKNOWN,
+    OSM_MEMBER_NODE,
+    OSM_MEMBER_WAY,
+    OSM_MEMBER_RELATION,
+};
+
+struct OSMMember {
+    OSMId ref;
+    uint32_t role;        // 文字列プールの番号
+    OSMMemberType type;
 };
 
 struct OSMRelation {
-    int id;
-    std::vector<std::pair<std::string, int>> members; // (role, ref_id)
-    std::map<std::string, std::string> tags;
+    OSMId id;
+    std::vector<OSMMember> members;
+    std::vector<OSMTag> tags;
 };
 
+// Lanelet2形式のOSMファイルの読み込み
+//
+// ファイルをメモリマップして XmlTokenizer で走査し、node・way・relation を直接テーブルへ
+// 組み立てる（正規表現や要素ごとの文字列の連結はしない）。並列モードでは大きなファイルを
+// 要素の境界で区間に分けてスレッドごとに読み、ファイルの順にテーブルへまとめるので、
+// 結果は1スレッドで読んだ場合と同じになる。
+//
+// テーブルはIDの昇順に並べた配列（同じIDはファイルの後の要素が残る）。検索表は配列の
+// 添字だけを持ち、IDが密なら (ID - 最小ID) で直接引き、疎ならオープンアドレス法の
+// ハッシュ表で引く（キーの比較は配列側のIDで行う）。
+// タグのキー・値とメンバーの役割は文字列プールにまとめ、要素には番号だけを持たせる。
 class OSMParser {
 public:
+    OSMParser();
+
+    // 並列モード（既定で有効。無効にすると1スレッドで先頭から読む）
+    void setParallel(bool enabled) { parallel_ = enabled; }
+    bool isParallel() const { return parallel_; }
+
+    // 読み込み（失敗した理由は getLastError()。結果の件数は呼び出し側がテーブルから報告する）
     bool loadFromFile(const std::string& filename);
-    
-    // データアクセス
-    const std::unordered_map<int, OSMNode>& getNodes() const { return nodes_; }
-    const std::unordered_map<int, OSMWay>& getWays() const { return ways_; }
-    const std::unordered_map<int, OSMRelation>& getRelations() const { return relations_; }
-    
+    bool loadFromBuffer(const char* data, size_t size);  // メモリ上のXML
+    const std::string& getLastError() const { return last_error_; }
+
+    // データアクセス（IDの昇順）
+    const std::vector<OSMNode>& getNodes() const { return nodes_; }
+    const std::vector<OSMWay>& getWays() const { return ways_; }
+    const std::vector<OSMRelation>& getRelations() const { return relations_; }
+    const StringPool& getStrings() const { return strings_; }
+
+    // IDによる検索（見つからなければ nullptr）
+    const OSMNode* findNode(OSMId id) const;
+    const OSMWay* findWay(OSMId id) const;
+    const OSMRelation* findRelation(OSMId id) const;
+
+    // タグの値（見つからなければ空のビュー）
+    std::string_view findTag(const std::vector<OSMTag>& tags, std::string_view key) const;
+
+    // おおよその使用メモリ [byte]
+    size_t getMemoryUsage() const;
+
     // 境界線抽出
-    std::vector<std::pair<std::vector<OSMNode>, std::vector<OSMNode>>> 
+    std::vector<std::pair<std::vector<OSMNode>, std::vector<OSMNode>>>
     extractTrackBoundaries() const;
 
 private:
-    std::unordered_map<int, OSMNode> nodes_;
-    std::unordered_map<int, OSMWay> ways_;
-    std::unordered_map<int, OSMRelation> relations_;
-    
-    void parseNode(const std::string& line);
-    void parseWay(const std::string& line);
-    void parseRelation(const std::string& line);
-    std::string extractAttribute(const std::string& line, const std::string& attr) const;
-    std::string extractTagValue(const std::string& line, const std::string& key) const;
+    bool parallel_;
+    std::string last_error_;
+    std::vector<OSMNode> nodes_;
+    std::vector<OSMWay> ways_;
+    std::vector<OSMRelation> relations_;
+    StringPool strings_;
+
+    // IDの検索表（slots は添字 + 1。0 は空き）
+    struct IdIndex {
+        bool direct = false;     // true: slots[id - base]、false: 大きさ2のべき乗のハッシュ表
+        OSMId base = 0;
+        std::vector<uint32_t> slots;
+    };
+    IdIndex node_index_;
+    IdIndex way_index_;
+    IdIndex relation_index_;
+
+    // テーブルをキャッシュから直接復元する
+    friend class OSMCache;
+    void buildIndexes();
+
+    template <typename Entity>
+    static void buildIndex(const std::vector<Entity>& table, IdIndex& index);
+    template <typename Entity>
+    static const Entity* findById(const std::vector<Entity>& table, const IdIndex& index, OSMId id);
 };
 
-} // namespace trajectory_editor
\ No newline at end of file
+} // namespace trajectory_editor
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "trace.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace trajectory_editor {
+
+namespace detail {
+
+// このスレッドから呼ぶ parallelFor が使えるスレッド数（0なら制限なし）
+inline size_t& threadBudget() {
+    thread_local size_t budget = 0;
+    return budget;
+}
+
+// スコープの間だけスレッド数の上限を設定する
+class ThreadBudgetScope {
+public:
+    explicit ThreadBudgetScope(size_t budget) : saved_(threadBudget()) { threadBudget() = budget; }
+    ~ThreadBudgetScope() { threadBudget() = saved_; }
+
+    ThreadBudgetScope(const ThreadBudgetScope&) = delete;
+    ThreadBudgetScope& operator=(const ThreadBudgetScope&) = delete;
+
+private:
+    size_t saved_;
+};
+
+} // namespace detail
+
+// 並列処理に使うスレッド数（取得できない環境では1）
+//
+// parallelFor の中から呼ぶと、外側のスレッド数で割った残りを返す（入れ子でスレッドが掛け算で増えない）。
+inline size_t getWorkerCount() {
+    if (detail::threadBudget() > 0) {
+        return detail::threadBudget();
+    }
+    unsigned int count = std::thread::hardware_concurrency();
+    return count > 0 ? count : 1;
+}
+
+// [begin, end) を連続したチャンクに分けて body(chunk_begin, chunk_end) を並列実行する
+//
+// min_chunk 未満の要素数しかない場合やスレッドが1つの場合は呼び出し元で実行する。
+// body の中の parallelFor はスレッド数を各スレッドで分け合う（ファイル単位で並列化した処理の
+// 中で点ごとに並列化しても、合計はおよそ getWorkerCount() に収まる）。
+// body で投げられた例外は全スレッドの終了後に呼び出し元で再送出する。
+template <typename Body>
+void parallelFor(size_t begin, size_t end, size_t min_chunk, Body&& body) {
+    if (begin >= end) {
+        return;
+    }
+    size_t count = end - begin;
+    size_t available = getWorkerCount();
+    size_t workers = std::min(available, count / std::max<size_t>(min_chunk, 1));
+    if (workers <= 1) {
+        body(begin, end);
+        return;
+    }
+    size_t nested_budget = std::max<size_t>(1, available / workers);
+
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> errors(workers);
+    threads.reserve(workers - 1);
+
+    size_t chunk = (count + workers - 1) / workers;
+    for (size_t w = 1; w < workers; ++w) {
+        size_t chunk_begin = begin + w * chunk;
+        size_t chunk_end = std::min(end, chunk_begin + chunk);
+        if (chunk_begin >= chunk_end) {
+            break;
+        }
+        threads.emplace_back([&body, &errors, w, chunk_begin, chunk_end, nested_budget]() {
+            TRACE_ZONE("parallelFor chunk");
+            detail::ThreadBudgetScope budget(nested_budget);
+            try {
+                body(chunk_begin, chunk_end);
+            } catch (...) {
+                errors[w] = std::current_exception();
+            }
+        });
+    }
+
+    // 先頭チャンクは呼び出し元のスレッドで処理する
+    try {
+        TRACE_ZONE("parallelFor chunk");
+        detail::ThreadBudgetScope budget(nested_budget);
+        body(begin, std::min(end, begin + chunk));
+    } catch (...) {
+        errors[0] = std::current_exception();
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+} // namespace trajectory_editor
@@ -0,0 +1,88 @@
+#include "string_pool.hpp"
+
+namespace trajectory_editor {
+
+namespace {
+
+constexpr size_t INITIAL_SLOTS = 64;
+
+} // namespace
+
+StringPool::StringPool() : offsets_{0}, slots_(INITIAL_SLOTS, 0) {}
+
+uint64_t StringPool::hash(std::string_view text) {
+    // FNV-1a
+    uint64_t value = 14695981039346656037ull;
+    for (char c : text) {
+        value ^= static_cast<unsigned char>(c);
+        value *= 1099511628211ull;
+    }
+    return value;
+}
+
+uint32_t StringPool::find(std::string_view text) const {
+    size_t mask = slots_.size() - 1;
+    for (size_t slot = hash(text) & mask;; slot = (slot + 1) & mask) {
+        uint32_t entry = slots_[slot];
+        if (entry == 0) {
+            return npos;
+        }
+        if (get(entry - 1) == text) {
+            return entry - 1;
+        }
+    }
+}
+
+uint32_t StringPool::intern(std::string_view text) {
+    size_t mask = slots_.size() - 1;
+    size_t slot = hash(text) & mask;
+    for (;; slot = (slot + 1) & mask) {
+        uint32_t entry = slots_[slot];
+        if (entry == 0) {
+            break;
+        }
+        if (get(entry - 1) == text) {
+            return entry - 1;
+        }
+    }
+
+    uint32_t id = static_cast<uint32_t>(size());
+    chars_.append(text.data(), text.size());
+    offsets_.push_back(chars_.size());
+    slots_[slot] = id + 1;
+
+    // 使用率が1/2を超えたら表を広げる
+    if (size() * 2 > slots_.size()) {
+        rehash(slots_.size() * 2);
+    }
+    return id;
+}
+
+std::string_view StringPool::get(uint32_t id) const {
+    return std::string_view(chars_.data() + offsets_[id], offsets_[id + 1] - offsets_[id]);
+}
+
+size_t StringPool::getMemoryUsage() const {
+    return chars_.capacity() + offsets_.capacity() * sizeof(size_t) + slots_.capacity() * sizeof(uint32_t);
+}
+
+void StringPool::clear() {
+    chars_.clear();
+    offsets_.assign(1, 0);
+    slots_.assign(INITIAL_SLOTS, 0);
+}
+
+void StringPool::rehash(size_t slot_count) {
+    std::vector<uint32_t> slots(slot_count, 0);
+    size_t mask = slot_count - 1;
+    for (uint32_t id = 0; id < size(); ++id) {
+        size_t slot = hash(get(id)) & mask;
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = id + 1;
+    }
+    slots_.swap(slots);
+}
+
+} // namespace trajectory_editor
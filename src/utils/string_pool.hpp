@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace trajectory_editor {
+
+// 文字列の重複をまとめて32ビットの番号で扱うプール
+//
+// 文字はすべて1つの連続したバッファに並べ、検索はオープンアドレス法のハッシュ表で行う。
+// 同じ文字列には常に同じ番号が返るので、比較は番号どうしで済む。get() が返すビューは
+// 次の intern() でバッファが伸びると無効になる。
+class StringPool {
+public:
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    StringPool();
+
+    uint32_t intern(std::string_view text);       // 未登録なら追加して番号を返す
+    uint32_t find(std::string_view text) const;   // 未登録なら npos
+    std::string_view get(uint32_t id) const;
+
+    size_t size() const { return offsets_.size() - 1; }
+    size_t getMemoryUsage() const;  // バッファと表の確保済みバイト数
+    void clear();
+
+private:
+    std::string chars_;
+    std::vector<size_t> offsets_;   // 番号 i の文字列は [offsets_[i], offsets_[i + 1])
+    std::vector<uint32_t> slots_;   // 番号 + 1（0 は空き）。大きさは2のべき乗
+
+    static uint64_t hash(std::string_view text);
+    void rehash(size_t slot_count);
+};
+
+} // namespace trajectory_editor
@@ -0,0 +1,195 @@
+#include "trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+namespace trajectory_editor {
+
+namespace {
+
+// スレッドごとに残す区間の数の既定値（1区間24バイト）
+constexpr size_t DEFAULT_BUFFER_CAPACITY = 65536;
+
+struct ExportedEvent {
+    const char* name;
+    uint64_t begin_ns;
+    uint64_t end_ns;
+    uint32_t lane;
+};
+
+void writeJsonString(std::ostream& out, const char* str) {
+    out << '"';
+    for (const char* p = str; *p != '\0'; ++p) {
+        unsigned char c = static_cast<unsigned char>(*p);
+        if (c == '"' || c == '\\') {
+            out << '\\' << *p;
+        } else if (c < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out << escaped;
+        } else {
+            out << *p;
+        }
+    }
+    out << '"';
+}
+
+} // namespace
+
+std::atomic<bool> TraceRecorder::enabled_{false};
+
+TraceRecorder::TraceRecorder() : capacity_(DEFAULT_BUFFER_CAPACITY) {}
+
+TraceRecorder& TraceRecorder::instance() {
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+uint64_t TraceRecorder::now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void TraceRecorder::record(const char* name, uint64_t begin_ns, uint64_t end_ns) {
+    // スレッドの終了時にバッファを返す（記録済みの区間は書き出せるように残す）
+    struct Slot {
+        ThreadBuffer* buffer = nullptr;
+        ~Slot() {
+            if (buffer) {
+                TraceRecorder::instance().releaseBuffer(buffer);
+            }
+        }
+    };
+    thread_local Slot slot;
+    if (!slot.buffer) {
+        slot.buffer = acquireBuffer();
+    }
+
+    ThreadBuffer& buffer = *slot.buffer;
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    size_t capacity = capacity_.load(std::memory_order_relaxed);
+    if (buffer.events.size() < capacity) {
+        buffer.events.push_back({name, begin_ns, end_ns});
+    } else if (capacity > 0) {
+        buffer.events[buffer.next] = {name, begin_ns, end_ns};
+        buffer.next = (buffer.next + 1) % capacity;
+        ++buffer.dropped;
+    }
+}
+
+TraceRecorder::ThreadBuffer* TraceRecorder::acquireBuffer() {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    if (!free_buffers_.empty()) {
+        ThreadBuffer* buffer = free_buffers_.back();
+        free_buffers_.pop_back();
+        return buffer;
+    }
+    buffers_.push_back(std::make_unique<ThreadBuffer>());
+    buffers_.back()->lane = static_cast<uint32_t>(buffers_.size());
+    return buffers_.back().get();
+}
+
+void TraceRecorder::releaseBuffer(ThreadBuffer* buffer) {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    free_buffers_.push_back(buffer);
+}
+
+void TraceRecorder::setBufferCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    capacity_.store(capacity, std::memory_order_relaxed);
+    for (auto& buffer : buffers_) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        buffer->events.clear();
+        buffer->events.shrink_to_fit();
+        buffer->next = 0;
+        buffer->dropped = 0;
+    }
+}
+
+void TraceRecorder::clear() {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    for (auto& buffer : buffers_) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        buffer->events.clear();
+        buffer->next = 0;
+        buffer->dropped = 0;
+    }
+}
+
+size_t TraceRecorder::getEventCount() const {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    size_t count = 0;
+    for (const auto& buffer : buffers_) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        count += buffer->events.size();
+    }
+    return count;
+}
+
+uint64_t TraceRecorder::getDroppedCount() const {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    uint64_t dropped = 0;
+    for (const auto& buffer : buffers_) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        dropped += buffer->dropped;
+    }
+    return dropped;
+}
+
+bool TraceRecorder::writeChromeTrace(const std::string& filepath) {
+    // 記録中のスレッドを長く止めないよう、バッファごとに写してから書き出す
+    std::vector<ExportedEvent> events;
+    uint64_t dropped = 0;
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        for (const auto& buffer : buffers_) {
+            std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+            const auto& ring = buffer->events;
+            for (size_t k = 0; k < ring.size(); ++k) {
+                const Event& event = ring[(buffer->next + k) % ring.size()];
+                events.push_back({event.name, event.begin_ns, event.end_ns, buffer->lane});
+            }
+            dropped += buffer->dropped;
+        }
+    }
+
+    // 区間は終了時に記録されるので、開始時刻順（同時なら外側の区間が先）に並べ直す
+    std::sort(events.begin(), events.end(), [](const ExportedEvent& a, const ExportedEvent& b) {
+        if (a.begin_ns != b.begin_ns) {
+            return a.begin_ns < b.begin_ns;
+        }
+        return a.end_ns > b.end_ns;
+    });
+    uint64_t origin_ns = events.empty() ? 0 : events.front().begin_ns;
+
+    std::ofstream file(filepath);
+    if (!file) {
+        last_error_ = "Cannot open " + filepath + " for writing";
+        return false;
+    }
+
+    file << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":" << dropped << "},\n"
+         << "\"traceEvents\":[";
+    char timing[64];
+    for (size_t i = 0; i < events.size(); ++i) {
+        const auto& event = events[i];
+        file << (i == 0 ? "\n" : ",\n") << "{\"name\":";
+        writeJsonString(file, event.name);
+        // ts・dur はマイクロ秒
+        std::snprintf(timing, sizeof(timing), "\"ts\":%.3f,\"dur\":%.3f",
+                      static_cast<double>(event.begin_ns - origin_ns) / 1000.0,
+                      static_cast<double>(event.end_ns - event.begin_ns) / 1000.0);
+        file << ",\"cat\":\"trajectory\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.lane << "," << timing << "}";
+    }
+    file << "\n]}\n";
+
+    if (!file) {
+        last_error_ = "Failed to write " + filepath;
+        return false;
+    }
+    last_error_.clear();
+    return true;
+}
+
+} // namespace trajectory_editor
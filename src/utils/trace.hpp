@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace trajectory_editor {
+
+// 処理区間の記録（Chrome trace形式のJSONに書き出し、chrome://tracing や Perfetto で開く）
+//
+// TRACE_ZONE("名前") を置いたスコープの開始・終了時刻を、スレッドごとのリングバッファに
+// 記録する。バッファが一杯になると古い区間から上書きするので、直近の様子が残る。
+// 記録は既定で止めてあり、止めている間の TRACE_ZONE は有効フラグを1回読むだけで済む。
+// TRAJECTORY_ENABLE_TRACE を定義しないビルドでは TRACE_ZONE は何も生成しない。
+// 区間の名前は書き出すまで有効な文字列（文字列リテラル）を渡す。
+class TraceRecorder {
+public:
+    static TraceRecorder& instance();
+
+    // TRACE_ZONE が組み込まれたビルドか
+    static constexpr bool isAvailable() {
+#ifdef TRAJECTORY_ENABLE_TRACE
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // 記録の開始・停止（止めても記録済みの区間は残る）
+    static void setEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    static bool isEnabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    // スレッドごとに残す区間の数（変えると記録済みの区間は消える）
+    void setBufferCapacity(size_t capacity);
+    size_t getBufferCapacity() const { return capacity_.load(std::memory_order_relaxed); }
+
+    void clear();
+    size_t getEventCount() const;
+    uint64_t getDroppedCount() const;  // 上書きで失った区間の数
+
+    // Chrome trace形式で書き出す（失敗した理由は getLastError()）
+    bool writeChromeTrace(const std::string& filepath);
+    const std::string& getLastError() const { return last_error_; }
+
+    // 区間の記録（TraceZone から呼ぶ。時刻は steady_clock の値 [ns]）
+    static uint64_t now();
+    void record(const char* name, uint64_t begin_ns, uint64_t end_ns);
+
+private:
+    struct Event {
+        const char* name;
+        uint64_t begin_ns;
+        uint64_t end_ns;
+    };
+
+    // スレッドのリングバッファ（終了したスレッドのバッファは次に記録するスレッドが引き継ぐ）
+    struct ThreadBuffer {
+        std::mutex mutex;
+        std::vector<Event> events;
+        size_t next = 0;       // 一杯になった後に次に上書きする位置
+        uint64_t dropped = 0;
+        uint32_t lane = 0;     // 書き出すときのスレッド番号
+    };
+
+    TraceRecorder();
+
+    ThreadBuffer* acquireBuffer();
+    void releaseBuffer(ThreadBuffer* buffer);
+
+    static std::atomic<bool> enabled_;
+    std::atomic<size_t> capacity_;
+    mutable std::mutex buffers_mutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+    std::vector<ThreadBuffer*> free_buffers_;
+    std::string last_error_;
+};
+
+// スコープの開始から終了までを1つの区間として記録する
+class TraceZone {
+public:
+    explicit TraceZone(const char* name)
+        : name_(name)
+        , active_(TraceRecorder::isEnabled())
+        , begin_ns_(active_ ? TraceRecorder::now() : 0) {}
+
+    ~TraceZone() {
+        if (active_) {
+            TraceRecorder::instance().record(name_, begin_ns_, TraceRecorder::now());
+        }
+    }
+
+    TraceZone(const TraceZone&) = delete;
+    TraceZone& operator=(const TraceZone&) = delete;
+
+private:
+    const char* name_;
+    bool active_;
+    uint64_t begin_ns_;
+};
+
+} // namespace trajectory_editor
+
+#ifdef TRAJECTORY_ENABLE_TRACE
+#define TRAJECTORY_TRACE_CONCAT_INNER(a, b) a##b
+#define TRAJECTORY_TRACE_CONCAT(a, b) TRAJECTORY_TRACE_CONCAT_INNER(a, b)
+#define TRACE_ZONE(name) \
+    ::trajectory_editor::TraceZone TRAJECTORY_TRACE_CONCAT(trace_zone_, __LINE__)(name)
+#else
+#define TRACE_ZONE(name) ((void)0)
+#endif
@@ -0,0 +1,269 @@
+#include "xml_tokenizer.hpp"
+#include <cstring>
+#include <cstdint>
+
+namespace trajectory_editor {
+
+namespace {
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+inline bool isNameEnd(char c) {
+    return isSpace(c) || c == '=' || c == '>' || c == '/' || c == '"' || c == '\'';
+}
+
+inline bool startsWith(const char* pos, const char* end, const char* pattern, size_t length) {
+    return static_cast<size_t>(end - pos) >= length && std::memcmp(pos, pattern, length) == 0;
+}
+
+void appendUtf8(uint32_t code, std::string& out) {
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    } else if (code < 0x800) {
+        out += static_cast<char>(0xC0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        out += static_cast<char>(0xE0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code >> 18));
+        out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+
+} // namespace
+
+std::string_view XmlToken::attribute(std::string_view attr_name) const {
+    for (const auto& attr : attributes) {
+        if (attr.name == attr_name) {
+            return attr.value;
+        }
+    }
+    return std::string_view();
+}
+
+XmlTokenizer::XmlTokenizer(const char* data, size_t size)
+    : begin_(data), pos_(data), end_(data + size), error_(false) {}
+
+bool XmlTokenizer::next(XmlToken& token) {
+    while (!error_ && pos_ < end_) {
+        // テキストは読み飛ばして次の '<' へ
+        const char* open = static_cast<const char*>(std::memchr(pos_, '<', static_cast<size_t>(end_ - pos_)));
+        if (!open) {
+            pos_ = end_;
+            return false;
+        }
+        pos_ = open;
+
+        if (startsWith(pos_, end_, "<?", 2)) {
+            if (!skipPast("?>", 2)) return false;
+        } else if (startsWith(pos_, end_, "<!--", 4)) {
+            if (!skipPast("-->", 3)) return false;
+        } else if (startsWith(pos_, end_, "<![CDATA[", 9)) {
+            if (!skipPast("]]>", 3)) return false;
+        } else if (startsWith(pos_, end_, "<!", 2)) {
+            // DOCTYPE（内部サブセットの [ ] を考慮して対応する '>' まで）
+            int depth = 0;
+            for (pos_ += 2; pos_ < end_; ++pos_) {
+                if (*pos_ == '[') {
+                    ++depth;
+                } else if (*pos_ == ']') {
+                    --depth;
+                } else if (*pos_ == '>' && depth <= 0) {
+                    break;
+                }
+            }
+            if (pos_ >= end_) {
+                error_ = true;
+                return false;
+            }
+            ++pos_;
+        } else if (startsWith(pos_, end_, "</", 2)) {
+            return readEndElement(token);
+        } else {
+            return readStartElement(token);
+        }
+    }
+    return false;
+}
+
+bool XmlTokenizer::skipPast(const char* pattern, size_t length) {
+    for (const char* p = pos_; p + length <= end_; ++p) {
+        p = static_cast<const char*>(std::memchr(p, pattern[0], static_cast<size_t>(end_ - p)));
+        if (!p || p + length > end_) {
+            break;
+        }
+        if (std::memcmp(p, pattern, length) == 0) {
+            pos_ = p + length;
+            return true;
+        }
+    }
+    error_ = true;
+    pos_ = end_;
+    return false;
+}
+
+void XmlTokenizer::skipSpaces() {
+    while (pos_ < end_ && isSpace(*pos_)) {
+        ++pos_;
+    }
+}
+
+std::string_view XmlTokenizer::readName() {
+    const char* start = pos_;
+    while (pos_ < end_ && !isNameEnd(*pos_)) {
+        ++pos_;
+    }
+    return std::string_view(start, static_cast<size_t>(pos_ - start));
+}
+
+bool XmlTokenizer::readStartElement(XmlToken& token) {
+    ++pos_;  // '<'
+    token.type = XML_START_ELEMENT;
+    token.attributes.clear();
+    token.self_closing = false;
+    token.name = readName();
+    if (token.name.empty()) {
+        error_ = true;
+        return false;
+    }
+
+    while (true) {
+        skipSpaces();
+        if (pos_ >= end_) {
+            break;
+        }
+        if (*pos_ == '>') {
+            ++pos_;
+            return true;
+        }
+        if (*pos_ == '/') {
+            if (pos_ + 1 < end_ && pos_[1] == '>') {
+                pos_ += 2;
+                token.self_closing = true;
+                return true;
+            }
+            break;
+        }
+
+        // name="value" または name='value'
+        XmlAttribute attr;
+        attr.name = readName();
+        skipSpaces();
+        if (attr.name.empty() || pos_ >= end_ || *pos_ != '=') {
+            break;
+        }
+        ++pos_;
+        skipSpaces();
+        if (pos_ >= end_ || (*pos_ != '"' && *pos_ != '\'')) {
+            break;
+        }
+        char quote = *pos_++;
+        const char* close = static_cast<const char*>(std::memchr(pos_, quote, static_cast<size_t>(end_ - pos_)));
+        if (!close) {
+            break;
+        }
+        attr.value = std::string_view(pos_, static_cast<size_t>(close - pos_));
+        pos_ = close + 1;
+        token.attributes.push_back(attr);
+    }
+
+    error_ = true;
+    return false;
+}
+
+bool XmlTokenizer::readEndElement(XmlToken& token) {
+    pos_ += 2;  // "</"
+    token.type = XML_END_ELEMENT;
+    token.attributes.clear();
+    token.self_closing = false;
+    token.name = readName();
+    skipSpaces();
+    if (token.name.empty() || pos_ >= end_ || *pos_ != '>') {
+        error_ = true;
+        return false;
+    }
+    ++pos_;
+    return true;
+}
+
+void decodeXmlEntities(std::string_view value, std::string& out) {
+    out.clear();
+    size_t amp = value.find('&');
+    if (amp == std::string_view::npos) {
+        out.assign(value.data(), value.size());
+        return;
+    }
+
+    out.reserve(value.size());
+    size_t pos = 0;
+    while (amp != std::string_view::npos) {
+        out.append(value.data() + pos, amp - pos);
+        size_t semicolon = value.find(';', amp);
+        if (semicolon == std::string_view::npos) {
+            pos = amp;
+            break;
+        }
+        std::string_view entity = value.substr(amp + 1, semicolon - amp - 1);
+        bool known = true;
+        if (entity == "lt") {
+            out += '<';
+        } else if (entity == "gt") {
+            out += '>';
+        } else if (entity == "amp") {
+            out += '&';
+        } else if (entity == "quot") {
+            out += '"';
+        } else if (entity == "apos") {
+            out += '\'';
+        } else if (entity.size() > 1 && entity[0] == '#') {
+            // 文字参照（&#NNN; と &#xHH;）
+            bool hex = entity[1] == 'x' || entity[1] == 'X';
+            uint32_t code = 0;
+            size_t digits = 0;
+            for (size_t i = hex ? 2 : 1; i < entity.size(); ++i, ++digits) {
+                char c = entity[i];
+                uint32_t digit;
+                if (c >= '0' && c <= '9') {
+                    digit = static_cast<uint32_t>(c - '0');
+                } else if (hex && c >= 'a' && c <= 'f') {
+                    digit = static_cast<uint32_t>(c - 'a' + 10);
+                } else if (hex && c >= 'A' && c <= 'F') {
+                    digit = static_cast<uint32_t>(c - 'A' + 10);
+                } else {
+                    known = false;
+                    break;
+                }
+                code = code * (hex ? 16 : 10) + digit;
+                if (code > 0x10FFFF) {
+                    known = false;
+                    break;
+                }
+            }
+            if (known && digits > 0) {
+                appendUtf8(code, out);
+            } else {
+                known = false;
+            }
+        } else {
+            known = false;
+        }
+
+        // 未知のエンティティはそのまま残す
+        if (!known) {
+            out.append(value.data() + amp, semicolon - amp + 1);
+        }
+        pos = semicolon + 1;
+        amp = value.find('&', pos);
+    }
+    if (pos < value.size()) {
+        out.append(value.data() + pos, value.size() - pos);
+    }
+}
+
+} // namespace trajectory_editor
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+namespace trajectory_editor {
+
+// XMLの属性（値はエンティティ未展開のまま元のバッファを指す）
+struct XmlAttribute {
+    std::string_view name;
+    std::string_view value;
+};
+
+// 要素の開始・終了
+enum XmlTokenType {
+    XML_START_ELEMENT,   // <name ...> または <name .../>（self_closing）
+    XML_END_ELEMENT,     // </name>
+};
+
+struct XmlToken {
+    XmlTokenType type = XML_START_ELEMENT;
+    std::string_view name;
+    std::vector<XmlAttribute> attributes;   // XML_START_ELEMENT のみ
+    bool self_closing = false;
+
+    // 属性の検索（見つからなければ空のビュー）
+    std::string_view attribute(std::string_view attr_name) const;
+};
+
+// メモリ上のXMLを先頭から順に読むプルトークナイザ
+//
+// 要素の開始・終了だけを返し、XML宣言・コメント・CDATA・DOCTYPE・テキストは読み飛ばす。
+// 名前と属性値は元のバッファを指す string_view なので、バッファはトークナイザより長く
+// 生きている必要がある。トークンの属性配列は next() のたびに使い回すので、要素ごとの
+// メモリ確保は最初の数回だけで済む。整形式でない入力では hasError() が true になり
+// next() は false を返す。
+class XmlTokenizer {
+public:
+    XmlTokenizer(const char* data, size_t size);
+
+    // 次の要素トークン（終端またはエラーで false）
+    bool next(XmlToken& token);
+
+    bool hasError() const { return error_; }
+    size_t getOffset() const { return static_cast<size_t>(pos_ - begin_); }  // 現在の読み取り位置
+
+private:
+    const char* begin_;
+    const char* pos_;
+    const char* end_;
+    bool error_;
+
+    bool skipPast(const char* pattern, size_t length);
+    void skipSpaces();
+    std::string_view readName();
+    bool readStartElement(XmlToken& token);
+    bool readEndElement(XmlToken& token);
+};
+
+// &lt; &amp; &#..; などを展開する（& を含まない値はそのままコピー）
+void decodeXmlEntities(std::string_view value, std::string& out);
+
+} // namespace trajectory_editor
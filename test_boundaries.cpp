@@ -1,4 +1,8 @@
 #include "src/core/track_boundaries.hpp"
+#include "src/utils/boundary_writer.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 
 int main() {
@@ -36,5 +40,24 @@ int main() {
         return 1;
     }
     
+    // 行数を偽った .trkb は確保する前に弾く（例外を投げずに false）
+    const std::string forged_path = (std::filesystem::temp_directory_path() / "forged_boundaries.trkb").string();
+    for (uint64_t claimed : {uint64_t(1) << 61, uint64_t(1) << 32, uint64_t(2)}) {
+        trajectory_editor::BoundaryBinaryHeader header;
+        std::memcpy(header.magic, "TRKB", 4);
+        header.version = trajectory_editor::BOUNDARY_BINARY_VERSION;
+        header.row_count = claimed;
+        std::ofstream forged(forged_path, std::ios::binary | std::ios::trunc);
+        forged.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        forged.write(std::string(48, '\0').data(), 48);  // 1行分
+        forged.close();
+        if (boundaries.loadFromFile(forged_path) || boundaries.getLastError().empty()) {
+            std::cout << "❌ Accepted a .trkb header claiming " << claimed << " rows" << std::endl;
+            return 1;
+        }
+    }
+    std::filesystem::remove(forged_path);
+    std::cout << "✅ Rejected .trkb headers that claim more rows than the file holds" << std::endl;
+    
     return 0;
 }
\ No newline at end of file
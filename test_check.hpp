@@ -0,0 +1,30 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+// テスト実行ファイル共通の判定と結果の出力
+//
+// check は失敗しても止めずに数え、main の最後で finish を返す（失敗があれば ctest で落ちる）。
+namespace test_check {
+
+inline int failures = 0;
+
+inline void check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cout << "❌ " << message << std::endl;
+        ++failures;
+    }
+}
+
+// 失敗数を出して終了コードを返す（name は "history check(s) failed" のように失敗数の後ろに付く）
+inline int finish(const std::string& name, const std::string& success_message) {
+    if (failures > 0) {
+        std::cout << "❌ " << failures << " " << name << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "✅ " << success_message << std::endl;
+    return 0;
+}
+
+} // namespace test_check
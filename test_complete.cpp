@@ -7,7 +7,7 @@ int main() {
     
     // 軌跡データテスト
     trajectory_editor::TrajectoryData trajectory;
-    bool traj_success = trajectory.loadFromCSV("data/raceline_base.csv");
+    bool traj_success = trajectory.loadFromCSV("data/raceline_awsim_15km.csv");
     
     // 境界線データテスト
     trajectory_editor::TrackBoundaries boundaries;
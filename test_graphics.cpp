@@ -5,7 +5,7 @@ int main() {
     trajectory_editor::TrajectoryData data;
     
     std::cout << "Testing CSV load..." << std::endl;
-    bool success = data.loadFromCSV("data/raceline_base.csv");
+    bool success = data.loadFromCSV("data/raceline_awsim_15km.csv");
     
     if (success) {
         std::cout << "✅ Success! Loaded " << data.size() << " points" << std::endl;
@@ -17,7 +17,7 @@ int main() {
         data.getVelocityRange(min_vel, max_vel);
         
         std::cout << "📍 Bounds: X[" << min_x << ", " << max_x << "] Y[" << min_y << ", " << max_y << "]" << std::endl;
-        std::cout << "🚗 Velocity: [" << min_vel << ", " << max_vel << "] km/h" << std::endl;
+        std::cout << "🚗 Velocity: [" << min_vel << ", " << max_vel << "] m/s" << std::endl;
         
         std::cout << "\n🎯 Graphics trajectory editor ready!" << std::endl;
         std::cout << "Run: ./build/trajectory_editor" << std::endl;
@@ -0,0 +1,196 @@
+#include "src/core/edit_history.hpp"
+#include "src/core/trajectory_resampler.hpp"
+#include "test_check.hpp"
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace trajectory_editor;
+
+using test_check::check;
+
+// 点列と8列形式の姿勢列（文字列のまま）を比べる
+struct State {
+    std::vector<TrajectoryPoint> points;
+    std::vector<std::vector<std::string>> extra_columns;
+
+    bool operator==(const State& other) const {
+        if (points.size() != other.points.size() || extra_columns != other.extra_columns) {
+            return false;
+        }
+        for (size_t i = 0; i < points.size(); ++i) {
+            const auto& a = points[i];
+            const auto& b = other.points[i];
+            if (a.x != b.x || a.y != b.y || a.z != b.z || a.velocity != b.velocity) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+State capture(const TrajectoryData& data) {
+    State state;
+    state.points = data.getPoints();
+    if (!data.empty()) {
+        state.extra_columns = data.getExtraColumns(0, data.size() - 1);
+    }
+    return state;
+}
+
+// 8列形式（姿勢列は to_string では出ない桁数にして、取り消しで丸めていないことを確かめる）
+bool writeExtendedCSV(const std::string& path, size_t count, double y_offset) {
+    std::ofstream file(path);
+    file << "x,y,z,x_quat,y_quat,z_quat,w_quat,speed\n";
+    for (size_t i = 0; i < count; ++i) {
+        double t = static_cast<double>(i);
+        file << t * 2.0 << "," << y_offset + std::sin(0.3 * t) << ",0.0,"
+             << "0.0,0.0,0.12345678901234" << i << ",0.98765432109876" << i << "," << 5.0 + 0.1 * t << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+// 実行 → 取り消し → やり直し → 取り消しで、前後の状態がそれぞれ元に戻るか
+void checkRoundTrip(const std::string& name, EditHistory& history, TrajectoryData& data,
+                    std::unique_ptr<EditCommand> command) {
+    State before = capture(data);
+    history.executeCommand(std::move(command), data);
+    State after = capture(data);
+    check(!(after == before), name + ": execute changes the data");
+    history.undo(data);
+    check(capture(data) == before, name + ": undo restores points and orientation columns");
+    history.redo(data);
+    check(capture(data) == after, name + ": redo reproduces the edit");
+    history.undo(data);
+    check(capture(data) == before, name + ": second undo");
+}
+
+} // namespace
+
+int main() {
+    std::cout << "🔍 Testing edit command undo/redo round trips..." << std::endl;
+    namespace fs = std::filesystem;
+    const fs::path dir = fs::temp_directory_path() / "trajectory_history_test";
+    fs::create_directories(dir);
+    const std::string green_path = (dir / "green.csv").string();
+    const std::string blue_path = (dir / "blue.csv").string();
+
+    TrajectoryData data;
+    TrajectoryData blue;
+    check(writeExtendedCSV(green_path, 40, 0.0) && data.loadFromCSV(green_path) && data.hasOrientation(),
+          "load 8-column green trajectory");
+    check(writeExtendedCSV(blue_path, 20, 3.0) && blue.loadFromCSV(blue_path), "load 8-column blue trajectory");
+    const State initial = capture(data);
+    EditHistory history;
+
+    const auto& points = data.getPoints();
+    checkRoundTrip("MovePoint", history, data,
+                   std::make_unique<MovePointCommand>(5, points[5].x, points[5].y, 100.0, 200.0));
+    checkRoundTrip("AddPoint", history, data, std::make_unique<AddPointCommand>(3, TrajectoryPoint(1.5, 0.5, 0, 7)));
+    checkRoundTrip("RemovePoint", history, data, std::make_unique<RemovePointCommand>(4, points[4]));
+    checkRoundTrip("ChangeVelocity", history, data,
+                   std::make_unique<ChangeVelocityCommand>(7, points[7].velocity, 12.0));
+
+    std::vector<double> old_velocities;
+    for (size_t i = 2; i <= 6; ++i) {
+        old_velocities.push_back(points[i].velocity);
+    }
+    checkRoundTrip("ChangeRangeVelocity", history, data,
+                   std::make_unique<ChangeRangeVelocityCommand>(2, 6, old_velocities, 9.0));
+    checkRoundTrip("SetVelocities", history, data,
+                   std::make_unique<SetVelocitiesCommand>(2, old_velocities, std::vector<double>(5, 3.0)));
+
+    std::vector<TrajectoryPoint> inserted = {TrajectoryPoint(0.5, 9, 0, 4), TrajectoryPoint(0.7, 9, 0, 4)};
+    checkRoundTrip("InsertRange", history, data, std::make_unique<InsertRangeCommand>(2, inserted));
+    checkRoundTrip("SpliceRange", history, data, std::make_unique<SpliceRangeCommand>(10, blue, 3, 8));
+    checkRoundTrip("RemoveRange", history, data, std::make_unique<RemoveRangeCommand>(3, data.getRange(3, 12)));
+    checkRoundTrip("ReplaceRange", history, data,
+                   std::make_unique<ReplaceRangeCommand>(2, data.getRange(2, 5), inserted, "Replace"));
+
+    ResampleOptions options;
+    options.spacing = 0.7;
+    TrajectoryResampler resampler;
+    resampler.setOptions(options);
+    checkRoundTrip("Resample", history, data,
+                   std::make_unique<ResampleCommand>(8, data.getRange(8, 20), resampler.resample(points, 8, 20),
+                                                     options.spacing));
+
+    // 上限を超える点数になる spacing は確保する前に断る
+    options.spacing = 1e-9;
+    resampler.setOptions(options);
+    bool rejected = false;
+    try {
+        resampler.resample(points, 0, data.size() - 1);
+    } catch (const std::length_error&) {
+        rejected = true;
+    }
+    check(rejected, "resample refuses a spacing beyond max_points");
+
+    // 8列形式どうしの挿入は挿入元の姿勢列をそのまま持ってくる
+    history.executeCommand(std::make_unique<SpliceRangeCommand>(0, blue, 0, 1), data);
+    check(data.getExtraColumns(0, 1) == blue.getExtraColumns(0, 1), "splice copies the source orientation columns");
+    history.undo(data);
+
+    std::vector<std::unique_ptr<EditCommand>> parts;
+    parts.push_back(std::make_unique<MovePointCommand>(1, points[1].x, points[1].y, -5.0, -5.0));
+    parts.push_back(std::make_unique<RemoveRangeCommand>(20, data.getRange(20, 25)));
+    checkRoundTrip("Composite", history, data, std::make_unique<CompositeCommand>(std::move(parts)));
+
+    // 直前のコマンドとまとめたものは1回の取り消しで両方戻る
+    State before_merge = capture(data);
+    history.executeCommand(std::make_unique<MovePointCommand>(9, points[9].x, points[9].y, 50.0, 50.0), data);
+    history.mergeIntoLastCommand(std::make_unique<ChangeVelocityCommand>(9, points[9].velocity, 1.0), data);
+    history.undo(data);
+    check(capture(data) == before_merge, "merged commands undo together");
+
+    // 乱択の編集列を全部取り消すと読み込んだ状態に戻る
+    history.clear();
+    history.setMaxHistorySize(1000);
+    check(capture(data) == initial, "all round trips left the data unchanged");
+    std::mt19937 rng(7);
+    for (int step = 0; step < 200; ++step) {
+        size_t n = data.size();
+        size_t i = rng() % n;
+        const auto& point = data.getPoints()[i];
+        switch (rng() % 5) {
+        case 0:
+            history.executeCommand(std::make_unique<MovePointCommand>(i, point.x, point.y, point.x + 1, point.y), data);
+            break;
+        case 1:
+            history.executeCommand(std::make_unique<AddPointCommand>(i, TrajectoryPoint(point.x, point.y + 1, 0, 3)),
+                                   data);
+            break;
+        case 2:
+            if (n <= 10) {
+                continue;
+            }
+            history.executeCommand(std::make_unique<RemovePointCommand>(i, point), data);
+            break;
+        case 3:
+            history.executeCommand(std::make_unique<SpliceRangeCommand>(i, blue, 2, 4), data);
+            break;
+        default:
+            if (i + 4 >= n) {
+                continue;
+            }
+            history.executeCommand(std::make_unique<RemoveRangeCommand>(i, data.getRange(i, i + 3)), data);
+            break;
+        }
+    }
+    while (history.canUndo()) {
+        history.undo(data);
+    }
+    check(capture(data) == initial, "undoing a random edit sequence restores the loaded trajectory");
+
+    fs::remove_all(dir);
+
+    return test_check::finish("history", "Every edit command undoes and redoes losslessly");
+}
@@ -0,0 +1,421 @@
+#include "src/core/arc_length_index.hpp"
+#include "src/core/frenet_frame.hpp"
+#include "src/core/max_tree.hpp"
+#include "src/core/pentadiagonal_solver.hpp"
+#include "src/core/raceline_optimizer.hpp"
+#include "src/core/segment_index.hpp"
+#include "src/core/track_clearance.hpp"
+#include "test_check.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace trajectory_editor;
+
+using test_check::check;
+
+constexpr double PI = 3.14159265358979323846;
+
+// 半径 radius の周回（最後の点は始点と同じ）に振幅 wobble の揺れを足したもの
+std::vector<TrajectoryPoint> makeLap(size_t count, double radius, double wobble) {
+    std::vector<TrajectoryPoint> points;
+    for (size_t i = 0; i < count; ++i) {
+        double theta = 2.0 * PI * static_cast<double>(i) / static_cast<double>(count);
+        double r = radius + wobble * std::sin(7.0 * theta);
+        points.emplace_back(r * std::cos(theta), r * std::sin(theta), 0.0, 10.0);
+    }
+    points.push_back(points.front());
+    return points;
+}
+
+// 点から線分への最短距離（総当たりの基準）
+double distanceToSegment(double x, double y, const TrajectoryPoint& a, const TrajectoryPoint& b) {
+    double ex = b.x - a.x, ey = b.y - a.y;
+    double length2 = ex * ex + ey * ey;
+    double t = length2 > 0.0 ? std::clamp(((x - a.x) * ex + (y - a.y) * ey) / length2, 0.0, 1.0) : 0.0;
+    return std::hypot(x - (a.x + t * ex), y - (a.y + t * ey));
+}
+
+// 半直線と線分の交点までの距離（交わらなければ +inf）
+double raySegment(double x, double y, double dx, double dy, const TrajectoryPoint& a, const TrajectoryPoint& b) {
+    double ex = b.x - a.x, ey = b.y - a.y;
+    double denom = dx * ey - dy * ex;
+    if (std::abs(denom) < 1e-15) {
+        return std::numeric_limits<double>::infinity();
+    }
+    double qx = a.x - x, qy = a.y - y;
+    double t = (qx * ey - qy * ex) / denom;
+    double u = (qx * dy - qy * dx) / denom;
+    if (t < 0.0 || u < 0.0 || u > 1.0) {
+        return std::numeric_limits<double>::infinity();
+    }
+    return t;
+}
+
+void testArcLengthIndex(std::mt19937& rng) {
+    std::uniform_real_distribution<double> coordinate(-50.0, 50.0);
+    TrajectoryData data;
+    for (size_t i = 0; i < 500; ++i) {
+        data.addPoint(TrajectoryPoint(coordinate(rng), coordinate(rng), 0.0, 5.0));
+    }
+
+    ArcLengthIndex index;
+    index.build(data);
+    auto matchesBruteForce = [&]() {
+        const auto& points = data.getPoints();
+        std::vector<double> distances(points.size(), 0.0);
+        for (size_t i = 1; i < points.size(); ++i) {
+            distances[i] = distances[i - 1] + std::hypot(points[i].x - points[i - 1].x, points[i].y - points[i - 1].y);
+        }
+        if (index.size() != points.size() || std::abs(index.getTotalLength() - distances.back()) > 1e-6) {
+            return false;
+        }
+        for (size_t i = 0; i < points.size(); ++i) {
+            if (std::abs(index.getDistanceAt(i) - distances[i]) > 1e-6) {
+                return false;
+            }
+        }
+        std::uniform_real_distribution<double> station(0.0, distances.back());
+        for (int query = 0; query < 200; ++query) {
+            double s = station(rng);
+            size_t expected = std::upper_bound(distances.begin(), distances.end(), s) - distances.begin() - 1;
+            if (index.findIndexAtDistance(s) != expected || index.findIndexAtOrAfterDistance(s) != expected + 1) {
+                return false;
+            }
+        }
+        return true;
+    };
+    check(matchesBruteForce(), "Fenwick arc-length index matches cumulative sums");
+
+    // 点の移動・挿入・削除のあとも差分更新で全体の再計算と一致する
+    for (int step = 0; step < 100; ++step) {
+        data.updatePoint(rng() % data.size(), TrajectoryPoint(coordinate(rng), coordinate(rng), 0.0, 5.0));
+    }
+    index.update(data);
+    check(matchesBruteForce(), "arc-length index after incremental moves");
+    data.insertRange(100, {TrajectoryPoint(0, 0, 0, 1), TrajectoryPoint(1, 1, 0, 1)});
+    data.removeRange(300, 309);
+    index.update(data);
+    check(matchesBruteForce(), "arc-length index after inserting and removing points");
+}
+
+void testMaxTree(std::mt19937& rng) {
+    std::uniform_real_distribution<double> value(-1.0, 10.0);
+    std::vector<double> values(777, 0.0);
+    MaxTree tree;
+    tree.resize(values.size());
+    bool matches = true;
+    for (int step = 0; step < 300; ++step) {
+        size_t begin = rng() % values.size();
+        size_t end = std::min(values.size(), begin + 1 + rng() % 20);
+        for (size_t i = begin; i < end; ++i) {
+            values[i] = std::max(0.0, std::round(value(rng)));  // 同じ値を作って小さい添字を優先するか見る
+            tree.set(i, values[i]);
+        }
+        tree.refresh(begin, end);
+        size_t expected = std::max_element(values.begin(), values.end()) - values.begin();
+        size_t index = 0;
+        matches = matches && tree.getMax(&index) == values[expected] && index == expected;
+    }
+    check(matches, "max tree follows range updates and breaks ties toward the smaller index");
+
+    // 符号を反転して -∞ を下限にすると負の値も含めた最小値になる
+    MaxTree min_tree(-std::numeric_limits<double>::infinity());
+    size_t index = 0;
+    min_tree.resize(values.size());
+    check(min_tree.getMax(&index) == -std::numeric_limits<double>::infinity() && index == 0,
+          "min tree starts empty at the floor");
+    for (size_t i = 0; i < values.size(); ++i) {
+        min_tree.set(i, -values[i]);
+    }
+    min_tree.refresh(0, values.size());
+    matches = true;
+    for (int step = 0; step < 300; ++step) {
+        size_t begin = rng() % values.size();
+        size_t end = std::min(values.size(), begin + 1 + rng() % 20);
+        for (size_t i = begin; i < end; ++i) {
+            values[i] = std::round(value(rng));
+            min_tree.set(i, -values[i]);
+        }
+        min_tree.refresh(begin, end);
+        size_t expected = std::min_element(values.begin(), values.end()) - values.begin();
+        matches = matches && -min_tree.getMax(&index) == values[expected] && index == expected;
+    }
+    check(matches, "negated values with a -inf floor give the minimum and its first index");
+}
+
+void testTrackClearance(std::mt19937& rng) {
+    // 幅10 m の直線コースで、はみ出す点と内側の点を混ぜる
+    TrackBoundaries boundaries;
+    boundaries.setLeftBoundary({BoundaryPoint(-10.0, 5.0), BoundaryPoint(1010.0, 5.0)});
+    boundaries.setRightBoundary({BoundaryPoint(-10.0, -5.0), BoundaryPoint(1010.0, -5.0)});
+    std::uniform_real_distribution<double> lateral(-7.0, 7.0);
+    TrajectoryData data;
+    for (size_t i = 0; i < 1000; ++i) {
+        data.addPoint(TrajectoryPoint(static_cast<double>(i), lateral(rng), 0.0, 5.0));
+    }
+
+    TrackClearance clearance;
+    clearance.setBoundaries(boundaries);
+    clearance.setMargin(0.5);
+    clearance.update(data);
+    std::vector<uint8_t> shown;  // 表示側と同じく変わった点だけを反映したフラグ
+    auto applyChanges = [&]() {
+        if (shown.size() != clearance.size()) {
+            shown = clearance.getViolationFlags();
+        }
+        for (size_t i : clearance.getChangedViolations()) {
+            shown[i] = clearance.getViolationFlags()[i];
+        }
+    };
+    auto matchesRebuild = [&]() {
+        applyChanges();
+        TrackClearance reference;
+        reference.setBoundaries(boundaries);
+        reference.setMargin(clearance.getMargin());
+        reference.build(data);
+        size_t index = 0;
+        size_t expected_index = 0;
+        return clearance.getMinClearance(&index) == reference.getMinClearance(&expected_index) &&
+               index == expected_index && clearance.countViolations() == reference.getViolations().size() &&
+               clearance.getViolations() == reference.getViolations() && shown == reference.getViolationFlags();
+    };
+    check(matchesRebuild() && clearance.countViolations() > 0, "clearance minimum and violations after build");
+
+    for (int step = 0; step < 50; ++step) {
+        size_t i = rng() % data.size();
+        data.updatePoint(i, TrajectoryPoint(static_cast<double>(i), lateral(rng), 0.0, 5.0));
+        clearance.update(data);
+        applyChanges();
+    }
+    check(matchesRebuild() && clearance.getLastRecomputedCount() <= 1, "clearance after incremental moves");
+    data.insertRange(100, {TrajectoryPoint(100.5, 9.0, 0, 1), TrajectoryPoint(100.7, 0.0, 0, 1)});
+    clearance.update(data);
+    check(matchesRebuild(), "clearance after inserting points");
+    data.removeRange(300, 359);
+    clearance.update(data);
+    check(matchesRebuild(), "clearance after removing points");
+    clearance.setMargin(2.0);
+    check(matchesRebuild(), "clearance flags after changing the margin");
+}
+
+void testPentadiagonalSolver(std::mt19937& rng) {
+    std::uniform_real_distribution<double> band(-1.0, 1.0);
+    const size_t n = 300;
+    std::vector<double> diag(n), off1(n), off2(n), rhs(n);
+    for (size_t k = 0; k < n; ++k) {
+        off1[k] = band(rng);
+        off2[k] = band(rng);
+        rhs[k] = band(rng);
+    }
+    for (size_t k = 0; k < n; ++k) {
+        diag[k] = 4.5 + band(rng);  // 対角優位なので正定値
+    }
+
+    PentadiagonalSolver solver;
+    check(solver.factor(diag, off1, off2) && solver.size() == n, "factor a positive definite matrix");
+    std::vector<double> x = rhs;
+    solver.solve(x);
+
+    // 帯から組み立てた A x と右辺の差
+    double residual = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        double sum = diag[i] * x[i];
+        if (i + 1 < n) sum += off1[i] * x[i + 1];
+        if (i + 2 < n) sum += off2[i] * x[i + 2];
+        if (i >= 1) sum += off1[i - 1] * x[i - 1];
+        if (i >= 2) sum += off2[i - 2] * x[i - 2];
+        residual = std::max(residual, std::abs(sum - rhs[i]));
+    }
+    check(residual < 1e-10, "LDL^T solve residual " + std::to_string(residual));
+
+    std::vector<double> indefinite(n, 1.0);
+    check(!solver.factor(indefinite, std::vector<double>(n, 2.0), off2), "non-positive pivot is rejected");
+}
+
+void testRacelineOptimizer() {
+    RacelineOptions options;
+    options.max_offset = 3.0;
+    RacelineOptimizer optimizer;
+    optimizer.setOptions(options);
+
+    // 周回（巡回行列の角をWoodbury補正で解く）
+    std::vector<TrajectoryPoint> lap = makeLap(240, 60.0, 1.5);
+    std::vector<TrajectoryPoint> result;
+    check(optimizer.optimize(lap, result), "optimize a closed lap");
+    const RacelineStats& stats = optimizer.getStatistics();
+    check(result.size() == lap.size(), "closed lap keeps the point count");
+    check(std::hypot(result.front().x - result.back().x, result.front().y - result.back().y) < 1e-9,
+          "closed lap stays closed");
+    // 揺れを取り除いた円の Σ κ^2 ds = 2π / R が下限
+    check(stats.converged && stats.final_cost < stats.initial_cost &&
+          std::abs(stats.final_cost - 2.0 * PI / 60.0) < 0.01 * stats.final_cost &&
+          std::abs(stats.final_cost - RacelineOptimizer::curvatureCost(result, true)) < 1e-12,
+          "closed lap curvature cost reaches the circle's");
+    check(stats.max_abs_offset <= options.max_offset + 1e-6, "offsets stay within max_offset");
+    double sum_x = 0.0, sum_y = 0.0;
+    for (size_t i = 0; i + 1 < result.size(); ++i) {
+        sum_x += result[i].x;
+        sum_y += result[i].y;
+    }
+    check(std::hypot(sum_x, sum_y) / static_cast<double>(result.size() - 1) < 1.0, "closed lap is not translated");
+
+    // 開いた軌跡（帯行列だけ）
+    std::vector<TrajectoryPoint> open;
+    for (size_t i = 0; i < 200; ++i) {
+        double t = static_cast<double>(i);
+        open.emplace_back(t, std::sin(0.4 * t), 0.0, 10.0);
+    }
+    check(optimizer.optimize(open, result) && result.size() == open.size(), "optimize an open trajectory");
+    check(optimizer.getStatistics().final_cost < optimizer.getStatistics().initial_cost,
+          "open trajectory curvature cost decreases");
+
+    std::vector<TrajectoryPoint> tiny(open.begin(), open.begin() + 4);
+    check(!optimizer.optimize(tiny, result), "too few points is rejected");
+
+    // 実コース：線形化が外れる大きな一歩でコストが初期ラインより悪くならない
+    TrajectoryData awsim;
+    TrackBoundaries boundaries;
+    check(awsim.loadFromCSV("data/raceline_awsim_15km.csv") && boundaries.loadFromFile("data/track_boundaries.csv"),
+          "load the AWSIM lap and boundaries");
+    RacelineOptimizer track_optimizer;
+    track_optimizer.setBoundaries(boundaries);
+    check(track_optimizer.optimize(awsim.getPoints(), result), "optimize the AWSIM lap");
+    const RacelineStats& track_stats = track_optimizer.getStatistics();
+    check(track_stats.converged && track_stats.final_cost < 0.75 * track_stats.initial_cost &&
+          track_stats.accepted_passes <= track_stats.passes,
+          "AWSIM lap cost " + std::to_string(track_stats.initial_cost) + " -> " +
+          std::to_string(track_stats.final_cost));
+}
+
+void testSegmentIndex(std::mt19937& rng) {
+    // 自分と交差する密な折れ線
+    std::vector<TrajectoryPoint> polyline;
+    for (size_t i = 0; i < 2000; ++i) {
+        double t = static_cast<double>(i) * 0.01;
+        polyline.emplace_back(30.0 * std::cos(t) + 5.0 * std::cos(13.0 * t),
+                              30.0 * std::sin(t) + 5.0 * std::sin(11.0 * t), 0.0, 0.0);
+    }
+    SegmentIndex index;
+    index.build(polyline);
+    check(index.getSegmentCount() == polyline.size() - 1, "segment count");
+
+    std::uniform_real_distribution<double> coordinate(-45.0, 45.0);
+    std::uniform_real_distribution<double> angle(0.0, 2.0 * PI);
+    bool nearest_matches = true;
+    bool hint_matches = true;
+    bool ray_matches = true;
+    for (int query = 0; query < 500; ++query) {
+        double x = coordinate(rng), y = coordinate(rng);
+        double expected = std::numeric_limits<double>::infinity();
+        for (size_t s = 0; s + 1 < polyline.size(); ++s) {
+            expected = std::min(expected, distanceToSegment(x, y, polyline[s], polyline[s + 1]));
+        }
+        SegmentHit hit = index.findNearest(x, y);
+        nearest_matches = nearest_matches && hit.valid && std::abs(hit.distance - expected) < 1e-9 &&
+                          std::abs(std::hypot(hit.x - x, hit.y - y) - hit.distance) < 1e-9 &&
+                          std::abs(std::abs(hit.signed_distance) - hit.distance) < 1e-9;
+        SegmentHit hinted = index.findNearest(x, y, rng() % index.getSegmentCount());
+        hint_matches = hint_matches && hinted.valid && std::abs(hinted.distance - expected) < 1e-9;
+
+        double theta = angle(rng);
+        double dx = std::cos(theta), dy = std::sin(theta);
+        double expected_t = std::numeric_limits<double>::infinity();
+        for (size_t s = 0; s + 1 < polyline.size(); ++s) {
+            expected_t = std::min(expected_t, raySegment(x, y, dx, dy, polyline[s], polyline[s + 1]));
+        }
+        double max_distance = 20.0;
+        double t = index.intersectRay(x, y, dx, dy, max_distance);
+        if (expected_t > max_distance) {
+            ray_matches = ray_matches && std::isinf(t);
+        } else {
+            ray_matches = ray_matches && std::abs(t - expected_t) < 1e-9;
+        }
+    }
+    check(nearest_matches, "BVH nearest matches brute force");
+    check(hint_matches, "BVH nearest with a hint matches brute force");
+    check(ray_matches, "BVH ray cast matches brute force");
+
+    // 進行方向の左が正
+    SegmentIndex straight;
+    straight.build(std::vector<TrajectoryPoint>{TrajectoryPoint(0, 0, 0, 0), TrajectoryPoint(10, 0, 0, 0)});
+    SegmentHit left = straight.findNearest(4.0, 2.0);
+    check(left.segment == 0 && std::abs(left.ratio - 0.4) < 1e-12 && std::abs(left.signed_distance - 2.0) < 1e-12,
+          "signed distance is positive on the left");
+    check(straight.findNearest(4.0, -2.0).signed_distance < 0.0, "signed distance is negative on the right");
+    check(std::abs(straight.intersectRay(4.0, 3.0, 0.0, -1.0, 10.0) - 3.0) < 1e-12, "ray hits a straight segment");
+    check(std::isinf(straight.intersectRay(4.0, 3.0, 0.0, 1.0, 10.0)), "ray pointing away misses");
+}
+
+void testFrenetFrame(std::mt19937& rng) {
+    std::uniform_real_distribution<double> lateral(-4.0, 4.0);
+
+    // 周回の基準線
+    FrenetFrame lap;
+    lap.build(makeLap(300, 50.0, 2.0));
+    check(lap.isClosed() && lap.getLength() > 0.0, "closed reference");
+    std::uniform_real_distribution<double> station(0.0, lap.getLength());
+    bool round_trip = true;
+    bool wraps = true;
+    for (int query = 0; query < 500; ++query) {
+        double s = station(rng), d = lateral(rng);
+        double x = 0.0, y = 0.0;
+        lap.toCartesian(s, d, x, y);
+        FrenetPoint frenet = lap.toFrenet(x, y);
+        double ds = std::fmod(std::abs(frenet.s - s), lap.getLength());
+        ds = std::min(ds, lap.getLength() - ds);  // 始点付近は折り返した s も同じ点
+        round_trip = round_trip && ds < 1e-6 && std::abs(frenet.d - d) < 1e-6;
+
+        double wx = 0.0, wy = 0.0;
+        lap.toCartesian(s + lap.getLength(), d, wx, wy);
+        wraps = wraps && std::hypot(wx - x, wy - y) < 1e-6;
+        lap.toCartesian(s - lap.getLength(), d, wx, wy);
+        wraps = wraps && std::hypot(wx - x, wy - y) < 1e-6;
+    }
+    check(round_trip, "closed reference (s, d) -> (x, y) -> (s, d) round trip");
+    check(wraps, "closed reference wraps s by the lap length");
+
+    // 開いた基準線（ヒント付きで順に変換）
+    std::vector<TrajectoryPoint> reference;
+    for (size_t i = 0; i < 400; ++i) {
+        double t = static_cast<double>(i) * 0.5;
+        reference.emplace_back(t, 8.0 * std::sin(0.05 * t), 0.0, 0.0);
+    }
+    FrenetFrame open;
+    open.build(reference);
+    check(!open.isClosed(), "open reference");
+    bool open_round_trip = true;
+    size_t hint = 0;
+    for (double s = 1.0; s < open.getLength() - 1.0; s += 0.37) {
+        double d = lateral(rng);
+        double x = 0.0, y = 0.0;
+        open.toCartesian(s, d, x, y);
+        FrenetPoint frenet = open.toFrenet(x, y, hint);
+        hint = frenet.segment;
+        open_round_trip = open_round_trip && std::abs(frenet.s - s) < 1e-6 && std::abs(frenet.d - d) < 1e-6;
+    }
+    check(open_round_trip, "open reference round trip with hints");
+}
+
+} // namespace
+
+int main() {
+    std::cout << "🔍 Testing numerical kernels..." << std::endl;
+    std::mt19937 rng(42);
+
+    testArcLengthIndex(rng);
+    testMaxTree(rng);
+    testTrackClearance(rng);
+    testPentadiagonalSolver(rng);
+    testRacelineOptimizer();
+    testSegmentIndex(rng);
+    testFrenetFrame(rng);
+
+    return test_check::finish("kernel", "Arc-length index, max tree, clearance, solvers, raceline, BVH and Frenet frame agree with references");
+}
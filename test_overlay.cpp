@@ -0,0 +1,143 @@
+#include "src/core/trajectory_data.hpp"
+#include "src/core/trajectory_overlay.hpp"
+#include "test_check.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using trajectory_editor::TrajectoryData;
+using trajectory_editor::TrajectoryOverlay;
+using trajectory_editor::TrajectoryPoint;
+
+using test_check::check;
+
+bool samePoint(const TrajectoryPoint& a, const TrajectoryPoint& b) {
+    return a.x == b.x && a.y == b.y && a.z == b.z && a.velocity == b.velocity;
+}
+
+TrajectoryPoint makePoint(size_t i) {
+    double t = static_cast<double>(i);
+    return TrajectoryPoint(t, 2.0 * t, 0.5, 10.0 + t);
+}
+
+} // namespace
+
+int main() {
+    std::cout << "🔍 Testing the memory-mapped overlay..." << std::endl;
+    namespace fs = std::filesystem;
+    const fs::path dir = fs::temp_directory_path() / "trajectory_overlay_test";
+    fs::create_directories(dir);
+    const std::string base_path = (dir / "base.trjb").string();
+    const std::string edited_path = (dir / "edited.trjb").string();
+    const std::string csv_path = (dir / "edited.csv").string();
+
+    // ベース（1000点）を書いて、読み込まずに開く
+    TrajectoryData base;
+    std::vector<TrajectoryPoint> expected;
+    for (size_t i = 0; i < 1000; ++i) {
+        expected.push_back(makePoint(i));
+        base.addPoint(expected.back());
+    }
+    check(base.saveToBinary(base_path), "save base .trjb");
+
+    TrajectoryOverlay overlay;
+    check(overlay.openBase(base_path), "open base: " + overlay.getLastError());
+    check(overlay.size() == 1000 && !overlay.isModified(), "base size");
+    check(!overlay.openBase((dir / "missing.trjb").string()) && !overlay.getLastError().empty(),
+          "missing file reports an error");
+    check(overlay.openBase(base_path), "reopen base");
+
+    // 置換・挿入・削除を TrajectoryData と同じ結果にする
+    overlay.movePoint(10, -1.0, -2.0);
+    expected[10].x = -1.0;
+    expected[10].y = -2.0;
+    overlay.removeRange(100, 50);
+    expected.erase(expected.begin() + 100, expected.begin() + 150);
+    std::vector<TrajectoryPoint> inserted = {TrajectoryPoint(7, 7, 7, 7), TrajectoryPoint(8, 8, 8, 8)};
+    overlay.insertRange(500, inserted);
+    expected.insert(expected.begin() + 500, inserted.begin(), inserted.end());
+    overlay.removePoint(0);
+    expected.erase(expected.begin());
+    check(overlay.isModified(), "modified after edits");
+    check(overlay.size() == expected.size(), "size after edits");
+
+    bool cursor_matches = true;
+    size_t visited = 0;
+    for (auto cursor = overlay.cursor(); cursor.valid(); cursor.next()) {
+        cursor_matches = cursor_matches && cursor.index() == visited && samePoint(cursor.point(), expected[visited]);
+        ++visited;
+    }
+    check(cursor_matches && visited == expected.size(), "cursor reads base and overlay in order");
+    // 先頭を消したので挿入した点は 499 から
+    check(samePoint(overlay.getPoint(498), expected[498]) && samePoint(overlay.getPoint(499), inserted[0]) &&
+          samePoint(overlay.getPoint(501), expected[501]), "random access across pieces");
+    check(overlay.getOverlayMemoryUsage() < 1000 * sizeof(TrajectoryPoint), "overlay memory follows the edits");
+
+    // ストリームで書き出した結果を読み直す
+    check(overlay.saveToBinary(edited_path), "save .trjb: " + overlay.getLastError());
+    TrajectoryData reloaded;
+    check(reloaded.loadFromBinary(edited_path) && reloaded.size() == expected.size(), "reload .trjb");
+    bool binary_matches = reloaded.size() == expected.size();
+    for (size_t i = 0; binary_matches && i < expected.size(); ++i) {
+        binary_matches = samePoint(reloaded.getPoints()[i], expected[i]);
+    }
+    check(binary_matches, "saved .trjb matches the edits");
+
+    // 上書き保存（mmap中のベース自身へ）しても壊れない
+    check(overlay.saveToBinary(base_path), "save over the mapped base");
+    check(reloaded.loadFromBinary(base_path) && reloaded.size() == expected.size(), "reload overwritten base");
+
+    // %f で長くなる値が書き出しバッファの境界をまたいでも欠けない
+    TrajectoryData large;
+    for (size_t i = 0; i < 3000; ++i) {
+        large.addPoint(TrajectoryPoint(1e300, -1e300, static_cast<double>(i), 1e200));
+    }
+    check(large.saveToBinary(edited_path), "save large-value .trjb");
+    check(overlay.openBase(edited_path), "open large-value .trjb");
+    check(overlay.saveToCSV(csv_path), "save CSV: " + overlay.getLastError());
+    TrajectoryData csv;
+    check(csv.loadFromCSV(csv_path) && csv.size() == 3000, "reload CSV with long rows");
+    bool csv_matches = csv.size() == 3000;
+    for (size_t i = 0; csv_matches && i < csv.size(); ++i) {
+        const auto& point = csv.getPoints()[i];
+        csv_matches = point.x == 1e300 && point.y == -1e300 && point.z == static_cast<double>(i);
+    }
+    check(csv_matches, "CSV rows are complete");
+
+    // 点数を偽ったヘッダーは確保する前に弾く（例外を投げずに false）
+    const std::string forged_path = (dir / "forged.trjb").string();
+    for (uint64_t claimed : {uint64_t(1) << 60, uint64_t(1) << 34, uint64_t(5)}) {
+        trajectory_editor::TrajectoryBinaryHeader header;
+        std::memcpy(header.magic, "TRJB", 4);
+        header.version = trajectory_editor::TRAJECTORY_BINARY_VERSION;
+        header.point_count = claimed;
+        std::ofstream forged(forged_path, std::ios::binary | std::ios::trunc);
+        forged.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        forged.write(std::string(80, '\0').data(), 80);  // 2点半
+        forged.close();
+        TrajectoryData truncated;
+        check(!truncated.loadFromBinary(forged_path) && !truncated.getLastError().empty(),
+              "loadFromBinary rejects a header claiming " + std::to_string(claimed) + " points");
+        check(!overlay.openBase(forged_path) && !overlay.getLastError().empty(),
+              "openBase rejects a header claiming " + std::to_string(claimed) + " points");
+    }
+
+    // 姿勢列は .trjb に入らないので書かずに理由を返す
+    const std::string extended_path = (dir / "extended.csv").string();
+    std::ofstream(extended_path) << "x,y,z,x_quat,y_quat,z_quat,w_quat,speed\n"
+                                 << "0,0,0,0,0,0,1,5\n1,0,0,0,0,0,1,5\n";
+    TrajectoryData extended;
+    check(extended.loadFromCSV(extended_path) && extended.hasOrientation(), "load 8-column CSV");
+    check(!extended.saveToBinary(edited_path) && !extended.getLastError().empty(),
+          "8-column data is not written as .trjb");
+
+    overlay.close();
+    fs::remove_all(dir);
+
+    return test_check::finish("overlay", "Overlay edits, cursor and streaming saves match");
+}
@@ -0,0 +1,386 @@
+#include "src/core/boundary_tiles.hpp"
+#include "src/utils/lanelet_graph.hpp"
+#include "src/utils/osm_cache.hpp"
+#include "src/utils/osm_parser.hpp"
+#include "src/utils/xml_tokenizer.hpp"
+#include "test_check.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace trajectory_editor;
+
+using test_check::check;
+
+// 文字列全体をトークンに分ける（エラーなら false）
+bool tokenize(const std::string& xml, std::vector<XmlToken>& tokens) {
+    XmlTokenizer tokenizer(xml.data(), xml.size());
+    XmlToken token;
+    tokens.clear();
+    while (tokenizer.next(token)) {
+        tokens.push_back(token);
+    }
+    return !tokenizer.hasError();
+}
+
+std::string decode(std::string_view value) {
+    std::string out;
+    decodeXmlEntities(value, out);
+    return out;
+}
+
+void writeNode(std::ostream& out, OSMId id, double x, double y) {
+    out << "  <node id=\"" << id << "\" lat=\"0\" lon=\"0\">\n"
+        << "    <tag k=\"local_x\" v=\"" << x << "\"/>\n"
+        << "    <tag k=\"local_y\" v=\"" << y << "\"/>\n"
+        << "  </node>\n";
+}
+
+void writeWay(std::ostream& out, OSMId id, const std::vector<OSMId>& refs) {
+    out << "  <way id=\"" << id << "\">\n";
+    for (OSMId ref : refs) {
+        out << "    <nd ref=\"" << ref << "\"/>\n";
+    }
+    out << "    <tag k=\"type\" v=\"line_thin\"/>\n  </way>\n";
+}
+
+void writeLanelet(std::ostream& out, OSMId id, OSMId left, OSMId right) {
+    out << "  <relation id=\"" << id << "\">\n"
+        << "    <member type=\"way\" ref=\"" << left << "\" role=\"left\"/>\n"
+        << "    <member type=\"way\" ref=\"" << right << "\" role=\"right\"/>\n"
+        << "    <tag k=\"type\" v=\"lanelet\"/>\n  </relation>\n";
+}
+
+// 周回する4つのlanelet（正方形の外側が左、内側が右）と、lanelet 2 の終点から分かれる1つ
+std::string makeLaneletMap() {
+    std::ostringstream out;
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<osm version=\"0.6\">\n";
+    const double corners[4][2] = {{0, 0}, {10, 0}, {10, 10}, {0, 10}};
+    for (int k = 0; k < 4; ++k) {
+        double cx = corners[k][0] - 5.0, cy = corners[k][1] - 5.0;
+        writeNode(out, 100 + k, 5.0 + 1.2 * cx, 5.0 + 1.2 * cy);   // 左（外側）
+        writeNode(out, 200 + k, 5.0 + 0.8 * cx, 5.0 + 0.8 * cy);   // 右（内側）
+    }
+    writeNode(out, 150, 25.0, 11.0);
+    writeNode(out, 250, 25.0, 9.0);
+    for (int k = 0; k < 4; ++k) {
+        writeWay(out, 1000 + k, {100 + k, 100 + (k + 1) % 4});
+        writeWay(out, 2000 + k, {200 + k, 200 + (k + 1) % 4});
+        writeLanelet(out, 1 + k, 1000 + k, 2000 + k);
+    }
+    writeWay(out, 1500, {102, 150});
+    writeWay(out, 2500, {202, 250});
+    writeLanelet(out, 50, 1500, 2500);
+    out << "</osm>\n";
+    return out.str();
+}
+
+void testXmlTokenizer() {
+    std::vector<XmlToken> tokens;
+    const std::string xml =
+        "<?xml version=\"1.0\"?>\n<!DOCTYPE osm>\n<!-- <fake/> -->\n"
+        "<osm a='1' b = \"two words\">text<![CDATA[<not-an-element/>]]>"
+        "<node id=\"5\"/><way></way></osm>";
+    check(tokenize(xml, tokens) && tokens.size() == 5, "tokenizer skips declaration, DOCTYPE, comments and CDATA");
+    if (tokens.size() == 5) {
+        check(tokens[0].type == XML_START_ELEMENT && tokens[0].name == "osm" && !tokens[0].self_closing,
+              "start element");
+        check(tokens[0].attribute("a") == "1" && tokens[0].attribute("b") == "two words" &&
+              tokens[0].attribute("missing").empty(), "single- and double-quoted attributes");
+        check(tokens[1].name == "node" && tokens[1].self_closing && tokens[1].attribute("id") == "5",
+              "self-closing element");
+        check(tokens[2].name == "way" && tokens[3].type == XML_END_ELEMENT && tokens[3].name == "way" &&
+              tokens[4].type == XML_END_ELEMENT && tokens[4].name == "osm", "end elements");
+    }
+
+    check(!tokenize("<osm><node id=\"1></osm>", tokens), "unterminated attribute is an error");
+    check(!tokenize("<osm><!-- never closed", tokens), "unterminated comment is an error");
+    check(!tokenize("<osm attr></osm>", tokens), "attribute without value is an error");
+
+    check(decode("a &lt; b &amp;&amp; c &gt; d") == "a < b && c > d", "named entities");
+    check(decode("&quot;&apos;") == "\"'", "quote entities");
+    check(decode("&#65;&#x42;&#x3b1;") == "AB\xCE\xB1", "numeric entities (UTF-8 output)");
+    check(decode("plain") == "plain", "values without entities are copied");
+}
+
+void testOSMParser(const std::filesystem::path& dir) {
+    // 区間分割が効く大きさ（数MB）のファイル。ID 1 は先頭と末尾にあり、後の要素が残る
+    std::ostringstream out;
+    out << "<?xml version=\"1.0\"?>\n<osm>\n";
+    writeNode(out, 1, -1.0, -1.0);
+    const OSMId node_count = 30000;
+    for (OSMId id = 2; id <= node_count; ++id) {
+        writeNode(out, id, static_cast<double>(id) * 0.5, std::sin(static_cast<double>(id)));
+    }
+    for (OSMId id = 1; id <= node_count / 10; ++id) {
+        out << "  <way id=\"" << id << "\">\n";
+        for (OSMId k = 0; k < 10; ++k) {
+            out << "    <nd ref=\"" << (id - 1) * 10 + k + 1 << "\"/>\n";
+        }
+        out << "    <tag k=\"name\" v=\"way &amp; " << id << "\"/>\n  </way>\n";
+    }
+    writeNode(out, 1, 42.0, 43.0);
+    out << "</osm>\n";
+    const std::string xml = out.str();
+    check(xml.size() > (4u << 20), "generated OSM file spans several slices");
+
+    OSMParser serial;
+    serial.setParallel(false);
+    OSMParser parallel;
+    parallel.setParallel(true);
+    check(serial.loadFromBuffer(xml.data(), xml.size()), "serial parse: " + serial.getLastError());
+    check(parallel.loadFromBuffer(xml.data(), xml.size()), "parallel parse: " + parallel.getLastError());
+
+    bool same_nodes = serial.getNodes().size() == parallel.getNodes().size();
+    for (size_t i = 0; same_nodes && i < serial.getNodes().size(); ++i) {
+        const auto& a = serial.getNodes()[i];
+        const auto& b = parallel.getNodes()[i];
+        same_nodes = a.id == b.id && a.local_x == b.local_x && a.local_y == b.local_y && a.elevation == b.elevation;
+    }
+    check(same_nodes && serial.getNodes().size() == static_cast<size_t>(node_count),
+          "parallel slices merge into the serial node table");
+    bool same_ways = serial.getWays().size() == parallel.getWays().size();
+    for (size_t i = 0; same_ways && i < serial.getWays().size(); ++i) {
+        const auto& a = serial.getWays()[i];
+        const auto& b = parallel.getWays()[i];
+        same_ways = a.id == b.id && a.node_refs == b.node_refs && a.tags.size() == 1 && b.tags.size() == 1 &&
+                    serial.getStrings().get(a.tags[0].value) == parallel.getStrings().get(b.tags[0].value);
+    }
+    check(same_ways && serial.getWays().size() == static_cast<size_t>(node_count / 10),
+          "parallel slices merge into the serial way table");
+
+    const OSMNode* node = parallel.findNode(1);
+    check(node && node->local_x == 42.0 && node->local_y == 43.0, "a later duplicate ID wins across slices");
+    const OSMWay* way = parallel.findWay(7);
+    check(way && way->node_refs.front() == 61 &&
+          parallel.findTag(way->tags, "name") == "way & 7", "way lookup and decoded tag value");
+    check(!parallel.findNode(node_count + 1) && !parallel.findWay(0), "missing IDs are not found");
+
+    // ファイル経由も同じ結果
+    const std::string path = (dir / "large.osm").string();
+    std::ofstream(path, std::ios::binary) << xml;
+    OSMParser from_file;
+    check(from_file.loadFromFile(path) && from_file.getNodes().size() == serial.getNodes().size(),
+          "load the same data from a file");
+    check(!from_file.loadFromFile((dir / "missing.osm").string()) && !from_file.getLastError().empty(),
+          "missing file reports an error");
+    const std::string broken = "<osm><node id=\"1\"";
+    check(!from_file.loadFromBuffer(broken.data(), broken.size()) && !from_file.getLastError().empty(),
+          "malformed XML reports an error");
+}
+
+void testLaneletGraph() {
+    const std::string xml = makeLaneletMap();
+    OSMParser parser;
+    check(parser.loadFromBuffer(xml.data(), xml.size()), "parse lanelet map: " + parser.getLastError());
+
+    LaneletGraph graph;
+    graph.build(parser);
+    check(graph.size() == 5, "every lanelet with both boundaries is built");
+    if (graph.size() != 5) {
+        return;
+    }
+    check(graph.getSuccessors(1).size() == 2 && graph.getPredecessors(0).size() == 1 &&
+          graph.getPredecessors(4).size() == 1, "successors follow shared boundary end nodes");
+
+    std::vector<LaneletCorridor> corridors = graph.stitch();
+    check(corridors.size() == 2, "loop and branch become two corridors");
+    if (corridors.size() != 2) {
+        return;
+    }
+    const LaneletCorridor& loop = corridors[0];
+    check(loop.closed && loop.lanelets == std::vector<size_t>({0, 1, 2, 3}), "loop is stitched in order and closed");
+    check(loop.left.size() == 5 && loop.right.size() == 5 && loop.left.front().id == loop.left.back().id &&
+          loop.left_starts == std::vector<size_t>({0, 1, 2, 3}), "seam nodes are not duplicated");
+    check(std::abs(loop.length - 0.5 * (48.0 + 32.0)) < 1e-9, "corridor length is the mean boundary length");
+    const LaneletCorridor& branch = corridors[1];
+    check(!branch.closed && branch.lanelets == std::vector<size_t>({4}), "branch is its own open corridor");
+
+    auto rows = LaneletGraph::pairByArcLength(loop);
+    check(rows.size() == 5 && rows.front().first.x == rows.back().first.x &&
+          rows.front().second.y == rows.back().second.y, "closed corridor rows end on the start row");
+    check(LaneletGraph::collectBoundaryWays(parser).size() == 10, "boundary ways are collected once");
+
+    LaneletFilter filter;
+    filter.ids = {2, 3};
+    graph.build(parser, filter);
+    check(graph.size() == 2 && graph.stitch().size() == 1, "filtered lanelets stitch into one corridor");
+}
+
+void testOSMCache(const std::filesystem::path& dir) {
+    namespace fs = std::filesystem;
+    const std::string source = (dir / "lanelets.osm").string();
+    const std::string xml = makeLaneletMap();
+    std::ofstream(source, std::ios::binary) << xml;
+
+    OSMParser parser;
+    check(parser.loadFromFile(source), "parse cached source");
+    LaneletGraph graph;
+    graph.build(parser);
+    auto boundaries = LaneletGraph::pairByArcLength(graph.stitch().front());
+
+    OSMCache cache;
+    std::vector<std::pair<LanePoint, LanePoint>> loaded;
+    OSMParser restored;
+    check(!cache.load(source, restored, loaded) && cache.getStatus() == "no cache", "no cache before saving");
+    check(cache.save(source, parser, boundaries), "save cache: " + cache.getStatus());
+    check(cache.load(source, restored, loaded) && cache.getStatus() == "loaded", "load cache: " + cache.getStatus());
+    check(restored.getNodes().size() == parser.getNodes().size() &&
+          restored.getWays().size() == parser.getWays().size() &&
+          restored.getRelations().size() == parser.getRelations().size() &&
+          loaded.size() == boundaries.size(), "cache restores the tables and boundaries");
+    const OSMRelation* relation = restored.findRelation(50);
+    check(relation && restored.findTag(relation->tags, "type") == "lanelet" &&
+          restored.getStrings().get(relation->members[0].role) == "left", "cache restores the string pool");
+
+    // 壊したキャッシュは読み込まずに理由を返す
+    const std::string cache_path = OSMCache::getCachePath(source);
+    std::string original;
+    {
+        std::ifstream in(cache_path, std::ios::binary);
+        original.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    auto loadCorrupted = [&](const std::string& bytes, const std::string& expected_status) {
+        std::ofstream(cache_path, std::ios::binary | std::ios::trunc) << bytes;
+        OSMParser target;
+        return !cache.load(source, target, loaded) && cache.getStatus() == expected_status;
+    };
+    check(loadCorrupted(original.substr(0, original.size() - 3), "corrupt cache"), "truncated cache");
+    check(loadCorrupted(original.substr(0, 20), "corrupt cache"), "cache shorter than its header");
+    std::string bytes = original;
+    bytes[0] = 'X';
+    check(loadCorrupted(bytes, "unknown cache format"), "bad magic");
+    bytes = original;
+    bytes[40] ^= 0x01;  // ヘッダーの node_count
+    check(loadCorrupted(bytes, "corrupt cache"), "node count that does not match the sections");
+    bytes = original + '\0';
+    check(loadCorrupted(bytes, "corrupt cache"), "trailing bytes after the sections");
+
+    // 変換元が変わればキャッシュは古い
+    std::ofstream(cache_path, std::ios::binary | std::ios::trunc) << original;
+    std::ofstream(source, std::ios::binary | std::ios::app) << "<!-- edited -->\n";
+    OSMParser target;
+    check(!cache.load(source, target, loaded) && cache.getStatus() == "source size changed", "stale source size");
+
+    std::ofstream(source, std::ios::binary | std::ios::trunc) << xml;
+    check(cache.save(source, parser, boundaries), "save cache again");
+    std::string same_size = xml;
+    same_size[same_size.find("line_thin")] = 'L';
+    std::ofstream(source, std::ios::binary | std::ios::trunc) << same_size;
+    fs::last_write_time(source, fs::last_write_time(source) + std::chrono::seconds(5));
+    check(!cache.load(source, target, loaded) && cache.getStatus() == "source content changed",
+          "same-size edit is detected by the content hash");
+
+    // touch しただけなら読み込める
+    std::ofstream(source, std::ios::binary | std::ios::trunc) << xml;
+    fs::last_write_time(source, fs::last_write_time(source) + std::chrono::seconds(10));
+    check(cache.load(source, target, loaded) && cache.getStatus() == "loaded", "touched source still loads");
+}
+
+// 線分 a → b が正方形 [x0, x0 + size] × [y0, y0 + size] の内部を通るか（角で接するだけなら false）
+bool crossesSquare(double ax, double ay, double bx, double by, double x0, double y0, double size) {
+    double t0 = 0.0, t1 = 1.0;
+    const double p[4] = {-(bx - ax), bx - ax, -(by - ay), by - ay};
+    const double q[4] = {ax - x0, x0 + size - ax, ay - y0, y0 + size - ay};
+    for (int k = 0; k < 4; ++k) {
+        if (p[k] == 0.0) {
+            if (q[k] < 0.0) {
+                return false;
+            }
+            continue;
+        }
+        double t = q[k] / p[k];
+        if (p[k] < 0.0) {
+            t0 = std::max(t0, t);
+        } else {
+            t1 = std::min(t1, t);
+        }
+    }
+    return t1 - t0 > 1e-9;
+}
+
+void testBoundaryTiles() {
+    // 1本ずつの線分を、通る正方形の総当たりと比べる（角をかすめるだけの短い区間も含む）
+    const double tile_size = 10.0;
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> coordinate(-60.0, 60.0);
+    std::ostringstream out;
+    out << "<?xml version=\"1.0\"?>\n<osm>\n";
+    const OSMId segment_count = 200;
+    std::vector<std::array<double, 4>> segments;
+    for (OSMId id = 1; id <= segment_count; ++id) {
+        std::array<double, 4> segment = {coordinate(rng), coordinate(rng), coordinate(rng), coordinate(rng)};
+        segments.push_back(segment);
+        writeNode(out, 2 * id, segment[0], segment[1]);
+        writeNode(out, 2 * id + 1, segment[2], segment[3]);
+        writeWay(out, id, {2 * id, 2 * id + 1});
+    }
+    // 4タイルが接する (10, 0) のすぐ上を通り、タイル (1, 0) の角をわずかにかすめる短い線分
+    segments.push_back({9.9, 0.1, 10.1, -0.1 + 1e-3});
+    writeNode(out, 2 * (segment_count + 1), 9.9, 0.1);
+    writeNode(out, 2 * (segment_count + 1) + 1, 10.1, -0.1 + 1e-3);
+    writeWay(out, segment_count + 1, {2 * (segment_count + 1), 2 * (segment_count + 1) + 1});
+    out << "</osm>\n";
+    const std::string xml = out.str();
+    auto parser = std::make_shared<OSMParser>();
+    check(parser->loadFromBuffer(xml.data(), xml.size()), "parse tile test map: " + parser->getLastError());
+
+    bool exact = true;
+    for (OSMId id = 1; id <= segment_count + 1; ++id) {
+        const auto& segment = segments[id - 1];
+        std::set<std::pair<int32_t, int32_t>> expected;
+        int32_t x_first = static_cast<int32_t>(std::floor(std::min(segment[0], segment[2]) / tile_size));
+        int32_t x_last = static_cast<int32_t>(std::floor(std::max(segment[0], segment[2]) / tile_size));
+        int32_t y_first = static_cast<int32_t>(std::floor(std::min(segment[1], segment[3]) / tile_size));
+        int32_t y_last = static_cast<int32_t>(std::floor(std::max(segment[1], segment[3]) / tile_size));
+        for (int32_t x = x_first; x <= x_last; ++x) {
+            for (int32_t y = y_first; y <= y_last; ++y) {
+                if (crossesSquare(segment[0], segment[1], segment[2], segment[3], x * tile_size, y * tile_size,
+                                  tile_size)) {
+                    expected.insert({x, y});
+                }
+            }
+        }
+
+        BoundaryTileIndex index;
+        index.build(parser, {id}, tile_size);
+        std::set<std::pair<int32_t, int32_t>> actual;
+        for (const auto& key : index.findTiles(-100.0, -100.0, 100.0, 100.0)) {
+            actual.insert({key.x, key.y});
+            exact = exact && index.decodeTile(key).size() == 1;
+        }
+        exact = exact && actual == expected;
+    }
+    check(exact, "every tile a boundary segment passes through holds that segment");
+}
+
+} // namespace
+
+int main() {
+    std::cout << "🔍 Testing XML, OSM, lanelet and cache parsers..." << std::endl;
+    namespace fs = std::filesystem;
+    const fs::path dir = fs::temp_directory_path() / "trajectory_parsers_test";
+    fs::create_directories(dir);
+
+    testXmlTokenizer();
+    testOSMParser(dir);
+    testLaneletGraph();
+    testBoundaryTiles();
+    testOSMCache(dir);
+
+    fs::remove_all(dir);
+
+    return test_check::finish("parser", "Tokenizer, OSM slicing, lanelet stitching, boundary tiles and cache validation behave");
+}
@@ -0,0 +1,113 @@
+#include "src/core/trajectory_engine.hpp"
+#include "test_check.hpp"
+#include <atomic>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using trajectory_editor::TrajectoryData;
+using trajectory_editor::TrajectoryEngine;
+using trajectory_editor::TrajectoryPoint;
+using trajectory_editor::TrajectorySnapshot;
+using trajectory_editor::TrajectorySnapshotPtr;
+
+using test_check::check;
+
+// スナップショットと読み直したファイルが同じ点列か
+bool sameAs(const std::vector<TrajectoryPoint>& points, const TrajectoryData& data) {
+    if (points.size() != data.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < points.size(); ++i) {
+        const auto& a = points[i];
+        const auto& b = data.getPoints()[i];
+        if (a.x != b.x || a.y != b.y || a.z != b.z || a.velocity != b.velocity) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double sumX(const TrajectorySnapshot& snapshot) {
+    double sum = 0.0;
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        sum += snapshot[i].x;
+    }
+    return sum;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "🔍 Testing snapshots and background autosave..." << std::endl;
+    namespace fs = std::filesystem;
+    const fs::path dir = fs::temp_directory_path() / "trajectory_snapshot_test";
+    fs::create_directories(dir);
+    const std::string autosave_path = (dir / "autosave.trjb").string();
+
+    // 3チャンク弱の点列
+    const size_t count = 3 * TrajectorySnapshot::CHUNK_SIZE - 100;
+    std::vector<TrajectoryPoint> points;
+    for (size_t i = 0; i < count; ++i) {
+        double t = static_cast<double>(i);
+        points.emplace_back(t, -t, 0.0, 10.0);
+    }
+    TrajectoryEngine engine;
+    engine.setPoints(points);
+
+    // 編集前のバージョンは編集後も変わらず、触れていないチャンクは共有される
+    TrajectorySnapshotPtr before = engine.getSnapshot();
+    check(before && before->size() == count && before->getChunkCount() == 3, "initial snapshot");
+    const double before_sum = sumX(*before);
+
+    std::atomic<bool> reader_ok{true};
+    std::thread reader([&]() {
+        for (int pass = 0; pass < 50; ++pass) {
+            if (sumX(*before) != before_sum) {
+                reader_ok = false;
+            }
+        }
+    });
+    const size_t edited = TrajectorySnapshot::CHUNK_SIZE + 10;  // 2つ目のチャンク
+    for (int step = 0; step < 20; ++step) {
+        engine.movePoint(edited, 1000.0 + step, 5.0);
+    }
+    reader.join();
+    check(reader_ok, "a reader thread sees a consistent version while editing");
+
+    TrajectorySnapshotPtr after = engine.getSnapshot();
+    check((*before)[edited].x == static_cast<double>(edited) && (*after)[edited].x == 1019.0,
+          "old and new versions hold their own values");
+    check(&before->getChunk(0) == &after->getChunk(0) && &before->getChunk(2) == &after->getChunk(2) &&
+          &before->getChunk(1) != &after->getChunk(1), "only the edited chunk is copied");
+    check(engine.getSnapshot() == after, "no new version without an edit");
+
+    // 自動保存：編集のたびに発行したバージョンを別スレッドが書き出す
+    engine.startAutosave(autosave_path);
+    check(engine.flushAutosave(), "initial autosave: " + engine.getLastError());
+    engine.movePoint(5, -1.0, -1.0);
+    engine.scaleVelocities(0, count - 1, 0.5);
+    check(engine.flushAutosave(), "autosave after edits: " + engine.getLastError());
+    check(engine.getAutosavedRevision() == engine.getData().getRevision(), "autosave reached the latest revision");
+    TrajectoryData saved;
+    check(saved.loadFromBinary(autosave_path) && sameAs(engine.getData().getPoints(), saved),
+          "autosave matches the edited data");
+
+    check(engine.undo() && engine.flushAutosave(), "autosave after undo");
+    check(saved.loadFromBinary(autosave_path) && sameAs(engine.getData().getPoints(), saved),
+          "autosave follows undo");
+
+    // 書けない場所は失敗として報告し、編集は続けられる
+    engine.startAutosave((dir / "missing" / "autosave.trjb").string());
+    check(!engine.flushAutosave() && !engine.getLastError().empty(), "autosave failure is reported");
+    engine.stopAutosave();
+    check(engine.movePoint(0, 1.0, 1.0), "editing continues after autosave stops");
+
+    fs::remove_all(dir);
+
+    return test_check::finish("snapshot", "Snapshots are shared per chunk and autosave follows the edits");
+}
@@ -0,0 +1,498 @@
+#include "src/core/trajectory_data.hpp"
+#include "src/core/track_boundaries.hpp"
+#include "src/core/synthetic_track.hpp"
+#include "src/core/trajectory_geometry.hpp"
+#include "src/core/kinematic_checker.hpp"
+#include "src/core/track_clearance.hpp"
+#include "src/core/segment_index.hpp"
+#include "src/core/trajectory_resampler.hpp"
+#include "src/core/edit_history.hpp"
+#include "src/utils/parallel.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef TRAJECTORY_BENCH_QT
+#include "src/gui/graphics_trajectory_view.hpp"
+#include <QtWidgets/QApplication>
+#endif
+
+namespace {
+
+namespace fs = std::filesystem;
+using namespace trajectory_editor;
+
+constexpr int EXIT_OK = 0;
+constexpr int EXIT_USAGE = 1;
+
+// 出力するJSONの形式（名前やフィールドを変えたら上げる）
+constexpr int RESULT_FORMAT_VERSION = 1;
+
+// 1回の計測でまとめて行う操作の数
+constexpr size_t HIT_TEST_SCAN_QUERIES = 100;      // 全点走査は重いので少なめ
+constexpr size_t HIT_TEST_INDEX_QUERIES = 10000;
+constexpr size_t MOVE_POINT_EDITS = 1000;
+
+// GUIの findNearestPointIndex と同じ探索範囲
+constexpr double HIT_TEST_RANGE = 50.0;
+
+// 最適化で計算が消えないように結果を逃がす先
+volatile double benchmark_sink = 0.0;
+
+void keep(double value) {
+    benchmark_sink = benchmark_sink + value;
+}
+
+// コマンドライン引数（--key value 形式のみ）
+struct Options {
+    std::map<std::string, std::string> values;
+
+    std::string getString(const std::string& key, const std::string& default_value) const {
+        auto it = values.find(key);
+        return it != values.end() ? it->second : default_value;
+    }
+
+    double getDouble(const std::string& key, double default_value) const {
+        auto it = values.find(key);
+        return it != values.end() ? std::stod(it->second) : default_value;
+    }
+};
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0 || i + 1 >= argc) {
+            std::cerr << "Unexpected argument: " << arg << std::endl;
+            return false;
+        }
+        options.values[arg.substr(2)] = argv[++i];
+    }
+    return true;
+}
+
+std::vector<size_t> parseSizes(const std::string& text) {
+    std::vector<size_t> sizes;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        double value = std::stod(item);
+        if (!(value >= 2.0)) {
+            throw std::invalid_argument("sizes must be at least 2: " + item);
+        }
+        sizes.push_back(static_cast<size_t>(value));
+    }
+    return sizes;
+}
+
+// 1つのベンチマークの計測結果
+struct BenchmarkResult {
+    std::string name;          // "<グループ>.<操作>/<点数>"（ビルド間で比較するキー）
+    size_t points = 0;
+    size_t items = 0;          // 1回の計測で処理した要素数（点数・検索回数など）
+    std::vector<double> samples_ns;
+
+    double min() const { return *std::min_element(samples_ns.begin(), samples_ns.end()); }
+    double max() const { return *std::max_element(samples_ns.begin(), samples_ns.end()); }
+    double mean() const {
+        double sum = 0.0;
+        for (double sample : samples_ns) {
+            sum += sample;
+        }
+        return sum / static_cast<double>(samples_ns.size());
+    }
+    double median() const {
+        std::vector<double> sorted = samples_ns;
+        std::sort(sorted.begin(), sorted.end());
+        size_t mid = sorted.size() / 2;
+        return sorted.size() % 2 == 1 ? sorted[mid] : 0.5 * (sorted[mid - 1] + sorted[mid]);
+    }
+};
+
+// 計測の実行と結果の収集
+//
+// setup() は計測の外で毎回呼ぶ（前回の結果を戻すなど）。body() だけを repeat 回計測する。
+// --filter があれば名前（点数を含む）にその文字列を含むものだけを実行する。
+class BenchmarkRunner {
+public:
+    BenchmarkRunner(size_t repeat, std::string filter) : repeat_(repeat), filter_(std::move(filter)) {}
+
+    static std::string makeName(const std::string& operation, size_t points) {
+        return operation + "/" + std::to_string(points);
+    }
+
+    bool enabled(const std::string& operation, size_t points) const {
+        return filter_.empty() || makeName(operation, points).find(filter_) != std::string::npos;
+    }
+
+    template <typename Setup, typename Body>
+    void run(const std::string& operation, size_t points, size_t items, Setup&& setup, Body&& body) {
+        if (!enabled(operation, points)) {
+            return;
+        }
+        BenchmarkResult result;
+        result.name = makeName(operation, points);
+        result.points = points;
+        result.items = items;
+        for (size_t i = 0; i < repeat_; ++i) {
+            setup();
+            auto start = std::chrono::steady_clock::now();
+            body();
+            auto end = std::chrono::steady_clock::now();
+            result.samples_ns.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+        }
+
+        std::cerr << result.name << ": median " << result.median() * 1e-6 << " ms" << std::endl;
+        results_.push_back(std::move(result));
+    }
+
+    template <typename Body>
+    void run(const std::string& operation, size_t points, size_t items, Body&& body) {
+        run(operation, points, items, [] {}, std::forward<Body>(body));
+    }
+
+    const std::vector<BenchmarkResult>& getResults() const { return results_; }
+    size_t getRepeat() const { return repeat_; }
+
+private:
+    size_t repeat_;
+    std::string filter_;
+    std::vector<BenchmarkResult> results_;
+};
+
+// 検索位置（軌跡の点から少し離した位置を決まった順に選ぶ）
+std::vector<std::pair<double, double>> makeQueries(const std::vector<TrajectoryPoint>& points, size_t count) {
+    std::vector<std::pair<double, double>> queries;
+    queries.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const auto& p = points[(i * 7919) % points.size()];
+        double offset = static_cast<double>(i % 11) - 5.0;
+        queries.emplace_back(p.x + offset, p.y - offset);
+    }
+    return queries;
+}
+
+// GUIの findNearestPointIndex と同じ全点走査
+size_t findNearestByScan(const std::vector<TrajectoryPoint>& points, double x, double y) {
+    size_t nearest_index = 0;
+    double min_distance = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < points.size(); ++i) {
+        double dx = x - points[i].x;
+        double dy = y - points[i].y;
+        double distance = std::sqrt(dx * dx + dy * dy);
+        if (distance <= HIT_TEST_RANGE && distance < min_distance) {
+            min_distance = distance;
+            nearest_index = i;
+        }
+    }
+    return nearest_index;
+}
+
+void runSize(BenchmarkRunner& runner, const SyntheticTrackOptions& track_options, const fs::path& tmpdir) {
+    const size_t n = track_options.point_count;
+    SyntheticTrackGenerator generator;
+    generator.setOptions(track_options);
+
+    // 生成
+    runner.run("generate.trajectory", n, n, [&] { keep(generator.generateTrajectory().back().x); });
+    runner.run("generate.boundaries", n, n, [&] {
+        std::vector<BoundaryPoint> left;
+        std::vector<BoundaryPoint> right;
+        generator.generateBoundaries(left, right);
+        keep(left.back().x + right.back().x);
+    });
+
+    TrajectoryData data;
+    data.insertRange(0, generator.generateTrajectory());
+    TrackBoundaries boundaries;
+    {
+        std::vector<BoundaryPoint> left;
+        std::vector<BoundaryPoint> right;
+        generator.generateBoundaries(left, right);
+        boundaries.setLeftBoundary(left);
+        boundaries.setRightBoundary(right);
+    }
+
+    // ファイル入出力
+    const std::string csv_path = (tmpdir / ("trajectory_bench_" + std::to_string(n) + ".csv")).string();
+    const std::string binary_path = (tmpdir / ("trajectory_bench_" + std::to_string(n) + ".trjb")).string();
+    runner.run("io.csv_save", n, n, [&] { keep(data.saveToCSV(csv_path)); });
+    if (runner.enabled("io.csv_load", n)) {
+        data.saveToCSV(csv_path);
+        runner.run("io.csv_load", n, n, [&] {
+            TrajectoryData loaded;
+            keep(loaded.loadFromCSV(csv_path) ? static_cast<double>(loaded.size()) : -1.0);
+        });
+    }
+    runner.run("io.binary_save", n, n, [&] { keep(data.saveToBinary(binary_path)); });
+    if (runner.enabled("io.binary_load", n)) {
+        data.saveToBinary(binary_path);
+        runner.run("io.binary_load", n, n, [&] {
+            TrajectoryData loaded;
+            keep(loaded.loadFromBinary(binary_path) ? static_cast<double>(loaded.size()) : -1.0);
+        });
+    }
+    std::error_code error;
+    fs::remove(csv_path, error);
+    fs::remove(binary_path, error);
+
+    // 範囲・統計
+    runner.run("query.bounds", n, n, [&] {
+        double min_x, max_x, min_y, max_y, min_v, max_v;
+        data.getBounds(min_x, max_x, min_y, max_y);
+        data.getVelocityRange(min_v, max_v);
+        keep(min_x + max_x + min_y + max_y + min_v + max_v);
+    });
+    runner.run("query.geometry_build", n, n, [&] {
+        TrajectoryGeometry geometry;
+        geometry.build(data);
+        keep(geometry.getMaxAbsCurvature());
+    });
+    runner.run("query.kinematics_build", n, n, [&] {
+        KinematicChecker checker;
+        checker.build(data);
+        keep(static_cast<double>(checker.countViolations()));
+    });
+    if (runner.enabled("query.clearance_index", n) || runner.enabled("query.clearance_build", n)) {
+        TrackClearance base_clearance;
+        runner.run("query.clearance_index", n, n, [&] { base_clearance.setBoundaries(boundaries); });
+        base_clearance.setBoundaries(boundaries);
+        runner.run("query.clearance_build", n, n, [&] {
+            TrackClearance clearance = base_clearance;
+            clearance.build(data);
+            keep(clearance.getMinClearance());
+        });
+    }
+
+    // ヒットテスト
+    const auto& points = data.getPoints();
+    auto scan_queries = makeQueries(points, HIT_TEST_SCAN_QUERIES);
+    runner.run("hit_test.point_scan", n, scan_queries.size(), [&] {
+        for (const auto& [x, y] : scan_queries) {
+            keep(static_cast<double>(findNearestByScan(points, x, y)));
+        }
+    });
+    if (runner.enabled("hit_test.segment_index_build", n) || runner.enabled("hit_test.segment_index_query", n)) {
+        SegmentIndex index;
+        runner.run("hit_test.segment_index_build", n, n, [&] { index.build(points); });
+        index.build(points);
+        auto index_queries = makeQueries(points, HIT_TEST_INDEX_QUERIES);
+        runner.run("hit_test.segment_index_query", n, index_queries.size(), [&] {
+            for (const auto& [x, y] : index_queries) {
+                keep(index.findNearest(x, y).distance);
+            }
+        });
+    }
+
+    // 編集コマンド（全点の速度変更・リサンプリングの実行と取り消し、点移動＋差分更新の繰り返し）
+    EditHistory history;
+    if (runner.enabled("edit.set_velocities.execute", n) || runner.enabled("edit.set_velocities.undo", n)) {
+        std::vector<double> old_velocities(n);
+        std::vector<double> new_velocities(n);
+        for (size_t i = 0; i < n; ++i) {
+            old_velocities[i] = points[i].velocity;
+            new_velocities[i] = points[i].velocity * 0.9;
+        }
+        auto makeCommand = [&] {
+            return std::make_unique<SetVelocitiesCommand>(0, old_velocities, new_velocities, "Scale velocities");
+        };
+        runner.run("edit.set_velocities.execute", n, n,
+                   [&] { if (history.canUndo()) history.undo(data); },
+                   [&] { history.executeCommand(makeCommand(), data); });
+        runner.run("edit.set_velocities.undo", n, n,
+                   [&] { if (!history.canUndo()) history.executeCommand(makeCommand(), data); },
+                   [&] { history.undo(data); });
+        history.clear();
+    }
+    if (runner.enabled("edit.splice.execute", n) || runner.enabled("edit.splice.undo", n)) {
+        // 別の軌跡の全点を中央に取り込む（実行は挿入元から直接コピー、取り消しで挿入した行を退避する）
+        TrajectoryData source = data;
+        auto makeCommand = [&] { return std::make_unique<SpliceRangeCommand>(n / 2, source, 0, n - 1); };
+        runner.run("edit.splice.execute", n, n,
+                   [&] {
+                       if (history.canUndo()) history.undo(data);
+                       history.clear();
+                   },
+                   [&] { history.executeCommand(makeCommand(), data); });
+        runner.run("edit.splice.undo", n, n,
+                   [&] { if (!history.canUndo()) history.executeCommand(makeCommand(), data); },
+                   [&] { history.undo(data); });
+        history.clear();
+    }
+    if (runner.enabled("edit.resample.compute", n) || runner.enabled("edit.resample.execute", n) ||
+        runner.enabled("edit.resample.undo", n)) {
+        ResampleOptions resample_options;
+        resample_options.spacing = 0.5 * track_options.spacing;
+        TrajectoryResampler resampler;
+        resampler.setOptions(resample_options);
+        std::vector<TrajectoryPoint> resampled = resampler.resample(data);
+        runner.run("edit.resample.compute", n, n, [&] { keep(resampler.resample(data).back().x); });
+        auto makeCommand = [&] {
+            return std::make_unique<ResampleCommand>(0, data.getRange(0, data.size() - 1), resampled,
+                                                     resample_options.spacing);
+        };
+        // 取り消したコマンドの破棄と次のコマンドの用意（点列のコピー）は計測に含めない
+        std::unique_ptr<EditCommand> pending;
+        runner.run("edit.resample.execute", n, n,
+                   [&] {
+                       if (history.canUndo()) history.undo(data);
+                       history.clear();
+                       pending = makeCommand();
+                   },
+                   [&] { history.executeCommand(std::move(pending), data); });
+        runner.run("edit.resample.undo", n, n,
+                   [&] { if (!history.canUndo()) history.executeCommand(makeCommand(), data); },
+                   [&] { history.undo(data); });
+        if (history.canUndo()) {
+            history.undo(data);
+        }
+        history.clear();
+    }
+    if (runner.enabled("edit.move_point.execute_undo", n)) {
+        TrajectoryGeometry geometry;
+        geometry.build(data);
+        runner.run("edit.move_point.execute_undo", n, MOVE_POINT_EDITS, [&] {
+            for (size_t i = 0; i < MOVE_POINT_EDITS; ++i) {
+                size_t index = (i * 7919) % data.size();
+                const auto& p = data.getPoints()[index];
+                history.executeCommand(std::make_unique<MovePointCommand>(index, p.x, p.y, p.x + 0.5, p.y), data);
+                geometry.update(data);
+                history.undo(data);
+                geometry.update(data);
+            }
+            keep(geometry.getMaxAbsCurvature());
+        });
+        history.clear();
+    }
+
+#ifdef TRAJECTORY_BENCH_QT
+    // シーン構築（境界線と軌跡のアイテムを作り直す。GUIの updateDisplay と同じ処理）
+    if (runner.enabled("scene.build", n)) {
+        GraphicsTrajectoryView view;
+        view.resize(1280, 800);
+        view.setTrackBoundaries(&boundaries);
+        view.setTrajectoryData(&data);
+        runner.run("scene.build", n, n, [&] {
+            view.updateDisplay();
+            QCoreApplication::processEvents();
+        });
+    }
+#endif
+}
+
+void writeJson(std::ostream& out, const BenchmarkRunner& runner, const SyntheticTrackOptions& track_options) {
+    out.precision(17);
+    out << "{\n"
+        << "  \"format_version\": " << RESULT_FORMAT_VERSION << ",\n"
+        << "  \"workers\": " << getWorkerCount() << ",\n"
+        << "  \"repeat\": " << runner.getRepeat() << ",\n"
+        << "  \"seed\": " << track_options.seed << ",\n"
+        << "  \"spacing\": " << track_options.spacing << ",\n"
+#ifdef __VERSION__
+        << "  \"compiler\": \"" << __VERSION__ << "\",\n"
+#endif
+#ifdef NDEBUG
+        << "  \"optimized\": true,\n"
+#else
+        << "  \"optimized\": false,\n"
+#endif
+#ifdef TRAJECTORY_BENCH_QT
+        << "  \"qt\": true,\n"
+#else
+        << "  \"qt\": false,\n"
+#endif
+        << "  \"results\": [";
+
+    const auto& results = runner.getResults();
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& result = results[i];
+        double median = result.median();
+        out << (i == 0 ? "\n" : ",\n")
+            << "    {\"name\": \"" << result.name << "\""
+            << ", \"points\": " << result.points
+            << ", \"items\": " << result.items
+            << ", \"min_ns\": " << result.min()
+            << ", \"median_ns\": " << median
+            << ", \"mean_ns\": " << result.mean()
+            << ", \"max_ns\": " << result.max()
+            << ", \"items_per_second\": " << (median > 0.0 ? static_cast<double>(result.items) * 1e9 / median : 0.0)
+            << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+void printUsage() {
+    std::cout << "Usage: trajectory_bench [options]\n"
+              << "\n"
+              << "Runs the benchmarks on synthetic tracks and writes the results as JSON.\n"
+              << "\n"
+              << "  --sizes <n,n,...>   point counts (default 1000,10000,100000,1000000)\n"
+              << "  --repeat <n>        measurements per benchmark (default 5)\n"
+              << "  --filter <text>     only run benchmarks whose name contains text\n"
+              << "  --output <file>     write JSON here instead of stdout\n"
+              << "  --tmpdir <dir>      directory for the I/O benchmarks (default: system temp)\n"
+              << "  --seed <n>          synthetic track seed (default 1)\n"
+              << "  --spacing <m>       synthetic point spacing (default 1)\n"
+              << "\n"
+              << "Names are <group>.<operation>/<points> and stay stable between builds.\n"
+              << "Progress goes to stderr. 1e8 points need more than 16 GB of memory.\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+#ifdef TRAJECTORY_BENCH_QT
+    // シーン構築はウィンドウを表示せずに測る
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    int qt_argc = 1;
+    QApplication app(qt_argc, argv);
+#endif
+
+    Options options;
+    if (!parseOptions(argc, argv, options) || options.values.count("help")) {
+        printUsage();
+        return EXIT_USAGE;
+    }
+
+    try {
+        std::vector<size_t> sizes = parseSizes(options.getString("sizes", "1000,10000,100000,1000000"));
+        size_t repeat = static_cast<size_t>(std::max(1.0, options.getDouble("repeat", 5.0)));
+        fs::path tmpdir = options.getString("tmpdir", fs::temp_directory_path().string());
+
+        SyntheticTrackOptions track_options;
+        track_options.seed = static_cast<uint64_t>(options.getDouble("seed", 1.0));
+        track_options.spacing = options.getDouble("spacing", track_options.spacing);
+
+        BenchmarkRunner runner(repeat, options.getString("filter", ""));
+        for (size_t size : sizes) {
+            track_options.point_count = size;
+            runSize(runner, track_options, tmpdir);
+        }
+
+        std::string output_path = options.getString("output", "");
+        if (output_path.empty()) {
+            writeJson(std::cout, runner, track_options);
+        } else {
+            std::ofstream file(output_path);
+            if (!file) {
+                std::cerr << "Failed to write: " << output_path << std::endl;
+                return EXIT_USAGE;
+            }
+            writeJson(file, runner, track_options);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_USAGE;
+    }
+    return EXIT_OK;
+}
@@ -0,0 +1,878 @@
+#include "src/core/trajectory_data.hpp"
+#include "src/core/trajectory_geometry.hpp"
+#include "src/core/track_boundaries.hpp"
+#include "src/core/track_clearance.hpp"
+#include "src/core/trajectory_comparison.hpp"
+#include "src/core/kinematic_checker.hpp"
+#include "src/core/trajectory_engine.hpp"
+#include "src/core/trajectory_overlay.hpp"
+#include "src/utils/parallel.hpp"
+#include "src/utils/trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+namespace fs = std::filesystem;
+using trajectory_editor::TrajectoryData;
+using trajectory_editor::TrajectoryPoint;
+
+// 終了コード（バッチ処理でファイルを弾くために使う）
+constexpr int EXIT_OK = 0;
+constexpr int EXIT_USAGE = 1;
+constexpr int EXIT_CHECK_FAILED = 2;
+
+// 1ファイル内の点ごとの処理を並列化する最小のチャンク
+constexpr size_t PARALLEL_CHUNK = 16384;
+
+// コマンドライン引数（--key value 形式のオプションと位置引数）
+struct Options {
+    std::vector<std::string> files;
+    std::map<std::string, std::string> values;
+
+    bool has(const std::string& key) const { return values.count(key) > 0; }
+
+    // 数値として読めない値（"1.5x" のような途中までの数値も含む）は
+    // オプション名を付けた std::invalid_argument を投げる
+    double getDouble(const std::string& key, double default_value) const {
+        auto it = values.find(key);
+        if (it == values.end()) {
+            return default_value;
+        }
+        size_t consumed = 0;
+        double value = 0.0;
+        try {
+            value = std::stod(it->second, &consumed);
+        } catch (const std::exception&) {
+            consumed = 0;
+        }
+        if (consumed == 0 || consumed != it->second.size()) {
+            throw std::invalid_argument("Invalid value for --" + key + ": " + it->second);
+        }
+        return value;
+    }
+
+    std::string getString(const std::string& key, const std::string& default_value) const {
+        auto it = values.find(key);
+        return it != values.end() ? it->second : default_value;
+    }
+};
+
+bool parseOptions(int argc, char* argv[], int first, Options& options) {
+    for (int i = first; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << std::endl;
+                return false;
+            }
+            options.values[arg.substr(2)] = argv[++i];
+        } else {
+            options.files.push_back(arg);
+        }
+    }
+    return true;
+}
+
+// 0以上の整数（符号・小数点・余分な文字は受け付けない）
+bool parseIndex(const std::string& text, size_t& value) {
+    if (text.empty() || text.size() > 12 ||
+        !std::all_of(text.begin(), text.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        return false;
+    }
+    value = static_cast<size_t>(std::stoull(text));
+    return true;
+}
+
+// 1以上の整数
+bool parseCount(const std::string& text, size_t& value) {
+    return parseIndex(text, value) && value >= 1;
+}
+
+bool endsWith(const std::string& str, const std::string& suffix) {
+    return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// 読み込みの失敗・読み飛ばした行を報告する
+bool reportLoad(const std::string& filepath, bool success, const std::string& error, std::ostream& err) {
+    if (!success) {
+        err << "Failed to load trajectory: " << filepath << " (" << error << ")\n";
+    } else if (!error.empty()) {
+        err << "Warning: " << error << "\n";
+    }
+    return success;
+}
+
+bool loadTrajectory(const std::string& filepath, TrajectoryData& data, std::ostream& err) {
+    bool success = endsWith(filepath, ".trjb") ? data.loadFromBinary(filepath) : data.loadFromCSV(filepath);
+    return reportLoad(filepath, success, data.getLastError(), err);
+}
+
+// 複数ファイルの結果をまとめる（読み込み失敗が最優先、次にチェック失敗）
+int mergeResult(int result, int file_result) {
+    if (result == EXIT_USAGE || file_result == EXIT_USAGE) {
+        return EXIT_USAGE;
+    }
+    return std::max(result, file_result);
+}
+
+// ファイルごとの処理 body(index, out, err) を並列に実行する
+//
+// 空いたスレッドが次のファイルを取るので、ファイルの大きさがばらついても偏らない。
+// 各ファイルの出力はためておき、入力の順に出す（実行順によらず同じ出力になる）。
+// 大きいファイルは各処理が点ごとに並列化する（ファイル単位のスレッドとスレッド数を分け合う）。
+// --jobs でファイル単位の並列数を制限できる。
+template <typename Body>
+int runBatch(const Options& options, Body&& body) {
+    const auto& files = options.files;
+    size_t jobs = trajectory_editor::getWorkerCount();
+    if (options.has("jobs") && !parseCount(options.getString("jobs", ""), jobs)) {
+        std::cerr << "--jobs requires an integer >= 1" << std::endl;
+        return EXIT_USAGE;
+    }
+    size_t workers = std::max<size_t>(1, std::min(jobs, files.size()));
+
+    struct FileOutput {
+        std::string out;
+        std::string err;
+        bool done = false;
+    };
+    std::vector<FileOutput> outputs(files.size());
+    std::atomic<size_t> next_file{0};
+    std::mutex output_mutex;
+    size_t next_print = 0;
+    int result = EXIT_OK;
+
+    trajectory_editor::parallelFor(0, workers, 1, [&](size_t begin, size_t end) {
+        for (size_t worker = begin; worker < end; ++worker) {
+            for (size_t i = next_file++; i < files.size(); i = next_file++) {
+                std::ostringstream out;
+                std::ostringstream err;
+                int file_result = EXIT_USAGE;
+                try {
+                    TRACE_ZONE("trajectory_cli file");
+                    file_result = body(i, out, err);
+                } catch (const std::exception& e) {
+                    err << files[i] << ": " << e.what() << "\n";
+                }
+
+                std::lock_guard<std::mutex> lock(output_mutex);
+                result = mergeResult(result, file_result);
+                outputs[i].out = out.str();
+                outputs[i].err = err.str();
+                outputs[i].done = true;
+                for (; next_print < files.size() && outputs[next_print].done; ++next_print) {
+                    std::cerr << outputs[next_print].err;
+                    std::cout << outputs[next_print].out;
+                    outputs[next_print] = FileOutput();
+                    outputs[next_print].done = true;
+                }
+                std::cout.flush();
+            }
+        }
+    });
+    return result;
+}
+
+// 変換結果の書き出し先
+//
+// 入力が1つで --output が既存のディレクトリでも '/' で終わるのでもなければそのファイルへ、
+// それ以外は --output をディレクトリとして同じファイル名で書く（--format csv|binary が
+// あれば拡張子を置き換える）。
+class OutputPaths {
+public:
+    bool init(const Options& options) {
+        output_ = options.getString("output", "");
+        if (output_.empty()) {
+            std::cerr << "This command requires --output <file or directory>" << std::endl;
+            return false;
+        }
+        std::string format = options.getString("format", "");
+        if (format == "csv") {
+            extension_ = ".csv";
+        } else if (format == "binary") {
+            extension_ = ".trjb";
+        } else if (!format.empty()) {
+            std::cerr << "Unknown format: " << format << std::endl;
+            return false;
+        }
+
+        std::error_code error;
+        is_directory_ = options.files.size() > 1 || output_.back() == '/' || fs::is_directory(output_, error);
+        if (is_directory_) {
+            fs::create_directories(output_, error);
+            if (error) {
+                std::cerr << "Failed to create output directory " << output_ << ": " << error.message() << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string get(const std::string& input) const {
+        if (!is_directory_) {
+            return output_;
+        }
+        fs::path name = fs::path(input).filename();
+        if (!extension_.empty()) {
+            name.replace_extension(extension_);
+        }
+        return (fs::path(output_) / name).string();
+    }
+
+private:
+    std::string output_;
+    std::string extension_;
+    bool is_directory_ = false;
+};
+
+// 読み込み → 編集 → 書き出しの共通処理（edit は summary に結果を書き、失敗なら false を返す）
+template <typename Edit>
+int runTransform(const Options& options, Edit&& edit) {
+    OutputPaths outputs;
+    if (!outputs.init(options)) {
+        return EXIT_USAGE;
+    }
+    return runBatch(options, [&](size_t index, std::ostream& out, std::ostream& err) {
+        const std::string& filepath = options.files[index];
+        trajectory_editor::TrajectoryEngine engine;
+        if (!reportLoad(filepath, engine.load(filepath), engine.getLastError(), err)) {
+            return EXIT_USAGE;
+        }
+
+        // 取り消しは使わないので履歴は1件だけ残す
+        engine.setMaxHistorySize(1);
+        std::ostringstream summary;
+        summary << "points=" << engine.size();
+        if (!edit(engine, summary)) {
+            err << filepath << ": " << engine.getLastError() << "\n";
+            return EXIT_USAGE;
+        }
+
+        std::string output_path = outputs.get(filepath);
+        if (!engine.save(output_path)) {
+            err << filepath << ": " << engine.getLastError() << "\n";
+            return EXIT_USAGE;
+        }
+        out << filepath << " -> " << output_path << ": " << summary.str() << "\n";
+        return EXIT_OK;
+    });
+}
+
+// .trjb を読み込まずにメモリマップしたまま編集して書き出す（edit は summary に結果を書き、
+// 失敗なら reason に理由を書いて false を返す）
+//
+// 編集はオーバーレイに持つので、メモリは点数ではなく編集した点数に比例する。
+template <typename Edit>
+int runOverlayTransform(const Options& options, Edit&& edit) {
+    OutputPaths outputs;
+    if (!outputs.init(options)) {
+        return EXIT_USAGE;
+    }
+    return runBatch(options, [&](size_t index, std::ostream& out, std::ostream& err) {
+        const std::string& filepath = options.files[index];
+        trajectory_editor::TrajectoryOverlay overlay;
+        if (!reportLoad(filepath, overlay.openBase(filepath), overlay.getLastError(), err)) {
+            return EXIT_USAGE;
+        }
+
+        std::ostringstream summary;
+        std::ostringstream reason;
+        summary << "points=" << overlay.size();
+        if (!edit(overlay, summary, reason)) {
+            err << filepath << ": " << reason.str() << "\n";
+            return EXIT_USAGE;
+        }
+
+        // 書き出しは一時ファイル経由なので、入力と同じパスに上書きしてもよい
+        std::string output_path = outputs.get(filepath);
+        bool saved = endsWith(output_path, ".trjb") ? overlay.saveToBinary(output_path)
+                                                    : overlay.saveToCSV(output_path);
+        if (!saved) {
+            err << overlay.getLastError() << "\n";
+            return EXIT_USAGE;
+        }
+        out << filepath << " -> " << output_path << ": " << summary.str() << "\n";
+        return EXIT_OK;
+    });
+}
+
+// 曲率・横加速度のチェック
+int runGeometry(const Options& options) {
+    double max_lat_acc = options.getDouble("max-lat-acc", 9.8);
+
+    return runBatch(options, [&](size_t index, std::ostream& out, std::ostream& err) {
+        const std::string& filepath = options.files[index];
+        TrajectoryData data;
+        if (!loadTrajectory(filepath, data, err)) {
+            return EXIT_USAGE;
+        }
+
+        trajectory_editor::TrajectoryGeometry geometry;
+        geometry.build(data);
+
+        size_t curvature_index = 0;
+        size_t lat_acc_index = 0;
+        double max_curvature = geometry.getMaxAbsCurvature(&curvature_index);
+        double max_lateral = geometry.getMaxAbsLateralAcceleration(&lat_acc_index);
+        size_t violations = geometry.countExceeding(max_lat_acc);
+
+        out << filepath << ": points=" << data.size()
+            << " max_curvature=" << max_curvature << " (point " << curvature_index << ")"
+            << " max_lateral_acc=" << max_lateral << " (point " << lat_acc_index << ")"
+            << " over_limit=" << violations << "\n";
+        return violations > 0 ? EXIT_CHECK_FAILED : EXIT_OK;
+    });
+}
+
+bool loadBoundaries(const std::string& boundaries_path, trajectory_editor::TrackBoundaries& boundaries) {
+    if (!boundaries.loadFromFile(boundaries_path) || boundaries.empty()) {
+        std::cerr << "Failed to load track boundaries: " << boundaries_path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// コース境界からのはみ出しチェック
+int runClearance(const Options& options) {
+    std::string boundaries_path = options.getString("boundaries", "data/track_boundaries.csv");
+    trajectory_editor::TrackBoundaries boundaries;
+    if (!loadBoundaries(boundaries_path, boundaries)) {
+        return EXIT_USAGE;
+    }
+
+    // 境界線の索引は1回だけ作り、ファイルごとにコピーして使う
+    trajectory_editor::TrackClearance base_clearance;
+    base_clearance.setBoundaries(boundaries);
+    base_clearance.setMargin(options.getDouble("margin", 0.0));
+
+    return runBatch(options, [&](size_t index, std::ostream& out, std::ostream& err) {
+        const std::string& filepath = options.files[index];
+        TrajectoryData data;
+        if (!loadTrajectory(filepath, data, err)) {
+            return EXIT_USAGE;
+        }
+
+        trajectory_editor::TrackClearance clearance = base_clearance;
+        clearance.build(data);
+        size_t min_index = 0;
+        double min_clearance = clearance.getMinClearance(&min_index);
+        size_t violations = clearance.countViolations();
+
+        out << filepath << ": points=" << data.size()
+            << " min_clearance=" << min_clearance << " (point " << min_index << ")"
+            << " violations=" << violations << "\n";
+        return violations > 0 ? EXIT_CHECK_FAILED : EXIT_OK;
+    });
+}
+
+// 基準軌跡との比較
+int runCompare(const Options& options) {
+    std::string reference_path = options.getString("reference", "");
+    if (reference_path.empty()) {
+        std::cerr << "compare requires --reference <file>" << std::endl;
+        return EXIT_USAGE;
+    }
+    TrajectoryData reference;
+    if (!loadTrajectory(reference_path, reference, std::cerr)) {
+        return EXIT_USAGE;
+    }
+
+    double max_lateral = options.getDouble("max-lateral", -1.0);
+    std::string output_path = options.getString("output", "");
+    if (!output_path.empty() && options.files.size() > 1) {
+        std::cerr << "compare --output takes a single input file" << std::endl;
+        return EXIT_USAGE;
+    }
+
+    return runBatch(options, [&](size_t index, std::ostream& out, std::ostream& err) {
+        const std::string& filepath = options.files[index];
+        TrajectoryData data;
+        if (!loadTrajectory(filepath, data, err)) {
+            return EXIT_USAGE;
+        }
+
+        trajectory_editor::TrajectoryComparison comparison;
+        comparison.build(data, reference);
+        const auto& stats = comparison.getStatistics();
+
+        out << filepath << ": points=" << stats.count
+            << " mean_lateral=" << stats.mean_lateral_offset
+            << " rms_lateral=" << stats.rms_lateral_offset
+            << " max_lateral=" << stats.max_abs_lateral_offset << " (point " << stats.max_lateral_index << ")"
+            << " mean_speed_delta=" << stats.mean_speed_delta
+            << " max_speed_delta=" << stats.max_abs_speed_delta << " (point " << stats.max_speed_delta_index << ")"
+            << " length=" << stats.target_length << "/" << stats.reference_length << "\n";
+
+        // 点ごとの結果（--output は入力が1つのときだけ受け付ける）
+        if (!output_path.empty()) {
+            std::ofstream file(output_path);
+            if (!file) {
+                err << "Failed to write: " << output_path << "\n";
+                return EXIT_USAGE;
+            }
+            file << "index,lateral_offset,arc_length_offset,speed_delta\n";
+            for (size_t i = 0; i < comparison.size(); ++i) {
+                file << i << "," << comparison.getLateralOffsets()[i] << ","
+                     << comparison.getArcLengthOffset(i) << "," << comparison.getSpeedDeltas()[i] << "\n";
+            }
+        }
+
+        return (max_lateral >= 0.0 && stats.max_abs_lateral_offset > max_lateral) ? EXIT_CHECK_FAILED : EXIT_OK;
+    });
+}
+
+// 縦加速度・加加速度のチェック
+int runFeasibility(const Options& options) {
+    trajectory_editor::KinematicLimits limits;
+    limits.max_acceleration = options.getDouble("max-accel", limits.max_acceleration);
+    limits.max_deceleration = options.getDouble("max-decel", limits.max_deceleration);
+    limits.max_jerk = options.getDouble("max-jerk", limits.max_jerk);
+    std::string output_path = options.getString("output", "");
+    if (!output_path.empty() && options.files.size() > 1) {
+        std::cerr << "feasibility --output takes a single input file" << std::endl;
+        return EXIT_USAGE;
+    }
+
+    return runBatch(options, [&](size_t index, std::ostream& out, std::ostream& err) {
+        const std::string& filepath = options.files[index];
+        TrajectoryData data;
+        if (!loadTrajectory(filepath, data, err)) {
+            return EXIT_USAGE;
+        }
+
+        trajectory_editor::KinematicChecker checker;
+        checker.setLimits(limits);
+        checker.build(data);
+        size_t accel_index = 0;
+        size_t decel_index = 0;
+        size_t jerk_index = 0;
+        double max_accel = checker.getMaxAcceleration(&accel_index);
+        double max_decel = checker.getMaxDeceleration(&decel_index);
+        double max_jerk = checker.getMaxAbsJerk(&jerk_index);
+        size_t violations = checker.countViolations();
+
+        out << filepath << ": points=" << data.size()
+            << " max_accel=" << max_accel << " (point " << accel_index << ")"
+            << " max_decel=" << max_decel << " (point " << decel_index << ")"
+            << " max_jerk=" << max_jerk << " (point " << jerk_index << ")"
+            << " violations=" << violations << "\n";
+
+        // 点ごとの結果（--output は入力が1つのときだけ受け付ける）
+        if (!output_path.empty()) {
+            std::ofstream file(output_path);
+            if (!file) {
+                err << "Failed to write: " << output_path << "\n";
+                return EXIT_USAGE;
+            }
+            file << "index,acceleration,jerk,flags\n";
+            for (size_t i = 0; i < checker.size(); ++i) {
+                file << i << "," << checker.getAccelerations()[i] << "," << checker.getJerks()[i] << ","
+                     << static_cast<int>(checker.getViolationFlags()[i]) << "\n";
+            }
+        }
+
+        return violations > 0 ? EXIT_CHECK_FAILED : EXIT_OK;
+    });
+}
+
+// 速度の倍率変更
+int runScale(const Options& options) {
+    double factor = options.getDouble("factor", -1.0);
+    if (!(factor >= 0.0) || !std::isfinite(factor)) {
+        std::cerr << "scale requires --factor <non-negative number>" << std::endl;
+        return EXIT_USAGE;
+    }
+    return runTransform(options, [&](trajectory_editor::TrajectoryEngine& engine, std::ostream&) {
+        return engine.scaleVelocities(0, engine.size() - 1, factor);
+    });
+}
+
+// 速度の上下限
+int runClamp(const Options& options) {
+    if (!options.has("min") && !options.has("max")) {
+        std::cerr << "clamp requires --min <m/s> and/or --max <m/s>" << std::endl;
+        return EXIT_USAGE;
+    }
+    double min_speed = options.getDouble("min", 0.0);
+    double max_speed = options.getDouble("max", std::numeric_limits<double>::infinity());
+    if (min_speed > max_speed) {
+        std::cerr << "clamp requires --min <= --max" << std::endl;
+        return EXIT_USAGE;
+    }
+    return runTransform(options, [&](trajectory_editor::TrajectoryEngine& engine, std::ostream&) {
+        return engine.clampVelocities(0, engine.size() - 1, min_speed, max_speed);
+    });
+}
+
+// 等間隔リサンプリング
+int runResample(const Options& options) {
+    trajectory_editor::ResampleOptions resample_options;
+    resample_options.spacing = options.getDouble("spacing", -1.0);
+    resample_options.alpha = options.getDouble("alpha", resample_options.alpha);
+    if (!(resample_options.spacing > 0.0)) {
+        std::cerr << "resample requires --spacing <m>" << std::endl;
+        return EXIT_USAGE;
+    }
+
+    return runTransform(options, [&](trajectory_editor::TrajectoryEngine& engine, std::ostream& summary) {
+        if (!engine.resample(0, engine.size() - 1, resample_options)) {
+            return false;
+        }
+        summary << " -> " << engine.size();
+        return true;
+    });
+}
+
+// 形式変換（出力の拡張子で決まる。入力がすべて .trjb なら読み込まずにストリームで書き出す）
+int runConvert(const Options& options) {
+    bool all_binary = std::all_of(options.files.begin(), options.files.end(),
+                                  [](const std::string& file) { return endsWith(file, ".trjb"); });
+    if (all_binary) {
+        return runOverlayTransform(options, [](trajectory_editor::TrajectoryOverlay&, std::ostream&, std::ostream&) {
+            return true;
+        });
+    }
+    return runTransform(options, [](trajectory_editor::TrajectoryEngine&, std::ostream&) { return true; });
+}
+
+// .trjb の範囲の置き換え（--at から --remove 点を消し、--insert のファイルの点を入れる）
+int runSplice(const Options& options) {
+    size_t at = 0;
+    size_t remove_count = 0;
+    if (!parseIndex(options.getString("at", ""), at) ||
+        (options.has("remove") && !parseIndex(options.getString("remove", ""), remove_count))) {
+        std::cerr << "splice requires --at <index> and optionally --remove <count> (integers >= 0)" << std::endl;
+        return EXIT_USAGE;
+    }
+    for (const auto& file : options.files) {
+        if (!endsWith(file, ".trjb")) {
+            std::cerr << "splice edits .trjb files only (convert " << file << " first)" << std::endl;
+            return EXIT_USAGE;
+        }
+    }
+
+    // 入れる点は小さい前提で読み込んでおく
+    std::vector<TrajectoryPoint> insert_points;
+    std::string insert_path = options.getString("insert", "");
+    if (!insert_path.empty()) {
+        TrajectoryData insert_data;
+        if (!loadTrajectory(insert_path, insert_data, std::cerr)) {
+            return EXIT_USAGE;
+        }
+        if (insert_data.hasOrientation()) {
+            std::cerr << insert_path << ": cannot splice orientation columns into a .trjb" << std::endl;
+            return EXIT_USAGE;
+        }
+        insert_points = insert_data.getPoints();
+    }
+    if (remove_count == 0 && insert_points.empty()) {
+        std::cerr << "splice requires --remove <count> and/or --insert <file>" << std::endl;
+        return EXIT_USAGE;
+    }
+
+    return runOverlayTransform(options, [&](trajectory_editor::TrajectoryOverlay& overlay, std::ostream& summary,
+                                            std::ostream& reason) {
+        if (at > overlay.size() || remove_count > overlay.size() - at) {
+            reason << "range " << at << "+" << remove_count << " is outside the " << overlay.size() << " points";
+            return false;
+        }
+        overlay.removeRange(at, remove_count);
+        overlay.insertRange(at, insert_points);
+        summary << " -> " << overlay.size() << " (overlay " << overlay.getOverlayMemoryUsage() << " bytes)";
+        return true;
+    });
+}
+
+// 点列の妥当性チェック
+struct ValidationCounts {
+    size_t non_finite = 0;        // x, y, z, 速度のどれかが NaN・無限大
+    size_t negative_speed = 0;
+    size_t duplicates = 0;        // 前の点と同じ位置
+    size_t over_speed = 0;        // --max-speed 超え
+    size_t long_segments = 0;     // --max-spacing より長い区間
+
+    void add(const ValidationCounts& other) {
+        non_finite += other.non_finite;
+        negative_speed += other.negative_speed;
+        duplicates += other.duplicates;
+        over_speed += other.over_speed;
+        long_segments += other.long_segments;
+    }
+    size_t total() const { return non_finite + negative_speed + duplicates + over_speed + long_segments; }
+};
+
+int runValidate(const Options& options) {
+    double max_speed = options.getDouble("max-speed", std::numeric_limits<double>::infinity());
+    double max_spacing = options.getDouble("max-spacing", std::numeric_limits<double>::infinity());
+
+    // 境界線があればはみ出しも調べる
+    bool check_clearance = options.has("boundaries");
+    trajectory_editor::TrackClearance base_clearance;
+    if (check_clearance) {
+        trajectory_editor::TrackBoundaries boundaries;
+        if (!loadBoundaries(options.getString("boundaries", ""), boundaries)) {
+            return EXIT_USAGE;
+        }
+        base_clearance.setBoundaries(boundaries);
+        base_clearance.setMargin(options.getDouble("margin", 0.0));
+    }
+
+    return runBatch(options, [&](size_t index, std::ostream& out, std::ostream& err) {
+        const std::string& filepath = options.files[index];
+        TrajectoryData data;
+        if (!loadTrajectory(filepath, data, err)) {
+            return EXIT_USAGE;
+        }
+
+        const auto& points = data.getPoints();
+        ValidationCounts counts;
+        std::mutex counts_mutex;
+        trajectory_editor::parallelFor(0, points.size(), PARALLEL_CHUNK, [&](size_t begin, size_t end) {
+            ValidationCounts chunk;
+            for (size_t i = begin; i < end; ++i) {
+                const TrajectoryPoint& p = points[i];
+                if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z) || !std::isfinite(p.velocity)) {
+                    ++chunk.non_finite;
+                    continue;
+                }
+                chunk.negative_speed += p.velocity < 0.0 ? 1 : 0;
+                chunk.over_speed += p.velocity > max_speed ? 1 : 0;
+                if (i > 0) {
+                    double length = std::hypot(p.x - points[i - 1].x, p.y - points[i - 1].y);
+                    chunk.duplicates += length == 0.0 ? 1 : 0;
+                    chunk.long_segments += length > max_spacing ? 1 : 0;
+                }
+            }
+            std::lock_guard<std::mutex> lock(counts_mutex);
+            counts.add(chunk);
+        });
+
+        size_t too_few = points.size() < 2 ? 1 : 0;
+        out << filepath << ": points=" << points.size()
+            << " non_finite=" << counts.non_finite
+            << " negative_speed=" << counts.negative_speed
+            << " duplicates=" << counts.duplicates;
+        if (std::isfinite(max_speed)) {
+            out << " over_speed=" << counts.over_speed;
+        }
+        if (std::isfinite(max_spacing)) {
+            out << " long_segments=" << counts.long_segments;
+        }
+
+        size_t violations = 0;
+        if (check_clearance && counts.non_finite == 0 && !too_few) {
+            trajectory_editor::TrackClearance clearance = base_clearance;
+            clearance.build(data);
+            violations = clearance.countViolations();
+            out << " clearance_violations=" << violations;
+        }
+
+        bool valid = too_few == 0 && counts.total() == 0 && violations == 0;
+        out << (valid ? " valid" : " invalid") << "\n";
+        return valid ? EXIT_OK : EXIT_CHECK_FAILED;
+    });
+}
+
+// 同じ添字の点どうしの差分（回帰チェック用。幾何的な比較は compare）
+int runDiff(const Options& options) {
+    std::string reference_path = options.getString("reference", "");
+    if (reference_path.empty()) {
+        std::cerr << "diff requires --reference <file>" << std::endl;
+        return EXIT_USAGE;
+    }
+    TrajectoryData reference;
+    if (!loadTrajectory(reference_path, reference, std::cerr)) {
+        return EXIT_USAGE;
+    }
+    double tolerance = options.getDouble("tolerance", 1e-6);
+    double speed_tolerance = options.getDouble("speed-tolerance", tolerance);
+
+    return runBatch(options, [&](size_t index, std::ostream& out, std::ostream& err) {
+        const std::string& filepath = options.files[index];
+        TrajectoryData data;
+        if (!loadTrajectory(filepath, data, err)) {
+            return EXIT_USAGE;
+        }
+
+        const auto& points = data.getPoints();
+        const auto& reference_points = reference.getPoints();
+        size_t common = std::min(points.size(), reference_points.size());
+
+        struct DiffStats {
+            size_t differing = 0;
+            size_t first = SIZE_MAX;
+            double max_position = 0.0;
+            double max_speed = 0.0;
+        } stats;
+        std::mutex stats_mutex;
+        trajectory_editor::parallelFor(0, common, PARALLEL_CHUNK, [&](size_t begin, size_t end) {
+            DiffStats chunk;
+            for (size_t i = begin; i < end; ++i) {
+                const TrajectoryPoint& a = points[i];
+                const TrajectoryPoint& b = reference_points[i];
+                double position = std::sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y) +
+                                            (a.z - b.z) * (a.z - b.z));
+                double speed = std::abs(a.velocity - b.velocity);
+                chunk.max_position = std::max(chunk.max_position, position);
+                chunk.max_speed = std::max(chunk.max_speed, speed);
+                if (position > tolerance || speed > speed_tolerance) {
+                    ++chunk.differing;
+                    chunk.first = std::min(chunk.first, i);
+                }
+            }
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            stats.differing += chunk.differing;
+            stats.first = std::min(stats.first, chunk.first);
+            stats.max_position = std::max(stats.max_position, chunk.max_position);
+            stats.max_speed = std::max(stats.max_speed, chunk.max_speed);
+        });
+
+        bool same = stats.differing == 0 && points.size() == reference_points.size();
+        out << filepath << ": points=" << points.size() << "/" << reference_points.size()
+            << " differing=" << stats.differing
+            << " max_position_delta=" << stats.max_position
+            << " max_speed_delta=" << stats.max_speed;
+        if (stats.first != SIZE_MAX) {
+            out << " first=" << stats.first;
+        }
+        out << (same ? " same" : " different") << "\n";
+        return same ? EXIT_OK : EXIT_CHECK_FAILED;
+    });
+}
+
+void printUsage() {
+    std::cout << "Usage: trajectory_cli <command> [options] <files...>\n"
+              << "\n"
+              << "Checks:\n"
+              << "  geometry   Report curvature and lateral acceleration\n"
+              << "             --max-lat-acc <m/s^2>  limit for the exit code (default 9.8)\n"
+              << "  clearance  Report the minimum distance to the track boundaries\n"
+              << "             --boundaries <file>    .csv, .trkb or .osm (default data/track_boundaries.csv)\n"
+              << "             --margin <m>           required clearance (default 0)\n"
+              << "  compare    Compare against a reference trajectory\n"
+              << "             --reference <file>     reference trajectory (required)\n"
+              << "             --max-lateral <m>      fail when the lateral offset exceeds this\n"
+              << "             --output <csv>         write per-point offsets (single input only)\n"
+              << "  feasibility  Check longitudinal acceleration and jerk\n"
+              << "             --max-accel <m/s^2>    acceleration limit (default 3)\n"
+              << "             --max-decel <m/s^2>    deceleration limit (default 6)\n"
+              << "             --max-jerk <m/s^3>     jerk limit (default 10)\n"
+              << "             --output <csv>         write per-point acceleration, jerk and flags (single input only)\n"
+              << "  validate   Check for non-finite values, negative speeds and duplicate points\n"
+              << "             --max-speed <m/s>      also count points above this speed\n"
+              << "             --max-spacing <m>      also count segments longer than this\n"
+              << "             --boundaries <file>    also count track boundary violations (--margin <m>)\n"
+              << "  diff       Compare point by point (same index) against a reference\n"
+              << "             --reference <file>     reference trajectory (required)\n"
+              << "             --tolerance <m>        position tolerance (default 1e-6)\n"
+              << "             --speed-tolerance <m/s>  speed tolerance (default: --tolerance)\n"
+              << "\n"
+              << "Transforms (write to --output, a file for one input or a directory):\n"
+              << "  scale      Multiply velocities       --factor <k>\n"
+              << "  clamp      Limit velocities          --min <m/s> --max <m/s>\n"
+              << "  resample   Equal spacing             --spacing <m> [--alpha <0..1>]\n"
+              << "  convert    Change format by the output extension (.csv or .trjb)\n"
+              << "             --format <csv|binary>  extension for directory outputs\n"
+              << "             Files with orientation columns (x_quat..w_quat) cannot be written as .trjb\n"
+              << "             .trjb inputs are streamed without loading them into memory\n"
+              << "  splice     Replace a range of a .trjb without loading it (memory-mapped)\n"
+              << "             --at <index> [--remove <count>] [--insert <file>]\n"
+              << "\n"
+              << "All commands: --jobs <n> files processed in parallel (default: hardware threads)\n"
+              << "              --trace <json>  write a Chrome trace of the run (open in ui.perfetto.dev)\n"
+              << "\n"
+              << "Exit codes: 0 = ok, 1 = usage or load error, 2 = check failed\n";
+}
+
+// コマンドを実行する（不明なコマンド・ファイルなしは使い方を出す）
+int runCommand(const std::string& command, const Options& options) {
+    try {
+        if (command == "geometry" && !options.files.empty()) {
+            return runGeometry(options);
+        }
+        if (command == "clearance" && !options.files.empty()) {
+            return runClearance(options);
+        }
+        if (command == "compare" && !options.files.empty()) {
+            return runCompare(options);
+        }
+        if (command == "feasibility" && !options.files.empty()) {
+            return runFeasibility(options);
+        }
+        if (command == "validate" && !options.files.empty()) {
+            return runValidate(options);
+        }
+        if (command == "diff" && !options.files.empty()) {
+            return runDiff(options);
+        }
+        if (command == "scale" && !options.files.empty()) {
+            return runScale(options);
+        }
+        if (command == "clamp" && !options.files.empty()) {
+            return runClamp(options);
+        }
+        if (command == "resample" && !options.files.empty()) {
+            return runResample(options);
+        }
+        if (command == "convert" && !options.files.empty()) {
+            return runConvert(options);
+        }
+        if (command == "splice" && !options.files.empty()) {
+            return runSplice(options);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_USAGE;
+    }
+
+    printUsage();
+    return EXIT_USAGE;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printUsage();
+        return EXIT_USAGE;
+    }
+
+    std::string command = argv[1];
+    Options options;
+    if (!parseOptions(argc, argv, 2, options)) {
+        return EXIT_USAGE;
+    }
+
+    // --trace: 実行全体を記録して終了時に書き出す
+    std::string trace_path = options.getString("trace", "");
+    if (!trace_path.empty()) {
+        if (!trajectory_editor::TraceRecorder::isAvailable()) {
+            std::cerr << "Warning: built with ENABLE_TRACING=OFF, the trace will be empty" << std::endl;
+        }
+        trajectory_editor::TraceRecorder::setEnabled(true);
+    }
+
+    int result = runCommand(command, options);
+
+    if (!trace_path.empty()) {
+        auto& recorder = trajectory_editor::TraceRecorder::instance();
+        trajectory_editor::TraceRecorder::setEnabled(false);
+        if (!recorder.writeChromeTrace(trace_path)) {
+            std::cerr << "Failed to write trace: " << recorder.getLastError() << std::endl;
+            result = mergeResult(result, EXIT_USAGE);
+        }
+    }
+    return result;
+}